@@ -0,0 +1,80 @@
+// bench/bench_byte_scan.c
+//
+// Reports GB/s for finding the runs of printable text in typical log
+// output (lines of 60-140 bytes), with each scanner the CPU has: the scan
+// alone, stopping at every newline as the append path does, and then the
+// whole append into a tab's text buffer.
+
+#include "x11_render.h"
+#include "byte_scan.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define OUTPUT_BYTES (64 << 20)
+#define SCAN_ROUNDS 8
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static char* make_log(size_t *len) {
+    static const char *levels[] = { "INFO", "DEBUG", "WARN", "INFO", "ERROR" };
+    char *out = malloc(OUTPUT_BYTES + 512);
+    if (!out) exit(1);
+    size_t n = 0;
+    for (int i = 0; n < OUTPUT_BYTES; i++) {
+        n += sprintf(out + n, "2024-05-%02d 12:%02d:%02d.%03d %-5s [worker-%d] request %d handled "
+                     "in %d ms (status=%d, bytes=%d)%s\n",
+                     i % 28 + 1, i / 60 % 60, i % 60, i % 1000, levels[i % 5], i % 16, i,
+                     i % 250, i % 7 ? 200 : 404, i * 37 % 100000,
+                     i % 3 ? "" : " user-agent=\"curl/8.5.0\" path=/api/v1/items");
+    }
+    *len = n;
+    return out;
+}
+
+// Every run in text, the way the append path looks for them
+static size_t scan_all(const char *text, size_t len) {
+    size_t runs = 0;
+    for (size_t i = 0; i < len; i++) {
+        i += byte_scan_text(text + i, len - i);
+        runs++;
+    }
+    return runs;
+}
+
+int main(void) {
+    size_t len;
+    char *out = make_log(&len);
+    printf("%.0f MB of log text, default scanner: %s\n", len / 1048576.0, byte_scan_implementation());
+
+    const char *names[] = { "scalar", "sse2", "avx2" };
+    for (int i = 0; i < 3; i++) {
+        if (byte_scan_select(names[i]) == -1) {
+            printf("%-7s not available\n", names[i]);
+            continue;
+        }
+        size_t runs = 0;
+        double t0 = now_s();
+        for (int r = 0; r < SCAN_ROUNDS; r++) runs += scan_all(out, len);
+        double scan = now_s() - t0;
+
+        TextBuffer *buf = text_buffer_init();
+        if (!buf) return 1;
+        t0 = now_s();
+        for (size_t off = 0; off < len; off += 65536) {
+            text_buffer_append_len(buf, out + off, len - off < 65536 ? len - off : 65536);
+        }
+        double append = now_s() - t0;
+        text_buffer_free(buf);
+
+        printf("%-7s scan %6.2f GB/s (%zu runs)   append %6.2f GB/s\n", names[i],
+               (double)len * SCAN_ROUNDS / scan / 1e9, runs / SCAN_ROUNDS, len / append / 1e9);
+    }
+    free(out);
+    return 0;
+}
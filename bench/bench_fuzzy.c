@@ -0,0 +1,167 @@
+// bench/bench_fuzzy.c
+//
+// Scores a million history entries against search terms of several
+// lengths by longest common substring: "before" with the heap matrix
+// calculate_lcs_length used to allocate for every entry (timed on a tenth
+// of them, it is that slow, and scaled up), then the byte-at-a-time
+// reference, then the bit-parallel matcher. Every score the
+// matcher gives is checked against the reference, here and on random
+// strings over small alphabets (where runs are long); any difference fails
+// the benchmark.
+
+#include "fuzzy_match.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define ENTRIES 1000000
+#define SAMPLE 100000           // Entries the heap matrix is timed on
+#define RANDOM_PAIRS 200000
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// calculate_lcs_length as it was: a row allocated per byte of the term
+static int lcs_heap_matrix(const char *str1, const char *str2) {
+    int len1 = strlen(str1);
+    int len2 = strlen(str2);
+    if (len1 == 0 || len2 == 0) return 0;
+    int **dp = malloc((len1 + 1) * sizeof(int*));
+    if (!dp) return 0;
+    for (int i = 0; i <= len1; i++) {
+        dp[i] = calloc(len2 + 1, sizeof(int));
+        if (!dp[i]) {
+            for (int j = 0; j < i; j++) free(dp[j]);
+            free(dp);
+            return 0;
+        }
+    }
+    int max_length = 0;
+    for (int i = 1; i <= len1; i++) {
+        for (int j = 1; j <= len2; j++) {
+            if (str1[i-1] == str2[j-1]) {
+                dp[i][j] = dp[i-1][j-1] + 1;
+                if (dp[i][j] > max_length) max_length = dp[i][j];
+            } else {
+                dp[i][j] = 0;
+            }
+        }
+    }
+    for (int i = 0; i <= len1; i++) free(dp[i]);
+    free(dp);
+    return max_length;
+}
+
+typedef struct {
+    char *text;                 // The entries, NUL-terminated, back to back
+    size_t *offsets;
+    size_t *lens;
+} History;
+
+static void make_history(History *h) {
+    static const char *forms[] = {
+        "git commit -m \"fix %d: handle empty input in parser\"",
+        "make -j%d bench",
+        "gcc -O2 -Wall -o build/obj_%d.o -c src/module_%d/file.c",
+        "cd ~/projects/service-%d/src",
+        "docker run --rm -it -p %d:80 nginx:latest",
+        "grep -rn \"TODO\" src/ --include=*.c | head -%d",
+        "ssh deploy@10.0.%d.12 'systemctl restart api'",
+        "ls -la /var/log/app-%d",
+    };
+    h->text = malloc((size_t)ENTRIES * 96);
+    h->offsets = malloc(ENTRIES * sizeof(size_t));
+    h->lens = malloc(ENTRIES * sizeof(size_t));
+    if (!h->text || !h->offsets || !h->lens) exit(1);
+    size_t n = 0;
+    for (int i = 0; i < ENTRIES; i++) {
+        int len = sprintf(h->text + n, forms[i * 7 % 8], i % 1000, i % 97);
+        h->offsets[i] = n;
+        h->lens[i] = len;
+        n += len + 1;
+    }
+}
+
+// Scores of the first n entries with one method; returns the sum, for checking
+static long long score_all(const History *h, int n, const char *term, int method, double *seconds) {
+    FuzzyPattern pattern;
+    long long sum = 0;
+    double t0 = now_s();
+    fuzzy_pattern_init(&pattern, term, strlen(term));
+    for (int i = 0; i < n; i++) {
+        const char *entry = h->text + h->offsets[i];
+        if (method == 0) sum += lcs_heap_matrix(term, entry);
+        else if (method == 1) sum += fuzzy_longest_common_reference(term, strlen(term), entry, h->lens[i]);
+        else sum += fuzzy_longest_common(&pattern, entry, h->lens[i]);
+    }
+    *seconds = now_s() - t0;
+    return sum;
+}
+
+static int check_entries(const History *h, const char *term) {
+    FuzzyPattern pattern;
+    fuzzy_pattern_init(&pattern, term, strlen(term));
+    int wrong = 0;
+    for (int i = 0; i < ENTRIES; i++) {
+        const char *entry = h->text + h->offsets[i];
+        wrong += fuzzy_longest_common(&pattern, entry, h->lens[i]) !=
+                 fuzzy_longest_common_reference(term, strlen(term), entry, h->lens[i]);
+    }
+    return wrong;
+}
+
+static int check_random(void) {
+    char a[80], b[160];
+    int wrong = 0;
+    srand(1);
+    for (int p = 0; p < RANDOM_PAIRS; p++) {
+        int alphabet = 1 + p % 4;
+        size_t a_len = 1 + rand() % 70;     // Past FUZZY_MAX_FAST too
+        size_t b_len = rand() % 150;
+        for (size_t i = 0; i < a_len; i++) a[i] = 'a' + rand() % alphabet;
+        for (size_t i = 0; i < b_len; i++) b[i] = 'a' + rand() % alphabet;
+        FuzzyPattern pattern;
+        fuzzy_pattern_init(&pattern, a, a_len);
+        wrong += fuzzy_longest_common(&pattern, b, b_len) !=
+                 fuzzy_longest_common_reference(a, a_len, b, b_len);
+    }
+    return wrong;
+}
+
+int main(void) {
+    History h;
+    make_history(&h);
+
+    static const char *terms[] = {
+        "git",
+        "docker run",
+        "restart the api service on deploy",
+        "gcc -O2 -Wall -o build/obj_12.o -c src/module_12/file.c && ./run",
+    };
+    printf("%d entries\n", ENTRIES);
+    int failed = 0;
+    for (int t = 0; t < 4; t++) {
+        double before, reference, fast;
+        long long s0 = score_all(&h, SAMPLE, terms[t], 0, &before);
+        long long s0_check = score_all(&h, SAMPLE, terms[t], 1, &reference);
+        long long s1 = score_all(&h, ENTRIES, terms[t], 1, &reference);
+        long long s2 = score_all(&h, ENTRIES, terms[t], 2, &fast);
+        int wrong = check_entries(&h, terms[t]) || s0 != s0_check || s1 != s2;
+        printf("term of %2zu bytes: heap matrix %8.1f ms  reference %7.1f ms  bit-parallel %6.1f ms%s\n",
+               strlen(terms[t]), before * 1e3 * ENTRIES / SAMPLE, reference * 1e3, fast * 1e3,
+               wrong ? "  MISMATCH" : "");
+        failed |= wrong;
+    }
+
+    int wrong = check_random();
+    printf("%d random pairs checked against the reference: %d differ\n", RANDOM_PAIRS, wrong);
+
+    free(h.text);
+    free(h.offsets);
+    free(h.lens);
+    return failed || wrong ? 1 : 0;
+}
@@ -0,0 +1,166 @@
+// bench/bench_history.c
+//
+// Measures what saving a command to the history file costs with a full
+// history (MAX_HISTORY_SIZE commands). "before" rewrites the whole file
+// after every command, as the tab manager used to; "after" only appends
+// the command to the journal, which is rewritten in the background once it
+// holds as many commands as are kept. Then reports the memory the commands
+// take, up to a million of them, and how long starting up with a million
+// takes: from the binary file, mapped, and from the same commands as text.
+// Runs in a temporary $HOME.
+
+#include "history_manager.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#define COMMANDS 2000
+#define COMMAND_SIZE 128
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// The history manager logs every command; keep that out of the results
+static int quiet(void) {
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+    dup2(null_fd, STDOUT_FILENO);
+    close(null_fd);
+    return saved;
+}
+
+static void loud(int saved) {
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+}
+
+static void make_command(char *out, size_t size, int i) {
+    snprintf(out, size, "gcc -O2 -Wall -o build/obj_%d.o -c src/module_%d/file_%d.c", i, i % 97, i);
+}
+
+static double run(int rewrite, HistoryManager *hm, int first) {
+    char command[COMMAND_SIZE];
+    int saved = quiet();
+    double t0 = now_us();
+    for (int i = 0; i < COMMANDS; i++) {
+        make_command(command, sizeof(command), first + i);
+        history_manager_add_command(hm, command);
+        if (rewrite) history_manager_save_to_file(hm);
+    }
+    double t = now_us() - t0;
+    loud(saved);
+    return t / COMMANDS;
+}
+
+int main(void) {
+    char home[] = "/tmp/myterm_bench_XXXXXX";
+    if (!mkdtemp(home)) { perror("mkdtemp"); return 1; }
+    setenv("HOME", home, 1);
+
+    int saved = quiet();
+    HistoryManager *hm = history_manager_init();
+    if (!hm) return 1;
+    char command[COMMAND_SIZE];
+    for (int i = 0; i < MAX_HISTORY_SIZE; i++) {
+        make_command(command, sizeof(command), i);
+        history_manager_add_command(hm, command);
+    }
+    history_manager_save_to_file(hm);
+    loud(saved);
+
+    struct stat st;
+    stat(hm->history_file, &st);
+    printf("%d commands in history, %.1f KB file\n", hm->count, st.st_size / 1024.0);
+
+    double before = run(1, hm, MAX_HISTORY_SIZE);
+    printf("before (rewrite)   %8.1f us/command  (%.1f MB written per command)\n",
+           before, st.st_size / 1048576.0);
+
+    // Enough commands to cross the compaction threshold at least once
+    int total = 0;
+    double after = 0;
+    int rounds = hm->limit / COMMANDS + 1;
+    for (int r = 0; r < rounds; r++) {
+        after += run(0, hm, MAX_HISTORY_SIZE + COMMANDS * (r + 1));
+        total += COMMANDS;
+    }
+    printf("after (journal)    %8.1f us/command  (one line written per command)\n", after / rounds);
+
+    saved = quiet();
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s", hm->history_file);
+    history_manager_cleanup(hm);
+    loud(saved);
+    stat(path, &st);
+    printf("  %d commands appended; the file is %.1f KB (rewritten every %d)\n",
+           total, st.st_size / 1024.0, MAX_HISTORY_SIZE);
+
+    unlink(path);
+
+    // Memory: commands used to be 512-byte slots, all MAX_HISTORY_SIZE of
+    // them allocated up front
+    printf("memory (fixed slots) %8.1f KB for any history\n",
+           MAX_HISTORY_SIZE * 512 / 1024.0);
+    static const int sizes[] = { 100, MAX_HISTORY_SIZE, 1000000 };
+    for (int s = 0; s < 3; s++) {
+        history_manager_set_limit(sizes[s]);
+        saved = quiet();
+        hm = history_manager_init();
+        if (!hm) return 1;
+        size_t text = 0;
+        double t0 = now_us();
+        for (int i = 0; i < sizes[s]; i++) {
+            make_command(command, sizeof(command), i);
+            history_manager_add_command(hm, command);
+            text += strlen(command) + 1;
+        }
+        double t = now_us() - t0;
+        size_t memory = history_manager_memory(hm);
+        if (s == 2) history_manager_save_to_file(hm);
+        history_manager_cleanup(hm);
+        loud(saved);
+        printf("memory (arena)     %8d commands: %8.1f KB (%.1f KB of text), %.2f us/add\n",
+               sizes[s], memory / 1024.0, text / 1024.0, t / sizes[s]);
+        if (s < 2) unlink(path);
+    }
+
+    // Startup with the million just saved: binary, then as text
+    char text_path[PATH_MAX + 16];
+    snprintf(text_path, sizeof(text_path), "%s/history.txt", home);
+    const char *formats[] = { "binary (mapped)", "text" };
+    for (int f = 0; f < 2; f++) {
+        saved = quiet();
+        double t0 = now_us();
+        hm = history_manager_init();
+        double startup = now_us() - t0;
+        if (!hm) return 1;
+        // Mapped commands are only read from disk when first used
+        size_t bytes = 0;
+        t0 = now_us();
+        for (int i = 0; i < hm->count; i++) {
+            size_t len;
+            history_manager_get(hm, i, &len);
+            bytes += len;
+        }
+        double first_pass = now_us() - t0;
+        if (f == 0) history_manager_export(hm, text_path);
+        int count = hm->count;
+        history_manager_cleanup(hm);
+        loud(saved);
+        printf("startup (%-15s) %8.2f ms for %d commands, then %.2f ms to read them all\n",
+               formats[f], startup / 1000, count, first_pass / 1000);
+        if (f == 0) rename(text_path, path);
+    }
+    unlink(path);
+    rmdir(home);
+    return 0;
+}
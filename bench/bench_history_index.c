@@ -0,0 +1,262 @@
+// bench/bench_history_index.c
+//
+// Searches two million history commands through the trigram index and
+// without it. Startup maps the history file and builds the index in the
+// background; searches scan until it is built. Then, for each term, the
+// indexed search against two scans of every command: the one fuzzy search
+// used to do, newest first until it had MAX_SEARCH_RESULTS matches (fast
+// when the term is common, all of the history when it is rare), and the one
+// that finds the best matches. Where the index would cost more than it
+// saves, the search falls back to the newest matches for the rest, so its
+// results are checked for what holds either way (each score right, best
+// first, none twice, as many as there are) and any difference there fails
+// the benchmark; whether they are the best scan's is reported. Runs in a
+// temporary $HOME.
+
+#include "history_manager.h"
+#include "fuzzy_match.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+
+#define COMMANDS 2000000
+#define RUNS 20
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// The history manager logs every search; keep that out of the results
+static int quiet(void) {
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+    dup2(null_fd, STDOUT_FILENO);
+    close(null_fd);
+    return saved;
+}
+
+static void loud(int saved) {
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+}
+
+// Writes the history file directly: adding two million commands one by
+// one would journal them all
+static int write_history(const char *path) {
+    static const char *words[] = {
+        "parser", "render", "socket", "config", "deploy", "window", "buffer", "thread",
+        "cache", "event", "input", "shell", "build", "tests", "utils", "proto",
+    };
+    static const char *forms[] = {
+        "git commit -m \"fix %s: handle empty %s\"",
+        "make -j%d %s",
+        "gcc -O2 -Wall -c src/%s/%s_%d.c",
+        "cd ~/projects/%s-%d/%s",
+        "docker run --rm -p %d:80 %s:%s",
+        "grep -rn \"%s\" src/%s | head -%d",
+        "ssh deploy@10.0.%d.12 'systemctl restart %s-%s'",
+        "vim src/%s/%s.c +%d",
+    };
+    size_t capacity = (size_t)COMMANDS * 64;
+    char *text = malloc(capacity);
+    HistoryEntry *entries = malloc(COMMANDS * sizeof(HistoryEntry));
+    if (!text || !entries) return -1;
+    srand(1);
+    size_t len = 0;
+    for (int i = 0; i < COMMANDS; i++) {
+        const char *a = words[rand() % 16], *b = words[rand() % 16];
+        int n = rand() % 10000;
+        int form = rand() % 8;
+        int w;
+        switch (form) {
+        case 1: w = snprintf(text + len, 64, forms[form], n % 64, a); break;
+        case 2: w = snprintf(text + len, 64, forms[form], a, b, n); break;
+        case 3: w = snprintf(text + len, 64, forms[form], a, n, b); break;
+        case 4: w = snprintf(text + len, 64, forms[form], n, a, b); break;
+        case 5: w = snprintf(text + len, 64, forms[form], a, b, n % 100); break;
+        case 6: w = snprintf(text + len, 64, forms[form], n % 256, a, b); break;
+        case 7: w = snprintf(text + len, 64, forms[form], a, b, n); break;
+        default: w = snprintf(text + len, 64, forms[form], a, b); break;
+        }
+        if (w >= 64) w = 63;
+        entries[i] = (HistoryEntry){ len, (uint32_t)w, 0 };
+        len += w + 1;
+    }
+    HistorySegment segment = { entries, COMMANDS, text, len };
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    int result = fd == -1 ? -1 : history_file_write(fd, &segment, 1);
+    if (fd != -1) close(fd);
+    free(text);
+    free(entries);
+    return result;
+}
+
+// The fuzzy search as it was: newest first until max_results match
+static int scan_newest(HistoryManager *hm, const char *term, HistorySearchResult *results,
+                       int max_results) {
+    FuzzyPattern pattern;
+    fuzzy_pattern_init(&pattern, term, strlen(term));
+    int n = 0;
+    for (int i = hm->count - 1; i >= 0 && n < max_results; i--) {
+        size_t len;
+        const char *command = history_manager_get(hm, i, &len);
+        int lcs_len = (int)fuzzy_longest_common(&pattern, command, len);
+        if (lcs_len > 2) results[n++] = (HistorySearchResult){ command, lcs_len, i + 1 };
+    }
+    return n;
+}
+
+// Every command scored, the best kept: what the index should find
+static int scan_best(HistoryManager *hm, const char *term, HistorySearchResult *results,
+                     int max_results) {
+    FuzzyPattern pattern;
+    fuzzy_pattern_init(&pattern, term, strlen(term));
+    int n = 0;
+    for (int i = hm->count - 1; i >= 0; i--) {
+        size_t len;
+        const char *command = history_manager_get(hm, i, &len);
+        int lcs_len = (int)fuzzy_longest_common(&pattern, command, len);
+        if (lcs_len <= 2 || (n == max_results && lcs_len <= results[n - 1].lcs_length)) continue;
+        int at = n < max_results ? n++ : n - 1;
+        while (at > 0 && results[at - 1].lcs_length < lcs_len) {
+            results[at] = results[at - 1];
+            at--;
+        }
+        results[at] = (HistorySearchResult){ command, lcs_len, i + 1 };
+    }
+    return n;
+}
+
+static int scan_exact(HistoryManager *hm, const char *term) {
+    for (int i = hm->count - 1; i >= 0; i--) {
+        if (strcmp(history_manager_get(hm, i, NULL), term) == 0) return i;
+    }
+    return -1;
+}
+
+int main(void) {
+    char home[] = "/tmp/myterm_bench_XXXXXX";
+    if (!mkdtemp(home)) { perror("mkdtemp"); return 1; }
+    setenv("HOME", home, 1);
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/.myterm_history", home);
+    if (write_history(path) == -1) { perror("write history"); return 1; }
+
+    history_manager_set_limit(COMMANDS);
+    int saved = quiet();
+    HistoryManager *hm = history_manager_init();
+    if (!hm) return 1;
+    HistorySearchResult results[MAX_SEARCH_RESULTS];
+    double start = now_us();
+    double t0 = now_us();
+    history_manager_search_fuzzy(hm, "git", results, MAX_SEARCH_RESULTS);
+    double first = now_us() - t0;
+    int building = !hm->index.built;
+    // The index is adopted by the first search after it is built
+    while (!hm->index.built) {
+        usleep(1000);
+        history_manager_search_fuzzy(hm, "git", results, MAX_SEARCH_RESULTS);
+    }
+    double build = now_us() - start;
+    loud(saved);
+    printf("%d commands: first search %.1f ms%s, index built in the background in %.0f ms, %.1f MB\n",
+           hm->count, first / 1000, building ? " (scanning, while it builds)" : "",
+           build / 1000, history_index_memory(&hm->index) / 1048576.0);
+
+    int failed = 0;
+
+    // Exact: a command in the middle, and one that isn't there
+    char present[128];
+    snprintf(present, sizeof(present), "%s", history_manager_get(hm, hm->count / 2, NULL));
+    const char *exact_terms[] = { present, "make -j64 parser" , "git commit -m \"fix nothing\"" };
+    for (int t = 0; t < 3; t++) {
+        char result[128];
+        int found = 0;
+        saved = quiet();
+        t0 = now_us();
+        for (int r = 0; r < RUNS; r++) found = history_manager_search_exact(hm, exact_terms[t], result, sizeof(result));
+        double indexed = (now_us() - t0) / RUNS;
+        loud(saved);
+        t0 = now_us();
+        int idx = scan_exact(hm, exact_terms[t]);
+        double scan = now_us() - t0;
+        int wrong = found != (idx != -1) || (found && strcmp(result, exact_terms[t]) != 0);
+        printf("exact %-44s indexed %8.1f us  scan %8.1f us%s\n",
+               exact_terms[t], indexed, scan, wrong ? "  MISMATCH" : "");
+        failed |= wrong;
+    }
+
+    static const char *terms[] = {
+        "git",
+        "docker run",
+        "systemctl restart",
+        "gcc -c src/render/window_42.c",
+        "tail -f /var/log/syslog",
+        "ssh deploy@10.0.7.12 'systemctl restart shell-cache'",
+    };
+    for (int t = 0; t < 6; t++) {
+        HistorySearchResult expected[MAX_SEARCH_RESULTS];
+        int n = 0;
+        saved = quiet();
+        t0 = now_us();
+        for (int r = 0; r < RUNS; r++) n = history_manager_search_fuzzy(hm, terms[t], results, MAX_SEARCH_RESULTS);
+        double indexed = (now_us() - t0) / RUNS;
+        loud(saved);
+        t0 = now_us();
+        scan_newest(hm, terms[t], expected, MAX_SEARCH_RESULTS);
+        double newest = now_us() - t0;
+        t0 = now_us();
+        int expected_n = scan_best(hm, terms[t], expected, MAX_SEARCH_RESULTS);
+        double best = now_us() - t0;
+        int wrong = n != expected_n;
+        int same = !wrong;
+        FuzzyPattern pattern;
+        fuzzy_pattern_init(&pattern, terms[t], strlen(terms[t]));
+        for (int i = 0; i < n && !wrong; i++) {
+            size_t len;
+            const char *command = history_manager_get(hm, results[i].index - 1, &len);
+            wrong = (int)fuzzy_longest_common(&pattern, command, len) != results[i].lcs_length ||
+                    (i > 0 && results[i].lcs_length > results[i - 1].lcs_length);
+            for (int j = 0; j < i; j++) wrong |= results[j].index == results[i].index;
+            same &= results[i].index == expected[i].index &&
+                    results[i].lcs_length == expected[i].lcs_length;
+        }
+        printf("fuzzy %-52s indexed %8.1f us  newest-first scan %8.1f us  best scan %8.1f us  (best %d%s)%s\n",
+               terms[t], indexed, newest, best, n ? results[0].lcs_length : 0,
+               same ? "" : ", then newest", wrong ? "  MISMATCH" : "");
+        failed |= wrong;
+    }
+
+    // Adding keeps it up to date: the new command is found at once, and
+    // the oldest (dropped) no longer is
+    char oldest[128];
+    snprintf(oldest, sizeof(oldest), "%s", history_manager_get(hm, 0, NULL));
+    saved = quiet();
+    t0 = now_us();
+    history_manager_add_command(hm, "tail -f /var/log/syslog | grep myterm");
+    double add = now_us() - t0;
+    char result[128];
+    int found_new = history_manager_search_exact(hm, "tail -f /var/log/syslog | grep myterm",
+                                                 result, sizeof(result));
+    int found_old = history_manager_search_exact(hm, oldest, result, sizeof(result));
+    int expect_old = scan_exact(hm, oldest) != -1;
+    loud(saved);
+    int wrong = !found_new || found_old != expect_old;
+    printf("add with the index built %.1f us; new command found %d, dropped one found %d%s\n",
+           add, found_new, found_old, wrong ? "  MISMATCH" : "");
+    failed |= wrong;
+
+    saved = quiet();
+    history_manager_cleanup(hm);
+    loud(saved);
+    unlink(path);
+    rmdir(home);
+    return failed;
+}
@@ -0,0 +1,131 @@
+// bench/bench_pipeline_throughput.c
+//
+// Pushes a large file through a pipeline and reports MB/s, for myterm's
+// pipeline engine (pipeline_start + job) and for the same pipeline run by
+// bash. "filter" is `cat F | grep x | wc -l` (throughput of the stages and
+// the pipes between them); "capture" is `cat F | cat` (throughput of
+// draining the last stage into the tab).
+
+#include "pipe_handler.h"
+#include "process_spawn.h"
+#include "signal_handler.h"
+#include "output_capture.h"
+#include "job.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/wait.h>
+
+#define FILE_MB 128
+#define RUNS 3
+
+static FILE *g_report = NULL;
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Output is counted and dropped, like a tab that only keeps its scrollback
+static void discard_output(const char *data, size_t len, void *user_data) {
+    (void)data;
+    *(size_t *)user_data += len;
+}
+
+static void make_input(const char *path) {
+    FILE *fp = fopen(path, "w");
+    if (!fp) { perror("fopen"); exit(1); }
+    char line[128];
+    size_t written = 0;
+    for (long i = 0; written < (size_t)FILE_MB << 20; i++) {
+        int n = snprintf(line, sizeof(line), "%08ld the quick brown fox jumps over the lazy dog %s\n",
+                         i, (i % 10 == 0) ? "x" : "-");
+        fwrite(line, 1, n, fp);
+        written += n;
+    }
+    fclose(fp);
+}
+
+static double run_myterm(const char *command, size_t *out_bytes) {
+    char buf[512];
+    snprintf(buf, sizeof(buf), "%s", command);
+    double start = now_s();
+    Pipeline *pipeline = parse_pipeline(buf);
+    char *output = NULL;
+    *out_bytes = 0;
+    Job *job = pipeline_start(pipeline, command, NULL, discard_output, out_bytes, &output);
+    if (job) {
+        output = job_run_foreground(job, NULL);
+    }
+    free(output);
+    free_pipeline(pipeline);
+    return now_s() - start;
+}
+
+static double run_bash(const char *command, size_t *out_bytes) {
+    int fds[2];
+    if (spawn_pipe(fds) == -1) { perror("pipe"); exit(1); }
+
+    double start = now_s();
+    pid_t pid = fork();
+    if (pid == 0) {
+        dup2(fds[1], STDOUT_FILENO);
+        execlp("bash", "bash", "-c", command, (char *)NULL);
+        _exit(127);
+    }
+    close(fds[1]);
+
+    OutputCapture capture;
+    *out_bytes = 0;
+    output_capture_init(&capture, discard_output, out_bytes);
+    output_capture_drain_fd(&capture, fds[0], NULL);
+    output_capture_flush(&capture);
+    output_capture_free(&capture);
+    close(fds[0]);
+    waitpid(pid, NULL, 0);
+    return now_s() - start;
+}
+
+static void report(const char *label, const char *command,
+                   double (*run)(const char *, size_t *)) {
+    double best = 1e9;
+    size_t out_bytes = 0;
+    for (int i = 0; i < RUNS; i++) {
+        double t = run(command, &out_bytes);
+        if (t < best) best = t;
+    }
+    fprintf(g_report, "%-16s %8.1f MB/s  (%.3f s, %zu bytes out)\n",
+           label, FILE_MB / best, best, out_bytes);
+}
+
+int main(void) {
+    // The job code logs to stdout; report on a private copy of stderr
+    g_report = fdopen(dup(STDERR_FILENO), "w");
+    if (!g_report) return 1;
+    setvbuf(g_report, NULL, _IONBF, 0);
+    if (!freopen("/dev/null", "w", stdout) || !freopen("/dev/null", "w", stderr)) return 1;
+    signal_handler_init();
+
+    char path[] = "/tmp/myterm_bench_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd == -1) { perror("mkstemp"); return 1; }
+    close(fd);
+    make_input(path);
+
+    char filter[256], capture[256];
+    snprintf(filter, sizeof(filter), "cat %s | grep x | wc -l", path);
+    snprintf(capture, sizeof(capture), "cat %s | cat", path);
+
+    fprintf(g_report, "%d MB through a pipeline, best of %d\n", FILE_MB, RUNS);
+    report("filter  myterm", filter, run_myterm);
+    report("filter  bash", filter, run_bash);
+    report("capture myterm", capture, run_myterm);
+    report("capture bash", capture, run_bash);
+
+    unlink(path);
+    return 0;
+}
@@ -0,0 +1,129 @@
+// bench/bench_render_flood.c
+//
+// Time to take in 100 MB of command output (`cat` of a log-like file) into
+// a tab while drawing it. "every chunk" draws after each chunk read from
+// the pipe, as the main loop did before frames were paced; "60 Hz" draws
+// only when the frame clock allows, as the main loop does now. With no X
+// display, drawing is reduced to reading the screenful of lines a frame
+// shows.
+
+#include "x11_render.h"
+#include "frame_clock.h"
+#include "pipe_handler.h"
+#include "signal_handler.h"
+#include "job.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#define FILE_MB 100
+#define SCREEN_LINES 43         // A default-sized window
+
+typedef struct {
+    TextBuffer *buf;
+    FrameClock clock;
+    int draw;                   // 0 = take output in without drawing
+    unsigned long frames;
+} Flood;
+
+static FILE *g_report = NULL;
+static X11Context *g_ctx = NULL;
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void make_input(const char *path) {
+    FILE *fp = fopen(path, "w");
+    if (!fp) { perror("fopen"); exit(1); }
+    char line[128];
+    size_t written = 0;
+    for (long i = 0; written < (size_t)FILE_MB << 20; i++) {
+        int n = snprintf(line, sizeof(line), "[%08ld] worker %ld: processed batch, %ld items ok\n",
+                         i, i % 16, i % 977);
+        fwrite(line, 1, n, fp);
+        written += n;
+    }
+    fclose(fp);
+}
+
+static void draw_frame(Flood *flood) {
+    if (g_ctx) {
+        render_text_buffer(g_ctx, flood->buf);
+        render_present(g_ctx, flood->buf);
+        XFlush(g_ctx->display);
+    } else {
+        int first = flood->buf->line_count - SCREEN_LINES;
+        for (int i = first < 0 ? 0 : first; i < flood->buf->line_count; i++) {
+            size_t len;
+            text_buffer_get_line(flood->buf, i, &len);
+        }
+    }
+    flood->frames++;
+}
+
+// The main loop draws between reads whenever a frame is due
+static void take_output(const char *data, size_t len, void *user_data) {
+    Flood *flood = user_data;
+    text_buffer_append_len(flood->buf, data, len);
+    if (flood->draw && frame_clock_wait_ms(&flood->clock) == 0) {
+        draw_frame(flood);
+        frame_clock_frame_drawn(&flood->clock);
+    }
+}
+
+static void run(const char *label, const char *command, int draw, int fps) {
+    Flood flood = { text_buffer_init(), { 0, 0 }, draw, 0 };
+    if (!flood.buf) exit(1);
+    frame_clock_init(&flood.clock, fps);
+
+    char buf[512];
+    snprintf(buf, sizeof(buf), "%s", command);
+    double start = now_s();
+    Pipeline *pipeline = parse_pipeline(buf);
+    char *output = NULL;
+    Job *job = pipeline_start(pipeline, command, NULL, take_output, &flood, &output);
+    if (job) output = job_run_foreground(job, NULL);
+    if (output) text_buffer_append(flood.buf, output);
+    if (draw) draw_frame(&flood);   // The final state is always shown
+    if (g_ctx) XSync(g_ctx->display, False);
+    double t = now_s() - start;
+
+    fprintf(g_report, "%-12s %6.2f s  %7.1f MB/s  %8lu frames  (%d lines kept)\n",
+            label, t, FILE_MB / t, flood.frames, flood.buf->line_count);
+    free(output);
+    free_pipeline(pipeline);
+    text_buffer_free(flood.buf);
+}
+
+int main(void) {
+    // The job code logs to stdout; report on a private copy of stderr
+    g_report = fdopen(dup(STDERR_FILENO), "w");
+    if (!g_report) return 1;
+    setvbuf(g_report, NULL, _IONBF, 0);
+    if (getenv("DISPLAY")) g_ctx = x11_init("bench_render_flood");
+    if (!freopen("/dev/null", "w", stdout) || !freopen("/dev/null", "w", stderr)) return 1;
+    signal_handler_init();
+
+    char path[] = "/tmp/myterm_bench_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd == -1) { perror("mkstemp"); return 1; }
+    close(fd);
+    make_input(path);
+
+    char command[256];
+    snprintf(command, sizeof(command), "cat %s", path);
+    fprintf(g_report, "%d MB of output into a tab, %s\n", FILE_MB,
+            g_ctx ? "drawn to an X window" : "no X display (frames read a screenful)");
+    run("not drawn", command, 0, 0);
+    run("every chunk", command, 1, 0);
+    run("60 Hz", command, 1, FRAME_CLOCK_DEFAULT_FPS);
+
+    unlink(path);
+    if (g_ctx) x11_cleanup(g_ctx);
+    return 0;
+}
@@ -0,0 +1,143 @@
+// bench/bench_scrollback.c
+//
+// Floods a tab's text buffer with output and reports lines/s and memory.
+// "before" reproduces the old fixed grid (char[10000][256], one 2.5 MB
+// memmove per line once it is full); "after" is the TextBuffer on top of
+// the scrollback ring. "unlimited" keeps every line, compressing old output
+// and spilling it to a temporary file, and then reads screenfuls from the
+// top and the middle.
+
+#include "x11_render.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define GRID_LINES 10000
+#define GRID_LINE_LENGTH 256
+#define BEFORE_LINES 15000     // The grid is too slow for more
+#define AFTER_LINES 2000000
+#define SCREEN_LINES 50
+
+typedef struct {
+    char lines[GRID_LINES][GRID_LINE_LENGTH];
+    int line_count, cursor_line, cursor_col;
+} Grid;
+
+static void grid_append(Grid *g, const char *text, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        if (text[i] == '\n' || g->cursor_col >= GRID_LINE_LENGTH - 1) {
+            g->cursor_line++;
+            g->cursor_col = 0;
+            if (g->cursor_line >= GRID_LINES) {
+                memmove(g->lines[0], g->lines[1], (GRID_LINES - 1) * GRID_LINE_LENGTH);
+                memset(g->lines[GRID_LINES - 1], 0, GRID_LINE_LENGTH);
+                g->cursor_line = GRID_LINES - 1;
+            }
+            if (g->cursor_line >= g->line_count) g->line_count = g->cursor_line + 1;
+        } else {
+            g->lines[g->cursor_line][g->cursor_col++] = text[i];
+        }
+    }
+}
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Output arrives in pipe-sized chunks, as from a job
+static char* make_output(int lines, size_t *len) {
+    char *out = malloc((size_t)lines * 80);
+    if (!out) exit(1);
+    size_t n = 0;
+    for (int i = 0; i < lines; i++) {
+        n += sprintf(out + n, "src/file_%06d.c:%d: warning: unused variable 'x%d'\n", i, i % 977, i);
+    }
+    *len = n;
+    return out;
+}
+
+static void feed(void (*append)(void *, const char *, size_t), void *target,
+                 const char *out, size_t len) {
+    for (size_t off = 0; off < len; off += 65536) {
+        size_t n = len - off < 65536 ? len - off : 65536;
+        append(target, out + off, n);
+    }
+}
+
+static void append_grid(void *target, const char *text, size_t len) {
+    grid_append((Grid *)target, text, len);
+}
+
+static void append_buffer(void *target, const char *text, size_t len) {
+    text_buffer_append_len((TextBuffer *)target, text, len);
+}
+
+int main(void) {
+    size_t len;
+    char *out = make_output(BEFORE_LINES, &len);
+    Grid *grid = calloc(1, sizeof(Grid));
+    if (!grid) return 1;
+    double t0 = now_s();
+    feed(append_grid, grid, out, len);
+    double t = now_s() - t0;
+    printf("before (fixed grid)  %9.0f lines/s  %6.1f MB held  (%d lines)\n",
+           BEFORE_LINES / t, sizeof(Grid) / 1048576.0, BEFORE_LINES);
+    free(grid);
+    free(out);
+
+    out = make_output(AFTER_LINES, &len);
+    TextBuffer *buf = text_buffer_init();
+    if (!buf) return 1;
+    t0 = now_s();
+    feed(append_buffer, buf, out, len);
+    t = now_s() - t0;
+    printf("after  (scrollback)  %9.0f lines/s  %6.1f MB held  (%d lines, %d kept)\n",
+           AFTER_LINES / t, scrollback_memory(&buf->scrollback) / 1048576.0,
+           AFTER_LINES, buf->line_count);
+
+    text_buffer_set_scrollback_lines(0);
+    TextBuffer *all = text_buffer_init();
+    if (!all) return 1;
+    t0 = now_s();
+    feed(append_buffer, all, out, len);
+    t = now_s() - t0;
+    printf("unlimited            %9.0f lines/s  %6.1f MB held  (%d lines, %.1f MB spilled)\n",
+           AFTER_LINES / t, scrollback_memory(&all->scrollback) / 1048576.0,
+           all->line_count, scrollback_spilled_bytes(&all->scrollback) / 1048576.0);
+
+    // Finished blocks are collected as the buffer is appended to; no event loop needed
+    ScrollbackStats stats;
+    scrollback_get_stats(&all->scrollback, &stats);
+    printf("  compressed %.1f MB -> %.1f MB (%.1fx), %.1f MB of output held\n",
+           stats.packed_input / 1048576.0, stats.packed_output / 1048576.0,
+           stats.packed_output ? (double)stats.packed_input / stats.packed_output : 0.0,
+           stats.bytes / 1048576.0);
+
+    // Scroll to the top, then halfway back down: one screenful each
+    int tops[] = { 0, all->line_count / 2 };
+    for (int i = 0; i < 2; i++) {
+        size_t bytes = 0, line_len;
+        t0 = now_s();
+        for (int j = 0; j < SCREEN_LINES; j++) {
+            if (text_buffer_get_line(all, tops[i] + j, &line_len)) bytes += line_len;
+        }
+        t = now_s() - t0;
+        printf("  screenful at %-7d %6.1f us  (%zu bytes)\n", tops[i], t * 1e6, bytes);
+    }
+    text_buffer_free(all);
+    text_buffer_set_scrollback_lines(MAX_LINES);
+
+    // An idle tab with a few lines in it
+    TextBuffer *small = text_buffer_init();
+    text_buffer_append(small, "$ ls\nMakefile  README.md  src\n");
+    printf("small tab            %6.1f KB held (was %.1f MB)\n",
+           scrollback_memory(&small->scrollback) / 1024.0, sizeof(Grid) / 1048576.0);
+
+    text_buffer_free(small);
+    text_buffer_free(buf);
+    free(out);
+    return 0;
+}
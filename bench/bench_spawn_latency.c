@@ -0,0 +1,119 @@
+// bench/bench_spawn_latency.c
+//
+// Measures how long it takes to start `true` and reap it, from a process
+// holding the GUI's real per-tab state (TextBuffer, LineEdit, ProcessManager)
+// plus the shared HistoryManager. fork() has to copy the page tables for all
+// of it, so its cost grows with every open tab; posix_spawn does not. The
+// zygote helper is forked before any tab exists and forks from its own
+// small address space. Foreground commands run on a pseudo-terminal, in a
+// session of their own, so each way is also timed like that: a fresh pty
+// per command (opened outside the timing), as the tabs do.
+
+#include "tab_manager.h"
+#include "process_spawn.h"
+#include "signal_handler.h"
+#include "zygote.h"
+#include "pseudo_terminal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/wait.h>
+
+#define ITERATIONS 500
+
+static FILE *g_report = NULL;
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void measure(const char *label, SpawnMode mode, int devnull, int pty) {
+    static double samples[ITERATIONS];
+    char *argv[] = { "true", NULL };
+
+    SpawnRequest req;
+    spawn_request_init(&req);
+    req.stdout_fd = devnull;
+    req.stderr_fd = devnull;
+    spawn_set_mode(mode);
+
+    for (int i = 0; i < ITERATIONS; i++) {
+        int master = -1, slave = -1;
+        if (pty) {
+            if (pty_open(&master, &slave) == -1) exit(1);
+            req.stdin_fd = req.stdout_fd = req.stderr_fd = slave;
+            req.new_session = 1;
+        }
+        double t0 = now_us();
+        pid_t pid = spawn_process(argv, &req);
+        if (pid == -1) {
+            perror("spawn_process");
+            exit(1);
+        }
+        spawn_waitpid(pid, NULL, 0);
+        samples[i] = now_us() - t0;
+        if (pty) {
+            close(slave);
+            close(master);
+        }
+    }
+
+    qsort(samples, ITERATIONS, sizeof(double), compare_double);
+    double sum = 0;
+    for (int i = 0; i < ITERATIONS; i++) sum += samples[i];
+    fprintf(g_report, "%-26s mean %8.1f us  p50 %8.1f us  p99 %8.1f us\n",
+            label, sum / ITERATIONS, samples[ITERATIONS / 2], samples[(ITERATIONS * 99) / 100]);
+}
+
+static void measure_both(int tabs, int devnull) {
+    char label[64];
+    for (int pty = 0; pty < 2; pty++) {
+        const char *on = pty ? "pty  " : "";
+        snprintf(label, sizeof(label), "%2d tab%s  %sfork + exec", tabs, tabs == 1 ? " " : "s", on);
+        measure(label, SPAWN_MODE_FORK, devnull, pty);
+        snprintf(label, sizeof(label), "%2d tab%s  %sposix_spawn", tabs, tabs == 1 ? " " : "s", on);
+        measure(label, SPAWN_MODE_POSIX_SPAWN, devnull, pty);
+        if (zygote_is_running()) {
+            snprintf(label, sizeof(label), "%2d tab%s  %szygote", tabs, tabs == 1 ? " " : "s", on);
+            measure(label, SPAWN_MODE_ZYGOTE, devnull, pty);
+        }
+    }
+}
+
+int main(void) {
+    // Tab setup logs to stdout/stderr; report on a private copy of stderr
+    g_report = fdopen(dup(STDERR_FILENO), "w");
+    if (!g_report) return 1;
+    setvbuf(g_report, NULL, _IONBF, 0);
+    if (!freopen("/dev/null", "w", stdout) || !freopen("/dev/null", "w", stderr)) return 1;
+    signal_handler_init();
+    zygote_start();   // Before the tabs exist, as in main()
+
+    int devnull = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    if (devnull == -1) return 1;
+
+    fprintf(g_report, "spawn + reap `true` x %d\n", ITERATIONS);
+
+    TabManager *mgr = tab_manager_init();   // Opens the first tab
+    if (!mgr) return 1;
+    measure_both(mgr->num_tabs, devnull);
+
+    while (mgr->num_tabs < 10 && tab_manager_create_tab(mgr) != -1) {
+    }
+    measure_both(mgr->num_tabs, devnull);
+
+    tab_manager_cleanup(mgr);
+    zygote_stop();
+    close(devnull);
+    return 0;
+}
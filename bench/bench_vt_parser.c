@@ -0,0 +1,117 @@
+// bench/bench_vt_parser.c
+//
+// Measures the escape sequence parser in MB/s: on its own with callbacks
+// that do nothing, then through a tab's text buffer, for plain lines (as
+// from a pipe), plain lines ending in "\r\n" (as from a pty), and output
+// with a colour change every few words (ls --color, gcc, grep). "raw" is
+// the bytes going straight into the scrollback, as before there was a parser.
+
+#include "x11_render.h"
+#include "vt_parser.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define OUTPUT_BYTES (64 << 20)
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static char* make_output(const char *format, size_t *len) {
+    char *out = malloc(OUTPUT_BYTES + 256);
+    if (!out) exit(1);
+    size_t n = 0;
+    for (int i = 0; n < OUTPUT_BYTES; i++) {
+        n += sprintf(out + n, format, i, i % 977, i);
+    }
+    *len = n;
+    return out;
+}
+
+static void feed(void (*append)(void *, const char *, size_t), void *target,
+                 const char *out, size_t len) {
+    for (size_t off = 0; off < len; off += 65536) {
+        size_t n = len - off < 65536 ? len - off : 65536;
+        append(target, out + off, n);
+    }
+}
+
+static size_t g_printed;
+
+static void count_print(void *user_data, const char *text, size_t len) {
+    (void)user_data; (void)text;
+    g_printed += len;
+}
+static void ignore_execute(void *user_data, unsigned char c) { (void)user_data; (void)c; }
+static void ignore_csi(void *user_data, const VtParser *parser, unsigned char final) {
+    (void)user_data; (void)parser; (void)final;
+}
+
+static const VtHandler g_counting = {
+    .print = count_print,
+    .execute = ignore_execute,
+    .csi_dispatch = ignore_csi,
+    .esc_dispatch = ignore_csi,
+};
+
+static void append_parser(void *target, const char *text, size_t len) {
+    vt_parser_feed((VtParser *)target, text, len);
+}
+
+static void append_scrollback(void *target, const char *text, size_t len) {
+    scrollback_append((Scrollback *)target, text, len);
+}
+
+static void append_buffer(void *target, const char *text, size_t len) {
+    text_buffer_append_len((TextBuffer *)target, text, len);
+}
+
+static void report(const char *name, size_t len, double t) {
+    printf("%-24s %8.0f MB/s\n", name, len / t / 1048576.0);
+}
+
+int main(void) {
+    static const char *plain = "src/file_%06d.c:%d: warning: unused variable 'x%d'\n";
+    static const char *pty = "src/file_%06d.c:%d: warning: unused variable 'x%d'\r\n";
+    static const char *colored = "\x1b[01m\x1b[Ksrc/file_%06d.c:%d:\x1b[m\x1b[K \x1b[01;35m\x1b[Kwarning:"
+                                 "\x1b[m\x1b[K unused variable '\x1b[01m\x1b[Kx%d\x1b[m\x1b[K'\r\n";
+    const char *names[] = { "plain", "pty", "colored" };
+    const char *formats[] = { plain, pty, colored };
+
+    for (int i = 0; i < 3; i++) {
+        size_t len;
+        char *out = make_output(formats[i], &len);
+        char name[64];
+
+        VtParser parser;
+        vt_parser_init(&parser, &g_counting, NULL);
+        g_printed = 0;
+        double t0 = now_s();
+        feed(append_parser, &parser, out, len);
+        snprintf(name, sizeof(name), "%s: parser only", names[i]);
+        report(name, len, now_s() - t0);
+
+        Scrollback sb;
+        if (scrollback_init(&sb, MAX_LINES) == -1) return 1;
+        t0 = now_s();
+        feed(append_scrollback, &sb, out, len);
+        snprintf(name, sizeof(name), "%s: raw", names[i]);
+        report(name, len, now_s() - t0);
+        scrollback_free(&sb);
+
+        TextBuffer *buf = text_buffer_init();
+        if (!buf) return 1;
+        t0 = now_s();
+        feed(append_buffer, buf, out, len);
+        snprintf(name, sizeof(name), "%s: text buffer", names[i]);
+        report(name, len, now_s() - t0);
+        printf("  %zu bytes printed, %zu attribute runs kept\n", g_printed, buf->attrs.count);
+        text_buffer_free(buf);
+        free(out);
+    }
+    return 0;
+}
@@ -0,0 +1,137 @@
+// bench/bench_wait_latency.c
+//
+// Measures how long `true` takes to run through the foreground command path.
+// "before" reproduces the old wait loop (non-blocking read, waitpid(WNOHANG),
+// usleep(10000)); "after" goes through execute_command_with_signals, which
+// sleeps in poll() on the output pipe and the SIGCHLD wakeup pipe. `true` is
+// a builtin now, so those run the binary by path; "builtin" is the plain
+// `true`, which runs without a child process at all.
+
+#include "command_exec.h"
+#include "signal_handler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#define ITERATIONS 200
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static double cpu_us(void) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1e6 +
+           ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+}
+
+// The wait loop as it was before the poll-driven waiter
+static void run_true_sleep_poll(void) {
+    int output_pipe[2];
+    if (pipe(output_pipe) == -1) { perror("pipe"); exit(1); }
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(output_pipe[0]);
+        dup2(output_pipe[1], STDOUT_FILENO);
+        close(output_pipe[1]);
+        execl("/usr/bin/true", "true", (char *)NULL);
+        _exit(127);
+    }
+    close(output_pipe[1]);
+    fcntl(output_pipe[0], F_SETFL, O_NONBLOCK);
+
+    int exited = 0;
+    while (!exited) {
+        char buffer[256];
+        ssize_t ignored = read(output_pipe[0], buffer, sizeof(buffer));
+        (void)ignored;
+        int status;
+        if (waitpid(pid, &status, WNOHANG) == pid) {
+            exited = 1;
+        }
+        usleep(10000);
+    }
+    close(output_pipe[0]);
+}
+
+static void run_true_poll_waiter(ProcessManager *pm, const char *command) {
+    char cmd_str[64];
+    snprintf(cmd_str, sizeof(cmd_str), "%s", command);
+    Command cmd;
+    RedirectInfo redir;
+    init_redirect_info(&redir);
+    parse_redirections(cmd_str, &redir);
+    parse_command(redir.clean_command, &cmd);
+
+    char *output = execute_command_with_signals(&cmd, &redir, pm, command, NULL, NULL, NULL);
+    free(output);
+
+    free_command(&cmd);
+    cleanup_redirect_info(&redir);
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static FILE *g_report = NULL;
+
+static void report(const char *label, double *samples, int n, double cpu) {
+    qsort(samples, n, sizeof(double), compare_double);
+    double sum = 0;
+    for (int i = 0; i < n; i++) sum += samples[i];
+    fprintf(g_report, "%-22s mean %8.1f us  p50 %8.1f us  p99 %8.1f us  cpu/cmd %6.1f us\n",
+            label, sum / n, samples[n / 2], samples[(n * 99) / 100], cpu / n);
+}
+
+int main(void) {
+    // The exec path logs heavily to stdout/stderr; report on a private copy of stderr
+    g_report = fdopen(dup(STDERR_FILENO), "w");
+    if (!g_report) return 1;
+    setvbuf(g_report, NULL, _IONBF, 0);
+    if (!freopen("/dev/null", "w", stdout) || !freopen("/dev/null", "w", stderr)) return 1;
+    signal_handler_init();
+
+    ProcessManager *pm = process_manager_init();
+    double samples[ITERATIONS];
+
+    fprintf(g_report, "`true` x %d through the foreground wait loop\n", ITERATIONS);
+
+    double cpu_start = cpu_us();
+    for (int i = 0; i < ITERATIONS; i++) {
+        double t0 = now_us();
+        run_true_sleep_poll();
+        samples[i] = now_us() - t0;
+    }
+    report("before (usleep 10ms)", samples, ITERATIONS, cpu_us() - cpu_start);
+
+    cpu_start = cpu_us();
+    for (int i = 0; i < ITERATIONS; i++) {
+        double t0 = now_us();
+        run_true_poll_waiter(pm, "/usr/bin/true");
+        samples[i] = now_us() - t0;
+    }
+    report("after (poll + SIGCHLD)", samples, ITERATIONS, cpu_us() - cpu_start);
+
+    cpu_start = cpu_us();
+    for (int i = 0; i < ITERATIONS; i++) {
+        double t0 = now_us();
+        run_true_poll_waiter(pm, "true");
+        samples[i] = now_us() - t0;
+    }
+    report("builtin (no fork)", samples, ITERATIONS, cpu_us() - cpu_start);
+
+    process_manager_cleanup(pm);
+    return 0;
+}
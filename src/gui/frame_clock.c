@@ -0,0 +1,25 @@
+// src/gui/frame_clock.c
+#include "frame_clock.h"
+#include <time.h>
+
+static long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+void frame_clock_init(FrameClock *clock, int fps) {
+    clock->interval_ms = fps > 0 ? (1000 + fps - 1) / fps : 0;
+    clock->last_frame_ms = 0;
+}
+
+int frame_clock_wait_ms(const FrameClock *clock) {
+    if (clock->interval_ms == 0) return 0;
+    long long elapsed = now_ms() - clock->last_frame_ms;
+    if (elapsed < 0 || elapsed >= clock->interval_ms) return 0;
+    return (int)(clock->interval_ms - elapsed);
+}
+
+void frame_clock_frame_drawn(FrameClock *clock) {
+    clock->last_frame_ms = now_ms();
+}
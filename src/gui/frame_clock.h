@@ -0,0 +1,35 @@
+// src/gui/frame_clock.h
+#ifndef FRAME_CLOCK_H
+#define FRAME_CLOCK_H
+
+// Paces drawing to a frame rate. Output is taken in as fast as it arrives,
+// but a frame is drawn at most once per interval, showing whatever the
+// buffer holds by then; lines that scrolled past in between are never
+// drawn at all. The first change after an idle spell is drawn right away.
+
+#define FRAME_CLOCK_DEFAULT_FPS 60
+
+typedef struct {
+    int interval_ms;            // 0 = draw after every change
+    long long last_frame_ms;    // When the last frame was drawn
+} FrameClock;
+
+/**
+ * @brief Set up a clock
+ * @param clock Clock
+ * @param fps Frames per second at most, 0 for no limit
+ */
+void frame_clock_init(FrameClock *clock, int fps);
+
+/**
+ * @brief How long until the next frame may be drawn
+ * @return 0 if it may be drawn now, otherwise milliseconds to wait
+ */
+int frame_clock_wait_ms(const FrameClock *clock);
+
+/**
+ * @brief Record that a frame was just drawn
+ */
+void frame_clock_frame_drawn(FrameClock *clock);
+
+#endif // FRAME_CLOCK_H
@@ -0,0 +1,813 @@
+// src/gui/scrollback.c
+#define _GNU_SOURCE   // O_TMPFILE, memfd_create(), FALLOC_FL_PUNCH_HOLE
+
+#include "scrollback.h"
+#include "../utils/lz_block.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define CHUNK SCROLLBACK_CHUNK_SIZE
+#define STRIDE SCROLLBACK_INDEX_STRIDE
+#define INITIAL_LINES 64
+#define INITIAL_CHUNKS 4
+#define INITIAL_INDEX 64
+#define INITIAL_TAIL_SIZE 1024
+#define NOT_SPILLED UINT64_MAX
+#define UNUSED_SLOT UINT64_MAX
+
+// Blocks must come out at least this much smaller to be kept compressed
+#define MIN_SAVING (CHUNK / 16)
+
+static ScrollbackLine* line_at(const Scrollback *sb, uint64_t n) {
+    return &sb->lines[n & (sb->line_capacity - 1)];
+}
+
+static ScrollbackChunk* chunk_at(const Scrollback *sb, uint64_t n) {
+    return &sb->chunks[n & (sb->chunk_capacity - 1)];
+}
+
+// Offset of line k * STRIDE
+static uint64_t index_entry(const Scrollback *sb, uint64_t k) {
+    return sb->index[sb->index_head + (k - sb->index_first)];
+}
+
+static void collect(Scrollback *sb);
+static void cancel_jobs(Scrollback *sb);
+
+int scrollback_init(Scrollback *sb, size_t max_lines) {
+    memset(sb, 0, sizeof(Scrollback));
+    sb->max_lines = max_lines;
+    sb->spill_fd = -1;
+    for (int i = 0; i < SCROLLBACK_CACHE_BLOCKS; i++) sb->cache[i].chunk = UNUSED_SLOT;
+
+    sb->line_capacity = INITIAL_LINES;
+    sb->lines = calloc(sb->line_capacity, sizeof(ScrollbackLine));
+    sb->chunk_capacity = INITIAL_CHUNKS;
+    sb->chunks = calloc(sb->chunk_capacity, sizeof(ScrollbackChunk));
+    sb->index_capacity = INITIAL_INDEX;
+    sb->index = malloc(sb->index_capacity * sizeof(uint64_t));
+    if (!sb->lines || !sb->chunks || !sb->index) {
+        perror("calloc Scrollback");
+        scrollback_free(sb);
+        return -1;
+    }
+
+    // Line 0, the current line, is empty and starts at offset 0
+    sb->end_line = 1;
+    sb->num_recent = 1;
+    sb->index[0] = 0;
+    sb->index_count = 1;
+    return 0;
+}
+
+void scrollback_free(Scrollback *sb) {
+    if (!sb) return;
+    if (sb->pending > 0) cancel_jobs(sb);
+    if (sb->chunks) {
+        for (size_t i = 0; i < sb->num_chunks; i++) {
+            ScrollbackChunk *chunk = chunk_at(sb, sb->released + i);
+            free(chunk->raw);
+            free(chunk->packed);
+        }
+    }
+    for (int i = 0; i < SCROLLBACK_CACHE_BLOCKS; i++) free(sb->cache[i].data);
+    if (sb->spill_fd != -1) close(sb->spill_fd);
+    free(sb->chunks);
+    free(sb->lines);
+    free(sb->index);
+    free(sb->scratch);
+    memset(sb, 0, sizeof(Scrollback));
+    sb->spill_fd = -1;
+}
+
+// ---- Compressor thread ----
+//
+// One thread compresses full chunks for every scrollback. Results wait on
+// a list until the main thread takes them (collect()), because only the
+// main thread touches a Scrollback; the notify pipe wakes its event loop.
+
+typedef struct PackJob {
+    Scrollback *sb;
+    uint64_t chunk;
+    char *raw;
+    char *packed;               // NULL if it didn't compress
+    size_t packed_len;
+    struct PackJob *next;
+} PackJob;
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t work;        // Jobs were queued
+    pthread_cond_t finished;    // The thread finished a job
+    PackJob *queue, *queue_tail;
+    PackJob *done;
+    Scrollback *busy;           // Whose job the thread is working on
+    int notify[2];
+    int state;                  // 0 = not started, 1 = running, -1 = unavailable
+} g_compressor = {
+    PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER,
+    NULL, NULL, NULL, NULL, { -1, -1 }, 0
+};
+
+static void compress_job(PackJob *job) {
+    char *packed = malloc(CHUNK);
+    size_t len = packed ? lz_block_compress(job->raw, CHUNK, packed, CHUNK - MIN_SAVING) : 0;
+    if (len == 0) {
+        free(packed);
+        return;
+    }
+    char *fitted = realloc(packed, len);
+    job->packed = fitted ? fitted : packed;
+    job->packed_len = len;
+}
+
+static void* compressor_main(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&g_compressor.lock);
+    for (;;) {
+        while (!g_compressor.queue) {
+            pthread_cond_wait(&g_compressor.work, &g_compressor.lock);
+        }
+        PackJob *job = g_compressor.queue;
+        g_compressor.queue = job->next;
+        if (!g_compressor.queue) g_compressor.queue_tail = NULL;
+        g_compressor.busy = job->sb;
+        pthread_mutex_unlock(&g_compressor.lock);
+
+        compress_job(job);
+
+        pthread_mutex_lock(&g_compressor.lock);
+        job->next = g_compressor.done;
+        g_compressor.done = job;
+        g_compressor.busy = NULL;
+        pthread_cond_broadcast(&g_compressor.finished);
+        // Full pipe: a wakeup is already on its way
+        ssize_t ignored = write(g_compressor.notify[1], "", 1);
+        (void)ignored;
+    }
+    return NULL;
+}
+
+static int start_compressor(void) {
+    if (g_compressor.state != 0) return g_compressor.state == 1 ? 0 : -1;
+    g_compressor.state = -1;
+
+    if (pipe(g_compressor.notify) == -1) {
+        perror("[SCROLLBACK] pipe");
+        return -1;
+    }
+    for (int i = 0; i < 2; i++) {
+        fcntl(g_compressor.notify[i], F_SETFD, FD_CLOEXEC);
+        fcntl(g_compressor.notify[i], F_SETFL, O_NONBLOCK);
+    }
+
+    // Signals stay with the main thread
+    pthread_t thread;
+    sigset_t all, saved;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &saved);
+    int result = pthread_create(&thread, NULL, compressor_main, NULL);
+    pthread_sigmask(SIG_SETMASK, &saved, NULL);
+    if (result != 0) {
+        fprintf(stderr, "[SCROLLBACK] compressor thread: %s\n", strerror(result));
+        close(g_compressor.notify[0]);
+        close(g_compressor.notify[1]);
+        g_compressor.notify[0] = g_compressor.notify[1] = -1;
+        return -1;
+    }
+    pthread_detach(thread);
+    g_compressor.state = 1;
+    printf("[SCROLLBACK] Compressor thread started\n");
+    fflush(stdout);
+    return 0;
+}
+
+int scrollback_compressor_fd(void) {
+    return start_compressor() == 0 ? g_compressor.notify[0] : -1;
+}
+
+// Drops the jobs of a scrollback that is going away; raw chunks that are
+// still in its ring are freed with it
+static void cancel_jobs(Scrollback *sb) {
+    pthread_mutex_lock(&g_compressor.lock);
+    while (g_compressor.busy == sb) {
+        pthread_cond_wait(&g_compressor.finished, &g_compressor.lock);
+    }
+    PackJob **lists[] = { &g_compressor.queue, &g_compressor.done };
+    for (int i = 0; i < 2; i++) {
+        PackJob **link = lists[i];
+        while (*link) {
+            PackJob *job = *link;
+            if (job->sb != sb) {
+                link = &job->next;
+                continue;
+            }
+            *link = job->next;
+            if (job->chunk < sb->released) free(job->raw);
+            free(job->packed);
+            free(job);
+        }
+    }
+    g_compressor.queue_tail = NULL;
+    for (PackJob *job = g_compressor.queue; job; job = job->next) g_compressor.queue_tail = job;
+    pthread_mutex_unlock(&g_compressor.lock);
+    sb->pending = 0;
+}
+
+// ---- Spill file ----
+
+// An unnamed file, so nothing is left behind if the terminal dies
+static int open_spill_file(void) {
+    const char *dir = getenv("TMPDIR");
+    if (!dir || !*dir) dir = "/tmp";
+    int fd;
+
+#ifdef O_TMPFILE
+    fd = open(dir, O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+    if (fd != -1) return fd;
+#endif
+#if defined(__linux__) && defined(MFD_CLOEXEC)
+    fd = memfd_create("myterm-scrollback", MFD_CLOEXEC);
+    if (fd != -1) return fd;
+#endif
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/myterm-scrollback-XXXXXX", dir);
+    fd = mkstemp(path);
+    if (fd == -1) return -1;
+    unlink(path);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    return fd;
+}
+
+static int spill_block(Scrollback *sb, ScrollbackChunk *chunk) {
+    if (sb->spill_fd == -1) {
+        sb->spill_fd = open_spill_file();
+        if (sb->spill_fd == -1) {
+            perror("[SCROLLBACK] spill file");
+            sb->spill_failed = 1;
+            return -1;
+        }
+    }
+
+    size_t written = 0;
+    while (written < chunk->packed_len) {
+        ssize_t w = pwrite(sb->spill_fd, chunk->packed + written, chunk->packed_len - written,
+                           (off_t)(sb->spill_end + written));
+        if (w == -1 && errno == EINTR) continue;
+        if (w <= 0) {
+            perror("[SCROLLBACK] pwrite");
+            sb->spill_failed = 1;   // Keep the rest in memory
+            return -1;
+        }
+        written += w;
+    }
+
+    chunk->file_offset = sb->spill_end;
+    sb->spill_end += chunk->packed_len;
+    sb->packed_resident -= chunk->packed_len;
+    free(chunk->packed);
+    chunk->packed = NULL;
+    return 0;
+}
+
+// Moves the oldest blocks to the file while there are too many in memory
+static void spill(Scrollback *sb) {
+    while (sb->packed_resident > SCROLLBACK_PACKED_BUDGET && !sb->spill_failed &&
+           sb->next_spill < sb->next_pack) {
+        ScrollbackChunk *chunk = chunk_at(sb, sb->next_spill);
+        if (chunk->pending) break;   // Blocks go to the file in order
+        if (chunk->packed && spill_block(sb, chunk) == -1) break;
+        sb->next_spill++;
+    }
+}
+
+// ---- Compressing ----
+
+// Replaces a chunk's raw bytes with its block
+static void apply(Scrollback *sb, PackJob *job) {
+    sb->pending--;
+    if (job->chunk < sb->released) {
+        // Dropped while it was being compressed
+        free(job->raw);
+        free(job->packed);
+        sb->raw_chunks--;
+        return;
+    }
+
+    ScrollbackChunk *chunk = chunk_at(sb, job->chunk);
+    chunk->pending = 0;
+    if (job->packed) {
+        chunk->packed = job->packed;
+        chunk->packed_len = (uint32_t)job->packed_len;
+        free(job->raw);
+    } else {
+        chunk->packed = job->raw;
+        chunk->packed_len = CHUNK;
+        chunk->stored = 1;
+    }
+    chunk->raw = NULL;
+    sb->raw_chunks--;
+    sb->packed_resident += chunk->packed_len;
+    sb->packed_input += CHUNK;
+    sb->packed_output += chunk->packed_len;
+}
+
+// Takes the finished jobs of one scrollback (or of all of them)
+static void collect(Scrollback *sb) {
+    if (sb && sb->pending == 0) return;
+
+    pthread_mutex_lock(&g_compressor.lock);
+    PackJob *mine = NULL;
+    PackJob **link = &g_compressor.done;
+    while (*link) {
+        PackJob *job = *link;
+        if (sb && job->sb != sb) {
+            link = &job->next;
+            continue;
+        }
+        *link = job->next;
+        job->next = mine;
+        mine = job;
+    }
+    pthread_mutex_unlock(&g_compressor.lock);
+
+    while (mine) {
+        PackJob *job = mine;
+        mine = job->next;
+        apply(job->sb, job);
+        spill(job->sb);
+        free(job);
+    }
+}
+
+void scrollback_compressor_collect(void) {
+    if (g_compressor.notify[0] != -1) {
+        char drain[256];
+        while (read(g_compressor.notify[0], drain, sizeof(drain)) > 0) {}
+    }
+    collect(NULL);
+}
+
+// Hands full chunks that have left the hot window to the compressor
+static void pack_old_chunks(Scrollback *sb) {
+    uint64_t tail = sb->released + sb->num_chunks - 1;
+    if (sb->next_pack < sb->released) sb->next_pack = sb->released;
+
+    while (sb->num_chunks > 0 && sb->next_pack + SCROLLBACK_HOT_CHUNKS <= tail) {
+        uint64_t n = sb->next_pack++;
+        ScrollbackChunk *chunk = chunk_at(sb, n);
+        if (!chunk->raw) continue;   // Lost to a failed allocation
+
+        PackJob *job = calloc(1, sizeof(PackJob));
+        if (!job) break;
+        job->sb = sb;
+        job->chunk = n;
+        job->raw = chunk->raw;
+        chunk->pending = 1;
+        sb->pending++;
+
+        if (sb->pending > SCROLLBACK_MAX_PENDING || start_compressor() == -1) {
+            // The thread can't keep up (or there is none): do it here
+            compress_job(job);
+            apply(sb, job);
+            free(job);
+            continue;
+        }
+        pthread_mutex_lock(&g_compressor.lock);
+        if (g_compressor.queue_tail) g_compressor.queue_tail->next = job;
+        else g_compressor.queue = job;
+        g_compressor.queue_tail = job;
+        pthread_cond_signal(&g_compressor.work);
+        pthread_mutex_unlock(&g_compressor.lock);
+    }
+    spill(sb);
+}
+
+// ---- Reading chunks ----
+
+// Bytes of chunk n, which must not have been released. An old chunk is
+// decompressed into the cache and stays there until SCROLLBACK_CACHE_BLOCKS
+// other chunks have been read since.
+static const char* chunk_data(Scrollback *sb, uint64_t n) {
+    ScrollbackChunk *chunk = chunk_at(sb, n);
+    if (chunk->raw) return chunk->raw;
+    if (chunk->stored && chunk->packed) return chunk->packed;
+
+    ScrollbackCacheSlot *victim = &sb->cache[0];
+    for (int i = 0; i < SCROLLBACK_CACHE_BLOCKS; i++) {
+        ScrollbackCacheSlot *slot = &sb->cache[i];
+        if (slot->chunk == n) {
+            slot->last_use = ++sb->cache_clock;
+            return slot->data;
+        }
+        if (slot->last_use < victim->last_use) victim = slot;
+    }
+
+    victim->chunk = UNUSED_SLOT;
+    victim->last_use = 0;
+    if (!victim->data && !(victim->data = malloc(CHUNK))) return NULL;
+
+    // The block, from memory or mapped from the file
+    const char *block = chunk->packed;
+    char *map = NULL;
+    size_t map_len = 0;
+    if (!block) {
+        if (chunk->file_offset == NOT_SPILLED || sb->spill_fd == -1) return NULL;
+        long page = sysconf(_SC_PAGESIZE);
+        off_t start = (off_t)(chunk->file_offset / page * page);
+        map_len = chunk->file_offset - start + chunk->packed_len;
+        map = mmap(NULL, map_len, PROT_READ, MAP_SHARED, sb->spill_fd, start);
+        if (map == MAP_FAILED) {
+            perror("[SCROLLBACK] mmap");
+            return NULL;
+        }
+        block = map + (chunk->file_offset - start);
+    }
+
+    long len;
+    if (chunk->stored) {
+        memcpy(victim->data, block, CHUNK);
+        len = CHUNK;
+    } else {
+        len = lz_block_decompress(block, chunk->packed_len, victim->data, CHUNK);
+    }
+    if (map) munmap(map, map_len);
+    if (len != CHUNK) {
+        fprintf(stderr, "[SCROLLBACK] chunk %llu is corrupt\n", (unsigned long long)n);
+        return NULL;
+    }
+
+    victim->chunk = n;
+    victim->last_use = ++sb->cache_clock;
+    return victim->data;
+}
+
+// ---- Dropping old lines ----
+
+// Gives back the chunks that end before the oldest line's index entry
+static void release(Scrollback *sb) {
+    uint64_t k = sb->first_line / STRIDE;
+    if (k > sb->index_first) {
+        sb->index_head += k - sb->index_first;
+        sb->index_first = k;
+        if (sb->index_head > sb->index_count / 2) {
+            sb->index_count -= sb->index_head;
+            memmove(sb->index, sb->index + sb->index_head, sb->index_count * sizeof(uint64_t));
+            sb->index_head = 0;
+        }
+    }
+
+    uint64_t floor_chunk = index_entry(sb, k) / CHUNK;
+    if (floor_chunk <= sb->released) return;
+
+    while (sb->num_chunks > 0 && sb->released < floor_chunk) {
+        uint64_t n = sb->released;
+        ScrollbackChunk *chunk = chunk_at(sb, n);
+        // A pending chunk's raw bytes belong to its job until it's collected
+        if (!chunk->pending && chunk->raw) {
+            free(chunk->raw);
+            sb->raw_chunks--;
+        }
+        if (chunk->packed) {
+            sb->packed_resident -= chunk->packed_len;
+            free(chunk->packed);
+        }
+        if (chunk->packed_len) {
+            sb->packed_input -= CHUNK;
+            sb->packed_output -= chunk->packed_len;
+        }
+        for (int i = 0; i < SCROLLBACK_CACHE_BLOCKS; i++) {
+            if (sb->cache[i].chunk == n) {
+                sb->cache[i].chunk = UNUSED_SLOT;
+                sb->cache[i].last_use = 0;
+            }
+        }
+        memset(chunk, 0, sizeof(ScrollbackChunk));
+        sb->released++;
+        sb->num_chunks--;
+    }
+    if (sb->num_chunks == 0) sb->released = floor_chunk;
+    if (sb->next_spill < sb->released) sb->next_spill = sb->released;
+
+    // File space before the oldest block still needed, in whole pages
+    if (sb->spill_fd != -1) {
+        uint64_t live = sb->spill_end;
+        for (uint64_t n = sb->released; n < sb->next_spill; n++) {
+            if (chunk_at(sb, n)->file_offset != NOT_SPILLED) {
+                live = chunk_at(sb, n)->file_offset;
+                break;
+            }
+        }
+        long page = sysconf(_SC_PAGESIZE);
+        live = live / page * page;
+        if (live > sb->spill_punched) {
+#ifdef FALLOC_FL_PUNCH_HOLE
+            if (fallocate(sb->spill_fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                          (off_t)sb->spill_punched, (off_t)(live - sb->spill_punched)) == -1 &&
+                errno != EOPNOTSUPP) {
+                perror("[SCROLLBACK] fallocate");
+            }
+#endif
+            sb->spill_punched = live;
+        }
+    }
+}
+
+// ---- Appending ----
+
+// Doubles a ring, moving entries to their slots under the new mask
+static int grow_lines(Scrollback *sb) {
+    size_t capacity = sb->line_capacity * 2;
+    ScrollbackLine *lines = malloc(capacity * sizeof(ScrollbackLine));
+    if (!lines) return -1;
+    for (size_t i = 0; i < sb->num_recent; i++) {
+        uint64_t n = sb->end_line - sb->num_recent + i;
+        lines[n & (capacity - 1)] = *line_at(sb, n);
+    }
+    free(sb->lines);
+    sb->lines = lines;
+    sb->line_capacity = capacity;
+    return 0;
+}
+
+static int grow_chunks(Scrollback *sb) {
+    size_t capacity = sb->chunk_capacity * 2;
+    ScrollbackChunk *chunks = malloc(capacity * sizeof(ScrollbackChunk));
+    if (!chunks) return -1;
+    for (size_t i = 0; i < sb->num_chunks; i++) {
+        uint64_t n = sb->released + i;
+        chunks[n & (capacity - 1)] = *chunk_at(sb, n);
+    }
+    free(sb->chunks);
+    sb->chunks = chunks;
+    sb->chunk_capacity = capacity;
+    return 0;
+}
+
+static int index_push(Scrollback *sb, uint64_t offset) {
+    if (sb->index_count == sb->index_capacity) {
+        size_t capacity = sb->index_capacity * 2;
+        uint64_t *index = realloc(sb->index, capacity * sizeof(uint64_t));
+        if (!index) return -1;
+        sb->index = index;
+        sb->index_capacity = capacity;
+    }
+    sb->index[sb->index_count++] = offset;
+    return 0;
+}
+
+// Makes room after end in the newest chunk; returns the bytes available
+static size_t reserve(Scrollback *sb) {
+    uint64_t n = sb->end / CHUNK;
+    size_t used = sb->end % CHUNK;
+
+    if (sb->num_chunks == 0 || n >= sb->released + sb->num_chunks) {
+        // The previous chunk is full (or gone), so this one won't stay small
+        if (sb->num_chunks == sb->chunk_capacity && grow_chunks(sb) == -1) return 0;
+        size_t size = (n == 0) ? INITIAL_TAIL_SIZE : CHUNK;
+        char *raw = malloc(size);
+        if (!raw) return 0;
+        if (sb->num_chunks == 0) sb->released = n;
+        ScrollbackChunk *chunk = chunk_at(sb, n);
+        memset(chunk, 0, sizeof(ScrollbackChunk));
+        chunk->raw = raw;
+        chunk->file_offset = NOT_SPILLED;
+        sb->num_chunks++;
+        sb->raw_chunks++;
+        sb->tail_size = size;
+        pack_old_chunks(sb);
+    } else if (used == sb->tail_size) {
+        size_t size = sb->tail_size * 2;
+        char *raw = realloc(chunk_at(sb, n)->raw, size);
+        if (!raw) return 0;
+        chunk_at(sb, n)->raw = raw;
+        sb->tail_size = size;
+    }
+    return sb->tail_size - used;
+}
+
+// Stores bytes at end; returns how many fit
+static size_t store(Scrollback *sb, const char *data, size_t len) {
+    size_t stored = 0;
+    while (stored < len) {
+        size_t room = reserve(sb);
+        if (room == 0) break;   // Out of memory; the rest is lost
+        size_t n = len - stored < room ? len - stored : room;
+        memcpy(chunk_at(sb, sb->end / CHUNK)->raw + sb->end % CHUNK, data + stored, n);
+        sb->end += n;
+        stored += n;
+    }
+    return stored;
+}
+
+// Adds bytes without newlines to the current line
+static void write_text(Scrollback *sb, const char *data, size_t len) {
+    line_at(sb, sb->end_line - 1)->len += store(sb, data, len);
+}
+
+// Ends the current line and starts an empty one
+static void new_line(Scrollback *sb) {
+    if (store(sb, "\n", 1) == 0) return;
+
+    uint64_t n = sb->end_line;
+    if (n % STRIDE == 0 && index_push(sb, sb->end) == -1) {
+        // Without its index entry the line couldn't be found again
+        sb->end--;
+        return;
+    }
+
+    if (sb->num_recent == sb->line_capacity &&
+        (sb->line_capacity >= SCROLLBACK_RECENT_LINES || grow_lines(sb) == -1)) {
+        sb->num_recent--;   // The oldest descriptor is overwritten
+    }
+    ScrollbackLine *line = line_at(sb, n);
+    line->offset = sb->end;
+    line->len = 0;
+    sb->num_recent++;
+    sb->end_line++;
+
+    if (sb->max_lines && sb->end_line - sb->first_line > sb->max_lines) {
+        sb->first_line++;
+        if (sb->num_recent > sb->end_line - sb->first_line) {
+            sb->num_recent = sb->end_line - sb->first_line;
+        }
+        if (sb->cursor_line < sb->first_line) sb->cursor_valid = 0;
+        release(sb);
+    }
+}
+
+void scrollback_append(Scrollback *sb, const char *data, size_t len) {
+    collect(sb);
+    while (len > 0) {
+        const char *newline = memchr(data, '\n', len);
+        size_t segment = newline ? (size_t)(newline - data) : len;
+
+        // NUL bytes would cut the line short when it is drawn
+        const char *p = data;
+        size_t left = segment;
+        const char *nul;
+        while (left > 0 && (nul = memchr(p, '\0', left)) != NULL) {
+            write_text(sb, p, nul - p);
+            left -= (nul - p) + 1;
+            p = nul + 1;
+        }
+        write_text(sb, p, left);
+
+        if (newline) {
+            new_line(sb);
+            segment++;
+        }
+        data += segment;
+        len -= segment;
+    }
+}
+
+// ---- Reading lines ----
+
+// Offset of the first newline at or after offset (end if there is none)
+static uint64_t find_newline(Scrollback *sb, uint64_t offset) {
+    while (offset < sb->end) {
+        uint64_t n = offset / CHUNK;
+        size_t start = offset % CHUNK;
+        size_t avail = CHUNK - start;
+        if (avail > sb->end - offset) avail = sb->end - offset;
+        const char *data = chunk_data(sb, n);
+        if (!data) return sb->end;
+        const char *nl = memchr(data + start, '\n', avail);
+        if (nl) return offset + (nl - (data + start));
+        offset += avail;
+    }
+    return sb->end;
+}
+
+// Finds where an old line (one without a descriptor) starts and its length
+static void locate(Scrollback *sb, uint64_t n, uint64_t *offset, size_t *len) {
+    uint64_t line, off;
+    if (sb->cursor_valid && sb->cursor_line <= n && n - sb->cursor_line < STRIDE) {
+        if (n == sb->cursor_line) {
+            *offset = sb->cursor_offset;
+            *len = sb->cursor_len;
+            return;
+        }
+        // Just past the line last located: usually the next one on screen
+        line = sb->cursor_line + 1;
+        off = sb->cursor_offset + sb->cursor_len + 1;
+    } else {
+        line = n / STRIDE * STRIDE;
+        off = index_entry(sb, n / STRIDE);
+    }
+    for (; line < n; line++) {
+        off = find_newline(sb, off) + 1;
+    }
+
+    *offset = off;
+    *len = find_newline(sb, off) - off;
+    sb->cursor_line = n;
+    sb->cursor_offset = *offset;
+    sb->cursor_len = *len;
+    sb->cursor_valid = 1;
+}
+
+static void line_span(Scrollback *sb, uint64_t n, uint64_t *offset, size_t *len) {
+    if (n >= sb->end_line - sb->num_recent) {
+        ScrollbackLine *line = line_at(sb, n);
+        *offset = line->offset;
+        *len = line->len;
+    } else {
+        locate(sb, n, offset, len);
+    }
+}
+
+size_t scrollback_line_count(const Scrollback *sb) {
+    return sb->end_line - sb->first_line;
+}
+
+const char* scrollback_line(Scrollback *sb, size_t index, size_t *len) {
+    if (index >= scrollback_line_count(sb)) return NULL;
+    collect(sb);
+
+    uint64_t offset;
+    size_t length;
+    line_span(sb, sb->first_line + index, &offset, &length);
+    *len = length;
+    if (length == 0) return "";
+
+    uint64_t chunk = offset / CHUNK;
+    size_t start = offset % CHUNK;
+    if (start + length <= CHUNK) {
+        const char *data = chunk_data(sb, chunk);
+        if (!data) {
+            *len = 0;
+            return "";
+        }
+        return data + start;
+    }
+
+    // Straddles chunks: gather it
+    if (sb->scratch_size < length) {
+        char *scratch = realloc(sb->scratch, length);
+        if (!scratch) {
+            *len = 0;
+            return "";
+        }
+        sb->scratch = scratch;
+        sb->scratch_size = length;
+    }
+    size_t copied = 0;
+    while (copied < length) {
+        size_t piece = CHUNK - start;
+        if (piece > length - copied) piece = length - copied;
+        const char *data = chunk_data(sb, chunk);
+        if (data) {
+            memcpy(sb->scratch + copied, data + start, piece);
+        } else {
+            memset(sb->scratch + copied, '?', piece);
+        }
+        copied += piece;
+        start = 0;
+        chunk++;
+    }
+    return sb->scratch;
+}
+
+size_t scrollback_memory(const Scrollback *sb) {
+    size_t bytes = sb->line_capacity * sizeof(ScrollbackLine) +
+                   sb->chunk_capacity * sizeof(ScrollbackChunk) +
+                   sb->index_capacity * sizeof(uint64_t) + sb->scratch_size +
+                   sb->packed_resident;
+    if (sb->raw_chunks > 0) {
+        bytes += (sb->raw_chunks - 1) * (size_t)CHUNK + sb->tail_size;
+    }
+    for (int i = 0; i < SCROLLBACK_CACHE_BLOCKS; i++) {
+        if (sb->cache[i].data) bytes += CHUNK;
+    }
+    return bytes;
+}
+
+uint64_t scrollback_spilled_bytes(const Scrollback *sb) {
+    return sb->spill_end - sb->spill_punched;
+}
+
+void scrollback_get_stats(Scrollback *sb, ScrollbackStats *stats) {
+    collect(sb);
+    uint64_t first;
+    size_t len;
+    line_span(sb, sb->first_line, &first, &len);
+
+    stats->lines = scrollback_line_count(sb);
+    stats->bytes = sb->end - first;
+    stats->resident = scrollback_memory(sb);
+    stats->packed_input = sb->packed_input;
+    stats->packed_output = sb->packed_output;
+    stats->spilled = scrollback_spilled_bytes(sb);
+    stats->pending = sb->pending;
+}
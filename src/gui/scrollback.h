@@ -0,0 +1,192 @@
+// src/gui/scrollback.h
+#ifndef SCROLLBACK_H
+#define SCROLLBACK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// A tab's output, as lines of any length.
+//
+// Bytes (newlines included) go into a store of SCROLLBACK_CHUNK_SIZE chunks
+// addressed by their absolute offset in the output. The newest
+// SCROLLBACK_HOT_CHUNKS chunks - the ones being written and shown at the
+// bottom of the window - are kept as they are (the newest one grows by
+// doubling, so a short output takes little memory). Older chunks are handed
+// to a background thread that compresses them (lz_block), and then only the
+// compressed block is kept; past SCROLLBACK_PACKED_BUDGET bytes of those,
+// the oldest blocks are appended to a per-tab temporary file and read back
+// through mmap(). Scrolling into old output decompresses its blocks into a
+// small LRU cache.
+//
+// The most recent SCROLLBACK_RECENT_LINES lines have descriptors - offset
+// and length - in a ring. Older lines are found through a sparse index that
+// holds the offset of every SCROLLBACK_INDEX_STRIDE-th line: a line is at
+// most STRIDE - 1 newlines past its index entry, so locating any line is
+// O(1), and reading consecutive lines (a screenful) costs O(1) per line.
+//
+// Resident memory is therefore bounded by the hot chunks, the compressed
+// budget, the cache and the recent ring, plus 8 bytes per STRIDE lines of
+// index and a few per chunk. Once max_lines is reached the oldest lines are
+// dropped and the space they used is given back (punched out of the file
+// where the system supports it).
+
+#define SCROLLBACK_CHUNK_SIZE 65536
+#define SCROLLBACK_HOT_CHUNKS 2
+#define SCROLLBACK_PACKED_BUDGET (512 * 1024)   // Compressed bytes kept in memory
+#define SCROLLBACK_CACHE_BLOCKS 4               // Decompressed chunks kept
+#define SCROLLBACK_MAX_PENDING 16               // Past this, compress in the caller
+#define SCROLLBACK_RECENT_LINES 4096
+#define SCROLLBACK_INDEX_STRIDE 64
+
+typedef struct {
+    uint64_t offset;            // Absolute offset of the first byte
+    size_t len;                 // Bytes, without the newline
+} ScrollbackLine;
+
+typedef struct {
+    char *raw;                  // The bytes, until compressed
+    char *packed;               // Compressed block in memory, or NULL
+    uint32_t packed_len;        // Its size; 0 until compressed
+    uint8_t stored;             // Didn't compress: the block is the raw bytes
+    uint8_t pending;            // With the compressor thread
+    uint64_t file_offset;       // Where the block is in the spill file, if spilled
+} ScrollbackChunk;
+
+typedef struct {
+    uint64_t chunk;             // Chunk number, or UINT64_MAX if unused
+    char *data;                 // SCROLLBACK_CHUNK_SIZE bytes, allocated on first use
+    unsigned last_use;
+} ScrollbackCacheSlot;
+
+// What `stats` shows for a tab
+typedef struct {
+    uint64_t lines;             // Lines held
+    uint64_t bytes;             // Bytes of output held
+    size_t resident;            // Bytes of memory used (scrollback_memory())
+    uint64_t packed_input;      // Bytes of output that were compressed ...
+    uint64_t packed_output;     // ... and what they compressed to
+    uint64_t spilled;           // Compressed bytes in the spill file
+    size_t pending;             // Chunks waiting for the compressor
+} ScrollbackStats;
+
+typedef struct Scrollback {
+    size_t max_lines;           // 0 = unlimited
+    uint64_t first_line;        // Absolute number of the oldest line held
+    uint64_t end_line;          // One past the current (last) line
+
+    // Recent lines: line n lives at lines[n & (line_capacity - 1)] for the
+    // last num_recent lines (always including the current one)
+    ScrollbackLine *lines;
+    size_t line_capacity;       // Power of two, at most SCROLLBACK_RECENT_LINES
+    size_t num_recent;
+
+    // Sparse index: index[index_head + i] is the offset of line
+    // (index_first + i) * STRIDE; entries before index_head were dropped
+    uint64_t *index;
+    size_t index_head;
+    size_t index_count;         // Entries in use, dropped ones included
+    size_t index_capacity;
+    uint64_t index_first;
+
+    // Chunk n (bytes [n * CHUNK, (n + 1) * CHUNK)) is described by
+    // chunks[n & (chunk_capacity - 1)] for n in [released, released + num_chunks)
+    ScrollbackChunk *chunks;
+    size_t chunk_capacity;      // Power of two
+    uint64_t released;          // Chunks below this one are no longer needed
+    size_t num_chunks;
+    size_t tail_size;           // Bytes allocated for the newest chunk
+    uint64_t end;               // Absolute offset of the next byte
+    uint64_t next_pack;         // Next chunk to hand to the compressor
+    uint64_t next_spill;        // Oldest chunk whose block may still be in memory
+    size_t raw_chunks;          // Chunks held uncompressed
+    size_t packed_resident;     // Bytes of compressed blocks in memory
+    size_t pending;             // Chunks with the compressor
+    uint64_t packed_input, packed_output;
+
+    // Blocks past the budget are appended to the spill file
+    int spill_fd;               // -1 until the first spill
+    int spill_failed;           // Couldn't create or write it: keep blocks in memory
+    uint64_t spill_end;         // Bytes written to it
+    uint64_t spill_punched;     // Bytes before this offset were given back
+
+    ScrollbackCacheSlot cache[SCROLLBACK_CACHE_BLOCKS];
+    unsigned cache_clock;
+
+    // The last line located, so walking down a screenful is O(1) per line
+    uint64_t cursor_line;
+    uint64_t cursor_offset;
+    size_t cursor_len;
+    int cursor_valid;
+
+    char *scratch;              // Lines that straddle chunks are copied here
+    size_t scratch_size;
+} Scrollback;
+
+/**
+ * @brief Initialize an empty scrollback (one empty line)
+ * @param sb Scrollback to initialize
+ * @param max_lines Lines to keep before the oldest are dropped (0 = no limit)
+ * @return 0 on success, -1 on allocation failure
+ */
+int scrollback_init(Scrollback *sb, size_t max_lines);
+
+/**
+ * @brief Free everything the scrollback holds, spill file included
+ */
+void scrollback_free(Scrollback *sb);
+
+/**
+ * @brief Append output; '\n' ends the current line, NUL bytes are dropped
+ * @param sb Scrollback
+ * @param data Bytes (not NUL-terminated)
+ * @param len Number of bytes
+ */
+void scrollback_append(Scrollback *sb, const char *data, size_t len);
+
+/**
+ * @brief Number of lines held, including the (possibly empty) current one
+ */
+size_t scrollback_line_count(const Scrollback *sb);
+
+/**
+ * @brief Get a line's text
+ * @param sb Scrollback
+ * @param index 0 for the oldest line held, scrollback_line_count() - 1 for the current one
+ * @param len Receives the length in bytes
+ * @return The text (not NUL-terminated), valid until the next call that
+ * changes or reads the scrollback; NULL if index is out of range
+ */
+const char* scrollback_line(Scrollback *sb, size_t index, size_t *len);
+
+/**
+ * @brief Bytes of memory the scrollback holds: hot chunks, descriptors,
+ * index, buffers and mapped cold chunks
+ */
+size_t scrollback_memory(const Scrollback *sb);
+
+/**
+ * @brief Compressed bytes that live in the spill file
+ */
+uint64_t scrollback_spilled_bytes(const Scrollback *sb);
+
+/**
+ * @brief Fill in the numbers `stats` reports
+ */
+void scrollback_get_stats(Scrollback *sb, ScrollbackStats *stats);
+
+/**
+ * @brief Descriptor that becomes readable when the compressor thread has
+ * finished blocks; watch it and call scrollback_compressor_collect()
+ * @return The descriptor (the thread is started if needed), or -1 if
+ * there is no thread and blocks are compressed right away instead
+ */
+int scrollback_compressor_fd(void);
+
+/**
+ * @brief Hand finished blocks back to their scrollbacks, freeing the raw
+ * chunks they replace. Scrollbacks also do this themselves whenever they
+ * are appended to or read.
+ */
+void scrollback_compressor_collect(void);
+
+#endif // SCROLLBACK_H
@@ -9,6 +9,10 @@
 #include "../shell/process_manager.h"
 #include "../shell/signal_handler.h"
 #include "../shell/history_manager.h"
+#include "../shell/job.h"
+#include "../shell/pseudo_terminal.h"
+#include "../shell/builtins.h"
+#include "../utils/event_loop.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -21,6 +25,40 @@
 
 static char initial_working_directory[PATH_MAX] = {0};
 
+// Appends a NUL-terminated notification or multiWatch report to the owning tab
+static void tab_text_callback(const char *text, void *user_data) {
+    Tab *tab = (Tab *)user_data;
+    if (tab && tab->buffer) {
+        text_buffer_append(tab->buffer, text);
+    }
+}
+
+// A multiWatch watcher finished a run
+static void multiwatch_ready_callback(int fd, int events, void *user_data) {
+    (void)fd;
+    (void)events;
+    Tab *tab = (Tab *)user_data;
+    if (tab->multiwatch_session) {
+        multiwatch_poll_output((MultiWatch *)tab->multiwatch_session, tab_text_callback, tab);
+    }
+}
+
+// Streams a chunk of child output straight into the owning tab's buffer
+static void tab_output_callback(const char *data, size_t len, void *user_data) {
+    Tab *tab = (Tab *)user_data;
+    if (tab && tab->buffer) {
+        text_buffer_append_len(tab->buffer, data, len);
+    }
+}
+
+// Output of a job that stopped or went to the background keeps streaming
+// into its tab until the process manager lets go of the job
+static void tab_release_job(Job *job, void *user_data) {
+    Tab *tab = (Tab *)user_data;
+    if (tab->manager->event_loop) event_loop_remove_fd(tab->manager->event_loop, job->output_fd);
+    job_abandon(job);
+}
+
 TabManager* tab_manager_init() {
     TabManager *mgr = malloc(sizeof(TabManager));
     if (!mgr) return NULL;
@@ -28,6 +66,7 @@ TabManager* tab_manager_init() {
     memset(mgr, 0, sizeof(TabManager));
     mgr->active_tab = -1;
     mgr->num_tabs = 0;
+    mgr->event_loop = NULL;
 
     mgr->history = history_manager_init();
     if (!mgr->history) {
@@ -61,6 +100,7 @@ int tab_manager_create_tab(TabManager *mgr) {
     Tab *tab = &mgr->tabs[tab_idx];
     tab->buffer = text_buffer_init();
     if (!tab->buffer) return -1;
+    text_buffer_set_screen_rows(tab->buffer, mgr->term_rows);
 
     tab->line_edit = line_edit_init();
     if (!tab->line_edit) {
@@ -87,6 +127,10 @@ int tab_manager_create_tab(TabManager *mgr) {
     tab->active = 1;
     tab->in_search_mode = 0;
     tab->interactive_fd = -1;
+    tab->job = NULL;
+    tab->manager = mgr;
+    tab->exit_requested = 0;
+    process_manager_set_job_release(tab->process_manager, tab_release_job, tab);
 
     mgr->num_tabs++;
     mgr->active_tab = tab_idx;
@@ -107,9 +151,15 @@ void tab_manager_close_tab(TabManager *mgr, int tab_index) {
     if (!mgr || tab_index < 0 || tab_index >= MAX_TABS || !mgr->tabs[tab_index].active) return;
     Tab *tab = &mgr->tabs[tab_index];
 
-    if (tab->multiwatch_session) {
-        cleanup_multiwatch((MultiWatch *)tab->multiwatch_session);
-        tab->multiwatch_session = NULL;
+    tab_manager_stop_multiwatch(mgr, tab);
+
+    if (tab->job) {
+        if (mgr->event_loop) event_loop_remove_fd(mgr->event_loop, tab->job->output_fd);
+        process_manager_clear_foreground(tab->process_manager);
+        signal_handler_take_terminal_back();
+        job_abandon(tab->job);
+        tab->job = NULL;
+        tab->interactive_fd = -1;
     }
 
     if (tab->process_manager) {
@@ -119,6 +169,8 @@ void tab_manager_close_tab(TabManager *mgr, int tab_index) {
 
     line_edit_free(tab->line_edit);
     text_buffer_free(tab->buffer);
+    tab->line_edit = NULL;
+    tab->buffer = NULL;  // A command still streaming into this tab checks for this
     tab->active = 0;
     mgr->num_tabs--;
 
@@ -146,41 +198,13 @@ void tab_manager_send_sigint(TabManager *mgr) {
     ProcessInfo *fg_proc = process_manager_get_foreground(tab->process_manager);
     if (!fg_proc) return;
     
-    if (kill(fg_proc->pid, 0) == -1) {
-        process_manager_clear_foreground(tab->process_manager);
-        signal_handler_take_terminal_back();
-        text_buffer_append(tab->buffer, "^C\n");
-        return;
-    }
-    
-    int kill_result = kill(-fg_proc->pgid, SIGINT);
-    
-    if (kill_result == -1) {
-        process_manager_clear_foreground(tab->process_manager);
-        signal_handler_take_terminal_back();
-        text_buffer_append(tab->buffer, "^C\n");
-        return;
-    }
-    
-    int status;
-    int wait_attempts = 0;
-    int max_attempts = 50;
+    printf("[SIGINT] Sending SIGINT to PGID %d (PID %d)\n", fg_proc->pgid, fg_proc->pid);
+    fflush(stdout);
     
-    while (wait_attempts < max_attempts) {
-        pid_t result = waitpid(fg_proc->pid, &status, WNOHANG);
-        
-        if (result == fg_proc->pid) {
-            break;
-        } else if (result == -1) {
-            break;
-        } else if (result == 0) {
-            usleep(10000);
-            wait_attempts++;
-        }
+    // The job is reaped from the main loop once it exits
+    if (kill(-fg_proc->pgid, SIGINT) == -1) {
+        perror("kill SIGINT");
     }
-    
-    process_manager_clear_foreground(tab->process_manager);
-    signal_handler_take_terminal_back();
     text_buffer_append(tab->buffer, "^C\n");
 }
 
@@ -194,8 +218,10 @@ void tab_manager_send_sigtstp(TabManager *mgr) {
     printf("[SIGTSTP] Sending SIGTSTP to PGID %d (PID %d)\n", fg_proc->pgid, fg_proc->pid);
     fflush(stdout);
     
-    // Send SIGTSTP to the process group
-    if (kill(-fg_proc->pgid, SIGTSTP) == -1) {
+    // A command on a pty leads its own session, so its process group is
+    // orphaned and the kernel discards SIGTSTP for it; stop it outright
+    int sig = (tab->job && tab->job->is_pty) ? SIGSTOP : SIGTSTP;
+    if (kill(-fg_proc->pgid, sig) == -1) {
         perror("kill SIGTSTP");
         text_buffer_append(tab->buffer, "^Z\n");
         process_manager_clear_foreground(tab->process_manager);
@@ -206,30 +232,196 @@ void tab_manager_send_sigtstp(TabManager *mgr) {
     printf("[SIGTSTP] Signal sent successfully\n");
     fflush(stdout);
     
-    // The stopped process will be handled by execute_command_with_signals
-    // Just send the signal here - the rest will be handled when waitpid detects WIFSTOPPED
+    // The job notices the stop from the main loop and moves to the background
 }
 
-void tab_manager_check_background_jobs(TabManager *mgr, void (*output_callback)(const char *)) {
-    Tab *tab = tab_manager_get_active(mgr);
-    if (!tab || !tab->process_manager) return;
+void tab_manager_set_event_loop(TabManager *mgr, struct EventLoop *loop) {
+    if (!mgr) return;
+    mgr->event_loop = loop;
+}
+
+void tab_manager_set_terminal_size(TabManager *mgr, int cols, int rows, int width, int height) {
+    if (!mgr) return;
+    if (cols == mgr->term_cols && rows == mgr->term_rows &&
+        width == mgr->term_width && height == mgr->term_height) {
+        return;
+    }
+    mgr->term_cols = cols;
+    mgr->term_rows = rows;
+    mgr->term_width = width;
+    mgr->term_height = height;
+    pty_set_default_size(cols, rows, width, height);
+
+    for (int i = 0; i < MAX_TABS; i++) {
+        Tab *tab = &mgr->tabs[i];
+        if (tab->active) text_buffer_set_screen_rows(tab->buffer, rows);
+        if (tab->active && tab->job && tab->job->is_pty) {
+            pty_set_size(tab->job->output_fd, cols, rows, width, height);
+        }
+    }
+}
+
+// Registers every watcher's notify pipe so results arrive through the event loop
+static void tab_manager_watch_multiwatch(TabManager *mgr, Tab *tab) {
+    MultiWatch *mw = (MultiWatch *)tab->multiwatch_session;
+    if (!mgr->event_loop || !mw) return;
     
-    process_manager_check_background_jobs(tab->process_manager, output_callback);
+    for (int i = 0; i < mw->num_commands; i++) {
+        if (mw->commands[i].notify_fd != -1) {
+            event_loop_add_fd(mgr->event_loop, mw->commands[i].notify_fd, EVENT_READ,
+                              multiwatch_ready_callback, tab);
+        }
+    }
 }
 
-void tab_manager_show_history(TabManager *mgr) {
-    Tab *tab = tab_manager_get_active(mgr);
-    if (!tab || !mgr->history) return;
+void tab_manager_stop_multiwatch(TabManager *mgr, Tab *tab) {
+    if (!tab || !tab->multiwatch_session) return;
+    MultiWatch *mw = (MultiWatch *)tab->multiwatch_session;
     
-    char *output = malloc(102400);
-    if (!output) {
-        text_buffer_append(tab->buffer, "Error: Out of memory\n");
+    if (mgr && mgr->event_loop) {
+        for (int i = 0; i < mw->num_commands; i++) {
+            event_loop_remove_fd(mgr->event_loop, mw->commands[i].notify_fd);
+        }
+    }
+    cleanup_multiwatch(mw);
+    tab->multiwatch_session = NULL;
+}
+
+// Ends the tab's foreground job once it has exited or stopped. A stopped
+// job now belongs to the process manager and stays registered.
+static void tab_finish_job(TabManager *mgr, Tab *tab) {
+    Job *job = tab->job;
+    tab->job = NULL;
+    tab->interactive_fd = -1;
+
+    char notice[1024];
+    if (job_leave_foreground(job, tab->process_manager, notice, sizeof(notice))) {
+        text_buffer_append(tab->buffer, notice);
+        return;
+    }
+    text_buffer_append(tab->buffer, notice);
+
+    if (mgr->event_loop) event_loop_remove_fd(mgr->event_loop, job->output_fd);
+    job_free(job);
+}
+
+static void tab_update_job(TabManager *mgr, Tab *tab) {
+    if (!tab->job) return;
+    JobState state = job_update(tab->job);
+    if (state == JOB_EXITED || state == JOB_STOPPED) {
+        tab_finish_job(mgr, tab);
+    }
+}
+
+// A job of the tab, in the foreground or not, wrote something
+static void job_output_callback(int fd, int events, void *user_data) {
+    (void)events;
+    Job *job = (Job *)user_data;
+    Tab *tab = (Tab *)job->owner;
+
+    if (job_read_output(job)) {
+        // Stop watching at EOF; the exit itself is reported through SIGCHLD
+        event_loop_remove_fd(tab->manager->event_loop, fd);
+        if (job == tab->job) tab_update_job(tab->manager, tab);
+    }
+}
+
+// Makes job the tab's foreground job and lets the event loop drive it
+static void tab_start_job(TabManager *mgr, Tab *tab, Job *job) {
+    tab->job = job;
+    tab->interactive_fd = job->input_fd;
+    job->owner = tab;
+    job_set_foreground(job, tab->process_manager);
+
+    if (mgr->event_loop &&
+        event_loop_add_fd(mgr->event_loop, job->output_fd, EVENT_READ,
+                          job_output_callback, job) == 0) {
         return;
     }
+
+    // No event loop to come back from, so finish it here
+    job_wait(job);
+    tab_finish_job(mgr, tab);
+}
+
+// `fg`: takes a job back from the process manager and makes it the
+// foreground job again
+static int tab_resume_job(ProcessInfo *info, void *user_data) {
+    Tab *tab = (Tab *)user_data;
+    Job *job = info->job;
+    if (!job || tab->job) return -1;
+
+    info->job = NULL;
+    process_manager_remove_background(tab->process_manager, info->pid);
+
+    // Registered again below, whether or not it was still being watched
+    if (tab->manager->event_loop) event_loop_remove_fd(tab->manager->event_loop, job->output_fd);
+    job_continue(job);
+    tab_start_job(tab->manager, tab, job);
+    return 0;
+}
+
+// `exit`: the tab closes once tab_manager_execute_command is done with it
+static void tab_request_exit(int status, void *user_data) {
+    (void)status;
+    Tab *tab = (Tab *)user_data;
+    tab->exit_requested = 1;
+}
+
+// `stats`: scrollback memory of every tab, how well old output compressed,
+// and how much drawing the window costs
+static void tab_report_stats(BuiltinStream *out, void *user_data) {
+    Tab *current = (Tab *)user_data;
+    TabManager *mgr = current->manager;
+    uint64_t total_input = 0, total_output = 0;
+    size_t total_resident = 0;
+
+    builtin_printf(out, "TAB  %10s %12s %12s %8s %12s\n",
+                   "LINES", "OUTPUT", "RESIDENT", "RATIO", "SPILLED");
+    for (int i = 0; i < MAX_TABS; i++) {
+        Tab *tab = &mgr->tabs[i];
+        if (!tab->active || !tab->buffer) continue;
+
+        ScrollbackStats stats;
+        scrollback_get_stats(&tab->buffer->scrollback, &stats);
+        char ratio[16] = "-";
+        if (stats.packed_output > 0) {
+            snprintf(ratio, sizeof(ratio), "%.1fx",
+                     (double)stats.packed_input / stats.packed_output);
+        }
+        builtin_printf(out, "%c%-3d %10llu %12llu %12zu %8s %12llu\n",
+                       tab == current ? '*' : ' ', i + 1,
+                       (unsigned long long)stats.lines, (unsigned long long)stats.bytes,
+                       stats.resident, ratio, (unsigned long long)stats.spilled);
+        total_input += stats.packed_input;
+        total_output += stats.packed_output;
+        total_resident += stats.resident;
+    }
+
+    builtin_printf(out, "Resident scrollback: %zu bytes", total_resident);
+    if (total_output > 0) {
+        builtin_printf(out, "; old output compressed %.1fx (%llu -> %llu bytes)",
+                       (double)total_input / total_output,
+                       (unsigned long long)total_input, (unsigned long long)total_output);
+    }
+    builtin_printf(out, "\n");
+
+    RenderStats render;
+    render_get_stats(&render);
+    builtin_printf(out, "Drawing: %lu frames, %lu rows, %lu X requests (%.1f/s lately)\n",
+                   render.frames, render.rows, render.requests, render.requests_per_second);
+}
+
+void tab_manager_poll_jobs(TabManager *mgr) {
+    if (!mgr) return;
     
-    history_manager_get_recent(mgr->history, output, 102400, HISTORY_DISPLAY_SIZE);
-    text_buffer_append(tab->buffer, output);
-    free(output);
+    for (int i = 0; i < MAX_TABS; i++) {
+        Tab *tab = &mgr->tabs[i];
+        if (!tab->active || !tab->process_manager) continue;
+        tab_update_job(mgr, tab);
+        process_manager_check_background_jobs(tab->process_manager, tab_text_callback, tab);
+    }
+    job_reap_abandoned();
 }
 
 void tab_manager_enter_search_mode(TabManager *mgr) {
@@ -261,14 +453,18 @@ void tab_manager_execute_search(TabManager *mgr, const char *search_term) {
         return;
     }
     
-    char exact_result[MAX_COMMAND_LENGTH];
-    if (history_manager_search_exact(mgr->history, search_term, 
-                                     exact_result, sizeof(exact_result))) {
+    // An exact match is as long as the search term
+    size_t exact_size = strlen(search_term) + 1;
+    char *exact_result = malloc(exact_size);
+    if (exact_result && history_manager_search_exact(mgr->history, search_term,
+                                                     exact_result, exact_size)) {
         text_buffer_append(tab->buffer, "[Exact match found]\n");
         text_buffer_append(tab->buffer, exact_result);
         text_buffer_append(tab->buffer, "\n");
+        free(exact_result);
         return;
     }
+    free(exact_result);
     
     HistorySearchResult results[MAX_SEARCH_RESULTS];
     int num_results = history_manager_search_fuzzy(mgr->history, search_term,
@@ -289,7 +485,7 @@ void tab_manager_execute_search(TabManager *mgr, const char *search_term) {
 
 void tab_manager_execute_command(TabManager *mgr, const char *cmd_str) {
     Tab *tab = tab_manager_get_active(mgr);
-    if (!tab || tab->multiwatch_session) {
+    if (!tab || tab->multiwatch_session || tab->job) {
         return;
     }
 
@@ -306,9 +502,11 @@ void tab_manager_execute_command(TabManager *mgr, const char *cmd_str) {
     }
 
     // CRITICAL FIX: Save the original command BEFORE any modification
-    char original_cmd[MAX_COMMAND_LENGTH];
-    strncpy(original_cmd, cmd_str, MAX_COMMAND_LENGTH - 1);
-    original_cmd[MAX_COMMAND_LENGTH - 1] = '\0';
+    char *original_cmd = strdup(cmd_str);
+    if (!original_cmd) {
+        perror("strdup");
+        return;
+    }
 
     printf("[EXECUTE] Command: '%s'\n", original_cmd);
     fflush(stdout);
@@ -323,28 +521,11 @@ void tab_manager_execute_command(TabManager *mgr, const char *cmd_str) {
 
     char *cmd_to_exec = strdup(original_cmd);
 
-    // Check for history command
-    if (strcmp(cmd_to_exec, "history") == 0) {
-        tab_manager_show_history(mgr);
-        free(cmd_to_exec);
-        line_edit_clear(tab->line_edit);
-        getcwd(tab->working_directory, sizeof(tab->working_directory));
-        chdir(saved_cwd);
-        
-        // Add history command to history
-        if (mgr->history) {
-            printf("[HISTORY] Adding 'history' command to history\n");
-            fflush(stdout);
-            history_manager_add_command(mgr->history, original_cmd);
-            history_manager_save_to_file(mgr->history);
-        }
-        return;
-    }
-
     // Execute the command
     if (is_multiwatch_command(cmd_to_exec)) {
         tab->multiwatch_session = multiwatch_start_session(cmd_to_exec);
         if (tab->multiwatch_session) {
+            tab_manager_watch_multiwatch(mgr, tab);
             text_buffer_append(tab->buffer, "[multiWatch started. Press Ctrl+C to stop.]\n\n");
         } else {
             text_buffer_append(tab->buffer, "Error: Invalid multiWatch syntax.\n");
@@ -358,17 +539,29 @@ void tab_manager_execute_command(TabManager *mgr, const char *cmd_str) {
         parse_redirections(cmd_to_exec, &redir_info);
         parse_command(redir_info.clean_command, &cmd);
 
-        if (cmd.argc > 0 && strcmp(cmd.args[0], "cd") == 0) {
-            builtin_cd(&cmd);
-        } else if (cmd.argc > 0) {
+        // Builtins run right here and can reach the tab through these
+        BuiltinEnv env = {
+            .pm = tab->process_manager,
+            .history = mgr->history,
+            .foreground = tab_resume_job,
+            .exit_shell = tab_request_exit,
+            .report_stats = tab_report_stats,
+            .user_data = tab,
+        };
+
+        if (cmd.argc > 0) {
+            // Started in the tab's directory; the main loop drives it from here on
+            Job *job;
             if (has_pipe(cmd_to_exec)) {
                 Pipeline *p = parse_pipeline(cmd_to_exec);
-                output = execute_pipeline_with_signals(p, tab->process_manager, cmd_to_exec);
+                job = pipeline_start(p, original_cmd, &env, tab_output_callback, tab, &output);
                 free_pipeline(p);
             } else {
-                output = execute_command_with_signals(&cmd, &redir_info, 
-                                                     tab->process_manager, cmd_to_exec,
-                                                     &tab->interactive_fd);
+                job = command_start(&cmd, &redir_info, original_cmd, &env,
+                                    tab_output_callback, tab, &output);
+            }
+            if (job) {
+                tab_start_job(mgr, tab, job);
             }
         }
         
@@ -381,7 +574,7 @@ void tab_manager_execute_command(TabManager *mgr, const char *cmd_str) {
         }
     }
     
-    printf("[EXECUTE] Command execution completed, cleaning up\n");
+    printf("[EXECUTE] Command started, cleaning up\n");
     fflush(stdout);
     
     free(cmd_to_exec);
@@ -396,12 +589,10 @@ void tab_manager_execute_command(TabManager *mgr, const char *cmd_str) {
     if (mgr->history) {
         printf("[HISTORY] Adding command to history: '%s'\n", original_cmd);
         fflush(stdout);
+        // Adding it appends it to the history file too
         int result = history_manager_add_command(mgr->history, original_cmd);
         if (result == 0) {
-            printf("[HISTORY] Command added successfully, saving to file...\n");
-            fflush(stdout);
-            history_manager_save_to_file(mgr->history);
-            printf("[HISTORY] File saved\n");
+            printf("[HISTORY] Command added successfully\n");
             fflush(stdout);
         } else {
             printf("[HISTORY] ERROR: Failed to add command\n");
@@ -411,6 +602,14 @@ void tab_manager_execute_command(TabManager *mgr, const char *cmd_str) {
         printf("[HISTORY] ERROR: History manager is NULL!\n");
         fflush(stdout);
     }
+    free(original_cmd);
+
+    if (tab->exit_requested) {
+        int tab_index = (int)(tab - mgr->tabs);
+        printf("[EXECUTE] exit: closing tab %d\n", tab_index);
+        fflush(stdout);
+        tab_manager_close_tab(mgr, tab_index);
+    }
 }
 int tab_manager_handle_autocomplete(TabManager *mgr) {
     Tab *tab = tab_manager_get_active(mgr);
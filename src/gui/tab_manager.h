@@ -13,6 +13,9 @@
 
 struct TextBuffer;
 struct MultiWatch;
+struct EventLoop;
+struct Job;
+struct TabManager;
 
 typedef struct Tab{
     struct TextBuffer *buffer;
@@ -31,6 +34,9 @@ typedef struct Tab{
     AutocompleteResult autocomplete_result;  // Last autocomplete results
     char autocomplete_prefix[MAX_FILENAME_LENGTH];  // Original prefix typed
     int interactive_fd;
+    struct Job *job;                    // Foreground command while it runs
+    struct TabManager *manager;
+    int exit_requested;                 // `exit` ran; close once the command line is done
 } Tab;
 
 // Tab manager to handle multiple tabs
@@ -39,6 +45,9 @@ typedef struct TabManager{
     int active_tab;
     int num_tabs;
     HistoryManager *history;
+    struct EventLoop *event_loop;   // Reactor that watches per-tab descriptors (may be NULL)
+    int term_cols, term_rows;       // Text area size given to pseudo-terminals
+    int term_width, term_height;    // The same in pixels
 } TabManager;
 
 // Function Prototypes
@@ -50,13 +59,46 @@ void tab_manager_switch_tab(TabManager *mgr, int tab_index);
 Tab* tab_manager_get_active(TabManager *mgr);
 void tab_manager_execute_command(TabManager *mgr, const char *cmd_str);
 
+/**
+ * @brief Attach the main event loop so tabs can register their descriptors
+ * @param mgr Tab manager
+ * @param loop Event loop (job output and multiWatch sources are added to
+ * and removed from it). Without one, commands run to completion before
+ * tab_manager_execute_command returns.
+ */
+void tab_manager_set_event_loop(TabManager *mgr, struct EventLoop *loop);
+
+/**
+ * @brief Set the terminal size reported to commands running on a pty
+ * Resizes the pty of every running job (which then gets SIGWINCH) and is
+ * used for the ones started later.
+ * @param mgr Tab manager
+ * @param cols Columns of the text area
+ * @param rows Rows of the text area
+ * @param width Text area width in pixels
+ * @param height Text area height in pixels
+ */
+void tab_manager_set_terminal_size(TabManager *mgr, int cols, int rows, int width, int height);
+
+/**
+ * @brief Stop a tab's multiWatch session and unregister its sources
+ * @param mgr Tab manager
+ * @param tab Tab that owns the session
+ */
+void tab_manager_stop_multiwatch(TabManager *mgr, Tab *tab);
+
 // Signal handling functions
 void tab_manager_send_sigint(TabManager *mgr);
 void tab_manager_send_sigtstp(TabManager *mgr);
-void tab_manager_check_background_jobs(TabManager *mgr, void (*output_callback)(const char *));
+
+/**
+ * @brief Advance every tab's foreground job and reap its background jobs
+ * Call whenever a child may have changed state (SIGCHLD, zygote status).
+ * Output and notifications are appended to the tab that owns the job.
+ */
+void tab_manager_poll_jobs(TabManager *mgr);
 
 // History-related functions
-void tab_manager_show_history(TabManager *mgr);
 void tab_manager_enter_search_mode(TabManager *mgr);
 void tab_manager_execute_search(TabManager *mgr, const char *search_term);
 
@@ -0,0 +1,66 @@
+// src/gui/text_attrs.c
+#include "text_attrs.h"
+#include <stdlib.h>
+#include <string.h>
+
+void text_attr_log_init(TextAttrLog *log) {
+    memset(log, 0, sizeof(*log));
+}
+
+void text_attr_log_free(TextAttrLog *log) {
+    free(log->runs);
+    memset(log, 0, sizeof(*log));
+}
+
+static int reserve(TextAttrLog *log, size_t more) {
+    if (log->head + log->count + more <= log->capacity) return 0;
+
+    // Slide the live runs down before growing when half the array is dropped ones
+    if (log->head > 0 && log->head >= log->capacity / 2) {
+        memmove(log->runs, log->runs + log->head, log->count * sizeof(TextAttrRun));
+        log->head = 0;
+        if (log->count + more <= log->capacity) return 0;
+    }
+    size_t capacity = log->capacity ? log->capacity : 256;
+    while (capacity < log->head + log->count + more) capacity *= 2;
+    TextAttrRun *runs = realloc(log->runs, capacity * sizeof(TextAttrRun));
+    if (!runs) return -1;
+    log->runs = runs;
+    log->capacity = capacity;
+    return 0;
+}
+
+void text_attr_log_add(TextAttrLog *log, uint64_t line, const TextAttr *attrs, size_t len) {
+    TextAttr current = TEXT_ATTR_DEFAULT;
+    for (size_t col = 0; col < len; col++) {
+        if (attrs[col] == current) continue;
+        current = attrs[col];
+        if (reserve(log, 1) == -1) return;
+        log->runs[log->head + log->count++] = (TextAttrRun){ line, (uint32_t)col, current };
+    }
+}
+
+void text_attr_log_drop(TextAttrLog *log, uint64_t first_line) {
+    while (log->count > 0 && log->runs[log->head].line < first_line) {
+        log->head++;
+        log->count--;
+    }
+    if (log->count == 0) log->head = 0;
+}
+
+const TextAttrRun* text_attr_log_find(const TextAttrLog *log, uint64_t line, size_t *count) {
+    *count = 0;
+    const TextAttrRun *runs = log->runs + log->head;
+
+    // First run at or after the line
+    size_t lo = 0, hi = log->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (runs[mid].line < line) lo = mid + 1;
+        else hi = mid;
+    }
+    size_t end = lo;
+    while (end < log->count && runs[end].line == line) end++;
+    *count = end - lo;
+    return runs + lo;
+}
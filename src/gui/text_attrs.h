@@ -0,0 +1,72 @@
+// src/gui/text_attrs.h
+#ifndef TEXT_ATTRS_H
+#define TEXT_ATTRS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// How a character is drawn, packed into 32 bits: foreground and background
+// are 0 for the default colour or 1 + an index into the 256-colour palette
+// (0-15 the ANSI colours, 16-231 a 6x6x6 cube, 232-255 grays), then flags.
+typedef uint32_t TextAttr;
+
+#define TEXT_ATTR_DEFAULT   0u
+#define TEXT_ATTR_BOLD      (1u << 18)
+#define TEXT_ATTR_UNDERLINE (1u << 19)
+#define TEXT_ATTR_REVERSE   (1u << 20)
+
+// Palette index of the colours, or -1 for the default
+static inline int text_attr_fg(TextAttr attr) { return (int)(attr & 0x1ff) - 1; }
+static inline int text_attr_bg(TextAttr attr) { return (int)((attr >> 9) & 0x1ff) - 1; }
+
+static inline TextAttr text_attr_set_fg(TextAttr attr, int index) {
+    return (attr & ~0x1ffu) | (TextAttr)(index + 1);
+}
+
+static inline TextAttr text_attr_set_bg(TextAttr attr, int index) {
+    return (attr & ~(0x1ffu << 9)) | ((TextAttr)(index + 1) << 9);
+}
+
+// From col on (to the next run or the end of the line), a line is drawn with attr
+typedef struct {
+    uint64_t line;              // Absolute scrollback line number
+    uint32_t col;
+    TextAttr attr;
+} TextAttrRun;
+
+// The attributes of finished lines, as runs in line order. Lines drawn
+// entirely in the default colours, most of them, take no room at all.
+typedef struct {
+    TextAttrRun *runs;          // Live runs are runs[head, head + count)
+    size_t head;
+    size_t count;
+    size_t capacity;
+} TextAttrLog;
+
+void text_attr_log_init(TextAttrLog *log);
+void text_attr_log_free(TextAttrLog *log);
+
+/**
+ * @brief Record the attributes of a finished line
+ * @param log Attribute log
+ * @param line Its absolute line number, above any recorded so far
+ * @param attrs One per byte of the line
+ * @param len Bytes in the line
+ */
+void text_attr_log_add(TextAttrLog *log, uint64_t line, const TextAttr *attrs, size_t len);
+
+/**
+ * @brief Forget the runs of lines before first_line (dropped from scrollback)
+ */
+void text_attr_log_drop(TextAttrLog *log, uint64_t first_line);
+
+/**
+ * @brief Find a line's runs
+ * @param log Attribute log
+ * @param line Absolute line number
+ * @param count Receives how many there are (0: all default)
+ * @return Its runs in column order, valid until the log is next changed
+ */
+const TextAttrRun* text_attr_log_find(const TextAttrLog *log, uint64_t line, size_t *count);
+
+#endif // TEXT_ATTRS_H
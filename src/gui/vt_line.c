@@ -0,0 +1,87 @@
+// src/gui/vt_line.c
+#include "vt_line.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define VT_LINE_INITIAL 256
+
+int vt_line_init(VtLine *line) {
+    memset(line, 0, sizeof(*line));
+    line->text = malloc(VT_LINE_INITIAL + 1);
+    line->attrs = malloc(VT_LINE_INITIAL * sizeof(TextAttr));
+    if (!line->text || !line->attrs) {
+        vt_line_free(line);
+        return -1;
+    }
+    line->capacity = VT_LINE_INITIAL;
+    return 0;
+}
+
+void vt_line_free(VtLine *line) {
+    free(line->text);
+    free(line->attrs);
+    memset(line, 0, sizeof(*line));
+}
+
+static int reserve(VtLine *line, size_t len) {
+    if (len <= line->capacity) return 0;
+    size_t capacity = line->capacity * 2;
+    while (capacity < len) capacity *= 2;
+    char *text = realloc(line->text, capacity + 1);
+    if (!text) return -1;
+    line->text = text;
+    TextAttr *attrs = realloc(line->attrs, capacity * sizeof(TextAttr));
+    if (!attrs) return -1;
+    line->attrs = attrs;
+    line->capacity = capacity;
+    return 0;
+}
+
+static void blank(VtLine *line, size_t from, size_t to) {
+    memset(line->text + from, ' ', to - from);
+    for (size_t i = from; i < to; i++) line->attrs[i] = TEXT_ATTR_DEFAULT;
+}
+
+void vt_line_write(VtLine *line, const char *text, size_t len, TextAttr attr) {
+    size_t end = line->cursor + len;
+    if (reserve(line, end) == -1) return;
+    if (line->cursor > line->len) blank(line, line->len, line->cursor);
+
+    memcpy(line->text + line->cursor, text, len);
+    TextAttr *attrs = line->attrs + line->cursor;
+    for (size_t i = 0; i < len; i++) attrs[i] = attr;
+    line->cursor = end;
+    if (end > line->len) line->len = end;
+}
+
+void vt_line_erase(VtLine *line, size_t from, size_t to) {
+    if (to >= line->len) {
+        if (from < line->len) line->len = from;
+        return;
+    }
+    if (from < to) blank(line, from, to);
+}
+
+void vt_line_delete(VtLine *line, size_t n) {
+    if (line->cursor >= line->len) return;
+    size_t left = line->len - line->cursor;
+    if (n > left) n = left;
+    memmove(line->text + line->cursor, line->text + line->cursor + n, left - n);
+    memmove(line->attrs + line->cursor, line->attrs + line->cursor + n, (left - n) * sizeof(TextAttr));
+    line->len -= n;
+}
+
+void vt_line_insert(VtLine *line, size_t n) {
+    if (line->cursor >= line->len) return;
+    if (reserve(line, line->len + n) == -1) return;
+    size_t left = line->len - line->cursor;
+    memmove(line->text + line->cursor + n, line->text + line->cursor, left);
+    memmove(line->attrs + line->cursor + n, line->attrs + line->cursor, left * sizeof(TextAttr));
+    blank(line, line->cursor, line->cursor + n);
+    line->len += n;
+}
+
+void vt_line_clear(VtLine *line) {
+    line->len = 0;
+    line->cursor = 0;
+}
@@ -0,0 +1,48 @@
+// src/gui/vt_line.h
+#ifndef VT_LINE_H
+#define VT_LINE_H
+
+#include "text_attrs.h"
+#include <stddef.h>
+
+// The line the cursor is on, as a row of cells (one per byte, each with its
+// attributes) that escape sequences can still overwrite, erase, insert into
+// and delete from. It goes to the scrollback when a line feed finishes it.
+typedef struct {
+    char *text;                 // Room for one byte more, for the '\n'
+    TextAttr *attrs;
+    size_t len;
+    size_t capacity;
+    size_t cursor;              // Column, may be past the end
+} VtLine;
+
+int vt_line_init(VtLine *line);
+void vt_line_free(VtLine *line);
+
+/**
+ * @brief Write text at the cursor, over what is there, and move past it;
+ * a cursor past the end pads the line with blanks first
+ */
+void vt_line_write(VtLine *line, const char *text, size_t len, TextAttr attr);
+
+/**
+ * @brief Blank the cells [from, to); erasing to the end shortens the line
+ */
+void vt_line_erase(VtLine *line, size_t from, size_t to);
+
+/**
+ * @brief Delete n cells at the cursor, pulling the rest of the line left
+ */
+void vt_line_delete(VtLine *line, size_t n);
+
+/**
+ * @brief Insert n blanks at the cursor, pushing the rest of the line right
+ */
+void vt_line_insert(VtLine *line, size_t n);
+
+/**
+ * @brief Empty the line and put the cursor at its start
+ */
+void vt_line_clear(VtLine *line);
+
+#endif // VT_LINE_H
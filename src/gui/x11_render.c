@@ -1,48 +1,421 @@
 // in src/gui/x11_render.c
 #include "x11_render.h"
 #include "tab_manager.h"
+#include "byte_scan.h"
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <limits.h>
+#include <time.h>
+
+static size_t g_scrollback_lines = MAX_LINES;
+
+// What is on the window, so a frame only draws what changed
+static struct {
+    Display *display;           // For freeing pixmaps along with their buffers
+    TextBuffer *buf;            // Buffer shown, NULL to present it again
+    int tabs_valid;             // The tab bar below is up to date
+    int active_tab;
+    unsigned tabs;              // Bit i set if tab i is open
+    int tabs_width;
+    unsigned char *rows;        // Rows to draw this frame
+    ViewRow *layout;            // What they will show
+    int rows_capacity;
+    TextAttrRun *spans;         // Where a row's attributes change
+    int spans_capacity;
+    unsigned long palette[256]; // Pixels of the 256 colours ...
+    unsigned char allocated[256];   // ... once allocated
+
+    // Measuring
+    RenderStats stats;
+    unsigned long last_request; // XNextRequest() at the end of the last frame
+    unsigned long window_requests;
+    double window_start;
+} g_render;
+
+void text_buffer_set_scrollback_lines(size_t lines) {
+    g_scrollback_lines = lines;
+}
+
+static const VtHandler g_vt_handler;
 
 TextBuffer* text_buffer_init() {
     TextBuffer *buf = malloc(sizeof(TextBuffer));
     if (!buf) { perror("malloc"); return NULL; }
+    if (scrollback_init(&buf->scrollback, g_scrollback_lines) == -1) {
+        free(buf);
+        return NULL;
+    }
+    if (vt_line_init(&buf->line) == -1) {
+        perror("malloc");
+        scrollback_free(&buf->scrollback);
+        free(buf);
+        return NULL;
+    }
+    text_attr_log_init(&buf->attrs);
+    vt_parser_init(&buf->parser, &g_vt_handler, buf);
+    buf->attr = TEXT_ATTR_DEFAULT;
+    buf->saved_col = 0;
+    buf->saved_attr = TEXT_ATTR_DEFAULT;
+    buf->screen_rows = 24;
+    buf->scroll_top = buf->scroll_bottom = -1;
     buf->line_count = 1;
     buf->cursor_line = 0;
     buf->cursor_col = 0;
     buf->scroll_offset = 0;  // NEW: Initialize scroll offset
-    memset(buf->lines, 0, sizeof(buf->lines));
+    buf->dirty_from = 0;
+    memset(&buf->view, 0, sizeof(TextView));
+    buf->view.pixmap = None;
     return buf;
 }
 
 void text_buffer_free(TextBuffer *buf) {
+    if (!buf) return;
+    if (g_render.buf == buf) g_render.buf = NULL;   // A new buffer may get its address
+    if (buf->view.pixmap != None && g_render.display) XFreePixmap(g_render.display, buf->view.pixmap);
+    free(buf->view.rows);
+    vt_line_free(&buf->line);
+    text_attr_log_free(&buf->attrs);
+    scrollback_free(&buf->scrollback);
     free(buf);
 }
 
+void text_buffer_set_screen_rows(TextBuffer *buf, int rows) {
+    if (buf && rows > 0) buf->screen_rows = rows;
+}
+
 void text_buffer_append(TextBuffer *buf, const char *text) {
-    for (int i = 0; text[i] != '\0'; ++i) {
-        if (text[i] == '\n' || buf->cursor_col >= MAX_LINE_LENGTH - 1) {
-            buf->cursor_line++;
-            buf->cursor_col = 0;
-            if (buf->cursor_line >= MAX_LINES) {
-                memmove(buf->lines[0], buf->lines[1], (MAX_LINES - 1) * MAX_LINE_LENGTH);
-                memset(buf->lines[MAX_LINES - 1], 0, MAX_LINE_LENGTH);
-                buf->cursor_line = MAX_LINES - 1;
+    text_buffer_append_len(buf, text, strlen(text));
+}
+
+// ---- Escape sequences ----
+//
+// The cursor line is a row of cells the parser's callbacks edit; a line
+// feed moves it, with its attribute runs, into the scrollback.
+
+// A line that never ends is broken here rather than held as cells forever
+#define VT_LINE_MAX (1 << 20)
+
+static void finish_line(TextBuffer *buf) {
+    VtLine *line = &buf->line;
+    text_attr_log_add(&buf->attrs, buf->scrollback.end_line - 1, line->attrs, line->len);
+    line->text[line->len] = '\n';
+    scrollback_append(&buf->scrollback, line->text, line->len + 1);
+    vt_line_clear(line);
+    text_attr_log_drop(&buf->attrs, buf->scrollback.first_line);
+}
+
+static void blank_lines(TextBuffer *buf, int count) {
+    if (buf->line.len > 0) finish_line(buf);
+    for (int i = 0; i < count; i++) scrollback_append(&buf->scrollback, "\n", 1);
+    buf->line.cursor = 0;
+}
+
+// Scrolling only adds lines when it moves the whole screen: scrolling part
+// of it would have to change lines already in the scrollback
+static int scrolls_whole_screen(const TextBuffer *buf) {
+    return buf->scroll_top <= 0 && (buf->scroll_bottom < 0 || buf->scroll_bottom >= buf->screen_rows - 1);
+}
+
+static void vt_print(void *user_data, const char *text, size_t len) {
+    TextBuffer *buf = user_data;
+    while (len > 0) {
+        size_t room = buf->line.cursor < VT_LINE_MAX ? VT_LINE_MAX - buf->line.cursor : 0;
+        size_t n = len < room ? len : room;
+        vt_line_write(&buf->line, text, n, buf->attr);
+        if (buf->line.cursor >= VT_LINE_MAX) finish_line(buf);
+        text += n;
+        len -= n;
+    }
+}
+
+static void vt_execute(void *user_data, unsigned char c) {
+    TextBuffer *buf = user_data;
+    VtLine *line = &buf->line;
+    switch (c) {
+        case '\n': case '\v': case '\f':
+            finish_line(buf);
+            break;
+        case '\r':
+            line->cursor = 0;
+            break;
+        case '\b':
+            if (line->cursor > 0) line->cursor--;
+            break;
+        case '\t':
+            line->cursor = (line->cursor / 8 + 1) * 8;
+            break;
+        default:
+            break;  // BEL, SO/SI... nothing to show
+    }
+}
+
+// Palette index of an extended colour (38;5;n or 38;2;r;g;b); *i is moved
+// past its parameters
+static int extended_color(const VtParser *parser, int *i) {
+    int kind = vt_param(parser, *i + 1, 0);
+    if (kind == 5) {
+        int index = vt_param(parser, *i + 2, 0);
+        *i += 2;
+        return index < 256 ? index : 255;
+    }
+    if (kind == 2) {
+        int r = vt_param(parser, *i + 2, 0), g = vt_param(parser, *i + 3, 0), b = vt_param(parser, *i + 4, 0);
+        *i += 4;
+        // Nearest colour of the 6x6x6 cube
+        #define CUBE(v) ((v) < 48 ? 0 : (v) < 115 ? 1 : ((v) - 35) / 40 > 5 ? 5 : ((v) - 35) / 40)
+        return 16 + 36 * CUBE(r) + 6 * CUBE(g) + CUBE(b);
+        #undef CUBE
+    }
+    *i += 1;
+    return -1;
+}
+
+static void select_graphic_rendition(TextBuffer *buf, const VtParser *parser) {
+    TextAttr attr = buf->attr;
+    int count = parser->num_params > 0 ? parser->num_params : 1;
+    for (int i = 0; i < count; i++) {
+        int p = vt_param(parser, i, 0);
+        if (p == 0) attr = TEXT_ATTR_DEFAULT;
+        else if (p == 1) attr |= TEXT_ATTR_BOLD;
+        else if (p == 4) attr |= TEXT_ATTR_UNDERLINE;
+        else if (p == 7) attr |= TEXT_ATTR_REVERSE;
+        else if (p == 22) attr &= ~TEXT_ATTR_BOLD;
+        else if (p == 24) attr &= ~TEXT_ATTR_UNDERLINE;
+        else if (p == 27) attr &= ~TEXT_ATTR_REVERSE;
+        else if (p >= 30 && p <= 37) attr = text_attr_set_fg(attr, p - 30);
+        else if (p == 39) attr = text_attr_set_fg(attr, -1);
+        else if (p >= 40 && p <= 47) attr = text_attr_set_bg(attr, p - 40);
+        else if (p == 49) attr = text_attr_set_bg(attr, -1);
+        else if (p >= 90 && p <= 97) attr = text_attr_set_fg(attr, p - 90 + 8);
+        else if (p >= 100 && p <= 107) attr = text_attr_set_bg(attr, p - 100 + 8);
+        else if (p == 38) attr = text_attr_set_fg(attr, extended_color(parser, &i));
+        else if (p == 48) attr = text_attr_set_bg(attr, extended_color(parser, &i));
+    }
+    buf->attr = attr;
+}
+
+static void vt_csi_dispatch(void *user_data, const VtParser *parser, unsigned char final) {
+    TextBuffer *buf = user_data;
+    VtLine *line = &buf->line;
+    // Modes (?25l, ?1049h...) and the like change nothing a log can show
+    if (vt_private_marker(parser) || parser->num_intermediates > 0) return;
+
+    size_t n = (size_t)vt_param(parser, 0, 1);
+    switch (final) {
+        case 'm':
+            select_graphic_rendition(buf, parser);
+            break;
+        case 'C': case 'a':                 // CUF, HPR
+            line->cursor += n;
+            break;
+        case 'D':                           // CUB
+            line->cursor = line->cursor > n ? line->cursor - n : 0;
+            break;
+        case 'G': case '`':                 // CHA, HPA
+            line->cursor = n - 1;
+            break;
+        case 'H': case 'f':                 // CUP: only the column applies
+            line->cursor = (size_t)vt_param(parser, 1, 1) - 1;
+            break;
+        case 'K':                           // EL
+        case 'J': {                         // ED: the cursor line is the last one
+            int mode = vt_param(parser, 0, 0);
+            if (final == 'J' && mode >= 2) {
+                blank_lines(buf, buf->screen_rows);
+            } else if (mode == 0) {
+                vt_line_erase(line, line->cursor, SIZE_MAX);
+            } else if (mode == 1) {
+                vt_line_erase(line, 0, line->cursor + 1);
+            } else {
+                vt_line_erase(line, 0, SIZE_MAX);
             }
-            if (buf->cursor_line >= buf->line_count) {
-                buf->line_count = buf->cursor_line + 1;
+            break;
+        }
+        case 'X':                           // ECH
+            vt_line_erase(line, line->cursor, line->cursor + n);
+            break;
+        case 'P':                           // DCH
+            vt_line_delete(line, n);
+            break;
+        case '@':                           // ICH
+            vt_line_insert(line, n);
+            break;
+        case 'S':                           // SU
+            if (scrolls_whole_screen(buf)) {
+                size_t cursor = line->cursor;
+                blank_lines(buf, (int)(n < (size_t)buf->screen_rows ? n : (size_t)buf->screen_rows));
+                line->cursor = cursor;
             }
+            break;
+        case 'r': {                         // DECSTBM
+            int top = vt_param(parser, 0, 1), bottom = vt_param(parser, 1, buf->screen_rows);
+            if (top < bottom) {
+                buf->scroll_top = top - 1;
+                buf->scroll_bottom = bottom - 1;
+            } else {
+                buf->scroll_top = buf->scroll_bottom = -1;
+            }
+            break;
+        }
+        default:
+            break;  // Moving up or down the screen, reports...
+    }
+}
+
+static void vt_esc_dispatch(void *user_data, const VtParser *parser, unsigned char final) {
+    TextBuffer *buf = user_data;
+    if (parser->num_intermediates > 0) return;  // Character sets
+    switch (final) {
+        case 'D':                           // IND
+            if (scrolls_whole_screen(buf)) {
+                size_t cursor = buf->line.cursor;
+                finish_line(buf);
+                buf->line.cursor = cursor;
+            }
+            break;
+        case 'E':                           // NEL
+            finish_line(buf);
+            break;
+        case '7':                           // DECSC
+            buf->saved_col = buf->line.cursor;
+            buf->saved_attr = buf->attr;
+            break;
+        case '8':                           // DECRC
+            buf->line.cursor = buf->saved_col;
+            buf->attr = buf->saved_attr;
+            break;
+        case 'c':                           // RIS
+            buf->attr = TEXT_ATTR_DEFAULT;
+            buf->scroll_top = buf->scroll_bottom = -1;
+            blank_lines(buf, buf->screen_rows);
+            break;
+        default:
+            break;
+    }
+}
+
+static const VtHandler g_vt_handler = {
+    .print = vt_print,
+    .execute = vt_execute,
+    .csi_dispatch = vt_csi_dispatch,
+    .esc_dispatch = vt_esc_dispatch,
+    .osc_dispatch = NULL,
+};
+
+// Appends the whole lines at the start of text that are only printable
+// bytes, ending in "\n" or "\r\n", straight to the scrollback. Returns the
+// bytes used.
+static size_t append_plain_lines(TextBuffer *buf, const char *text, size_t len) {
+    const unsigned char *p = (const unsigned char *)text;
+    size_t start = 0, done = 0;
+    for (size_t i = 0; i < len; i++) {
+        i += byte_scan_text(text + i, len - i);
+        if (i == len) break;
+        unsigned char c = p[i];
+        if (c == '\n') {
+            done = i + 1;
+        } else if (c == '\r' && i + 1 < len && p[i + 1] == '\n') {
+            scrollback_append(&buf->scrollback, text + start, i - start);
+            start = ++i;
+            done = i + 1;
         } else {
-            buf->lines[buf->cursor_line][buf->cursor_col] = text[i];
-            buf->cursor_col++;
+            break;
+        }
+    }
+    if (done > start) scrollback_append(&buf->scrollback, text + start, done - start);
+    return done;
+}
+
+// Appends raw bytes (not NUL-terminated), e.g. a chunk streamed from a child pipe
+void text_buffer_append_len(TextBuffer *buf, const char *text, size_t len) {
+    // The cursor line may change; lines after it are new
+    uint64_t current = buf->scrollback.end_line - 1;
+    if (current < buf->dirty_from) buf->dirty_from = current;
+
+    while (len > 0) {
+        // Nothing pending and nothing set: plain lines don't need parsing
+        if (buf->parser.state == VT_GROUND && buf->line.len == 0 && buf->line.cursor == 0 &&
+            buf->attr == TEXT_ATTR_DEFAULT) {
+            size_t used = append_plain_lines(buf, text, len);
+            text += used;
+            len -= used;
+            if (len == 0) break;
         }
+        // Parse up to the next line feed, after which the above may apply again
+        const char *newline = memchr(text, '\n', len);
+        size_t n = newline ? (size_t)(newline - text) + 1 : len;
+        vt_parser_feed(&buf->parser, text, n);
+        text += n;
+        len -= n;
     }
+
+    size_t count = scrollback_line_count(&buf->scrollback);
+    buf->line_count = count > INT_MAX ? INT_MAX : (int)count;
+    buf->cursor_line = buf->line_count - 1;
+    buf->cursor_col = buf->line.cursor > INT_MAX ? INT_MAX : (int)buf->line.cursor;
+    buf->view.width_line = UINT64_MAX;  // The cursor line may have changed in place
     
     // NEW: Auto-scroll to bottom when new content is added
     buf->scroll_offset = 0;
 }
 
+const char* text_buffer_get_line(TextBuffer *buf, int index, size_t *len) {
+    if (!buf || index < 0) return NULL;
+    // Past INT_MAX lines, line_count stops growing and shows the newest ones
+    size_t count = scrollback_line_count(&buf->scrollback);
+    size_t skip = count - buf->line_count;
+    if (skip + index == count - 1) {
+        *len = buf->line.len;
+        return buf->line.text;
+    }
+    return scrollback_line(&buf->scrollback, skip + index, len);
+}
+
+// Absolute scrollback line number of a line of the buffer
+static uint64_t absolute_line(const TextBuffer *buf, int index) {
+    size_t skip = scrollback_line_count(&buf->scrollback) - buf->line_count;
+    return buf->scrollback.first_line + skip + index;
+}
+
+void text_buffer_mark_dirty(TextBuffer *buf, int index) {
+    if (!buf || index < 0 || index >= buf->line_count) return;
+    uint64_t line = absolute_line(buf, index);
+    if (line < buf->dirty_from) buf->dirty_from = line;
+}
+
+// Rows a line of len bytes wraps onto; an empty line still takes one
+static int wrap_rows(size_t len, int columns) {
+    return len == 0 ? 1 : (int)((len - 1) / columns + 1);
+}
+
+int render_text_width(X11Context *ctx, const char *text, int len) {
+    XFontStruct *font = ctx->font;
+    if (!font->per_char || font->min_bounds.width == font->max_bounds.width) {
+        return len * font->max_bounds.width;
+    }
+    return XTextWidth(font, text, len);
+}
+
+int text_buffer_line_width(X11Context *ctx, TextBuffer *buf, int index) {
+    size_t len;
+    const char *text = text_buffer_get_line(buf, index, &len);
+    if (!text) return 0;
+    int columns = text_buffer_get_visible_columns(ctx);
+
+    // A line only changes by growing, so its number and length identify it
+    TextView *view = &buf->view;
+    uint64_t line = absolute_line(buf, index);
+    if (view->width_line != line || view->width_len != len || view->width_columns != columns) {
+        size_t start = (size_t)(wrap_rows(len, columns) - 1) * columns;
+        view->width_line = line;
+        view->width_len = len;
+        view->width_columns = columns;
+        view->width_pixels = render_text_width(ctx, text + start, (int)(len - start));
+    }
+    return view->width_pixels;
+}
+
 // NEW: Get number of visible lines in the window
 int text_buffer_get_visible_lines(X11Context *ctx) {
     int font_height = ctx->font->ascent + ctx->font->descent;
@@ -50,16 +423,24 @@ int text_buffer_get_visible_lines(X11Context *ctx) {
     return available_height / font_height;
 }
 
+// Number of characters that fit across the text area (10px margin each side)
+int text_buffer_get_visible_columns(X11Context *ctx) {
+    int char_width = ctx->font->max_bounds.width;
+    if (char_width <= 0) char_width = 1;
+    int columns = (ctx->width - 20) / char_width;
+    return columns > 0 ? columns : 1;
+}
+
 // NEW: Scroll up by specified number of lines
 void text_buffer_scroll_up(TextBuffer *buf, int lines) {
     if (!buf) return;
     
-    buf->scroll_offset += lines;
-    
     // Limit scroll offset to prevent scrolling beyond the buffer
     int max_scroll = buf->line_count - 1;
-    if (buf->scroll_offset > max_scroll) {
+    if (lines > max_scroll - buf->scroll_offset) {
         buf->scroll_offset = max_scroll;
+    } else {
+        buf->scroll_offset += lines;
     }
 }
 
@@ -81,7 +462,197 @@ void text_buffer_scroll_to_bottom(TextBuffer *buf) {
     buf->scroll_offset = 0;
 }
 
+// ---- Batching ----
+//
+// Drawing into a back buffer is queued during a frame and sent by
+// render_present(): all background fills in one PolyFillRectangle, all
+// runs of text on a row in one PolyText8 (core text can't change baseline
+// within a request), and all cursor boxes in one more PolyFillRectangle,
+// with the GC's colour changed only between those groups. Coloured
+// backgrounds and underlines are one PolyFillRectangle per colour, and
+// coloured text one PolyText8 per colour and row.
+
+typedef struct {
+    int x, y;
+    int colored;                // Drawn in pixel rather than black
+    unsigned long pixel;
+    size_t text;                // Offset of the bytes in the arena
+    int len;
+} TextRun;
+
+typedef struct {
+    XRectangle rect;
+    unsigned long pixel;
+} ColorFill;
+
+static struct {
+    XRectangle *clears;
+    int num_clears, clears_capacity;
+    XRectangle *boxes;
+    int num_boxes, boxes_capacity;
+    ColorFill *fills;           // Backgrounds and underlines, under the text
+    int num_fills, fills_capacity;
+    XRectangle *scratch;        // One colour's fills
+    int scratch_capacity;
+    TextRun *runs;
+    int num_runs, runs_capacity;
+    XTextItem *items;           // Scratch for one row's runs
+    int items_capacity;
+    char *arena;                // Copies of the text: lines may move once read again
+    size_t arena_len, arena_capacity;
+} g_batch;
+
+// Makes room for one more element in a queue
+static int grow(void **array, int count, int *capacity, size_t size) {
+    if (count < *capacity) return 0;
+    int new_capacity = *capacity ? *capacity * 2 : 64;
+    void *grown = realloc(*array, new_capacity * size);
+    if (!grown) return -1;
+    *array = grown;
+    *capacity = new_capacity;
+    return 0;
+}
+
+static void queue_rect(XRectangle **rects, int *count, int *capacity, int x, int y, int w, int h) {
+    if (grow((void **)rects, *count, capacity, sizeof(XRectangle)) == -1) return;
+    (*rects)[(*count)++] = (XRectangle){ (short)x, (short)y, (unsigned short)w, (unsigned short)h };
+}
+
+static void queue_clear(int x, int y, int width, int height) {
+    queue_rect(&g_batch.clears, &g_batch.num_clears, &g_batch.clears_capacity, x, y, width, height);
+}
+
+void render_queue_box(int x, int y, int width, int height) {
+    queue_rect(&g_batch.boxes, &g_batch.num_boxes, &g_batch.boxes_capacity, x, y, width, height);
+}
+
+static void queue_fill(int x, int y, int width, int height, unsigned long pixel) {
+    if (grow((void **)&g_batch.fills, g_batch.num_fills, &g_batch.fills_capacity, sizeof(ColorFill)) == -1) return;
+    g_batch.fills[g_batch.num_fills++] = (ColorFill){
+        { (short)x, (short)y, (unsigned short)width, (unsigned short)height }, pixel };
+}
+
+static void queue_run(int x, int y, const char *text, int len, int colored, unsigned long pixel) {
+    if (len <= 0) return;
+    if (g_batch.arena_capacity - g_batch.arena_len < (size_t)len) {
+        size_t capacity = g_batch.arena_capacity ? g_batch.arena_capacity : 4096;
+        while (capacity - g_batch.arena_len < (size_t)len) capacity *= 2;
+        char *arena = realloc(g_batch.arena, capacity);
+        if (!arena) return;
+        g_batch.arena = arena;
+        g_batch.arena_capacity = capacity;
+    }
+    if (grow((void **)&g_batch.runs, g_batch.num_runs, &g_batch.runs_capacity, sizeof(TextRun)) == -1) return;
+
+    memcpy(g_batch.arena + g_batch.arena_len, text, len);
+    g_batch.runs[g_batch.num_runs++] = (TextRun){ x, y, colored, pixel, g_batch.arena_len, len };
+    g_batch.arena_len += len;
+}
+
+void render_queue_text(int x, int y, const char *text, int len) {
+    queue_run(x, y, text, len, 0, 0);
+}
+
+static int same_color(const TextRun *a, const TextRun *b) {
+    return a->colored == b->colored && (!a->colored || a->pixel == b->pixel);
+}
+
+// Black first, then by colour, then top to bottom, then left to right
+static int compare_runs(const void *a, const void *b) {
+    const TextRun *ra = a, *rb = b;
+    if (ra->colored != rb->colored) return ra->colored - rb->colored;
+    if (ra->colored && ra->pixel != rb->pixel) return ra->pixel < rb->pixel ? -1 : 1;
+    if (ra->y != rb->y) return ra->y < rb->y ? -1 : 1;
+    return (ra->x > rb->x) - (ra->x < rb->x);
+}
+
+static int compare_fills(const void *a, const void *b) {
+    const ColorFill *fa = a, *fb = b;
+    return (fa->pixel > fb->pixel) - (fa->pixel < fb->pixel);
+}
+
+static void flush_fills(X11Context *ctx, Drawable d) {
+    qsort(g_batch.fills, g_batch.num_fills, sizeof(ColorFill), compare_fills);
+    for (int i = 0, end; i < g_batch.num_fills; i = end) {
+        for (end = i + 1; end < g_batch.num_fills && g_batch.fills[end].pixel == g_batch.fills[i].pixel; end++) {}
+        while (g_batch.scratch_capacity < end - i) {
+            if (grow((void **)&g_batch.scratch, g_batch.scratch_capacity, &g_batch.scratch_capacity,
+                     sizeof(XRectangle)) == -1) break;
+        }
+        if (g_batch.scratch_capacity < end - i) continue;
+        for (int j = i; j < end; j++) g_batch.scratch[j - i] = g_batch.fills[j].rect;
+        XSetForeground(ctx->display, ctx->gc, g_batch.fills[i].pixel);
+        XFillRectangles(ctx->display, d, ctx->gc, g_batch.scratch, end - i);
+    }
+    if (g_batch.num_fills > 0) XSetForeground(ctx->display, ctx->gc, ctx->black_pixel);
+}
+
+// Sends everything queued for d
+static void flush_batch(X11Context *ctx, Drawable d) {
+    if (g_batch.num_clears > 0) {
+        XSetForeground(ctx->display, ctx->gc, ctx->white_pixel);
+        XFillRectangles(ctx->display, d, ctx->gc, g_batch.clears, g_batch.num_clears);
+        XSetForeground(ctx->display, ctx->gc, ctx->black_pixel);
+    }
+    flush_fills(ctx, d);
+
+    qsort(g_batch.runs, g_batch.num_runs, sizeof(TextRun), compare_runs);
+    const TextRun *color = NULL;    // Colour the GC has, NULL for black
+    for (int i = 0, end; i < g_batch.num_runs; i = end) {
+        TextRun *first = &g_batch.runs[i];
+        for (end = i + 1; end < g_batch.num_runs && g_batch.runs[end].y == first->y &&
+                          same_color(&g_batch.runs[end], first); end++) {}
+        while (g_batch.items_capacity < end - i) {
+            if (grow((void **)&g_batch.items, g_batch.items_capacity, &g_batch.items_capacity,
+                     sizeof(XTextItem)) == -1) break;
+        }
+        if (g_batch.items_capacity < end - i) continue;
+
+        // The runs on one row, each placed relative to where the last one ended
+        int pen = first->x;
+        for (int j = i; j < end; j++) {
+            TextRun *run = &g_batch.runs[j];
+            XTextItem *item = &g_batch.items[j - i];
+            item->chars = g_batch.arena + run->text;
+            item->nchars = run->len;
+            item->delta = run->x - pen;
+            item->font = None;
+            pen = run->x + render_text_width(ctx, item->chars, run->len);
+        }
+        if (first->colored && (!color || color->pixel != first->pixel)) {
+            color = first;
+            XSetForeground(ctx->display, ctx->gc, first->pixel);
+        }
+        XDrawText(ctx->display, d, ctx->gc, first->x, first->y, g_batch.items, end - i);
+    }
+    if (color) XSetForeground(ctx->display, ctx->gc, ctx->black_pixel);
+
+    if (g_batch.num_boxes > 0) {
+        XFillRectangles(ctx->display, d, ctx->gc, g_batch.boxes, g_batch.num_boxes);
+    }
+    g_batch.num_clears = g_batch.num_boxes = g_batch.num_runs = g_batch.num_fills = 0;
+    g_batch.arena_len = 0;
+}
+
+void render_invalidate(void) {
+    g_render.buf = NULL;
+    g_render.tabs_valid = 0;
+}
+
 void render_tabs(X11Context *ctx, struct TabManager *mgr) {
+    unsigned tabs = 0;
+    for (int i = 0; i < MAX_TABS; ++i) {
+        if (mgr->tabs[i].active) tabs |= 1u << i;
+    }
+    if (g_render.tabs_valid && g_render.tabs == tabs && g_render.active_tab == mgr->active_tab &&
+        g_render.tabs_width == ctx->width) {
+        return;
+    }
+    g_render.tabs_valid = 1;
+    g_render.tabs_width = ctx->width;
+    g_render.tabs = tabs;
+    g_render.active_tab = mgr->active_tab;
+
     XSetForeground(ctx->display, ctx->gc, 0xDDDDDD); // Light gray
     XFillRectangle(ctx->display, ctx->window, ctx->gc, 0, 0, ctx->width, TAB_BAR_HEIGHT);
 
@@ -106,51 +677,325 @@ void render_tabs(X11Context *ctx, struct TabManager *mgr) {
     }
 }
 
-void render_text_buffer(X11Context *ctx, TextBuffer *buf) {
-    XClearArea(ctx->display, ctx->window, 0, TAB_BAR_HEIGHT, ctx->width, ctx->height - TAB_BAR_HEIGHT, False);
-    
+// A window-sized pixmap for the buffer; a new one has nothing drawn
+static void ensure_pixmap(X11Context *ctx, TextView *view) {
+    if (view->pixmap != None && view->width == ctx->width && view->height == ctx->height) return;
+    if (view->pixmap != None) XFreePixmap(ctx->display, view->pixmap);
+    view->pixmap = XCreatePixmap(ctx->display, ctx->window, ctx->width, ctx->height,
+                                 DefaultDepth(ctx->display, ctx->screen));
+    view->width = ctx->width;
+    view->height = ctx->height;
+    view->valid = 0;
+    g_render.display = ctx->display;
+}
+
+static int same_row(const ViewRow *a, const ViewRow *b) {
+    return a->line == b->line && a->seg == b->seg;
+}
+
+// Lays out the rows the view shows, into out (room for visible rows):
+// the line scroll_offset lines above the last one ends on the bottom row,
+// unless the lines above it don't fill the screen, in which case line 0
+// starts on the top row. Only lines on screen are measured, so a resize
+// costs the same with a million lines of scrollback as with fifty.
+// Returns the number of rows with text.
+static int layout_rows(TextBuffer *buf, int visible, int columns, ViewRow *out) {
+    uint64_t base = absolute_line(buf, 0);
+    int bottom = buf->line_count - 1 - buf->scroll_offset;
+    if (bottom < 0) bottom = 0;
+
+    int pos = visible;
+    for (int i = bottom; i >= 0 && pos > 0; i--) {
+        size_t len;
+        text_buffer_get_line(buf, i, &len);
+        for (int seg = wrap_rows(len, columns) - 1; seg >= 0 && pos > 0; seg--) {
+            out[--pos] = (ViewRow){ base + i, (uint32_t)seg, 0 };
+        }
+    }
+    if (pos == 0) return visible;
+
+    int count = visible - pos;
+    memmove(out, out + pos, count * sizeof(ViewRow));
+    for (int i = bottom + 1; i < buf->line_count && count < visible; i++) {
+        size_t len;
+        text_buffer_get_line(buf, i, &len);
+        int n = wrap_rows(len, columns);
+        for (int seg = 0; seg < n && count < visible; seg++) {
+            out[count++] = (ViewRow){ base + i, (uint32_t)seg, 0 };
+        }
+    }
+    return count;
+}
+
+// Where the attributes of bytes [start, start + len) of a line change, into
+// spans (room for len); the first span starts at start
+static int line_spans(TextBuffer *buf, int index, size_t start, size_t len, TextAttrRun *spans) {
+    int count = 0;
+    if (index == buf->line_count - 1) {
+        const TextAttr *attrs = buf->line.attrs;
+        for (size_t col = start; col < start + len; col++) {
+            if (count == 0 || attrs[col] != spans[count - 1].attr) {
+                spans[count++] = (TextAttrRun){ 0, (uint32_t)col, attrs[col] };
+            }
+        }
+        return count;
+    }
+
+    size_t num_runs;
+    const TextAttrRun *runs = text_attr_log_find(&buf->attrs, absolute_line(buf, index), &num_runs);
+    size_t r = 0;
+    TextAttr attr = TEXT_ATTR_DEFAULT;
+    while (r < num_runs && runs[r].col <= start) attr = runs[r++].attr;
+    spans[count++] = (TextAttrRun){ 0, (uint32_t)start, attr };
+    for (; r < num_runs && runs[r].col < start + len; r++) {
+        spans[count++] = runs[r];
+    }
+    return count;
+}
+
+// The xterm palette: 16 ANSI colours, a 6x6x6 cube, then 24 grays
+static unsigned long palette_pixel(X11Context *ctx, int index) {
+    if (g_render.allocated[index]) return g_render.palette[index];
+    static const unsigned short ansi[16][3] = {
+        {0x00, 0x00, 0x00}, {0xcd, 0x00, 0x00}, {0x00, 0xcd, 0x00}, {0xcd, 0xcd, 0x00},
+        {0x00, 0x00, 0xee}, {0xcd, 0x00, 0xcd}, {0x00, 0xcd, 0xcd}, {0xe5, 0xe5, 0xe5},
+        {0x7f, 0x7f, 0x7f}, {0xff, 0x00, 0x00}, {0x00, 0xff, 0x00}, {0xff, 0xff, 0x00},
+        {0x5c, 0x5c, 0xff}, {0xff, 0x00, 0xff}, {0x00, 0xff, 0xff}, {0xff, 0xff, 0xff},
+    };
+    unsigned short rgb[3];
+    if (index < 16) {
+        memcpy(rgb, ansi[index], sizeof(rgb));
+    } else if (index < 232) {
+        int cube[3] = { (index - 16) / 36, (index - 16) / 6 % 6, (index - 16) % 6 };
+        for (int i = 0; i < 3; i++) rgb[i] = cube[i] ? 55 + cube[i] * 40 : 0;
+    } else {
+        rgb[0] = rgb[1] = rgb[2] = 8 + (index - 232) * 10;
+    }
+
+    XColor color = { .red = rgb[0] * 257, .green = rgb[1] * 257, .blue = rgb[2] * 257,
+                     .flags = DoRed | DoGreen | DoBlue };
+    Colormap colormap = DefaultColormap(ctx->display, ctx->screen);
+    g_render.palette[index] = XAllocColor(ctx->display, colormap, &color) ? color.pixel : ctx->black_pixel;
+    g_render.allocated[index] = 1;
+    return g_render.palette[index];
+}
+
+// Queues one row's piece of a line, bytes [start, start + len), in its colours
+static void queue_piece(X11Context *ctx, TextBuffer *buf, int index, const char *text,
+                        size_t start, size_t len, int y, int columns) {
+    if (g_render.spans_capacity < columns) {
+        TextAttrRun *spans = realloc(g_render.spans, columns * sizeof(TextAttrRun));
+        if (!spans) return;
+        g_render.spans = spans;
+        g_render.spans_capacity = columns;
+    }
+    TextAttrRun *spans = g_render.spans;
+    int count = line_spans(buf, index, start, len, spans);
+    if (count == 1 && spans[0].attr == TEXT_ATTR_DEFAULT) {
+        render_queue_text(10, y, text + start, (int)len);
+        return;
+    }
+
+    int font_height = ctx->font->ascent + ctx->font->descent;
+    for (int i = 0; i < count; i++) {
+        size_t from = spans[i].col, to = i + 1 < count ? spans[i + 1].col : start + len;
+        TextAttr attr = spans[i].attr;
+        int x = 10 + render_text_width(ctx, text + start, (int)(from - start));
+        int width = render_text_width(ctx, text + from, (int)(to - from));
+
+        // Bold brightens the eight ANSI colours; reverse swaps the two
+        int fg = text_attr_fg(attr), bg = text_attr_bg(attr);
+        if ((attr & TEXT_ATTR_BOLD) && fg >= 0 && fg < 8) fg += 8;
+        int fg_default = fg < 0, bg_default = bg < 0;
+        unsigned long fg_pixel = fg_default ? ctx->black_pixel : palette_pixel(ctx, fg);
+        unsigned long bg_pixel = bg_default ? ctx->white_pixel : palette_pixel(ctx, bg);
+        if (attr & TEXT_ATTR_REVERSE) {
+            unsigned long swap = fg_pixel;
+            fg_pixel = bg_pixel;
+            bg_pixel = swap;
+            fg_default = bg_default = 0;
+        }
+
+        if (!bg_default) queue_fill(x, y - ctx->font->ascent, width, font_height, bg_pixel);
+        if (attr & TEXT_ATTR_UNDERLINE) queue_fill(x, y + 1, width, 1, fg_pixel);
+        queue_run(x, y, text + from, (int)(to - from), !fg_default, fg_pixel);
+    }
+}
+
+int render_text_buffer(X11Context *ctx, TextBuffer *buf) {
+    TextView *view = &buf->view;
     int font_height = ctx->font->ascent + ctx->font->descent;
     int visible_lines = text_buffer_get_visible_lines(ctx);
+    int columns = text_buffer_get_visible_columns(ctx);
+    if (visible_lines <= 0) return 0;
+
+    if (g_render.rows_capacity < visible_lines) {
+        unsigned char *rows = realloc(g_render.rows, visible_lines);
+        ViewRow *layout = realloc(g_render.layout, visible_lines * sizeof(ViewRow));
+        if (rows) g_render.rows = rows;
+        if (layout) g_render.layout = layout;
+        if (!rows || !layout) return 0;
+        g_render.rows_capacity = visible_lines;
+    }
+    if (view->rows_capacity < visible_lines) {
+        ViewRow *rows = realloc(view->rows, visible_lines * sizeof(ViewRow));
+        if (!rows) return 0;
+        view->rows = rows;
+        view->rows_capacity = visible_lines;
+    }
+    ensure_pixmap(ctx, view);
+    Drawable d = view->pixmap;
+
+    ViewRow *now = g_render.layout, *old = view->rows;
+    int count = layout_rows(buf, visible_lines, columns, now);
+    unsigned char *redraw = g_render.rows;
+
+    // Rows that show what they showed last frame, or what another row did
+    // (the view moved), keep their pixels: the latter are shifted there with
+    // one XCopyArea. Lines only change from dirty_from down, and rows that
+    // had the cursor or the scroll indicator drawn on them are drawn again.
+    int all = !view->valid || view->columns != columns;
+    if (!all) {
+        int delta = 0, found = 0;   // Row r now shows what row r + delta did
+        for (int j = 0; j < view->num_rows && !found; j++) {
+            if (same_row(&old[j], &now[0])) { delta = j; found = 1; }
+        }
+        for (int j = 0; j < count && !found; j++) {
+            if (same_row(&now[j], &old[0])) { delta = -j; found = 1; }
+        }
+
+        int a = delta < 0 ? -delta : 0, b = a;
+        while (found && b < count && b + delta < view->num_rows &&
+               now[b].line < buf->dirty_from && same_row(&now[b], &old[b + delta])) {
+            b++;
+        }
+        if (b > a && delta != 0) {
+            XCopyArea(ctx->display, d, d, ctx->gc, 0, TAB_BAR_HEIGHT + (a + delta) * font_height,
+                      ctx->width, (b - a) * font_height, 0, TAB_BAR_HEIGHT + a * font_height);
+        }
+        for (int r = 0; r < visible_lines; r++) {
+            if (r >= a && r < b) {
+                redraw[r] = old[r + delta].overlay;
+            } else {
+                // A row past the text only needs clearing if it had some
+                redraw[r] = r < count || r < view->num_rows;
+            }
+        }
+        if (buf->scroll_offset > 0 && (delta != 0 || buf->scroll_offset != view->scroll_offset)) {
+            redraw[0] = 1;
+        }
+    } else {
+        queue_clear(0, TAB_BAR_HEIGHT, ctx->width, ctx->height - TAB_BAR_HEIGHT);
+        memset(redraw, 1, visible_lines);
+    }
+    // The indicator covers the first row and a little of the second
+    if (buf->scroll_offset > 0 && visible_lines > 1 && (redraw[0] || redraw[1])) {
+        redraw[0] = redraw[1] = 1;
+    }
+    buf->dirty_from = UINT64_MAX;
+    view->valid = 1;
+    view->columns = columns;
+    view->scroll_offset = buf->scroll_offset;
     
-    // Calculate which lines to display based on scroll offset
-    int start_line = buf->line_count - visible_lines - buf->scroll_offset;
-    if (start_line < 0) start_line = 0;
-    
-    int end_line = start_line + visible_lines;
-    if (end_line > buf->line_count) end_line = buf->line_count;
-    
-    // Render visible lines
-    for (int i = start_line; i < end_line; ++i) {
-        int display_row = i - start_line;
-        int y_pos = TAB_BAR_HEIGHT + (display_row * font_height) + ctx->font->ascent;
-        
-        if (y_pos > ctx->height + font_height) break;
-        
-        XDrawString(ctx->display, ctx->window, ctx->gc, 10, y_pos, 
-                   buf->lines[i], strlen(buf->lines[i]));
+    // Render the rows that need it
+    uint64_t base = absolute_line(buf, 0);
+    int drawn = 0;
+    for (int row = 0; row < visible_lines; ++row) {
+        if (!redraw[row]) continue;
+        int y_pos = TAB_BAR_HEIGHT + (row * font_height) + ctx->font->ascent;
+        if (!all) queue_clear(0, y_pos - ctx->font->ascent, ctx->width, font_height);
+        drawn = 1;
+        if (row >= count) continue;
+
+        size_t len;
+        const char *text = text_buffer_get_line(buf, (int)(now[row].line - base), &len);
+        size_t start = (size_t)now[row].seg * columns;
+        if (!text || start >= len) continue;
+        size_t piece = len - start < (size_t)columns ? len - start : (size_t)columns;
+        queue_piece(ctx, buf, (int)(now[row].line - base), text, start, piece, y_pos, columns);
+        g_render.stats.rows++;
     }
+    if (drawn) view->presented = 0;
     
     // NEW: Draw scroll indicator if scrolled up
     if (buf->scroll_offset > 0) {
-        char scroll_indicator[64];
-        snprintf(scroll_indicator, sizeof(scroll_indicator), 
-                "[Scrolled up %d lines]", buf->scroll_offset);
-        
-        XSetForeground(ctx->display, ctx->gc, 0x888888); // Gray text
-        int indicator_y = TAB_BAR_HEIGHT + ctx->font->ascent + 5;
-        XDrawString(ctx->display, ctx->window, ctx->gc, 
-                   ctx->width - 200, indicator_y, 
-                   scroll_indicator, strlen(scroll_indicator));
-        XSetForeground(ctx->display, ctx->gc, ctx->black_pixel);
+        now[0].overlay = 1;
+        if (count > 1) now[1].overlay = 1;
+        if (redraw[0]) {
+            char scroll_indicator[64];
+            snprintf(scroll_indicator, sizeof(scroll_indicator), 
+                    "[Scrolled up %d lines]", buf->scroll_offset);
+            int indicator_y = TAB_BAR_HEIGHT + ctx->font->ascent + 5;
+            queue_run(ctx->width - 200, indicator_y, scroll_indicator, strlen(scroll_indicator), 1, 0x888888);
+        }
     }
     
-    // Draw cursor (only if at bottom)
+    // Draw cursor (only if at bottom), after the last row of the cursor line
+    view->cursor_row = -1;
+    uint64_t cursor = absolute_line(buf, buf->cursor_line);
     if (buf->scroll_offset == 0) {
-        int cursor_display_line = buf->cursor_line - start_line;
-        if (cursor_display_line >= 0 && cursor_display_line < visible_lines) {
-            int cursor_x = 10 + XTextWidth(ctx->font, buf->lines[buf->cursor_line], buf->cursor_col);
-            int cursor_y = TAB_BAR_HEIGHT + (cursor_display_line * font_height);
-            XFillRectangle(ctx->display, ctx->window, ctx->gc, cursor_x, cursor_y, 8, font_height);
+        for (int r = count - 1; r >= 0 && view->cursor_row == -1; r--) {
+            if (now[r].line == cursor) view->cursor_row = r;
         }
     }
-}
\ No newline at end of file
+    memcpy(view->rows, now, count * sizeof(ViewRow));
+    view->num_rows = count;
+    if (view->cursor_row == -1) return 0;
+
+    int row = view->cursor_row;
+    view->rows[row].overlay = 1;
+    if (!redraw[row]) return 0;
+    int cursor_x = 10 + text_buffer_line_width(ctx, buf, buf->cursor_line);
+    int cursor_y = TAB_BAR_HEIGHT + (row * font_height);
+    render_queue_box(cursor_x, cursor_y, 8, font_height);
+    return 1;
+}
+
+void render_present(X11Context *ctx, TextBuffer *buf) {
+    TextView *view = &buf->view;
+    if (view->pixmap == None) return;
+    flush_batch(ctx, view->pixmap);
+    if (g_render.buf == buf && view->presented) return;
+    XCopyArea(ctx->display, view->pixmap, ctx->window, ctx->gc, 0, TAB_BAR_HEIGHT,
+              ctx->width, ctx->height - TAB_BAR_HEIGHT, 0, TAB_BAR_HEIGHT);
+    view->presented = 1;
+    g_render.buf = buf;
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void render_frame_done(X11Context *ctx) {
+    unsigned long next = XNextRequest(ctx->display);
+    double now = now_seconds();
+    if (g_render.window_start == 0) {
+        g_render.last_request = next;
+        g_render.window_start = now;
+    }
+
+    // Everything sent since the last frame counts, input handling included
+    unsigned long sent = next - g_render.last_request;
+    g_render.last_request = next;
+    g_render.stats.requests += sent;
+    g_render.window_requests += sent;
+    if (sent > 0) g_render.stats.frames++;
+
+    // An idle terminal has no frames, so the window that ends idle time
+    // reports its rate too
+    double elapsed = now - g_render.window_start;
+    if (elapsed >= 1.0) {
+        g_render.stats.requests_per_second = g_render.window_requests / elapsed;
+        printf("[RENDER] %lu X requests in %.1f s (%.1f/s)\n",
+               g_render.window_requests, elapsed, g_render.stats.requests_per_second);
+        fflush(stdout);
+        g_render.window_requests = 0;
+        g_render.window_start = now;
+    }
+}
+
+void render_get_stats(RenderStats *stats) {
+    *stats = g_render.stats;
+}
@@ -3,34 +3,193 @@
 #define X11_RENDER_H
 
 #include "x11_window.h"
+#include "scrollback.h"
+#include "text_attrs.h"
+#include "vt_line.h"
+#include "vt_parser.h"
+#include <stddef.h>
+#include <stdint.h>
 
 // Forward declaration of the struct.
 struct TabManager;
 
-#define MAX_LINES 10000
-#define MAX_LINE_LENGTH 256
+#define MAX_LINES 10000     // Default scrollback lines kept per tab
 #define TAB_BAR_HEIGHT 30
 
+// What a row of the window shows: one wrapped piece of a line
+typedef struct {
+    uint64_t line;              // Absolute scrollback line number
+    uint32_t seg;               // Which piece: bytes [seg * columns, (seg + 1) * columns)
+    uint8_t overlay;            // The cursor, prompt or scroll indicator is drawn on it
+} ViewRow;
+
+// A buffer's back buffer: the window-sized pixmap its rows are drawn into,
+// and what it shows. Kept while the tab is in the background, so switching
+// back to it costs only the rows that changed.
+typedef struct {
+    Pixmap pixmap;              // None until the buffer is first drawn
+    int width, height;          // Its size
+    int valid;                  // The rows below are drawn
+    int columns;                // Width lines were wrapped at
+    ViewRow *rows;              // What each row shows, top to bottom
+    int num_rows, rows_capacity;
+    int scroll_offset;
+    int cursor_row;             // Row with the end of the cursor line, or -1
+    int presented;              // The window shows the pixmap as it is
+    uint64_t width_line;        // Line whose last row's pixel width is cached ...
+    size_t width_len;           // ... at this length
+    int width_columns;          // ... wrapped at this width
+    int width_pixels;
+} TextView;
+
 typedef struct TextBuffer{
-    char lines[MAX_LINES][MAX_LINE_LENGTH];
+    Scrollback scrollback;  // The text, as lines of any length; its current
+                            // line stays empty, the cursor line is below
+    VtLine line;            // The cursor line, until a line feed finishes it
+    TextAttrLog attrs;      // Colours of the finished lines
+    VtParser parser;        // Escape sequences in the output
+    TextAttr attr;          // What new text is drawn with (set by SGR)
+    size_t saved_col;       // Saved by ESC 7
+    TextAttr saved_attr;
+    int screen_rows;        // Rows programs were told the screen has
+    int scroll_top;         // Scroll region set by DECSTBM (0-based rows,
+    int scroll_bottom;      // bottom inclusive), -1 for the whole screen
     int line_count;
     int cursor_line;
-    int cursor_col;
+    int cursor_col;         // Cursor column in the cursor line
     int scroll_offset;  // NEW: Tracks how many lines we've scrolled up
+    uint64_t dirty_from;    // First line changed since it was drawn (absolute
+                            // scrollback line number), UINT64_MAX if none
+    TextView view;
 } TextBuffer;
 
+// What `stats` shows about drawing
+typedef struct {
+    unsigned long frames;           // Frames that drew anything
+    unsigned long rows;             // Text rows redrawn
+    unsigned long requests;         // X requests sent since startup
+    double requests_per_second;     // Over the last measuring window
+} RenderStats;
+
 // --- Function prototypes ---
+
+/**
+ * @brief Set how many lines of scrollback buffers created from now on keep
+ * @param lines Line limit, 0 for unlimited (old output spills to a temporary file)
+ */
+void text_buffer_set_scrollback_lines(size_t lines);
+
 TextBuffer* text_buffer_init();
 void text_buffer_free(TextBuffer *buf);
 void text_buffer_append(TextBuffer *buf, const char *text);
 
+/**
+ * @brief Append output as a terminal would show it
+ *
+ * Text is interpreted by a VT100/ANSI parser: SGR colours and attributes,
+ * carriage return, backspace, tabs, cursor movement along the line, erasing
+ * and inserting or deleting characters. Lines are kept in a log rather than
+ * a screen, so sequences that move up the screen are ignored and clearing
+ * the screen scrolls its lines out of view. Runs of plain lines in the
+ * default colours skip the parser.
+ * @param buf Text buffer
+ * @param text Bytes (not NUL-terminated), e.g. a chunk streamed from a child
+ * @param len Their number
+ */
+void text_buffer_append_len(TextBuffer *buf, const char *text, size_t len);
+
+/**
+ * @brief Rows programs writing to the buffer think the screen has
+ * (clearing the screen scrolls that many lines)
+ */
+void text_buffer_set_screen_rows(TextBuffer *buf, int rows);
+
+/**
+ * @brief Get a line of the buffer
+ * @param buf Text buffer
+ * @param index Line number, 0 to line_count - 1
+ * @param len Receives the length in bytes
+ * @return The text (not NUL-terminated), valid until the buffer is next
+ * changed or read; NULL if index is out of range
+ */
+const char* text_buffer_get_line(TextBuffer *buf, int index, size_t *len);
+
 // NEW: Scrolling functions
 void text_buffer_scroll_up(TextBuffer *buf, int lines);
 void text_buffer_scroll_down(TextBuffer *buf, int lines);
 void text_buffer_scroll_to_bottom(TextBuffer *buf);
 int text_buffer_get_visible_lines(X11Context *ctx);
+int text_buffer_get_visible_columns(X11Context *ctx);
+
+/**
+ * @brief Pixel width of the last row a line wraps onto, cached until the
+ * line grows or the window is resized
+ */
+int text_buffer_line_width(X11Context *ctx, TextBuffer *buf, int index);
 
+/**
+ * @brief Mark a line as changed, so the next frame redraws its row
+ * @param buf Text buffer
+ * @param index Line number, 0 to line_count - 1
+ */
+void text_buffer_mark_dirty(TextBuffer *buf, int index);
+
+/**
+ * @brief Draw the whole window next frame (it was exposed)
+ */
+void render_invalidate(void);
+
+/**
+ * @brief Draw the tab bar, if a tab was opened, closed or switched to
+ */
 void render_tabs(X11Context *ctx, struct TabManager *mgr);
-void render_text_buffer(X11Context *ctx, TextBuffer *buf);
+
+/**
+ * @brief Bring the buffer's back buffer (buf->view.pixmap) up to date
+ *
+ * Lines longer than the window is wide wrap onto more rows; only the
+ * lines on screen are laid out. When the view moved by fewer rows than fit
+ * on screen, the rows still shown are shifted with XCopyArea and only the
+ * rows that came into view are drawn; otherwise only rows from the first
+ * dirty line down are drawn again, and an unchanged buffer costs no
+ * drawing at all.
+ * @return 1 if buf->view.cursor_row, the row the cursor line ends on, was
+ * redrawn (the prompt must be drawn over it again), 0 if not
+ */
+int render_text_buffer(X11Context *ctx, TextBuffer *buf);
+
+/**
+ * @brief Queue text to draw into the back buffer this frame, in the
+ * default colour
+ * @param x Left edge
+ * @param y Baseline
+ * @param text The bytes, copied
+ * @param len Their number
+ */
+void render_queue_text(int x, int y, const char *text, int len);
+
+/**
+ * @brief Queue a filled box (a cursor) to draw over the text this frame
+ */
+void render_queue_box(int x, int y, int width, int height);
+
+/**
+ * @brief Pixel width of some text; no font lookups for a fixed-width font
+ */
+int render_text_width(X11Context *ctx, const char *text, int len);
+
+/**
+ * @brief Send what the frame queued to the back buffer, then copy the
+ * back buffer to the window if the window doesn't show it as it is already
+ */
+void render_present(X11Context *ctx, TextBuffer *buf);
+
+/**
+ * @brief Count the X requests of a frame that was just flushed; every
+ * second or so of activity the rate goes to the debug log
+ */
+void render_frame_done(X11Context *ctx);
+
+void render_get_stats(RenderStats *stats);
 
 #endif // X11_RENDER_H
\ No newline at end of file
@@ -42,8 +42,10 @@ X11Context* x11_init(const char *title) {
     ctx->gc = XCreateGC(ctx->display, ctx->window, 0, NULL);
     XSetFont(ctx->display, ctx->gc, ctx->font->fid);
     XSetForeground(ctx->display, ctx->gc, ctx->black_pixel);
+    // Scrolling copies within pixmaps, which have nothing to expose
+    XSetGraphicsExposures(ctx->display, ctx->gc, False);
 
-    XSelectInput(ctx->display, ctx->window, ExposureMask | KeyPressMask | ButtonPressMask);
+    XSelectInput(ctx->display, ctx->window, ExposureMask | KeyPressMask | ButtonPressMask | StructureNotifyMask);
     XMapWindow(ctx->display, ctx->window);
     XFlush(ctx->display);
 
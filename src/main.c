@@ -4,6 +4,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <locale.h>
+#include <limits.h>
 #include <unistd.h>
 #include <X11/Xutil.h>
 #include <X11/keysym.h>
@@ -12,31 +13,57 @@
 #include "gui/x11_window.h"
 #include "gui/x11_render.h"
 #include "gui/tab_manager.h"
+#include "gui/frame_clock.h"
 #include "input/input_handler.h"
 #include "input/line_edit.h"
 #include "utils/unicode_handler.h"
 #include "shell/multiwatch.h"
 #include "shell/signal_handler.h"
 #include "shell/process_manager.h"
+#include "shell/process_spawn.h"
+#include "shell/zygote.h"
+#include "shell/command_exec.h"
+#include "shell/history_manager.h"
+#include "utils/event_loop.h"
+
+// Cursor blink period, and how long it keeps blinking after the last key press.
+// Once it stops the cursor stays solid and an idle terminal has no wakeups at all.
+#define CURSOR_BLINK_MS      530
+#define CURSOR_BLINK_TIMEOUT 10000
 
 static char *clipboard_content = NULL;
-static TabManager *g_tab_mgr_for_callback = NULL;
 
-static void multiwatch_output_callback(const char *output) {
-    if (g_tab_mgr_for_callback) {
-        Tab *active_tab = tab_manager_get_active(g_tab_mgr_for_callback);
-        if (active_tab) {
-            text_buffer_append(active_tab->buffer, output);
-        }
+static EventLoop *g_loop = NULL;
+static int g_cursor_timer = -1;
+static int g_cursor_visible = 1;
+static int g_cursor_blinks = 0;
+static int g_needs_redraw = 1;
+static FrameClock g_frame_clock;
+static int g_frame_timer = -1;
+static int g_frame_timer_armed = 0;
+
+static void cursor_blink_callback(void *user_data) {
+    (void)user_data;
+    g_cursor_visible = !g_cursor_visible;
+    g_needs_redraw = 1;
+
+    if (++g_cursor_blinks >= CURSOR_BLINK_TIMEOUT / CURSOR_BLINK_MS && g_cursor_visible) {
+        event_loop_disarm_timer(g_loop, g_cursor_timer);
     }
 }
 
-static void background_job_callback(const char *notification) {
-    if (g_tab_mgr_for_callback) {
-        Tab *active_tab = tab_manager_get_active(g_tab_mgr_for_callback);
-        if (active_tab) {
-            text_buffer_append(active_tab->buffer, notification);
-        }
+// The next frame may be drawn; the main loop draws it
+static void frame_timer_callback(void *user_data) {
+    (void)user_data;
+    g_frame_timer_armed = 0;
+}
+
+// Show the cursor solid and restart blinking after user input
+static void cursor_reset_blink(void) {
+    g_cursor_visible = 1;
+    g_cursor_blinks = 0;
+    if (g_loop && g_cursor_timer != -1) {
+        event_loop_arm_timer(g_loop, g_cursor_timer, CURSOR_BLINK_MS, CURSOR_BLINK_MS);
     }
 }
 
@@ -148,8 +175,7 @@ void process_keypress(XEvent *event, TabManager *mgr, InputState *input_state, X
     if (event->xkey.state & ControlMask) {
         if (keysym == XK_c) {
             if (active_tab->multiwatch_session) {
-                cleanup_multiwatch((MultiWatch *)active_tab->multiwatch_session);
-                active_tab->multiwatch_session = NULL;
+                tab_manager_stop_multiwatch(mgr, active_tab);
                 line_edit_clear(le);
                 text_buffer_append(active_tab->buffer, "\n[multiWatch stopped.]\n");
             } else if (active_tab->process_manager && 
@@ -179,7 +205,7 @@ void process_keypress(XEvent *event, TabManager *mgr, InputState *input_state, X
         
         // Jump to top/bottom
         if (keysym == XK_Home) {
-            text_buffer_scroll_up(active_tab->buffer, MAX_LINES);
+            text_buffer_scroll_up(active_tab->buffer, INT_MAX);
             return;
         }
         if (keysym == XK_End) {
@@ -245,33 +271,194 @@ void process_keypress(XEvent *event, TabManager *mgr, InputState *input_state, X
     }
 }
 
+// The prompt as last drawn; typing or a cursor blink redraws only its row
+static struct {
+    Tab *tab;
+    char line[MAX_INPUT_LENGTH];
+    int cursor_pos;
+    int cursor_visible;
+    int mode;
+} g_prompt;
+
+// Draws what changed in the tab bar, the active tab's buffer and the input
+// prompt into the buffer's back buffer, then shows it
+static void render_frame(X11Context *ctx, TabManager *mgr) {
+    Tab *active_tab = tab_manager_get_active(mgr);
+    if (!active_tab) return;
+
+    const char *line = line_edit_get_line(active_tab->line_edit);
+    int mode = active_tab->in_search_mode || active_tab->in_autocomplete_mode;
+    if (g_prompt.tab != active_tab || strcmp(g_prompt.line, line) != 0 ||
+        g_prompt.cursor_pos != active_tab->line_edit->cursor_pos ||
+        g_prompt.cursor_visible != g_cursor_visible || g_prompt.mode != mode) {
+        text_buffer_mark_dirty(active_tab->buffer, active_tab->buffer->cursor_line);
+        g_prompt.tab = active_tab;
+        snprintf(g_prompt.line, sizeof(g_prompt.line), "%s", line);
+        g_prompt.cursor_pos = active_tab->line_edit->cursor_pos;
+        g_prompt.cursor_visible = g_cursor_visible;
+        g_prompt.mode = mode;
+    }
+
+    render_tabs(ctx, mgr);
+    int prompt_row_cleared = render_text_buffer(ctx, active_tab->buffer);
+
+    int font_height = ctx->font->ascent + ctx->font->descent;
+    
+    // ================================================================
+    // UPDATED RENDERING LOGIC (FIXES OVERLAPPING PROMPT)
+    // ================================================================
+    // Only show input prompt if at bottom and not in multiwatch
+    if (prompt_row_cleared && !active_tab->multiwatch_session && active_tab->buffer->scroll_offset == 0) {
+        int row = active_tab->buffer->view.cursor_row;
+        int line_y = TAB_BAR_HEIGHT + (row * font_height) + ctx->font->ascent;
+        
+        int start_x = 10;
+        
+        // [FIX] Context-aware prompt rendering
+        if (mode) {
+            // In these modes, the prompt (e.g., "Enter search term: ") is already written 
+            // into the text buffer lines. We just need to calculate its width so 
+            // we can draw the user's input input immediately AFTER it.
+            start_x += text_buffer_line_width(ctx, active_tab->buffer, active_tab->buffer->cursor_line);
+        } else {
+            // Standard shell mode: Draw the "$ " prompt manually
+            render_queue_text(10, line_y, "$ ", 2);
+            start_x += render_text_width(ctx, "$ ", 2);
+        }
+        
+        // Draw the user's input (from line_edit) at the calculated position
+        render_queue_text(start_x, line_y, line, strlen(line));
+    
+        // Draw Cursor (blinks while the user is active)
+        if (g_cursor_visible) {
+            int cursor_x = start_x + render_text_width(ctx, line, active_tab->line_edit->cursor_pos);
+            int cursor_y = TAB_BAR_HEIGHT + (row * font_height);
+            render_queue_box(cursor_x, cursor_y, 8, font_height);
+        }
+    }
+    // ================================================================
+    
+    render_present(ctx, active_tab->buffer);
+    XFlush(ctx->display);
+    render_frame_done(ctx);
+}
+
 static X11Context *g_ctx = NULL;
 static TabManager *g_tab_mgr = NULL;
 static InputState *g_input_state = NULL;
+static Atom g_wm_delete_window;
+static int g_running = 1;
 
-// Function to process pending X11 events (called from command execution)
-int process_pending_events(void) {
-    if (!g_ctx || !g_tab_mgr || !g_input_state) return 0;
-    
-    while (XPending(g_ctx->display)) {
-        XEvent event;
-        XNextEvent(g_ctx->display, &event);
-        if (XFilterEvent(&event, None)) continue;
+static void handle_x_event(XEvent *event) {
+    X11Context *ctx = g_ctx;
+    Tab *active_tab = tab_manager_get_active(g_tab_mgr);
 
-        switch (event.type) {
-            case KeyPress:
-                process_keypress(&event, g_tab_mgr, g_input_state, g_ctx);
-                break;
-            case ButtonPress:
-                if (event.xbutton.button == 4 || event.xbutton.button == 5) {
-                    handle_mouse_scroll(&event.xbutton, g_tab_mgr, g_ctx);
+    switch (event->type) {
+        case KeyPress:
+            cursor_reset_blink();
+            process_keypress(event, g_tab_mgr, g_input_state, ctx);
+            break;
+        case ButtonPress:
+            if (event->xbutton.button == 4 || event->xbutton.button == 5) {
+                handle_mouse_scroll(&event->xbutton, g_tab_mgr, ctx);
+            } else {
+                handle_mouse_click(&event->xbutton, g_tab_mgr, ctx);
+            }
+            break;
+        case Expose:
+            render_invalidate();
+            break;
+        case ConfigureNotify:
+            // Tabs re-wrap their lines and get a new back buffer when next drawn
+            if (event->xconfigure.width == ctx->width && event->xconfigure.height == ctx->height) return;
+            ctx->width = event->xconfigure.width;
+            ctx->height = event->xconfigure.height;
+            render_invalidate();
+            tab_manager_set_terminal_size(g_tab_mgr, text_buffer_get_visible_columns(ctx),
+                                          text_buffer_get_visible_lines(ctx),
+                                          ctx->width - 20, ctx->height - TAB_BAR_HEIGHT);
+            break;
+        case ClientMessage:
+            if ((Atom)event->xclient.data.l[0] == g_wm_delete_window) g_running = 0;
+            break;
+        case SelectionNotify: {
+            if (event->xselection.property == None) break;
+            Atom type;
+            int format;
+            unsigned long nitems, bytes_after;
+            unsigned char *data = NULL;
+            if (XGetWindowProperty(ctx->display, ctx->window, event->xselection.property, 0, 4096, False, AnyPropertyType, &type, &format, &nitems, &bytes_after, &data) == Success) {
+                if (data && active_tab && !active_tab->multiwatch_session) {
+                    line_edit_insert_string(active_tab->line_edit, (char *)data);
+                }
+                if (data) XFree(data);
+            }
+            break;
+        }
+        case SelectionRequest: {
+            XSelectionRequestEvent *req = &event->xselectionrequest;
+            if (req->selection == XInternAtom(ctx->display, "CLIPBOARD", False)) {
+                XSelectionEvent sev = {0};
+                sev.type = SelectionNotify;
+                sev.display = req->display;
+                sev.requestor = req->requestor;
+                sev.selection = req->selection;
+                sev.target = req->target;
+                sev.property = req->property;
+                sev.time = req->time;
+                
+                Atom utf8_atom = XInternAtom(ctx->display, "UTF8_STRING", True);
+                if (sev.target == utf8_atom && clipboard_content) {
+                    XChangeProperty(sev.display, sev.requestor, sev.property, utf8_atom, 8, PropModeReplace, (unsigned char *)clipboard_content, strlen(clipboard_content));
                 } else {
-                    handle_mouse_click(&event.xbutton, g_tab_mgr, g_ctx);
+                    sev.property = None;
                 }
-                break;
+                XSendEvent(ctx->display, sev.requestor, True, NoEventMask, (XEvent *)&sev);
+            }
+            return;   // Nothing on screen changed
         }
     }
-    return 0;
+    g_needs_redraw = 1;
+}
+
+// Reads everything the X server has sent and handles it
+static void handle_x_events(void) {
+    while (XPending(g_ctx->display)) {
+        XEvent event;
+        XNextEvent(g_ctx->display, &event);
+        if (XFilterEvent(&event, None)) continue;
+        handle_x_event(&event);
+    }
+}
+
+// The X connection is readable; the main loop reads it with handle_x_events()
+static void x_connection_callback(int fd, int events, void *user_data) {
+    (void)fd;
+    (void)events;
+    (void)user_data;
+}
+
+static void sigchld_callback(int fd, int events, void *user_data) {
+    (void)fd;
+    (void)events;
+    signal_handler_drain_sigchld();
+    tab_manager_poll_jobs((TabManager *)user_data);
+}
+
+// The zygote reported a status change for one of its children
+static void zygote_callback(int fd, int events, void *user_data) {
+    (void)fd;
+    (void)events;
+    zygote_drain();
+    tab_manager_poll_jobs((TabManager *)user_data);
+}
+
+// The scrollback compressor finished blocks; swap them in for the raw chunks
+static void compressor_callback(int fd, int events, void *user_data) {
+    (void)fd;
+    (void)events;
+    (void)user_data;
+    scrollback_compressor_collect();
 }
 
 int main(void) {
@@ -294,10 +481,85 @@ int main(void) {
         fprintf(stderr, "Warning: Failed to initialize signal handlers.\n");
     }
 
+    // How commands are started: MYTERM_SPAWN=posix_spawn (the default), fork
+    // or zygote. The zygote is forked here, while the process is still
+    // small; commands are then forked from it instead of from the GUI. It
+    // costs a round trip per command and is no faster than posix_spawn,
+    // which doesn't copy the GUI either, so it is only used when asked for.
+    const char *spawn_setting = getenv("MYTERM_SPAWN");
+    if (spawn_setting && *spawn_setting) {
+        if (strcmp(spawn_setting, "zygote") == 0) {
+            if (zygote_start() == 0) {
+                spawn_set_mode(SPAWN_MODE_ZYGOTE);
+            } else {
+                fprintf(stderr, "Warning: Spawner helper unavailable, using posix_spawn.\n");
+            }
+        } else if (strcmp(spawn_setting, "fork") == 0) {
+            spawn_set_mode(SPAWN_MODE_FORK);
+        } else if (strcmp(spawn_setting, "posix_spawn") != 0) {
+            fprintf(stderr, "Warning: Ignoring MYTERM_SPAWN=%s\n", spawn_setting);
+        }
+    }
+
+    // Scrollback lines per tab: MYTERM_SCROLLBACK=N, or 0/unlimited for no limit
+    const char *scrollback_setting = getenv("MYTERM_SCROLLBACK");
+    if (scrollback_setting && *scrollback_setting) {
+        char *end;
+        unsigned long long lines = strtoull(scrollback_setting, &end, 10);
+        if (strcmp(scrollback_setting, "unlimited") == 0) {
+            text_buffer_set_scrollback_lines(0);
+        } else if (*end == '\0' && scrollback_setting[0] != '-') {
+            text_buffer_set_scrollback_lines((size_t)lines);
+        } else {
+            fprintf(stderr, "Warning: Ignoring MYTERM_SCROLLBACK=%s\n", scrollback_setting);
+        }
+    }
+
+    // Commands kept in history: MYTERM_HISTORY_SIZE=N
+    const char *history_setting = getenv("MYTERM_HISTORY_SIZE");
+    if (history_setting && *history_setting) {
+        char *end;
+        long commands = strtol(history_setting, &end, 10);
+        if (*end == '\0' && commands > 0 && commands <= INT_MAX / 2) {
+            history_manager_set_limit((int)commands);
+        } else {
+            fprintf(stderr, "Warning: Ignoring MYTERM_HISTORY_SIZE=%s\n", history_setting);
+        }
+    }
+
+    // When the history file is flushed to disk: MYTERM_HISTORY_FSYNC=never/compact/always
+    const char *fsync_setting = getenv("MYTERM_HISTORY_FSYNC");
+    if (fsync_setting && *fsync_setting) {
+        if (strcmp(fsync_setting, "never") == 0) {
+            history_manager_set_fsync(HISTORY_FSYNC_NEVER);
+        } else if (strcmp(fsync_setting, "compact") == 0) {
+            history_manager_set_fsync(HISTORY_FSYNC_COMPACT);
+        } else if (strcmp(fsync_setting, "always") == 0) {
+            history_manager_set_fsync(HISTORY_FSYNC_ALWAYS);
+        } else {
+            fprintf(stderr, "Warning: Ignoring MYTERM_HISTORY_FSYNC=%s\n", fsync_setting);
+        }
+    }
+
+    // Frames per second at most: MYTERM_FPS=N, or 0 to draw after every change
+    int fps = FRAME_CLOCK_DEFAULT_FPS;
+    const char *fps_setting = getenv("MYTERM_FPS");
+    if (fps_setting && *fps_setting) {
+        char *end;
+        long value = strtol(fps_setting, &end, 10);
+        if (*end == '\0' && value >= 0 && value <= 1000) {
+            fps = (int)value;
+        } else {
+            fprintf(stderr, "Warning: Ignoring MYTERM_FPS=%s\n", fps_setting);
+        }
+    }
+    frame_clock_init(&g_frame_clock, fps);
+
     X11Context *ctx = x11_init("MyTerm");
     TabManager *tab_mgr = tab_manager_init();
     InputState *input_state = input_state_init(ctx->display, ctx->window);
-    if (!ctx || !tab_mgr || !input_state) {
+    EventLoop *loop = event_loop_create();
+    if (!ctx || !tab_mgr || !input_state || !loop) {
         fprintf(stderr, "Failed to initialize components\n");
         return 1;
     }
@@ -305,142 +567,85 @@ int main(void) {
     g_ctx = ctx;
     g_tab_mgr = tab_mgr;
     g_input_state = input_state;
-    g_tab_mgr_for_callback = tab_mgr;
-
-    extern void set_event_processor_callback(int (*callback)(void));
-    set_event_processor_callback(process_pending_events);
+    g_loop = loop;
+
+    // Commands run on a pty sized like the text area unless MYTERM_PTY=0
+    const char *pty_setting = getenv("MYTERM_PTY");
+    command_set_pty_mode(!pty_setting || strcmp(pty_setting, "0") != 0);
+    tab_manager_set_terminal_size(tab_mgr, text_buffer_get_visible_columns(ctx),
+                                  text_buffer_get_visible_lines(ctx),
+                                  ctx->width - 20, ctx->height - TAB_BAR_HEIGHT);
+
+    // Everything the terminal waits on goes through one reactor, including
+    // the output of every tab's running command
+    tab_manager_set_event_loop(tab_mgr, loop);
+    event_loop_add_fd(loop, ConnectionNumber(ctx->display), EVENT_READ, x_connection_callback, NULL);
+    if (signal_handler_get_sigchld_fd() != -1) {
+        event_loop_add_fd(loop, signal_handler_get_sigchld_fd(), EVENT_READ, sigchld_callback, tab_mgr);
+    }
+    int zygote_fd = zygote_get_fd();
+    if (zygote_fd != -1) {
+        event_loop_add_fd(loop, zygote_fd, EVENT_READ, zygote_callback, tab_mgr);
+    }
+    int compressor_fd = scrollback_compressor_fd();
+    if (compressor_fd != -1) {
+        event_loop_add_fd(loop, compressor_fd, EVENT_READ, compressor_callback, NULL);
+    }
+    g_cursor_timer = event_loop_add_timer(loop, cursor_blink_callback, NULL);
+    cursor_reset_blink();
+    g_frame_timer = event_loop_add_timer(loop, frame_timer_callback, NULL);
 
-    Atom wm_delete_window = XInternAtom(ctx->display, "WM_DELETE_WINDOW", False);
-    XSetWMProtocols(ctx->display, ctx->window, &wm_delete_window, 1);
+    g_wm_delete_window = XInternAtom(ctx->display, "WM_DELETE_WINDOW", False);
+    XSetWMProtocols(ctx->display, ctx->window, &g_wm_delete_window, 1);
 
     printf("Entering main event loop\n");
     fflush(stdout);
 
-    int running = 1;
-    while (running) {
-        Tab *active_tab = tab_manager_get_active(tab_mgr);
-
-        if (active_tab && active_tab->multiwatch_session) {
-            multiwatch_poll_output((MultiWatch *)active_tab->multiwatch_session, multiwatch_output_callback);
-        }
+    while (g_running) {
+        handle_x_events();
         
-        if (active_tab) {
-            tab_manager_check_background_jobs(tab_mgr, background_job_callback);
-        }
+        if (tab_mgr->num_tabs == 0) break;
         
-        while (XPending(ctx->display)) {
-            XEvent event;
-            XNextEvent(ctx->display, &event);
-            if (XFilterEvent(&event, None)) continue;
-
-            switch (event.type) {
-                case KeyPress:
-                    process_keypress(&event, tab_mgr, input_state, ctx);
-                    break;
-                case ButtonPress:
-                    if (event.xbutton.button == 4 || event.xbutton.button == 5) {
-                        handle_mouse_scroll(&event.xbutton, tab_mgr, ctx);
-                    } else {
-                        handle_mouse_click(&event.xbutton, tab_mgr, ctx);
-                    }
-                    break;
-                case ClientMessage:
-                    if ((Atom)event.xclient.data.l[0] == wm_delete_window) running = 0;
-                    break;
-                case SelectionNotify: {
-                    if (event.xselection.property == None) break;
-                    Atom type;
-                    int format;
-                    unsigned long nitems, bytes_after;
-                    unsigned char *data = NULL;
-                    if (XGetWindowProperty(ctx->display, ctx->window, event.xselection.property, 0, 4096, False, AnyPropertyType, &type, &format, &nitems, &bytes_after, &data) == Success) {
-                        if (data && active_tab && !active_tab->multiwatch_session) {
-                            line_edit_insert_string(active_tab->line_edit, (char *)data);
-                        }
-                        if (data) XFree(data);
-                    }
-                    break;
-                }
-                case SelectionRequest: {
-                    XSelectionRequestEvent *req = &event.xselectionrequest;
-                    if (req->selection == XInternAtom(ctx->display, "CLIPBOARD", False)) {
-                        XSelectionEvent sev = {0};
-                        sev.type = SelectionNotify;
-                        sev.display = req->display;
-                        sev.requestor = req->requestor;
-                        sev.selection = req->selection;
-                        sev.target = req->target;
-                        sev.property = req->property;
-                        sev.time = req->time;
-                        
-                        Atom utf8_atom = XInternAtom(ctx->display, "UTF8_STRING", True);
-                        if (sev.target == utf8_atom && clipboard_content) {
-                            XChangeProperty(sev.display, sev.requestor, sev.property, utf8_atom, 8, PropModeReplace, (unsigned char *)clipboard_content, strlen(clipboard_content));
-                        } else {
-                            sev.property = None;
-                        }
-                        XSendEvent(ctx->display, sev.requestor, True, NoEventMask, (XEvent *)&sev);
-                    }
-                    break;
+        // Output keeps being read between frames; a frame shows wherever it got to
+        if (g_needs_redraw) {
+            int wait = frame_clock_wait_ms(&g_frame_clock);
+            if (wait == 0 || g_frame_timer == -1) {
+                g_needs_redraw = 0;
+                render_frame(ctx, tab_mgr);
+                frame_clock_frame_drawn(&g_frame_clock);
+                if (g_frame_timer_armed) {
+                    event_loop_disarm_timer(loop, g_frame_timer);
+                    g_frame_timer_armed = 0;
                 }
+            } else if (!g_frame_timer_armed) {
+                event_loop_arm_timer(loop, g_frame_timer, wait, 0);
+                g_frame_timer_armed = 1;
             }
         }
-        
-        if (tab_mgr->num_tabs == 0) running = 0;
-        
-        if (active_tab) {
-            render_tabs(ctx, tab_mgr);
-            render_text_buffer(ctx, active_tab->buffer);
 
-            const char *line = line_edit_get_line(active_tab->line_edit);
-            int font_height = ctx->font->ascent + ctx->font->descent;
-            
-            // ================================================================
-            // UPDATED RENDERING LOGIC (FIXES OVERLAPPING PROMPT)
-            // ================================================================
-            // Only show input prompt if at bottom and not in multiwatch
-            if (!active_tab->multiwatch_session && active_tab->buffer->scroll_offset == 0) {
-                int visible_lines = text_buffer_get_visible_lines(ctx);
-                int display_line = active_tab->buffer->cursor_line;
-                int start_line = active_tab->buffer->line_count - visible_lines;
-                if (start_line < 0) start_line = 0;
-                
-                int line_y = TAB_BAR_HEIGHT + ((display_line - start_line) * font_height) + ctx->font->ascent;
-                
-                int start_x = 10;
-                
-                // [FIX] Context-aware prompt rendering
-                if (active_tab->in_search_mode || active_tab->in_autocomplete_mode) {
-                    // In these modes, the prompt (e.g., "Enter search term: ") is already written 
-                    // into the text buffer lines. We just need to calculate its width so 
-                    // we can draw the user's input input immediately AFTER it.
-                    char *prompt_line = active_tab->buffer->lines[active_tab->buffer->cursor_line];
-                    start_x += XTextWidth(ctx->font, prompt_line, strlen(prompt_line));
-                } else {
-                    // Standard shell mode: Draw the "$ " prompt manually
-                    XDrawString(ctx->display, ctx->window, ctx->gc, 10, line_y, "$ ", 2);
-                    start_x += XTextWidth(ctx->font, "$ ", 2);
-                }
-                
-                // Draw the user's input (from line_edit) at the calculated position
-                XDrawString(ctx->display, ctx->window, ctx->gc, start_x, line_y, line, strlen(line));
-            
-                // Draw Cursor
-                int cursor_x = start_x + XTextWidth(ctx->font, line, active_tab->line_edit->cursor_pos);
-                int cursor_y = TAB_BAR_HEIGHT + ((display_line - start_line) * font_height);
-                XFillRectangle(ctx->display, ctx->window, ctx->gc, cursor_x, cursor_y, 8, font_height);
-            }
-            // ================================================================
-            
-            XFlush(ctx->display);
+        // Rendering may have read more events into Xlib's queue; epoll can't see those
+        if (XEventsQueued(ctx->display, QueuedAlready) > 0) continue;
+
+        // spawn_waitpid() reads every queued zygote status, so one read on
+        // behalf of a tab may have used up the wakeup meant for another
+        tab_manager_poll_jobs(tab_mgr);
+
+        // If the spawner died its socket was closed; stop watching that descriptor
+        if (zygote_fd != -1 && !zygote_is_running()) {
+            event_loop_remove_fd(loop, zygote_fd);
+            zygote_fd = -1;
         }
 
-        usleep(10000);
+        if (event_loop_run_once(loop, -1) > 0) {
+            g_needs_redraw = 1;
+        }
     }
 
     if (clipboard_content) free(clipboard_content);
     input_state_cleanup(input_state);
     tab_manager_cleanup(tab_mgr);
+    event_loop_destroy(loop);
+    zygote_stop();
     x11_cleanup(ctx);
     if (debug_out) fclose(debug_out);
     
@@ -0,0 +1,717 @@
+// src/shell/builtins.c
+#include "builtins.h"
+#include "path_cache.h"
+#include "job.h"
+#include "../utils/unicode_handler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+extern char **environ;
+
+// ---------------------------------------------------------------------------
+// Output
+
+int builtin_write(BuiltinStream *stream, const char *data, size_t len) {
+    if (stream->fd == -1) {
+        return stream->capture ? output_capture_append(stream->capture, data, len) : 0;
+    }
+
+    while (len > 0) {
+        ssize_t n = write(stream->fd, data, len);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        data += n;
+        len -= n;
+    }
+    return 0;
+}
+
+int builtin_printf(BuiltinStream *stream, const char *format, ...) {
+    char small[512];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(small, sizeof(small), format, args);
+    va_end(args);
+    if (len < 0) return -1;
+    if ((size_t)len < sizeof(small)) return builtin_write(stream, small, len);
+
+    char *big = malloc(len + 1);
+    if (!big) return -1;
+    va_start(args, format);
+    vsnprintf(big, len + 1, format, args);
+    va_end(args);
+    int result = builtin_write(stream, big, len);
+    free(big);
+    return result;
+}
+
+// ---------------------------------------------------------------------------
+// Helpers
+
+// Shell variable names: a letter or '_', then letters, digits and '_'
+static int valid_identifier(const char *name, size_t len) {
+    if (len == 0 || !(isalpha((unsigned char)name[0]) || name[0] == '_')) return 0;
+    for (size_t i = 1; i < len; i++) {
+        if (!(isalnum((unsigned char)name[i]) || name[i] == '_')) return 0;
+    }
+    return 1;
+}
+
+// Resolves a job spec ("%N", "N", "%+", "%%", or none for the current job)
+static ProcessInfo* find_job(BuiltinEnv *env, BuiltinIO *io, const char *who, const char *spec) {
+    int job_id = 0;
+    if (spec && strcmp(spec, "%%") != 0 && strcmp(spec, "%+") != 0) {
+        const char *digits = (spec[0] == '%') ? spec + 1 : spec;
+        char *end;
+        job_id = (int)strtol(digits, &end, 10);
+        if (*digits == '\0' || *end != '\0' || job_id <= 0) {
+            builtin_printf(&io->err, "%s: %s: no such job\n", who, spec);
+            return NULL;
+        }
+    }
+
+    ProcessInfo *info = process_manager_find_by_job_id(env->pm, job_id);
+    if (!info) {
+        builtin_printf(&io->err, "%s: %s: no such job\n", who, spec ? spec : "current");
+    }
+    return info;
+}
+
+static const struct {
+    const char *name;
+    int number;
+} g_signals[] = {
+    { "HUP", SIGHUP },   { "INT", SIGINT },   { "QUIT", SIGQUIT }, { "ILL", SIGILL },
+    { "TRAP", SIGTRAP }, { "ABRT", SIGABRT }, { "BUS", SIGBUS },   { "FPE", SIGFPE },
+    { "KILL", SIGKILL }, { "USR1", SIGUSR1 }, { "SEGV", SIGSEGV }, { "USR2", SIGUSR2 },
+    { "PIPE", SIGPIPE }, { "ALRM", SIGALRM }, { "TERM", SIGTERM }, { "CHLD", SIGCHLD },
+    { "CONT", SIGCONT }, { "STOP", SIGSTOP }, { "TSTP", SIGTSTP }, { "TTIN", SIGTTIN },
+    { "TTOU", SIGTTOU }, { "URG", SIGURG },   { "WINCH", SIGWINCH },
+};
+#define NUM_SIGNALS (int)(sizeof(g_signals) / sizeof(g_signals[0]))
+
+// Accepts "TERM", "SIGTERM", "term" or a number; returns -1 if unknown
+static int parse_signal(const char *text) {
+    if (isdigit((unsigned char)text[0])) {
+        char *end;
+        long number = strtol(text, &end, 10);
+        return (*end == '\0' && number >= 0 && number < NSIG) ? (int)number : -1;
+    }
+    if (strncasecmp(text, "SIG", 3) == 0) text += 3;
+    for (int i = 0; i < NUM_SIGNALS; i++) {
+        if (strcasecmp(text, g_signals[i].name) == 0) return g_signals[i].number;
+    }
+    return -1;
+}
+
+// ---------------------------------------------------------------------------
+// The builtins
+
+static int builtin_true(int argc, char **argv, BuiltinIO *io, BuiltinEnv *env) {
+    (void)argc; (void)argv; (void)io; (void)env;
+    return 0;
+}
+
+static int builtin_false(int argc, char **argv, BuiltinIO *io, BuiltinEnv *env) {
+    (void)argc; (void)argv; (void)io; (void)env;
+    return 1;
+}
+
+// echo [-neE] [arg ...]
+static int builtin_echo(int argc, char **argv, BuiltinIO *io, BuiltinEnv *env) {
+    (void)env;
+    int enable_escapes = 0;
+    int suppress_newline = 0;
+    int i = 1;
+
+    // Leading words made only of n/e/E flags are options, as in bash
+    for (; i < argc && argv[i][0] == '-' && argv[i][1] != '\0'; i++) {
+        if (strspn(argv[i] + 1, "neE") != strlen(argv[i] + 1)) break;
+        for (const char *f = argv[i] + 1; *f; f++) {
+            if (*f == 'n') suppress_newline = 1;
+            else enable_escapes = (*f == 'e');
+        }
+    }
+
+    for (int first = i; i < argc; i++) {
+        if (i > first) builtin_write(&io->out, " ", 1);
+
+        if (enable_escapes) {
+            // Escapes only ever shorten the text
+            size_t len = strlen(argv[i]) + 1;
+            char *processed = malloc(len);
+            if (!processed) return 1;
+            process_escape_sequences(argv[i], processed, len);
+            builtin_write(&io->out, processed, strlen(processed));
+            free(processed);
+        } else {
+            builtin_write(&io->out, argv[i], strlen(argv[i]));
+        }
+    }
+
+    if (!suppress_newline && builtin_write(&io->out, "\n", 1) == -1) return 1;
+    return 0;
+}
+
+// cd [dir]
+static int builtin_cd(int argc, char **argv, BuiltinIO *io, BuiltinEnv *env) {
+    const char *dir = (argc < 2) ? getenv("HOME") : argv[1];
+    if (!dir) {
+        builtin_printf(&io->err, "cd: HOME not set\n");
+        return 1;
+    }
+
+    if (env->in_pipeline) {
+        // A subshell's cd is lost anyway; only report what it would have
+        struct stat st;
+        int error = 0;
+        if (stat(dir, &st) == -1) error = errno;
+        else if (!S_ISDIR(st.st_mode)) error = ENOTDIR;
+        else if (access(dir, X_OK) == -1) error = errno;
+        if (error) {
+            builtin_printf(&io->err, "cd: %s: %s\n", dir, strerror(error));
+            return 1;
+        }
+        return 0;
+    }
+
+    if (chdir(dir) != 0) {
+        builtin_printf(&io->err, "cd: %s: %s\n", dir, strerror(errno));
+        return 1;
+    }
+    return 0;
+}
+
+// pwd
+static int builtin_pwd(int argc, char **argv, BuiltinIO *io, BuiltinEnv *env) {
+    (void)argc; (void)argv; (void)env;
+    char cwd[PATH_MAX];
+    if (!getcwd(cwd, sizeof(cwd))) {
+        builtin_printf(&io->err, "pwd: error retrieving current directory: %s\n", strerror(errno));
+        return 1;
+    }
+    return builtin_printf(&io->out, "%s\n", cwd) == -1 ? 1 : 0;
+}
+
+static int compare_strings(const void *a, const void *b) {
+    return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+// export [-p] [name[=value] ...]
+static int builtin_export(int argc, char **argv, BuiltinIO *io, BuiltinEnv *env) {
+    if (argc < 2 || strcmp(argv[1], "-p") == 0) {
+        int count = 0;
+        while (environ[count]) count++;
+        char **sorted = malloc((count + 1) * sizeof(char *));
+        if (!sorted) return 1;
+        memcpy(sorted, environ, count * sizeof(char *));
+        qsort(sorted, count, sizeof(char *), compare_strings);
+
+        for (int i = 0; i < count; i++) {
+            const char *eq = strchr(sorted[i], '=');
+            if (!eq) continue;
+            builtin_printf(&io->out, "declare -x %.*s=\"%s\"\n",
+                           (int)(eq - sorted[i]), sorted[i], eq + 1);
+        }
+        free(sorted);
+        return 0;
+    }
+
+    int status = 0;
+    for (int i = 1; i < argc; i++) {
+        const char *eq = strchr(argv[i], '=');
+        size_t name_len = eq ? (size_t)(eq - argv[i]) : strlen(argv[i]);
+        if (!valid_identifier(argv[i], name_len)) {
+            builtin_printf(&io->err, "export: `%s': not a valid identifier\n", argv[i]);
+            status = 1;
+            continue;
+        }
+        // There are no unexported shell variables, so `export NAME` has nothing to do
+        if (!eq || env->in_pipeline) continue;
+
+        char *name = strndup(argv[i], name_len);
+        if (!name || setenv(name, eq + 1, 1) == -1) {
+            builtin_printf(&io->err, "export: %s: %s\n", argv[i], strerror(errno));
+            status = 1;
+        }
+        free(name);
+    }
+    return status;
+}
+
+// unset [-v] name ...
+static int builtin_unset(int argc, char **argv, BuiltinIO *io, BuiltinEnv *env) {
+    int status = 0;
+    int i = 1;
+    if (i < argc && strcmp(argv[i], "-v") == 0) i++;
+
+    for (; i < argc; i++) {
+        if (!valid_identifier(argv[i], strlen(argv[i]))) {
+            builtin_printf(&io->err, "unset: `%s': not a valid identifier\n", argv[i]);
+            status = 1;
+        } else if (!env->in_pipeline) {
+            unsetenv(argv[i]);
+        }
+    }
+    return status;
+}
+
+// hash [-r] [-p pathname] [name ...]
+static int builtin_hash(int argc, char **argv, BuiltinIO *io, BuiltinEnv *env) {
+    if (argc < 2) {
+        char *list = path_cache_list();
+        if (!list) return 1;
+        builtin_write(&io->out, list, strlen(list));
+        free(list);
+        return 0;
+    }
+
+    if (strcmp(argv[1], "-r") == 0) {
+        if (!env->in_pipeline) path_cache_clear();
+        return 0;
+    }
+
+    if (strcmp(argv[1], "-p") == 0) {
+        if (argc < 4) {
+            builtin_printf(&io->err, "hash: usage: hash [-r] [-p pathname] [name ...]\n");
+            return 2;
+        }
+        if (!env->in_pipeline && path_cache_insert(argv[3], argv[2]) == -1) {
+            builtin_printf(&io->err, "hash: out of memory\n");
+            return 1;
+        }
+        return 0;
+    }
+
+    int status = 0;
+    for (int i = 1; i < argc; i++) {
+        if (path_cache_remember(argv[i]) == -1) {
+            builtin_printf(&io->err, "hash: %s: not found\n", argv[i]);
+            status = 1;
+        }
+    }
+    return status;
+}
+
+// history [-r file | -w file]
+static int builtin_history(int argc, char **argv, BuiltinIO *io, BuiltinEnv *env) {
+    if (!env->history) {
+        builtin_printf(&io->err, "history: no history in this shell\n");
+        return 1;
+    }
+
+    // Import from, or export to, a text file
+    if (argc > 1 && (strcmp(argv[1], "-r") == 0 || strcmp(argv[1], "-w") == 0)) {
+        if (argc != 3) {
+            builtin_printf(&io->err, "history: usage: history [-r file | -w file]\n");
+            return 2;
+        }
+        int result = argv[1][1] == 'r' ? history_manager_import(env->history, argv[2])
+                                       : history_manager_export(env->history, argv[2]);
+        if (result == -1) {
+            builtin_printf(&io->err, "history: %s: %s\n", argv[2], strerror(errno));
+            return 1;
+        }
+        return 0;
+    }
+
+    // The newest HISTORY_DISPLAY_SIZE, newest first, each written as it is
+    int count = env->history->count;
+    if (count == 0) {
+        builtin_printf(&io->out, "No commands in history.\n");
+        return 0;
+    }
+    int shown = count < HISTORY_DISPLAY_SIZE ? count : HISTORY_DISPLAY_SIZE;
+    for (int i = 0; i < shown; i++) {
+        size_t len;
+        const char *command = history_manager_get(env->history, count - 1 - i, &len);
+        if (builtin_printf(&io->out, "  [%d] %.*s\n", count - i, (int)len, command) == -1) return 1;
+    }
+    return 0;
+}
+
+// jobs [-lp]
+static int builtin_jobs(int argc, char **argv, BuiltinIO *io, BuiltinEnv *env) {
+    int show_pids = 0, only_pids = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-l") == 0) show_pids = 1;
+        else if (strcmp(argv[i], "-p") == 0) only_pids = 1;
+        else {
+            builtin_printf(&io->err, "jobs: %s: invalid option\n", argv[i]);
+            return 2;
+        }
+    }
+    if (!env->pm) return 0;
+
+    for (int i = 0; i < env->pm->num_bg_jobs; i++) {
+        ProcessInfo *info = &env->pm->bg_jobs[i];
+        if (only_pids) {
+            builtin_printf(&io->out, "%d\n", (int)info->pid);
+            continue;
+        }
+        // '+' marks the current job (the one `fg` picks), '-' the previous one
+        char mark = (i == env->pm->num_bg_jobs - 1) ? '+' :
+                    (i == env->pm->num_bg_jobs - 2) ? '-' : ' ';
+        if (show_pids) {
+            builtin_printf(&io->out, "[%d]%c %d %-24s%s\n", info->job_id, mark,
+                           (int)info->pid, process_state_to_string(info->state), info->command);
+        } else {
+            builtin_printf(&io->out, "[%d]%c  %-24s%s\n", info->job_id, mark,
+                           process_state_to_string(info->state), info->command);
+        }
+    }
+    return 0;
+}
+
+// fg [job]
+static int builtin_fg(int argc, char **argv, BuiltinIO *io, BuiltinEnv *env) {
+    if (env->in_pipeline || !env->pm || !env->foreground) {
+        builtin_printf(&io->err, "fg: no job control\n");
+        return 1;
+    }
+
+    ProcessInfo *info = find_job(env, io, "fg", argc > 1 ? argv[1] : NULL);
+    if (!info) return 1;
+
+    builtin_printf(&io->out, "%s\n", info->command);
+    if (env->foreground(info, env->user_data) != 0) {
+        builtin_printf(&io->err, "fg: job %d can't be resumed\n", info->job_id);
+        return 1;
+    }
+    return 0;
+}
+
+// bg [job]
+static int builtin_bg(int argc, char **argv, BuiltinIO *io, BuiltinEnv *env) {
+    if (env->in_pipeline || !env->pm) {
+        builtin_printf(&io->err, "bg: no job control\n");
+        return 1;
+    }
+
+    ProcessInfo *info = find_job(env, io, "bg", argc > 1 ? argv[1] : NULL);
+    if (!info) return 1;
+
+    if (info->state == PROC_RUNNING) {
+        builtin_printf(&io->err, "bg: job %d already in background\n", info->job_id);
+        return 0;
+    }
+
+    if (info->job) {
+        job_continue(info->job);
+    } else if (kill(-info->pgid, SIGCONT) == -1) {
+        builtin_printf(&io->err, "bg: %s\n", strerror(errno));
+        return 1;
+    }
+    info->state = PROC_RUNNING;
+    builtin_printf(&io->out, "[%d]+ %s &\n", info->job_id, info->command);
+    return 0;
+}
+
+// kill [-s sigspec | -sigspec | -n signum] pid|job ... ; kill -l
+static int builtin_kill(int argc, char **argv, BuiltinIO *io, BuiltinEnv *env) {
+    if (argc < 2) {
+        builtin_printf(&io->err, "kill: usage: kill [-s sigspec | -n signum | -sigspec] pid | jobspec ... or kill -l\n");
+        return 2;
+    }
+
+    if (strcmp(argv[1], "-l") == 0) {
+        for (int i = 0; i < NUM_SIGNALS; i++) {
+            builtin_printf(&io->out, "%2d) SIG%-8s%s", g_signals[i].number, g_signals[i].name,
+                           (i % 4 == 3 || i == NUM_SIGNALS - 1) ? "\n" : "\t");
+        }
+        return 0;
+    }
+
+    int sig = SIGTERM;
+    int i = 1;
+    if ((strcmp(argv[i], "-s") == 0 || strcmp(argv[i], "-n") == 0) && i + 1 < argc) {
+        sig = parse_signal(argv[i + 1]);
+        if (sig == -1) {
+            builtin_printf(&io->err, "kill: %s: invalid signal specification\n", argv[i + 1]);
+            return 1;
+        }
+        i += 2;
+    } else if (argv[i][0] == '-' && argv[i][1] != '\0' && strcmp(argv[i], "--") != 0) {
+        sig = parse_signal(argv[i] + 1);
+        if (sig == -1) {
+            builtin_printf(&io->err, "kill: %s: invalid signal specification\n", argv[i] + 1);
+            return 1;
+        }
+        i++;
+    }
+    if (i < argc && strcmp(argv[i], "--") == 0) i++;
+
+    int status = 0;
+    for (; i < argc; i++) {
+        pid_t target;
+        ProcessInfo *info = NULL;
+        if (argv[i][0] == '%') {
+            info = find_job(env, io, "kill", argv[i]);
+            if (!info) {
+                status = 1;
+                continue;
+            }
+            target = -info->pgid;
+        } else {
+            char *end;
+            long pid = strtol(argv[i], &end, 10);
+            if (argv[i][0] == '\0' || *end != '\0') {
+                builtin_printf(&io->err, "kill: %s: arguments must be process or job IDs\n", argv[i]);
+                status = 1;
+                continue;
+            }
+            target = (pid_t)pid;
+        }
+
+        if (kill(target, sig) == -1) {
+            builtin_printf(&io->err, "kill: (%s) - %s\n", argv[i], strerror(errno));
+            status = 1;
+        } else if (info && info->state == PROC_STOPPED && (sig == SIGTERM || sig == SIGHUP)) {
+            // A stopped job only acts on the signal once it runs again
+            kill(target, SIGCONT);
+        }
+    }
+    return status;
+}
+
+// type name ...
+static int builtin_type(int argc, char **argv, BuiltinIO *io, BuiltinEnv *env) {
+    (void)env;
+    int status = 0;
+    for (int i = 1; i < argc; i++) {
+        char path[PATH_MAX];
+        if (builtin_find(argv[i])) {
+            builtin_printf(&io->out, "%s is a shell builtin\n", argv[i]);
+            continue;
+        }
+        switch (path_cache_lookup(argv[i], path, sizeof(path))) {
+            case 1:
+                builtin_printf(&io->out, "%s is hashed (%s)\n", argv[i], path);
+                break;
+            case 0:
+                builtin_printf(&io->out, "%s is %s\n", argv[i], path);
+                break;
+            default:
+                builtin_printf(&io->err, "type: %s: not found\n", argv[i]);
+                status = 1;
+                break;
+        }
+    }
+    return status;
+}
+
+// exit [n]
+static int builtin_exit(int argc, char **argv, BuiltinIO *io, BuiltinEnv *env) {
+    int status = 0;
+    if (argc > 1) {
+        char *end;
+        long value = strtol(argv[1], &end, 10);
+        if (argv[1][0] == '\0' || *end != '\0') {
+            builtin_printf(&io->err, "exit: %s: numeric argument required\n", argv[1]);
+            status = 2;
+        } else {
+            status = (int)(value & 0xff);
+        }
+    }
+    if (!env->in_pipeline && env->exit_shell) {
+        env->exit_shell(status, env->user_data);
+    }
+    return status;
+}
+
+// stats
+static int builtin_stats(int argc, char **argv, BuiltinIO *io, BuiltinEnv *env) {
+    (void)argc; (void)argv;
+    if (!env->report_stats) {
+        builtin_printf(&io->err, "stats: no terminal statistics here\n");
+        return 1;
+    }
+    env->report_stats(&io->out, env->user_data);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Dispatch
+
+static const Builtin g_builtins[] = {
+    { "echo",    builtin_echo },
+    { "cd",      builtin_cd },
+    { "pwd",     builtin_pwd },
+    { "true",    builtin_true },
+    { "false",   builtin_false },
+    { "export",  builtin_export },
+    { "unset",   builtin_unset },
+    { "hash",    builtin_hash },
+    { "history", builtin_history },
+    { "jobs",    builtin_jobs },
+    { "fg",      builtin_fg },
+    { "bg",      builtin_bg },
+    { "kill",    builtin_kill },
+    { "type",    builtin_type },
+    { "exit",    builtin_exit },
+    { "stats",   builtin_stats },
+};
+#define NUM_BUILTINS (int)(sizeof(g_builtins) / sizeof(g_builtins[0]))
+
+// At least twice as many slots as builtins, so a seed is found quickly
+#define BUILTIN_SLOT_BITS 5
+#define BUILTIN_SLOTS (1 << BUILTIN_SLOT_BITS)
+
+static const Builtin *g_slots[BUILTIN_SLOTS];
+static uint32_t g_seed = 0;
+
+static uint32_t hash_name(uint32_t seed, const char *name) {
+    // FNV-1a, started from a seed
+    uint32_t h = 2166136261u ^ seed;
+    for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+        h ^= *p;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// The low bits of FNV-1a only depend on the low bits of the seed, so the
+// slot is taken from the top bits
+static uint32_t slot_of(uint32_t seed, const char *name) {
+    return hash_name(seed, name) >> (32 - BUILTIN_SLOT_BITS);
+}
+
+// Tries seeds until every builtin gets a slot of its own
+static void build_slots(void) {
+    for (uint32_t seed = 1; ; seed++) {
+        memset(g_slots, 0, sizeof(g_slots));
+        int i;
+        for (i = 0; i < NUM_BUILTINS; i++) {
+            uint32_t slot = slot_of(seed, g_builtins[i].name);
+            if (g_slots[slot]) break;
+            g_slots[slot] = &g_builtins[i];
+        }
+        if (i == NUM_BUILTINS) {
+            g_seed = seed;
+            return;
+        }
+    }
+}
+
+const Builtin* builtin_find(const char *name) {
+    if (!name) return NULL;
+    if (g_seed == 0) build_slots();
+
+    const Builtin *builtin = g_slots[slot_of(g_seed, name)];
+    return (builtin && strcmp(builtin->name, name) == 0) ? builtin : NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Running builtins
+
+int builtin_run_command(const Builtin *builtin, Command *cmd, RedirectInfo *redir_info,
+                        BuiltinEnv *env, OutputCapture *capture) {
+    BuiltinEnv no_env = { 0 };
+    if (!env) env = &no_env;
+
+    int redir_in, redir_out;
+    char error[PATH_MAX + 128];
+    if (redirect_open_files(redir_info, &redir_in, &redir_out, error, sizeof(error)) == -1) {
+        output_capture_append(capture, error, strlen(error));
+        output_capture_append(capture, "\n", 1);
+        return 1;
+    }
+
+    BuiltinIO io = {
+        .out = { redir_out, capture },
+        .err = { -1, capture },
+    };
+    printf("[BUILTIN] Running '%s'%s\n", builtin->name, redir_out != -1 ? " (redirected)" : "");
+    fflush(stdout);
+    int status = builtin->func(cmd->argc, cmd->args, &io, env);
+
+    if (redir_in != -1) close(redir_in);
+    if (redir_out != -1) close(redir_out);
+    return status;
+}
+
+// Output of a builtin stage on its way into the pipe
+typedef struct {
+    int fd;
+    OutputCapture output;
+} StageWriter;
+
+static void* stage_writer_main(void *arg) {
+    StageWriter *writer = (StageWriter *)arg;
+    BuiltinStream stream = { writer->fd, NULL };
+
+    // A reader that stops early gets us EPIPE (SIGPIPE is blocked in this thread)
+    for (OutputChunk *chunk = writer->output.head; chunk; chunk = chunk->next) {
+        if (builtin_write(&stream, chunk->data, chunk->len) == -1) break;
+    }
+
+    close(writer->fd);
+    output_capture_free(&writer->output);
+    free(writer);
+    return NULL;
+}
+
+int builtin_start_stage(const Builtin *builtin, Command *cmd, BuiltinEnv *env,
+                        int out_fd, char *errors, size_t errors_size) {
+    BuiltinEnv stage_env = { 0 };
+    if (env) stage_env = *env;
+    stage_env.in_pipeline = 1;
+
+    StageWriter *writer = calloc(1, sizeof(StageWriter));
+    if (!writer) return -1;
+    OutputCapture err;
+    output_capture_init(&writer->output, NULL, NULL);
+    output_capture_init(&err, NULL, NULL);
+
+    BuiltinIO io = {
+        .out = { -1, &writer->output },
+        .err = { -1, &err },
+    };
+    int status = builtin->func(cmd->argc, cmd->args, &io, &stage_env);
+
+    char *messages = output_capture_join(&err);
+    output_capture_free(&err);
+    if (messages && errors && strlen(errors) + strlen(messages) < errors_size) {
+        strcat(errors, messages);
+    }
+    free(messages);
+
+    // The thread gets a descriptor of its own and the default signal
+    // dispositions stay with the main thread: block everything while it is
+    // created so it inherits a full mask
+    writer->fd = fcntl(out_fd, F_DUPFD_CLOEXEC, 0);
+    pthread_t thread;
+    sigset_t all, saved;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &saved);
+    int result = (writer->fd == -1) ? errno :
+                 pthread_create(&thread, NULL, stage_writer_main, writer);
+    pthread_sigmask(SIG_SETMASK, &saved, NULL);
+
+    if (result != 0) {
+        fprintf(stderr, "builtin stage: %s\n", strerror(result));
+        if (writer->fd != -1) close(writer->fd);
+        output_capture_free(&writer->output);
+        free(writer);
+        return -1;
+    }
+    pthread_detach(thread);
+
+    printf("[BUILTIN] '%s' runs as a pipeline stage (status %d)\n", builtin->name, status);
+    fflush(stdout);
+    return status;
+}
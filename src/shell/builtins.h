@@ -0,0 +1,116 @@
+// src/shell/builtins.h
+#ifndef BUILTINS_H
+#define BUILTINS_H
+
+#include <stddef.h>
+#include <sys/types.h>
+#include "command_parser.h"
+#include "redirect_handler.h"
+#include "output_capture.h"
+#include "process_manager.h"
+#include "history_manager.h"
+
+// Commands the shell runs itself, without starting a process.
+//
+// The builtins live in one table and are found through a perfect hash of
+// their names (a seeded FNV-1a chosen once so that no two names share a
+// slot), so dispatch costs one hash and one strcmp whatever the table size.
+// A builtin writes through a BuiltinStream, which is either a descriptor
+// (a redirection file or a pipe) or an OutputCapture, so its output streams
+// out in pieces instead of being built up in a fixed-size buffer.
+
+// Where a builtin's stdout or stderr goes
+typedef struct {
+    int fd;                     // Written to directly if not -1
+    OutputCapture *capture;     // Appended to otherwise
+} BuiltinStream;
+
+typedef struct {
+    BuiltinStream out;
+    BuiltinStream err;
+} BuiltinIO;
+
+// The shell state a builtin may look at or change. Every member may be
+// NULL/0; builtins that need one that is missing report an error.
+typedef struct BuiltinEnv {
+    ProcessManager *pm;         // The tab's jobs (`jobs`, `fg`, `bg`, `kill %N`)
+    HistoryManager *history;    // For `history`
+    // Resume a background job as the foreground job (`fg`); 0 on success
+    int (*foreground)(ProcessInfo *info, void *user_data);
+    // Close the shell once the current command is done (`exit`)
+    void (*exit_shell)(int status, void *user_data);
+    // Write the terminal's memory statistics (`stats`)
+    void (*report_stats)(BuiltinStream *out, void *user_data);
+    void *user_data;            // Passed through to the hooks
+    int in_pipeline;            // Running as a pipeline stage: like a subshell,
+                                // changes to the shell (cd, export, exit) are dropped
+} BuiltinEnv;
+
+/**
+ * @brief A builtin command
+ * @param argc Number of arguments, including the name
+ * @param argv Arguments, NULL-terminated
+ * @param io Where output and errors go
+ * @param env Shell state (never NULL)
+ * @return Exit status
+ */
+typedef int (*BuiltinFunc)(int argc, char **argv, BuiltinIO *io, BuiltinEnv *env);
+
+typedef struct {
+    const char *name;
+    BuiltinFunc func;
+} Builtin;
+
+/**
+ * @brief Look up a builtin by command name
+ * @param name Command name (argv[0])
+ * @return The builtin, or NULL if name is not one
+ */
+const Builtin* builtin_find(const char *name);
+
+/**
+ * @brief Write bytes to a builtin's stream
+ * @return 0 on success, -1 if the bytes could not be written
+ */
+int builtin_write(BuiltinStream *stream, const char *data, size_t len);
+
+/**
+ * @brief printf() to a builtin's stream
+ * @return 0 on success, -1 on failure
+ */
+int builtin_printf(BuiltinStream *stream, const char *format, ...)
+    __attribute__((format(printf, 2, 3)));
+
+/**
+ * @brief Run a builtin as a command of its own, in the calling process
+ * Redirections are honored: '>' sends stdout to the file, '<' is opened
+ * (and reported if it can't be) but builtins don't read input.
+ * @param builtin Builtin from builtin_find()
+ * @param cmd Parsed command
+ * @param redir_info Its redirections (may be NULL)
+ * @param env Shell state (NULL = none)
+ * @param capture Receives stdout (unless redirected) and stderr
+ * @return Exit status of the builtin, 1 if a redirection failed
+ */
+int builtin_run_command(const Builtin *builtin, Command *cmd, RedirectInfo *redir_info,
+                        BuiltinEnv *env, OutputCapture *capture);
+
+/**
+ * @brief Run a builtin as a pipeline stage
+ * The builtin itself runs right away in the calling thread, as in a
+ * subshell (env->in_pipeline is set for it). Its output is then written to
+ * out_fd by a detached thread, which blocks on the pipe like a process
+ * would until the next stage has read everything, and then closes it.
+ * @param builtin Builtin from builtin_find()
+ * @param cmd Parsed command
+ * @param env Shell state (NULL = none)
+ * @param out_fd Where stdout goes; the thread writes to a duplicate, so the
+ * caller still owns (and should close) out_fd
+ * @param errors Receives what the builtin wrote to stderr
+ * @param errors_size Size of errors (appended to, never overflowed)
+ * @return Exit status of the builtin, or -1 if the writer thread could not be started
+ */
+int builtin_start_stage(const Builtin *builtin, Command *cmd, BuiltinEnv *env,
+                        int out_fd, char *errors, size_t errors_size);
+
+#endif // BUILTINS_H
@@ -0,0 +1,44 @@
+// src/shell/child_waiter.c
+#include "child_waiter.h"
+#include "signal_handler.h"
+#include "zygote.h"
+#include <stdio.h>
+#include <string.h>
+#include <poll.h>
+#include <errno.h>
+
+int child_waiter_wait(int output_fd) {
+    struct pollfd fds[3];
+    int nfds = 0;
+
+    if (output_fd >= 0) {
+        fds[nfds].fd = output_fd;
+        fds[nfds].events = POLLIN;
+        nfds++;
+    }
+
+    int sigchld_fd = signal_handler_get_sigchld_fd();
+    if (sigchld_fd >= 0) {
+        fds[nfds].fd = sigchld_fd;
+        fds[nfds].events = POLLIN;
+        nfds++;
+    }
+
+    // Children started by the zygote report their status over its socket
+    int zygote_fd = zygote_get_fd();
+    if (zygote_fd >= 0) {
+        fds[nfds].fd = zygote_fd;
+        fds[nfds].events = POLLIN;
+        nfds++;
+    }
+
+    // Without the SIGCHLD pipe we can't be woken on exit, so fall back to a short tick
+    int timeout = (sigchld_fd >= 0) ? -1 : 10;
+
+    if (poll(fds, nfds, timeout) == -1 && errno != EINTR) {
+        printf("[WAITER] poll error: %s\n", strerror(errno));
+        fflush(stdout);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,23 @@
+// src/shell/child_waiter.h
+#ifndef CHILD_WAITER_H
+#define CHILD_WAITER_H
+
+/**
+ * @brief Sleep until something needs attention while a child runs
+ *
+ * Used by callers that wait for a command synchronously (job_wait); the GUI
+ * drives its jobs from the main event loop instead. Blocks in poll() on
+ * output_fd, the SIGCHLD wakeup pipe and the zygote socket. There is no
+ * timeout: the caller is woken exactly when output arrives or a child
+ * changes state, and costs nothing while idle.
+ *
+ * Callers must drain the SIGCHLD pipe (signal_handler_drain_sigchld) before
+ * each spawn_waitpid() check so no state change is missed (spawn_waitpid
+ * drains the zygote socket itself).
+ *
+ * @param output_fd Output pipe to watch, or -1 if it already hit EOF
+ * @return 0 on wakeup, -1 on poll error
+ */
+int child_waiter_wait(int output_fd);
+
+#endif // CHILD_WAITER_H
@@ -3,7 +3,10 @@
 #include "command_exec.h"
 #include "process_manager.h"
 #include "signal_handler.h"
-#include "../utils/unicode_handler.h"
+#include "output_capture.h"
+#include "process_spawn.h"
+#include "pseudo_terminal.h"
+#include "builtins.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -11,535 +14,211 @@
 #include <sys/wait.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <limits.h>
 
-// Global callback for processing events during command execution
-static int (*g_event_processor_callback)(void) = NULL;
+static int g_pty_mode = 0;
 
-void set_event_processor_callback(int (*callback)(void)) {
-    g_event_processor_callback = callback;
-    printf("[EXEC] Event processor callback registered\n");
-    fflush(stdout);
+void command_set_pty_mode(int enabled) {
+    g_pty_mode = enabled;
 }
 
-// Built-in 'cd' command
-int builtin_cd(Command *cmd) {
-    if (cmd->argc < 2) {
-        if (chdir(getenv("HOME")) != 0) perror("cd");
-    } else {
-        if (chdir(cmd->args[1]) != 0) perror("cd");
-    }
-    return 0;
+int command_get_pty_mode(void) {
+    return g_pty_mode;
 }
 
-// Built-in 'echo' command with -e flag support
-static char* builtin_echo(Command *cmd) {
-    if (cmd->argc < 2) {
-        return strdup("\n");
-    }
-    
-    int enable_escapes = 0;
-    int start_index = 1;
-    int suppress_newline = 0;
-    
-    // Parse flags
-    for (int i = 1; i < cmd->argc; i++) {
-        if (strcmp(cmd->args[i], "-e") == 0) {
-            enable_escapes = 1;
-            start_index = i + 1;
-        } else if (strcmp(cmd->args[i], "-n") == 0) {
-            suppress_newline = 1;
-            start_index = i + 1;
-        } else if (strcmp(cmd->args[i], "-ne") == 0 || strcmp(cmd->args[i], "-en") == 0) {
-            enable_escapes = 1;
-            suppress_newline = 1;
-            start_index = i + 1;
-        } else {
-            // First non-flag argument, stop parsing flags
-            break;
-        }
-    }
-    
-    // Allocate buffer for output
-    char *output = malloc(8192);
-    if (!output) return NULL;
-    output[0] = '\0';
-    
-    // Process each argument
-    for (int i = start_index; i < cmd->argc; i++) {
-        if (i > start_index) {
-            strcat(output, " ");  // Space between arguments
-        }
-        
-        if (enable_escapes) {
-            // Process escape sequences
-            char processed[4096];
-            process_escape_sequences(cmd->args[i], processed, sizeof(processed));
-            strcat(output, processed);
-        } else {
-            // No escape processing
-            strcat(output, cmd->args[i]);
-        }
-    }
-    
-    if (!suppress_newline) {
-        strcat(output, "\n");
+// Opens the redirection files and returns the shell-style error message on failure
+static char* open_redirections(RedirectInfo *redir_info, int *in_fd, int *out_fd) {
+    char error[PATH_MAX + 128];
+    if (redirect_open_files(redir_info, in_fd, out_fd, error, sizeof(error)) == 0) {
+        return NULL;
     }
-    
-    return output;
+    strcat(error, "\n");
+    return strdup(error);
 }
 
-// Handle output redirection for built-in commands
-static int handle_builtin_output_redirection(char *output, RedirectInfo *redir_info) {
-    if (!redir_info || redir_info->count == 0) {
-        return 0;  // No redirection
+// Closes every descriptor in the list that is open
+static void close_fds(int *fds, int count) {
+    for (int i = 0; i < count; i++) {
+        if (fds[i] != -1) close(fds[i]);
     }
-    
-    for (int i = 0; i < redir_info->count; i++) {
-        if (redir_info->redirects[i].type == REDIRECT_OUTPUT) {
-            FILE *fp = fopen(redir_info->redirects[i].filename, "w");
-            if (!fp) {
-                perror("fopen");
-                return -1;
-            }
-            fprintf(fp, "%s", output);
-            fclose(fp);
-            return 1;  // Output redirected to file
-        }
-    }
-    
-    return 0;  // No output redirection
 }
 
 // Legacy function - kept for backward compatibility
 char* execute_external_command(Command *cmd, RedirectInfo *redir_info) {
+    int in_fd, out_fd;
+    char *error = open_redirections(redir_info, &in_fd, &out_fd);
+    if (error) return error;
+
     int output_pipe[2];
-    if (pipe(output_pipe) == -1) { 
+    if (spawn_pipe(output_pipe) == -1) { 
         perror("pipe"); 
+        int fds[] = { in_fd, out_fd };
+        close_fds(fds, 2);
         return NULL; 
     }
 
-    pid_t pid = fork();
-    if (pid == -1) { 
-        perror("fork"); 
-        return NULL; 
-    }
+    SpawnRequest req;
+    spawn_request_init(&req);
+    req.pgid = -1;
+    req.stdin_fd = in_fd;
+    req.stdout_fd = (out_fd != -1) ? out_fd : output_pipe[1];
+    req.stderr_fd = output_pipe[1];
 
-    if (pid == 0) { // --- Child Process ---
-        close(output_pipe[0]);
-        dup2(output_pipe[1], STDOUT_FILENO);
-        dup2(output_pipe[1], STDERR_FILENO);
-        close(output_pipe[1]);
-        
-        // Redirection logic
-        for (int i = 0; i < redir_info->count; ++i) {
-            Redirect *r = &redir_info->redirects[i];
-            if (r->type == REDIRECT_INPUT) {
-                int in_fd = open(r->filename, O_RDONLY);
-                if (in_fd == -1) { 
-                    perror("open"); 
-                    exit(1); 
-                }
-                if (dup2(in_fd, STDIN_FILENO) == -1) { 
-                    perror("dup2"); 
-                    exit(1); 
-                }
-                close(in_fd);
-            } else if (r->type == REDIRECT_OUTPUT) {
-                int out_fd = open(r->filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
-                if (out_fd == -1) { 
-                    perror("open"); 
-                    exit(1); 
-                }
-                if (dup2(out_fd, STDOUT_FILENO) == -1) { 
-                    perror("dup2"); 
-                    exit(1); 
-                }
-                close(out_fd);
-            }
-        }
+    pid_t pid = spawn_process(cmd->args, &req);
+    int spawn_errno = errno;
 
-        execvp(cmd->args[0], cmd->args);
-        perror("execvp");
-        exit(127);
-        
-    } else { // --- Parent Process ---
-        close(output_pipe[1]);
-        char *output = malloc(8192);
-        if (output) output[0] = '\0';
-        char buffer[256];
-        int bytes_read;
-        while ((bytes_read = read(output_pipe[0], buffer, sizeof(buffer) - 1)) > 0) {
-            buffer[bytes_read] = '\0';
-            strcat(output, buffer);
-        }
+    int child_ends[] = { output_pipe[1], in_fd, out_fd };
+    close_fds(child_ends, 3);
+
+    if (pid == -1) {
         close(output_pipe[0]);
-        waitpid(pid, NULL, 0);
-        return output;
+        char message[512];
+        spawn_format_error(cmd->args[0], spawn_errno, message, sizeof(message));
+        return strdup(message);
     }
+
+    OutputCapture capture;
+    output_capture_init(&capture, NULL, NULL);
+    output_capture_drain_fd(&capture, output_pipe[0], NULL);
+    close(output_pipe[0]);
+    spawn_waitpid(pid, NULL, 0);
+    char *output = output_capture_join(&capture);
+    output_capture_free(&capture);
+    return output;
 }
 
-// NEW: Execute command with full signal handling support and event processing
-char* execute_command_with_signals(Command *cmd, RedirectInfo *redir_info,
-                                    ProcessManager *pm, const char *cmd_str,
-                                    int *interactive_fd) {
+// Runs a builtin in the shell itself; the output goes wherever a job's would
+static char* run_builtin(const Builtin *builtin, Command *cmd, RedirectInfo *redir_info,
+                         BuiltinEnv *env, OutputChunkCallback on_output, void *user_data) {
+    OutputCapture capture;
+    output_capture_init(&capture, on_output, user_data);
+    builtin_run_command(builtin, cmd, redir_info, env, &capture);
+    output_capture_flush(&capture);
+    char *output = output_capture_join(&capture);
+    output_capture_free(&capture);
+    return output ? output : strdup("");
+}
+
+Job* command_start(Command *cmd, RedirectInfo *redir_info, const char *cmd_str,
+                   BuiltinEnv *env, OutputChunkCallback on_output, void *user_data,
+                   char **output) {
+    *output = NULL;
     if (!cmd || cmd->argc == 0) {
         printf("[EXEC] ERROR: NULL command\n");
         fflush(stdout);
         return NULL;
     }
-    
+
     printf("[EXEC] Starting command: %s\n", cmd_str);
     fflush(stdout);
-    
-    int output_pipe[2];
-    if (pipe(output_pipe) == -1) { 
-        perror("pipe"); 
-        return NULL; 
+
+    const Builtin *builtin = builtin_find(cmd->args[0]);
+    if (builtin) {
+        *output = run_builtin(builtin, cmd, redir_info, env, on_output, user_data);
+        return NULL;
     }
 
-    printf("[EXEC] Forking child process...\n");
-    fflush(stdout);
-    if (strcmp(cmd->args[0], "echo") == 0) {
-        char *echo_output = builtin_echo(cmd);
-        if (!echo_output) return NULL;
-        
-        // Handle output redirection
-        int redirected = handle_builtin_output_redirection(echo_output, redir_info);
-        if (redirected == 1) {
-            free(echo_output);
-            return strdup("");  // Output went to file
-        } else if (redirected == -1) {
-            free(echo_output);
-            return strdup("[Error: could not open output file]\n");
-        }
-        
-        return echo_output;  // Return output for display
+    // Redirection files are opened here so a bad filename is reported like a shell would
+    int redir_in, redir_out;
+    char *redir_error = open_redirections(redir_info, &redir_in, &redir_out);
+    if (redir_error) {
+        printf("[EXEC] Redirection failed: %s", redir_error);
+        fflush(stdout);
+        *output = redir_error;
+        return NULL;
     }
 
-    // [NEW] Setup Input Pipe Logic for interactive commands
-    int input_pipe[2];
-    int use_input_pipe = 0;
-    
-    // Check if user is already redirecting input (e.g., < file.txt)
-    int has_input_redir = 0;
-    if (redir_info) {
-        for (int i = 0; i < redir_info->count; i++) {
-            if (redir_info->redirects[i].type == REDIRECT_INPUT) has_input_redir = 1;
+    // output_pipe[1] and input_pipe[0] are the child's ends, [0] and [1] ours
+    int output_pipe[2] = { -1, -1 };
+    int input_pipe[2] = { -1, -1 };
+    int use_pty = 0;
+
+    if (g_pty_mode) {
+        // The pty is both directions: the child gets the slave, we keep the
+        // master for output and a duplicate of it for input
+        int master, slave;
+        if (pty_open(&master, &slave) == 0) {
+            output_pipe[0] = master;
+            output_pipe[1] = slave;
+            if (redir_in == -1) {
+                input_pipe[1] = fcntl(master, F_DUPFD_CLOEXEC, 0);
+            }
+            use_pty = 1;
         }
     }
 
-    // If no file input, create a pipe so the GUI can send input
-    if (!has_input_redir) {
-        if (pipe(input_pipe) == -1) {
-            perror("input pipe");
-        } else {
-            use_input_pipe = 1;
+    if (!use_pty) {
+        if (spawn_pipe(output_pipe) == -1) { 
+            perror("pipe"); 
+            int fds[] = { redir_in, redir_out };
+            close_fds(fds, 2);
+            return NULL; 
         }
-    }
 
-    pid_t pid = fork();
-    if (pid == -1) { 
-        perror("fork"); 
-        close(output_pipe[0]);
-        close(output_pipe[1]);
-        if (use_input_pipe) {
-            close(input_pipe[0]);
-            close(input_pipe[1]);
+        // Without file input, a pipe lets the GUI send what the user types
+        if (redir_in == -1 && spawn_pipe(input_pipe) == -1) {
+            perror("input pipe");
+            input_pipe[0] = input_pipe[1] = -1;
         }
-        return NULL; 
     }
 
-    if (pid == 0) { 
-        // ============================================
-        // CHILD PROCESS
-        // ============================================
-        
-        pid_t child_pgid = getpid();
-        
-        // Create new process group
-        if (setpgid(0, child_pgid) == -1) {
-            perror("[CHILD] setpgid");
-            exit(1);
-        }
-        
-        printf("[CHILD] PID=%d, PGID=%d starting command: %s\n", 
-               getpid(), child_pgid, cmd->args[0]);
-        fflush(stdout);
-        
-        // Restore default signal handlers
-        signal_handler_setup_child();
-        
-        // [NEW] Connect Input Pipe
-        if (use_input_pipe) {
-            close(input_pipe[1]); // Close write end
-            dup2(input_pipe[0], STDIN_FILENO); // Read from pipe as STDIN
-            close(input_pipe[0]);
-        }
+    // The child leads a new process group (a new session on a pty) and gets
+    // default signal handlers
+    SpawnRequest req;
+    spawn_request_init(&req);
+    req.stdin_fd = (redir_in != -1) ? redir_in : (use_pty ? output_pipe[1] : input_pipe[0]);
+    req.stdout_fd = (redir_out != -1) ? redir_out : output_pipe[1];
+    req.stderr_fd = output_pipe[1];
+    req.new_session = use_pty;
 
-        // Set up output redirection
-        close(output_pipe[0]);
-        dup2(output_pipe[1], STDOUT_FILENO);
-        dup2(output_pipe[1], STDERR_FILENO);
-        close(output_pipe[1]);
-        
-        // Handle file redirections
-        for (int i = 0; i < redir_info->count; ++i) {
-            Redirect *r = &redir_info->redirects[i];
-            if (r->type == REDIRECT_INPUT) {
-                // If explicit redirection is used, it overrides our pipe
-                int in_fd = open(r->filename, O_RDONLY);
-                if (in_fd == -1) { 
-                    perror("[CHILD] open input"); 
-                    exit(1); 
-                }
-                if (dup2(in_fd, STDIN_FILENO) == -1) { 
-                    perror("[CHILD] dup2 input"); 
-                    exit(1); 
-                }
-                close(in_fd);
-            } else if (r->type == REDIRECT_OUTPUT) {
-                int out_fd = open(r->filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
-                if (out_fd == -1) { 
-                    perror("[CHILD] open output"); 
-                    exit(1); 
-                }
-                if (dup2(out_fd, STDOUT_FILENO) == -1) { 
-                    perror("[CHILD] dup2 output"); 
-                    exit(1); 
-                }
-                close(out_fd);
-            }
-        }
+    pid_t pid = spawn_process(cmd->args, &req);
+    int spawn_errno = errno;
 
-        // Execute the command
-        execvp(cmd->args[0], cmd->args);
-        
-        // If we get here, exec failed
-        fprintf(stderr, "[CHILD] execvp failed: %s\n", strerror(errno));
-        exit(127);
-    }
-    
-    // ============================================
-    // PARENT PROCESS
-    // ============================================
-    
-    close(output_pipe[1]);
-
-    // [NEW] Configure Input Pipe for Parent
-    if (use_input_pipe) {
-        close(input_pipe[0]); // Close read end
-        if (interactive_fd) {
-            *interactive_fd = input_pipe[1]; // Save write end for main.c
-        } else {
-            close(input_pipe[1]); // Safety if pointer is NULL
-        }
-    }
-    
-    // Set child's process group (parent side)
-    pid_t child_pgid = pid;
-    if (setpgid(pid, child_pgid) == -1 && errno != ESRCH) {
-        printf("[PARENT] WARNING: setpgid failed: %s\n", strerror(errno));
-        fflush(stdout);
-    }
-    
-    printf("[PARENT] Child PID=%d, PGID=%d started\n", pid, child_pgid);
-    fflush(stdout);
-    
-    // Register as foreground process
-    if (pm) {
-        printf("[PARENT] Registering as foreground process\n");
+    // The parent keeps only the read end of the output and the write end of the input
+    int child_ends[] = { output_pipe[1], input_pipe[0], redir_in, redir_out };
+    close_fds(child_ends, 4);
+
+    if (pid == -1) { 
+        printf("[EXEC] Spawn failed: %s\n", strerror(spawn_errno));
         fflush(stdout);
-        process_manager_set_foreground(pm, pid, child_pgid, cmd_str);
-        signal_handler_give_terminal_to(child_pgid);
-    }
-    
-    // Allocate output buffer
-    char *output = malloc(8192);
-    if (!output) {
-        perror("[PARENT] malloc");
-        close(output_pipe[0]);
-        if (use_input_pipe && interactive_fd && *interactive_fd != -1) {
-            close(*interactive_fd);
-            *interactive_fd = -1;
-        }
-        waitpid(pid, NULL, 0);
-        if (pm) {
-            process_manager_clear_foreground(pm);
-            signal_handler_take_terminal_back();
-        }
+        int parent_ends[] = { output_pipe[0], input_pipe[1] };
+        close_fds(parent_ends, 2);
+        char message[512];
+        spawn_format_error(cmd->args[0], spawn_errno, message, sizeof(message));
+        *output = strdup(message);
         return NULL;
     }
-    output[0] = '\0';
-    int output_len = 0;
-    
-    // Make output pipe non-blocking for better responsiveness
-    int flags = fcntl(output_pipe[0], F_GETFL, 0);
-    fcntl(output_pipe[0], F_SETFL, flags | O_NONBLOCK);
-    
-    int process_exited = 0;
-    int eof_reached = 0;
-    int final_status = 0;  // Store the final status for later checking
-    
-    printf("[PARENT] Starting read loop, waiting for child to exit...\n");
-    fflush(stdout);
-    
-    // ============================================
-    // MAIN WAIT LOOP WITH EVENT PROCESSING
-    // ============================================
-    
-    while (!process_exited) {
-        // *** KEY FIX: Process X11 events while waiting ***
-        if (g_event_processor_callback) {
-            g_event_processor_callback();
-        }
-        
-        // Try to read output (non-blocking)
-        if (!eof_reached) {
-            char buffer[256];
-            ssize_t bytes_read = read(output_pipe[0], buffer, sizeof(buffer) - 1);
-            
-            if (bytes_read > 0) {
-                buffer[bytes_read] = '\0';
-                if (output_len + bytes_read < 8191) {
-                    strcat(output, buffer);
-                    output_len += bytes_read;
-                }
-            } else if (bytes_read == 0) {
-                // EOF on pipe - child closed stdout
-                if (!eof_reached) {
-                    printf("[PARENT] EOF on pipe, but continuing to wait for process...\n");
-                    fflush(stdout);
-                    eof_reached = 1;
-                }
-            } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
-                // Real error (not just "would block")
-                printf("[PARENT] Read error: %s\n", strerror(errno));
-                fflush(stdout);
-                eof_reached = 1;
-            }
-        }
-        
-        // Check if process has exited or been stopped
-        int status;
-        pid_t wait_result = waitpid(pid, &status, WNOHANG | WUNTRACED);
-        
-        if (wait_result == pid) {
-            // Store the status for later use
-            final_status = status;
-            
-            // Process changed state
-            if (WIFSTOPPED(status)) {
-                // Process was stopped (Ctrl+Z)
-                printf("[PARENT] Process %d stopped by signal\n", pid);
-                fflush(stdout);
-                
-                // CRITICAL: Move to background and clean up immediately
-                if (pm) {
-                    int job_id = process_manager_move_to_background(pm);
-                    signal_handler_take_terminal_back();
-                    
-                    // Format the notification that will be shown
-                    char notification[1024];
-                    // Get the command from the process manager background job we just added
-                    ProcessInfo *bg_job = process_manager_find_by_pid(pm, pid);
-                    if (bg_job) {
-                        snprintf(notification, sizeof(notification),
-                                 "\n[%d]+ Stopped                 %s\n",
-                                 job_id, bg_job->command);
-                    } else {
-                        snprintf(notification, sizeof(notification),
-                                 "\n[%d]+ Stopped\n", job_id);
-                    }
-                    
-                    // Append ^Z and notification to output buffer
-                    if (output && output_len + strlen("^Z\n") + strlen(notification) < 8191) {
-                        strcat(output, "^Z\n");
-                        strcat(output, notification);
-                        output_len = strlen(output);
-                    }
-                    
-                    printf("[PARENT] Moved to background as job %d\n", job_id);
-                    fflush(stdout);
-                }
-                
-                // Exit the wait loop - process is stopped and moved to background
-                process_exited = 1;
-            } else if (WIFEXITED(status)) {
-                // Process exited normally
-                printf("[PARENT] Process %d exited with status %d\n", 
-                       pid, WEXITSTATUS(status));
-                fflush(stdout);
-                process_exited = 1;
-            } else if (WIFSIGNALED(status)) {
-                // Process was terminated by signal
-                printf("[PARENT] Process %d terminated by signal %d\n", 
-                       pid, WTERMSIG(status));
-                fflush(stdout);
-                process_exited = 1;
-            }
-        } else if (wait_result == -1) {
-            // Error from waitpid
-            if (errno == ECHILD) {
-                // Child doesn't exist (already reaped somehow)
-                printf("[PARENT] Child process already reaped\n");
-                fflush(stdout);
-                process_exited = 1;
-            } else if (errno != EINTR) {
-                // Real error (not interrupted by signal)
-                printf("[PARENT] waitpid error: %s\n", strerror(errno));
-                fflush(stdout);
-                process_exited = 1;
-            }
-        }
-        // If wait_result == 0, process is still running, continue loop
-        
-        // Small delay to avoid busy-waiting (10ms = responsive but not CPU-heavy)
-        usleep(10000);
-    }
-    
-    printf("[PARENT] Process exited, reading remaining output...\n");
-    fflush(stdout);
-    
-    // Only try to read remaining output if process actually exited (not stopped)
-    // For stopped processes, the pipe is still open and will block
-    if (!WIFSTOPPED(final_status)) {
-        // Read any remaining output after process exits
-        // (Switch back to blocking mode for final read)
-        fcntl(output_pipe[0], F_SETFL, flags & ~O_NONBLOCK);
-        
-        char buffer[256];
-        ssize_t bytes_read;
-        while ((bytes_read = read(output_pipe[0], buffer, sizeof(buffer) - 1)) > 0) {
-            buffer[bytes_read] = '\0';
-            if (output_len + bytes_read < 8191) {
-                strcat(output, buffer);
-                output_len += bytes_read;
-            }
-        }
-    }
-    
-    close(output_pipe[0]);
 
-    // [NEW] Cleanup Input Pipe after process finishes
-    if (use_input_pipe && interactive_fd && *interactive_fd != -1) {
-        close(*interactive_fd);
-        *interactive_fd = -1; // Reset so main.c stops trying to write
-    }
-    
-    printf("[PARENT] Cleaning up, clearing foreground process\n");
+    printf("[PARENT] Child PID=%d, PGID=%d started%s\n", pid, pid, use_pty ? " on a pty" : "");
     fflush(stdout);
-    
-    // Clean up process manager state
-    // Only clear foreground if the process wasn't moved to background
-    if (pm && !WIFSTOPPED(final_status)) {
-        process_manager_clear_foreground(pm);
-        signal_handler_take_terminal_back();
+
+    Job *job = job_create(cmd_str, &pid, 1, pid, output_pipe[0], input_pipe[1],
+                          on_output, user_data);
+    if (job) job->is_pty = use_pty;
+    return job;
+}
+
+// Synchronous version for callers without a main loop
+char* execute_command_with_signals(Command *cmd, RedirectInfo *redir_info,
+                                    ProcessManager *pm, const char *cmd_str,
+                                    int *interactive_fd,
+                                    OutputChunkCallback on_output, void *user_data) {
+    char *output;
+    BuiltinEnv env = { .pm = pm };
+    Job *job = command_start(cmd, redir_info, cmd_str, &env, on_output, user_data, &output);
+    if (!job) return output;
+
+    if (interactive_fd) {
+        *interactive_fd = job->input_fd;
+    } else if (job->input_fd != -1) {
+        // Nobody will write to the child, so let it see EOF
+        close(job->input_fd);
+        job->input_fd = -1;
     }
-    // If WIFSTOPPED, we already moved to background and took terminal back
-    
-    printf("[PARENT] Command execution complete, returning output (%d bytes)\n", output_len);
-    fflush(stdout);
-    
+
+    output = job_run_foreground(job, pm);
+
+    if (interactive_fd) *interactive_fd = -1;
     return output;
 }
 
@@ -547,29 +226,6 @@ char* execute_command_with_signals(Command *cmd, RedirectInfo *redir_info,
 char* execute_command(Command *cmd, RedirectInfo *redir_info) {
     if (cmd->argc == 0) return NULL;
     
-    // Check for built-in echo
-    if (strcmp(cmd->args[0], "echo") == 0) {
-        char *echo_output = builtin_echo(cmd);
-        if (!echo_output) return NULL;
-        
-        int redirected = handle_builtin_output_redirection(echo_output, redir_info);
-        if (redirected == 1) {
-            free(echo_output);
-            return strdup("");
-        } else if (redirected == -1) {
-            free(echo_output);
-            return strdup("[Error: could not open output file]\n");
-        }
-        
-        return echo_output;
-    }
-    
-    // Check for built-in cd
-    if (strcmp(cmd->args[0], "cd") == 0) {
-        builtin_cd(cmd);
-        return strdup("");
-    }
-    
-    // Pass NULL for pm, cmd_str, and interactive_fd for legacy calls
-    return execute_command_with_signals(cmd, redir_info, NULL, "legacy", NULL);
+    // Pass NULL for pm, cmd_str, interactive_fd and the output callback for legacy calls
+    return execute_command_with_signals(cmd, redir_info, NULL, "legacy", NULL, NULL, NULL);
 }
\ No newline at end of file
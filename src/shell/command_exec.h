@@ -5,6 +5,9 @@
 #include "command_parser.h"
 #include "redirect_handler.h"
 #include "process_manager.h"
+#include "output_capture.h"
+#include "job.h"
+#include "builtins.h"
 
 // Forward declaration
 
@@ -14,28 +17,60 @@
  * @param redir_info Redirection information.
  * @return The output of the command as a dynamically allocated string.
  * The caller is responsible for freeing this string.
- * Returns NULL on failure or for commands with no output (like cd).
+ * Returns NULL on failure.
  */
 char* execute_command(Command *cmd, RedirectInfo *redir_info);
 
 /**
- * @brief Executes a parsed command with full signal handling support.
+ * @brief Starts a parsed command without waiting for it.
  * @param cmd The command to execute.
  * @param redir_info Redirection information.
- * @param pm Process manager for job control.
  * @param cmd_str Original command string for display.
- * @return The output of the command as a dynamically allocated string.
+ * @param env Shell state for builtins (see builtins.h), or NULL.
+ * @param on_output Receives the command's output as it arrives.
+ * @param user_data Passed through to on_output.
+ * @param output Set to the output not passed to on_output (or the error
+ * message) when no job is started: for builtins, which run right here
+ * without a child process, and when the command can't be run.
+ * The caller is responsible for freeing this string.
+ * @return The running job, or NULL if nothing was started.
+ */
+Job* command_start(Command *cmd, RedirectInfo *redir_info, const char *cmd_str,
+                   BuiltinEnv *env, OutputChunkCallback on_output, void *user_data,
+                   char **output);
+
+/**
+ * @brief Executes a parsed command with full signal handling support,
+ * blocking until it exits or is stopped.
+ * @param cmd The command to execute.
+ * @param redir_info Redirection information.
+ * @param pm Process manager for job control (and the job builtins).
+ * @param cmd_str Original command string for display.
+ * @param interactive_fd Receives the write end of the child's stdin pipe while it runs.
+ * @param on_output If non-NULL, output is streamed to this callback as it arrives
+ * instead of being accumulated. Output size is unbounded either way.
+ * @param user_data Passed through to on_output.
+ * @return The output of the command as a dynamically allocated string
+ * (only what was not already streamed to on_output), or NULL on failure.
  */
 char* execute_command_with_signals(Command *cmd, RedirectInfo *redir_info,
                                     ProcessManager *pm, const char *cmd_str,
-                                    int *interactive_fd);
-void set_event_processor_callback(int (*callback)(void));
+                                    int *interactive_fd,
+                                    OutputChunkCallback on_output, void *user_data);
+
+/**
+ * @brief Selects whether commands run on a pseudo-terminal (default: off).
+ * With it on, a single command gets a pty as its stdin, stdout, stderr and
+ * controlling terminal (see pseudo_terminal.h) instead of pipes, so it
+ * line-buffers and can run interactively. Redirections still apply, and
+ * pipelines always use pipes.
+ * @param enabled Nonzero to use pseudo-terminals.
+ */
+void command_set_pty_mode(int enabled);
 
 /**
- * @brief Built-in cd command handler.
- * @param cmd The parsed cd command.
- * @return 0 on success, -1 on failure.
+ * @brief Returns nonzero if commands run on a pseudo-terminal.
  */
-int builtin_cd(Command *cmd);
+int command_get_pty_mode(void);
 
 #endif // COMMAND_EXEC_H
\ No newline at end of file
@@ -0,0 +1,182 @@
+// src/shell/history_file.c
+#include "history_file.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define PAD8(n) (((n) + 7) & ~(uint64_t)7)
+
+uint64_t history_checksum(uint64_t seed, const void *data, size_t len) {
+    const unsigned char *p = data;
+    uint64_t h = seed;
+    while (len > 0) {
+        uint64_t word = 0;
+        size_t n = len < 8 ? len : 8;
+        memcpy(&word, p, n);
+        h ^= word * 0x9e3779b97f4a7c15ULL;
+        h = ((h << 29) | (h >> 35)) * 0xbf58476d1ce4e5b9ULL;
+        p += n;
+        len -= n;
+    }
+    return h;
+}
+
+static uint64_t header_checksum(const HistoryFileHeader *header) {
+    return history_checksum(0, header, offsetof(HistoryFileHeader, header_checksum));
+}
+
+// Whether the header describes a file that fits in size bytes
+static int header_valid(const HistoryFileHeader *header, size_t size) {
+    if (header->version != HISTORY_FILE_VERSION ||
+        header->header_size != sizeof(HistoryFileHeader) ||
+        header->header_checksum != header_checksum(header) ||
+        header->text_size % 8 != 0) {
+        return 0;
+    }
+    uint64_t room = size - sizeof(HistoryFileHeader);
+    if (header->count > room / sizeof(HistoryEntry)) return 0;
+    room -= header->count * sizeof(HistoryEntry);
+    if (header->text_size > room) return 0;
+    return header->end == sizeof(HistoryFileHeader) + header->count * sizeof(HistoryEntry) +
+                          header->text_size;
+}
+
+int history_file_map(int fd, HistoryMap *map) {
+    memset(map, 0, sizeof(*map));
+    struct stat st;
+    if (fstat(fd, &st) == -1) return -1;
+    if (st.st_size == 0) return 0;
+
+    void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) return -1;
+    map->data = data;
+    map->size = (size_t)st.st_size;
+
+    const HistoryFileHeader *header = data;
+    if (map->size < sizeof(HistoryFileHeader) ||
+        memcmp(header->magic, HISTORY_FILE_MAGIC, sizeof(header->magic)) != 0) {
+        return 0;   // Text: all journal
+    }
+    if (!header_valid(header, map->size)) {
+        history_file_unmap(map);
+        errno = EINVAL;
+        return -1;
+    }
+    map->count = header->count;
+    map->entries = (const HistoryEntry *)(map->data + sizeof(HistoryFileHeader));
+    map->text = (const char *)(map->entries + header->count);
+    map->text_size = header->text_size;
+    map->end = header->end;
+    return 0;
+}
+
+void history_file_unmap(HistoryMap *map) {
+    if (map->data) munmap((void *)map->data, map->size);
+    memset(map, 0, sizeof(*map));
+}
+
+const char* history_file_get(const HistoryMap *map, uint64_t i, size_t *len) {
+    const HistoryEntry *entry = &map->entries[i];
+    // Only the header was checked: an entry must stay inside the text
+    if (entry->offset >= map->text_size || entry->len >= map->text_size - entry->offset ||
+        map->text[entry->offset + entry->len] != '\0') {
+        if (len) *len = 0;
+        return "";
+    }
+    if (len) *len = entry->len;
+    return map->text + entry->offset;
+}
+
+int history_file_verify(HistoryMap *map) {
+    if (map->verified || map->count == 0) return 0;
+    const HistoryFileHeader *header = (const HistoryFileHeader *)map->data;
+    uint64_t sum = history_checksum(0, map->entries, map->count * sizeof(HistoryEntry));
+    sum = history_checksum(sum, map->text, map->text_size);
+    if (sum != header->data_checksum) return -1;
+    map->verified = 1;
+    return 0;
+}
+
+static int write_all(int fd, const void *data, size_t len) {
+    const char *p = data;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// The part of a segment's text that is written: from its first entry on
+static size_t segment_start(const HistorySegment *segment) {
+    return segment->count ? segment->entries[0].offset : segment->len;
+}
+
+long long history_file_write(int fd, const HistorySegment *segments, int num_segments) {
+    size_t count = 0;
+    for (int s = 0; s < num_segments; s++) count += segments[s].count;
+
+    HistoryEntry *table = malloc(count ? count * sizeof(HistoryEntry) : 1);
+    if (!table) return -1;
+
+    // Each segment's text is placed after the last, at a multiple of 8
+    uint64_t text_size = 0;
+    size_t n = 0;
+    for (int s = 0; s < num_segments; s++) {
+        const HistorySegment *segment = &segments[s];
+        size_t start = segment_start(segment);
+        for (size_t i = 0; i < segment->count; i++) {
+            HistoryEntry entry = segment->entries[i];
+            if (entry.offset < start || entry.offset >= segment->len ||
+                entry.len >= segment->len - entry.offset ||
+                segment->text[entry.offset + entry.len] != '\0') {
+                free(table);
+                errno = EINVAL;
+                return -1;
+            }
+            entry.offset = entry.offset - start + text_size;
+            table[n++] = entry;
+        }
+        text_size += PAD8(segment->len - start);
+    }
+
+    static const char zeros[8];
+    uint64_t sum = history_checksum(0, table, count * sizeof(HistoryEntry));
+    for (int s = 0; s < num_segments; s++) {
+        size_t start = segment_start(&segments[s]);
+        size_t len = segments[s].len - start;
+        // A short last word is padded with zeros, as the text is
+        sum = history_checksum(sum, segments[s].text + start, len);
+    }
+
+    HistoryFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, HISTORY_FILE_MAGIC, sizeof(HISTORY_FILE_MAGIC));
+    header.version = HISTORY_FILE_VERSION;
+    header.header_size = sizeof(header);
+    header.count = count;
+    header.text_size = text_size;
+    header.end = sizeof(header) + count * sizeof(HistoryEntry) + text_size;
+    header.data_checksum = sum;
+    header.header_checksum = header_checksum(&header);
+
+    int ok = write_all(fd, &header, sizeof(header)) == 0 &&
+             write_all(fd, table, count * sizeof(HistoryEntry)) == 0;
+    for (int s = 0; ok && s < num_segments; s++) {
+        size_t start = segment_start(&segments[s]);
+        size_t len = segments[s].len - start;
+        ok = write_all(fd, segments[s].text + start, len) == 0 &&
+             write_all(fd, zeros, PAD8(len) - len) == 0;
+    }
+    free(table);
+    return ok ? (long long)header.end : -1;
+}
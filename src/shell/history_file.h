@@ -0,0 +1,103 @@
+// src/shell/history_file.h
+#ifndef HISTORY_FILE_H
+#define HISTORY_FILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The history file, in the machine's byte order:
+//
+//   header         HistoryFileHeader
+//   offset table   header.count HistoryEntry records, oldest first
+//   text           the commands, each NUL-terminated, padded to 8 bytes
+//   journal        "#<time>\n<command>\n" lines appended since it was written
+//
+// It is opened with mmap(): only the header is checked, and commands are
+// read where they are. A file without the header is all journal, which is
+// how text history (the old format, or bash's) is imported.
+
+#define HISTORY_FILE_MAGIC "MYTHIST"
+#define HISTORY_FILE_VERSION 1
+
+// A command: where its text is and when it was added
+typedef struct {
+    uint64_t offset;        // Of its text, from the start of the text
+    uint32_t len;           // Without the NUL after it
+    uint32_t time;          // Seconds since the epoch, 0 if not known
+} HistoryEntry;
+
+typedef struct {
+    char magic[8];              // HISTORY_FILE_MAGIC
+    uint32_t version;           // HISTORY_FILE_VERSION
+    uint32_t header_size;       // sizeof(HistoryFileHeader)
+    uint64_t count;             // Commands
+    uint64_t text_size;         // Bytes of text, a multiple of 8
+    uint64_t end;               // Where the journal starts
+    uint64_t data_checksum;     // Of the offset table and the text
+    uint64_t header_checksum;   // Of everything above
+} HistoryFileHeader;
+
+// A history file opened for reading
+typedef struct {
+    const char *data;           // The whole file, mapped; NULL if not open
+    size_t size;
+    uint64_t count;             // 0 if it has no header
+    const HistoryEntry *entries;
+    const char *text;
+    uint64_t text_size;
+    size_t end;                 // Where the journal starts (0 if no header)
+    int verified;               // 1 once the data checksum has been checked
+} HistoryMap;
+
+// Commands to write, in order: entries' offsets are from text
+typedef struct {
+    const HistoryEntry *entries;
+    size_t count;
+    const char *text;
+    size_t len;
+} HistorySegment;
+
+/**
+ * @brief Checksum bytes 8 at a time (a short last word is padded with
+ * zeros), continuing from seed
+ */
+uint64_t history_checksum(uint64_t seed, const void *data, size_t len);
+
+/**
+ * @brief Map a history file and check its header
+ * @param fd Open for reading
+ * @param map Receives the mapping
+ * @return 0 on success (a file without the header is all journal), -1 if
+ * the header is damaged or the file can't be mapped
+ */
+int history_file_map(int fd, HistoryMap *map);
+
+/**
+ * @brief Unmap a history file (does nothing if it isn't mapped)
+ */
+void history_file_unmap(HistoryMap *map);
+
+/**
+ * @brief Get command i of a mapped file
+ * @param len Receives its length (may be NULL)
+ * @return The command, NUL-terminated; "" if its entry is damaged
+ */
+const char* history_file_get(const HistoryMap *map, uint64_t i, size_t *len);
+
+/**
+ * @brief Check the offset table and text against the data checksum
+ * @return 0 if they match, -1 if not
+ */
+int history_file_verify(HistoryMap *map);
+
+/**
+ * @brief Write the header, offset table and text of a history file
+ * @param fd Open for writing, at the start of the file
+ * @param segments The commands, oldest first; a segment's text is written
+ * from its first entry's offset on
+ * @param num_segments Their number
+ * @return Bytes written (where the journal starts), -1 on failure
+ */
+long long history_file_write(int fd, const HistorySegment *segments, int num_segments);
+
+#endif // HISTORY_FILE_H
@@ -0,0 +1,207 @@
+// src/shell/history_index.c
+#include "history_index.h"
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t trigram_key(const char *p) {
+    return ((uint32_t)(unsigned char)p[0] << 16 | (uint32_t)(unsigned char)p[1] << 8 |
+            (uint32_t)(unsigned char)p[2]) + 1;
+}
+
+static size_t slot_for(const HistoryIndex *index, uint32_t key) {
+    return (size_t)(key * 2654435761u) & (index->capacity - 1);
+}
+
+void history_index_reset(HistoryIndex *index) {
+    for (size_t i = 0; i < index->capacity; i++) free(index->lists[i].ids);
+    free(index->lists);
+    memset(index, 0, sizeof(*index));
+}
+
+// Moves the lists to a table twice the size
+static int grow_table(HistoryIndex *index) {
+    size_t capacity = index->capacity ? index->capacity * 2 : 4096;
+    TrigramList *lists = calloc(capacity, sizeof(TrigramList));
+    if (!lists) return -1;
+    HistoryIndex grown = *index;
+    grown.lists = lists;
+    grown.capacity = capacity;
+    for (size_t i = 0; i < index->capacity; i++) {
+        if (!index->lists[i].key) continue;
+        size_t slot = slot_for(&grown, index->lists[i].key);
+        while (lists[slot].key) slot = (slot + 1) & (capacity - 1);
+        lists[slot] = index->lists[i];
+    }
+    free(index->lists);
+    *index = grown;
+    return 0;
+}
+
+static TrigramList* lookup(const HistoryIndex *index, uint32_t key) {
+    if (index->capacity == 0) return NULL;
+    size_t slot = slot_for(index, key);
+    while (index->lists[slot].key) {
+        if (index->lists[slot].key == key) return &index->lists[slot];
+        slot = (slot + 1) & (index->capacity - 1);
+    }
+    return NULL;
+}
+
+// The list for key, made if there is none
+static TrigramList* list_for(HistoryIndex *index, uint32_t key) {
+    TrigramList *list = lookup(index, key);
+    if (list) return list;
+    if ((index->used + 1) * 2 > index->capacity && grow_table(index) == -1) return NULL;
+    size_t slot = slot_for(index, key);
+    while (index->lists[slot].key) slot = (slot + 1) & (index->capacity - 1);
+    index->lists[slot].key = key;
+    index->used++;
+    return &index->lists[slot];
+}
+
+int history_index_add(HistoryIndex *index, const char *text, size_t len) {
+    uint32_t id = index->next_id;
+    if (id == UINT32_MAX) {
+        // Out of ids: it has to be built again
+        history_index_reset(index);
+        return -1;
+    }
+    for (size_t i = 0; i + 3 <= len; i++) {
+        TrigramList *list = list_for(index, trigram_key(text + i));
+        if (!list) goto fail;
+        // Once for each command, however often it has these bytes
+        if (list->len > 0 && list->ids[list->len - 1] == id) continue;
+        if (list->len == list->capacity) {
+            uint32_t capacity = list->capacity ? list->capacity * 2 : 4;
+            uint32_t *ids = realloc(list->ids, capacity * sizeof(uint32_t));
+            if (!ids) goto fail;
+            index->postings_capacity += capacity - list->capacity;
+            list->ids = ids;
+            list->capacity = capacity;
+        }
+        list->ids[list->len++] = id;
+    }
+    index->next_id = id + 1;
+    return 0;
+
+fail:
+    history_index_reset(index);
+    return -1;
+}
+
+// Number of ids in ids[0..len) below id
+static size_t count_below(const uint32_t *ids, size_t len, uint32_t id) {
+    size_t lo = 0, hi = len;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (ids[mid] < id) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// Trims the ids of commands no longer kept from every list
+static void sweep(HistoryIndex *index) {
+    for (size_t i = 0; i < index->capacity; i++) {
+        TrigramList *list = &index->lists[i];
+        if (!list->key || list->len == 0 || list->ids[0] >= index->first_id) continue;
+        size_t stale = count_below(list->ids, list->len, index->first_id);
+        memmove(list->ids, list->ids + stale, (list->len - stale) * sizeof(uint32_t));
+        list->len -= stale;
+        // The slot stays, for the lists after it
+        if (list->len <= list->capacity / 4) {
+            uint32_t capacity = list->len ? list->len * 2 : 0;
+            uint32_t *ids = capacity ? realloc(list->ids, capacity * sizeof(uint32_t)) : NULL;
+            if (capacity && !ids) continue;
+            if (!capacity) free(list->ids);
+            index->postings_capacity -= list->capacity - capacity;
+            list->ids = ids;
+            list->capacity = capacity;
+        }
+    }
+    index->swept_id = index->first_id;
+}
+
+void history_index_drop_oldest(HistoryIndex *index) {
+    if (index->first_id == index->next_id) return;
+    index->first_id++;
+    if (index->first_id - index->swept_id >= index->next_id - index->first_id) sweep(index);
+}
+
+const TrigramList* history_index_find(const HistoryIndex *index, const char *trigram) {
+    return lookup(index, trigram_key(trigram));
+}
+
+void history_index_cursor(IndexCursor *cursor, const HistoryIndex *index,
+                          const TrigramList **lists, int count) {
+    // The shortest lists, shortest first, each once
+    cursor->count = 0;
+    cursor->floor = index->first_id;
+    cursor->steps = 0;
+    for (int i = 0; i < count; i++) {
+        const TrigramList *list = lists[i];
+        int duplicate = 0;
+        for (int j = 0; j < cursor->count; j++) duplicate |= cursor->lists[j] == list;
+        int at = cursor->count;
+        while (at > 0 && cursor->lists[at - 1]->len > list->len) at--;
+        if (duplicate || at == INDEX_CURSOR_LISTS) continue;
+        int last = cursor->count < INDEX_CURSOR_LISTS ? cursor->count : INDEX_CURSOR_LISTS - 1;
+        memmove(&cursor->lists[at + 1], &cursor->lists[at], (last - at) * sizeof(cursor->lists[0]));
+        cursor->lists[at] = list;
+        if (cursor->count < INDEX_CURSOR_LISTS) cursor->count++;
+    }
+    for (int i = 0; i < cursor->count; i++) cursor->pos[i] = cursor->lists[i]->len;
+}
+
+// Number of ids in ids[0..end) at or below id, looking back from end in
+// growing steps, since the cursor moves only a little at a time
+static size_t seek_back(const uint32_t *ids, size_t end, uint32_t id) {
+    if (end == 0 || ids[end - 1] <= id) return end;
+    size_t hi = end - 1;        // ids[hi] > id
+    size_t step = 1;
+    while (step <= hi && ids[hi - step] > id) {
+        hi -= step;
+        step *= 2;
+    }
+    size_t lo = step <= hi ? hi - step : 0;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (ids[mid] > id) hi = mid;
+        else lo = mid + 1;
+    }
+    return lo;
+}
+
+int history_index_next(IndexCursor *cursor, uint32_t *id) {
+    if (cursor->count == 0) return 0;
+    const TrigramList *driver = cursor->lists[0];
+    while (cursor->pos[0] > 0) {
+        uint32_t candidate = driver->ids[--cursor->pos[0]];
+        cursor->steps++;
+        if (candidate < cursor->floor) break;
+        int in_all = 1;
+        for (int i = 1; i < cursor->count; i++) {
+            const TrigramList *list = cursor->lists[i];
+            size_t end = seek_back(list->ids, cursor->pos[i], candidate);
+            cursor->pos[i] = end;
+            if (end == 0) {
+                cursor->pos[0] = 0;     // Nothing older is in this one
+                return 0;
+            }
+            if (list->ids[end - 1] != candidate) {
+                in_all = 0;
+                break;
+            }
+        }
+        if (in_all) {
+            *id = candidate;
+            return 1;
+        }
+    }
+    cursor->pos[0] = 0;
+    return 0;
+}
+
+size_t history_index_memory(const HistoryIndex *index) {
+    return index->capacity * sizeof(TrigramList) + index->postings_capacity * sizeof(uint32_t);
+}
@@ -0,0 +1,86 @@
+// src/shell/history_index.h
+#ifndef HISTORY_INDEX_H
+#define HISTORY_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// An inverted index of the history's trigrams: for every 3 bytes that
+// occur in some command, the ids of the commands they occur in, ascending.
+// Commands get ids in the order they are added; the oldest one kept has
+// first_id, so command i of the history has id first_id + i. Dropping the
+// oldest only moves first_id: lists keep ids below it until a sweep trims
+// them, once as many commands have been dropped as are kept.
+
+#define INDEX_CURSOR_LISTS 8    // Lists a cursor intersects at most
+
+// The commands a trigram occurs in
+typedef struct {
+    uint32_t key;               // Its bytes, plus one; 0 for an empty slot
+    uint32_t len;
+    uint32_t capacity;
+    uint32_t *ids;              // Ascending
+} TrigramList;
+
+typedef struct {
+    TrigramList *lists;         // Open addressing
+    size_t capacity;            // Slots, a power of two
+    size_t used;
+    size_t postings_capacity;   // Ids allocated over all lists
+    uint32_t first_id;          // Ids below this are commands no longer kept
+    uint32_t next_id;
+    uint32_t swept_id;          // first_id at the last sweep
+    int built;                  // Set by its owner once it holds every command
+} HistoryIndex;
+
+// Ids in every one of some lists, newest first
+typedef struct {
+    const TrigramList *lists[INDEX_CURSOR_LISTS];  // Shortest first
+    size_t pos[INDEX_CURSOR_LISTS];     // Ids from here on are newer than any left
+    int count;
+    uint32_t floor;             // The index's first_id
+    size_t steps;               // Ids of the shortest list looked at so far
+} IndexCursor;
+
+/**
+ * @brief Free an index's lists and mark it not built
+ */
+void history_index_reset(HistoryIndex *index);
+
+/**
+ * @brief Index a command as the newest, with id next_id
+ * @return 0 on success, -1 if out of memory (the index is then reset)
+ */
+int history_index_add(HistoryIndex *index, const char *text, size_t len);
+
+/**
+ * @brief Forget the oldest command
+ */
+void history_index_drop_oldest(HistoryIndex *index);
+
+/**
+ * @brief The list for the 3 bytes at trigram, NULL if no command has them
+ */
+const TrigramList* history_index_find(const HistoryIndex *index, const char *trigram);
+
+/**
+ * @brief Start going through the ids in all of some lists
+ * @param lists The lists (none NULL); of more than INDEX_CURSOR_LISTS, the
+ * shortest are used, so some ids may be in only those
+ * @param count Their number
+ */
+void history_index_cursor(IndexCursor *cursor, const HistoryIndex *index,
+                          const TrigramList **lists, int count);
+
+/**
+ * @brief Next id, going from newest to oldest
+ * @return 1 with *id set, 0 once there are no more
+ */
+int history_index_next(IndexCursor *cursor, uint32_t *id);
+
+/**
+ * @brief Bytes the index takes
+ */
+size_t history_index_memory(const HistoryIndex *index);
+
+#endif // HISTORY_INDEX_H
@@ -1,10 +1,26 @@
 // src/shell/history_manager.c - WITH DEBUG OUTPUT
 #include "history_manager.h"
+#include "../utils/fuzzy_match.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
+#include <time.h>
+
+static HistoryFsync g_fsync = HISTORY_FSYNC_COMPACT;
+static int g_limit = MAX_HISTORY_SIZE;
+
+void history_manager_set_fsync(HistoryFsync policy) {
+    g_fsync = policy;
+}
+
+void history_manager_set_limit(int commands) {
+    if (commands > 0) g_limit = commands;
+}
 
 static const char* get_home_directory(void) {
     const char *home = getenv("HOME");
@@ -13,23 +29,521 @@ static const char* get_home_directory(void) {
     return home;
 }
 
-static void sanitize_command(char *command) {
-    if (!command) return;
-    
-    char *start = command;
-    while (*start && (*start == ' ' || *start == '\t' || *start == '\n')) {
-        start++;
+static int is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\n';
+}
+
+// The command without leading and trailing blanks: where it starts, and
+// its length in *len
+static const char* trim_command(const char *command, size_t *len) {
+    while (is_blank(*command)) command++;
+    size_t n = strlen(command);
+    while (n > 0 && is_blank(command[n - 1])) n--;
+    *len = n;
+    return command;
+}
+
+// ---- Storage ----
+//
+// The oldest commands can still be in the history file, mapped as it was
+// at startup: hm->mapped of them, from entry hm->map_first on. The rest
+// are in the arena.
+
+// Commands in the arena
+static int stored(const HistoryManager *hm) {
+    return hm->count - hm->mapped;
+}
+
+static HistoryEntry* entry_at(const HistoryManager *hm, int index) {
+    return &hm->entries[((size_t)hm->start_index + index) & (hm->entries_capacity - 1)];
+}
+
+const char* history_manager_get(const HistoryManager *hm, int index, size_t *len) {
+    if (!hm || index < 0 || index >= hm->count) return NULL;
+    if (index < hm->mapped) return history_file_get(&hm->map, (uint64_t)hm->map_first + index, len);
+    const HistoryEntry *entry = entry_at(hm, index - hm->mapped);
+    if (len) *len = entry->len;
+    return hm->arena + entry->offset;
+}
+
+// When command index was added (0 if not known)
+static uint32_t command_time(const HistoryManager *hm, int index) {
+    if (index < hm->mapped) return hm->map.entries[hm->map_first + index].time;
+    return entry_at(hm, index - hm->mapped)->time;
+}
+
+size_t history_manager_memory(const HistoryManager *hm) {
+    return hm->arena_capacity + hm->entries_capacity * sizeof(HistoryEntry) +
+           history_index_memory(&hm->index);
+}
+
+static void drop_oldest(HistoryManager *hm) {
+    hm->count--;
+    if (hm->index.built) history_index_drop_oldest(&hm->index);
+    else if (hm->indexer_job) hm->index_dropped++;
+    if (hm->mapped > 0) {
+        // The file stays mapped: a rewrite may be reading it
+        hm->map_first++;
+        hm->mapped--;
+        return;
     }
-    
-    char *end = start + strlen(start) - 1;
-    while (end > start && (*end == ' ' || *end == '\t' || *end == '\n')) {
-        *end = '\0';
-        end--;
+    hm->start_index = (int)(((size_t)hm->start_index + 1) & (hm->entries_capacity - 1));
+    if (hm->count == 0) {
+        hm->start_index = 0;
+        hm->arena_start = hm->arena_len = 0;
+    } else {
+        hm->arena_start = entry_at(hm, 0)->offset;
     }
-    
-    if (start != command) {
-        memmove(command, start, strlen(start) + 1);
+}
+
+// Room for one more entry: the ring doubles, unwrapped into the new array
+static int reserve_entry(HistoryManager *hm) {
+    if ((size_t)stored(hm) < hm->entries_capacity) return 0;
+    size_t capacity = hm->entries_capacity ? hm->entries_capacity * 2 : 64;
+    HistoryEntry *entries = malloc(capacity * sizeof(HistoryEntry));
+    if (!entries) return -1;
+    for (int i = 0; i < stored(hm); i++) entries[i] = *entry_at(hm, i);
+    free(hm->entries);
+    hm->entries = entries;
+    hm->entries_capacity = capacity;
+    hm->start_index = 0;
+    return 0;
+}
+
+// Room for len more bytes of text. Dropped commands' bytes are reclaimed
+// by sliding the arena down once they are half of it, so it holds at most
+// about twice what is kept.
+static int reserve_text(HistoryManager *hm, size_t len) {
+    if (hm->arena_capacity - hm->arena_len >= len) return 0;
+
+    if (hm->arena_start > 0 && hm->arena_start >= hm->arena_len / 2) {
+        memmove(hm->arena, hm->arena + hm->arena_start, hm->arena_len - hm->arena_start);
+        for (int i = 0; i < stored(hm); i++) entry_at(hm, i)->offset -= hm->arena_start;
+        hm->arena_len -= hm->arena_start;
+        hm->arena_start = 0;
+        if (hm->arena_capacity - hm->arena_len >= len) return 0;
+    }
+    size_t capacity = hm->arena_capacity ? hm->arena_capacity * 2 : 4096;
+    while (capacity - hm->arena_len < len) capacity *= 2;
+    char *arena = realloc(hm->arena, capacity);
+    if (!arena) return -1;
+    hm->arena = arena;
+    hm->arena_capacity = capacity;
+    return 0;
+}
+
+// Puts a command in the ring, replacing the oldest once it is full
+static int store_command(HistoryManager *hm, const char *command, size_t len, uint32_t time) {
+    if (len >= UINT32_MAX) {
+        fprintf(stderr, "history_manager store: command too long\n");
+        return -1;
+    }
+    if (hm->count >= hm->limit) drop_oldest(hm);
+    if (reserve_entry(hm) == -1 || reserve_text(hm, len + 1) == -1) {
+        perror("history_manager store");
+        return -1;
+    }
+    *entry_at(hm, stored(hm)) = (HistoryEntry){ hm->arena_len, (uint32_t)len, time };
+    memcpy(hm->arena + hm->arena_len, command, len);
+    hm->arena[hm->arena_len + len] = '\0';
+    hm->arena_len += len + 1;
+    hm->count++;
+    // Out of memory, the index is dropped; it is built again in the background
+    if (hm->index.built) history_index_add(&hm->index, command, len);
+    return 0;
+}
+
+static int write_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        data += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// Writes all of a record, picking up where a short writev() stopped
+static int writev_all(int fd, struct iovec *iov, int count) {
+    while (count > 0) {
+        ssize_t n = writev(fd, iov, count);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        while (count > 0 && (size_t)n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+    return 0;
+}
+
+// ---- Compaction ----
+//
+// The history file is the commands kept when it was last written, in the
+// binary format, followed by a journal of "#<time>" and command lines for
+// those added since. Once the journal holds JOURNAL_RECORDS commands (or
+// the limit, if that is fewer) a thread writes the commands kept to
+// history_file.tmp and renames it over the history file. Lines appended
+// while it works are kept in hm->appended and written to the new file
+// before the rename, under the journal lock, so none are lost; the new
+// file then takes the journal.
+
+#define JOURNAL_RECORDS 16384   // Bounds the lines parsed at startup
+
+typedef struct HistoryCompactJob {
+    HistoryManager *hm;
+    HistorySegment segments[2]; // The commands kept: those mapped, then the arena's
+    char *text;                 // The arena's, copied
+    HistoryEntry *entries;
+    int done;                   // Set (under the journal lock) when finished
+} CompactJob;
+
+static int compact(CompactJob *job) {
+    HistoryManager *hm = job->hm;
+    char temp_file[PATH_MAX + 8];
+    snprintf(temp_file, sizeof(temp_file), "%s.tmp", hm->history_file);
+
+    // Only the header was checked at startup: don't carry damage forward
+    if (job->segments[0].count > 0 && history_file_verify(&hm->map) == -1) {
+        fprintf(stderr, "history: %s is damaged; dropping the %zu commands it had\n",
+                hm->history_file, job->segments[0].count);
+        job->segments[0].count = 0;
+    }
+
+    int fd = open(temp_file, O_WRONLY | O_APPEND | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (fd == -1) {
+        perror("open history file");
+        return -1;
+    }
+    int ok = history_file_write(fd, job->segments, 2) != -1 &&
+             (g_fsync == HISTORY_FSYNC_NEVER || fsync(fd) == 0);
+
+    pthread_mutex_lock(&hm->journal_lock);
+    if (ok && hm->appended_len > 0) {
+        ok = write_all(fd, hm->appended, hm->appended_len) == 0 &&
+             (g_fsync == HISTORY_FSYNC_NEVER || fsync(fd) == 0);
+    }
+    if (ok && rename(temp_file, hm->history_file) == 0) {
+        if (hm->journal_fd != -1) close(hm->journal_fd);
+        hm->journal_fd = fd;    // Now the history file itself
+        hm->journal_records = hm->appended_records;
+    } else {
+        perror("rewrite history file");
+        close(fd);
+        unlink(temp_file);
+        ok = 0;
+    }
+    hm->appended_len = 0;
+    hm->appended_records = 0;
+    job->done = 1;
+    pthread_mutex_unlock(&hm->journal_lock);
+    return ok ? 0 : -1;
+}
+
+static void* compactor_main(void *arg) {
+    CompactJob *job = arg;
+    if (compact(job) == 0) {
+        printf("[HISTORY_COMPACT] Rewrote %s (%zu commands)\n", job->hm->history_file,
+               job->segments[0].count + job->segments[1].count);
+        fflush(stdout);
+    }
+    return NULL;
+}
+
+static void free_job(CompactJob *job) {
+    free(job->text);
+    free(job->entries);
+    free(job);
+}
+
+static void wait_for_compactor(HistoryManager *hm) {
+    if (!hm->job) return;
+    pthread_join(hm->compactor, NULL);
+    free_job(hm->job);
+    hm->job = NULL;
+}
+
+// The commands kept: the mapped ones are read where they are, the
+// arena's are copied
+static CompactJob* new_job(HistoryManager *hm) {
+    CompactJob *job = calloc(1, sizeof(CompactJob));
+    if (!job) return NULL;
+    job->hm = hm;
+    if (hm->mapped > 0) {
+        job->segments[0] = (HistorySegment){ hm->map.entries + hm->map_first, (size_t)hm->mapped,
+                                             hm->map.text, hm->map.text_size };
+    }
+
+    int n = stored(hm);
+    size_t len = hm->arena_len - hm->arena_start;
+    job->text = malloc(len + 1);
+    job->entries = malloc((n + 1) * sizeof(HistoryEntry));
+    if (!job->text || !job->entries) {
+        free_job(job);
+        return NULL;
+    }
+    if (len > 0) memcpy(job->text, hm->arena + hm->arena_start, len);
+    for (int i = 0; i < n; i++) {
+        job->entries[i] = *entry_at(hm, i);
+        job->entries[i].offset -= hm->arena_start;
+    }
+    job->segments[1] = (HistorySegment){ job->entries, (size_t)n, job->text, len };
+    return job;
+}
+
+// Starts a rewrite once the journal is long enough (and the last one is done)
+static void maybe_compact(HistoryManager *hm) {
+    if (hm->job) {
+        pthread_mutex_lock(&hm->journal_lock);
+        int done = hm->job->done;
+        pthread_mutex_unlock(&hm->journal_lock);
+        if (!done) return;
+        wait_for_compactor(hm);
+    }
+    int records = hm->limit < JOURNAL_RECORDS ? hm->limit : JOURNAL_RECORDS;
+    if (hm->journal_fd == -1 || hm->journal_records < records) return;
+
+    CompactJob *job = new_job(hm);
+    if (!job) return;
+    if (pthread_create(&hm->compactor, NULL, compactor_main, job) != 0) {
+        perror("pthread_create history compactor");
+        free_job(job);
+        return;
+    }
+    hm->job = job;
+}
+
+// Appends a command to the journal: one writev() of its two lines
+static void journal_append(HistoryManager *hm, const char *command, size_t command_len,
+                           uint32_t time) {
+    char stamp[16];
+    int stamp_len = snprintf(stamp, sizeof(stamp), "#%u\n", time);
+    struct iovec record[3] = {
+        { stamp, (size_t)stamp_len },
+        { (void *)command, command_len },
+        { "\n", 1 },
+    };
+    size_t len = stamp_len + command_len + 1;
+
+    pthread_mutex_lock(&hm->journal_lock);
+    if (hm->journal_fd != -1) {
+        if (writev_all(hm->journal_fd, record, 3) == -1) {
+            perror("write history file");
+        } else {
+            if (g_fsync == HISTORY_FSYNC_ALWAYS) fsync(hm->journal_fd);
+            hm->journal_records++;
+        }
+    }
+    // A rewrite in progress must copy it into the new file too
+    if (hm->job && !hm->job->done) {
+        if (hm->appended_capacity - hm->appended_len < len) {
+            size_t capacity = hm->appended_capacity ? hm->appended_capacity * 2 : 4096;
+            while (capacity - hm->appended_len < len) capacity *= 2;
+            char *grown = realloc(hm->appended, capacity);
+            if (grown) {
+                hm->appended = grown;
+                hm->appended_capacity = capacity;
+            }
+        }
+        if (hm->appended_capacity - hm->appended_len >= len) {
+            char *p = hm->appended + hm->appended_len;
+            memcpy(p, stamp, stamp_len);
+            memcpy(p + stamp_len, command, command_len);
+            p[stamp_len + command_len] = '\n';
+            hm->appended_len += len;
+            hm->appended_records++;
+        }
+    }
+    pthread_mutex_unlock(&hm->journal_lock);
+    maybe_compact(hm);
+}
+
+// Stores the commands in journal lines ("#<time>" lines give the time of
+// the command after them), appending them to hm's own journal too if
+// journal is set. Returns how many there were.
+static int read_journal(HistoryManager *hm, const char *text, size_t len, int journal) {
+    const char *end = text + len;
+    uint32_t time = 0;
+    int records = 0;
+    while (text < end) {
+        const char *newline = memchr(text, '\n', end - text);
+        size_t n = (newline ? newline : end) - text;
+
+        size_t digits = 1;
+        uint32_t stamp = 0;
+        while (digits < n && text[digits] >= '0' && text[digits] <= '9') {
+            stamp = stamp * 10 + (text[digits] - '0');
+            digits++;
+        }
+        if (n > 1 && text[0] == '#' && digits == n) {
+            time = stamp;
+        } else if (n > 0) {
+            if (store_command(hm, text, n, time) == -1) break;
+            if (journal) journal_append(hm, text, n, time);
+            records++;
+            time = 0;
+        }
+        if (!newline) break;
+        text = newline + 1;
+    }
+    return records;
+}
+
+// ---- Indexing ----
+//
+// The trigram index of every command kept is built on a thread, from the
+// commands kept when it starts: those mapped are read where they are, the
+// arena's are copied. Until it is done searches scan. Then the first search
+// takes it over and brings it up to date: the commands dropped since are
+// dropped from it, and those added since are added.
+
+typedef struct HistoryIndexJob {
+    HistoryIndex index;
+    const HistoryMap *map;      // Commands map_first to map_first + mapped - 1 of it
+    int map_first;
+    int mapped;
+    char *text;                 // Then the arena's, copied
+    HistoryEntry *entries;
+    int stored;
+    int failed;                 // Out of memory
+    int done;                   // Set (under lock) when finished
+    int cancel;                 // Set (under lock) to stop it early
+    pthread_mutex_t lock;
+} IndexJob;
+
+static void* indexer_main(void *arg) {
+    IndexJob *job = arg;
+    int total = job->mapped + job->stored;
+    for (int i = 0; i < total && !job->failed; i++) {
+        if (i % 4096 == 0) {
+            pthread_mutex_lock(&job->lock);
+            int cancel = job->cancel;
+            pthread_mutex_unlock(&job->lock);
+            if (cancel) {
+                job->failed = 1;
+                break;
+            }
+        }
+        size_t len;
+        const char *command;
+        if (i < job->mapped) {
+            command = history_file_get(job->map, (uint64_t)job->map_first + i, &len);
+        } else {
+            command = job->text + job->entries[i - job->mapped].offset;
+            len = job->entries[i - job->mapped].len;
+        }
+        if (history_index_add(&job->index, command, len) == -1) job->failed = 1;
+    }
+    if (!job->failed) {
+        printf("[HISTORY_INDEX] Indexed %d commands (%zu KB)\n", total,
+               history_index_memory(&job->index) / 1024);
+        fflush(stdout);
     }
+    pthread_mutex_lock(&job->lock);
+    job->done = 1;
+    pthread_mutex_unlock(&job->lock);
+    return NULL;
+}
+
+static void free_index_job(IndexJob *job) {
+    history_index_reset(&job->index);
+    pthread_mutex_destroy(&job->lock);
+    free(job->text);
+    free(job->entries);
+    free(job);
+}
+
+// Stops a build in progress and forgets it
+static void stop_indexer(HistoryManager *hm) {
+    if (!hm->indexer_job) return;
+    pthread_mutex_lock(&hm->indexer_job->lock);
+    hm->indexer_job->cancel = 1;
+    pthread_mutex_unlock(&hm->indexer_job->lock);
+    pthread_join(hm->indexer, NULL);
+    free_index_job(hm->indexer_job);
+    hm->indexer_job = NULL;
+}
+
+static void start_indexer(HistoryManager *hm) {
+    if (hm->index.built || hm->indexer_job) return;
+    IndexJob *job = calloc(1, sizeof(IndexJob));
+    if (!job) return;
+    job->map = &hm->map;
+    job->map_first = hm->map_first;
+    job->mapped = hm->mapped;
+    job->stored = stored(hm);
+    size_t len = hm->arena_len - hm->arena_start;
+    job->text = malloc(len + 1);
+    job->entries = malloc((job->stored + 1) * sizeof(HistoryEntry));
+    if (!job->text || !job->entries) {
+        free(job->text);
+        free(job->entries);
+        free(job);
+        return;
+    }
+    if (len > 0) memcpy(job->text, hm->arena + hm->arena_start, len);
+    for (int i = 0; i < job->stored; i++) {
+        job->entries[i] = *entry_at(hm, i);
+        job->entries[i].offset -= hm->arena_start;
+    }
+    pthread_mutex_init(&job->lock, NULL);
+    if (pthread_create(&hm->indexer, NULL, indexer_main, job) != 0) {
+        perror("pthread_create history indexer");
+        free_index_job(job);
+        return;
+    }
+    hm->indexer_job = job;
+    hm->index_dropped = 0;
+}
+
+// Whether the index can be searched, taking it over from the thread if
+// it has just finished. If there is none, one is started (again, if the
+// last ran out of memory) and searches scan meanwhile.
+static int index_ready(HistoryManager *hm) {
+    if (hm->index.built) return 1;
+    IndexJob *job = hm->indexer_job;
+    if (!job) {
+        start_indexer(hm);
+        return 0;
+    }
+    pthread_mutex_lock(&job->lock);
+    int done = job->done;
+    pthread_mutex_unlock(&job->lock);
+    if (!done) return 0;
+
+    pthread_join(hm->indexer, NULL);
+    hm->indexer_job = NULL;
+    if (job->failed) {
+        fprintf(stderr, "history: no memory to index %d commands\n", job->mapped + job->stored);
+        free_index_job(job);
+        return 0;
+    }
+    int indexed = job->mapped + job->stored;
+    hm->index = job->index;
+    memset(&job->index, 0, sizeof(job->index));
+    free_index_job(job);
+    hm->index.built = 1;
+
+    // Command i of the history was command index_dropped + i of those indexed
+    for (int i = 0; i < hm->index_dropped; i++) history_index_drop_oldest(&hm->index);
+    int first_new = indexed - hm->index_dropped;
+    for (int i = first_new > 0 ? first_new : 0; i < hm->count && hm->index.built; i++) {
+        size_t len;
+        const char *command = history_manager_get(hm, i, &len);
+        history_index_add(&hm->index, command, len);
+    }
+    hm->index_dropped = 0;
+    return hm->index.built;
 }
 
 HistoryManager* history_manager_init(void) {
@@ -41,6 +555,9 @@ HistoryManager* history_manager_init(void) {
     
     hm->start_index = 0;
     hm->count = 0;
+    hm->limit = g_limit;
+    hm->journal_fd = -1;
+    pthread_mutex_init(&hm->journal_lock, NULL);
     
     snprintf(hm->history_file, PATH_MAX, "%s/.myterm_history", 
              get_home_directory());
@@ -52,6 +569,11 @@ HistoryManager* history_manager_init(void) {
     
     printf("[HISTORY_INIT] Loaded %d commands from file\n", hm->count);
     fflush(stdout);
+
+    hm->journal_fd = open(hm->history_file, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (hm->journal_fd == -1) perror("open history file");
+    maybe_compact(hm);
+    start_indexer(hm);
     
     return hm;
 }
@@ -59,10 +581,22 @@ HistoryManager* history_manager_init(void) {
 void history_manager_cleanup(HistoryManager *hm) {
     if (!hm) return;
     
-    printf("[HISTORY_CLEANUP] Saving %d commands\n", hm->count);
+    printf("[HISTORY_CLEANUP] %d commands, %d journaled in the history file\n",
+           hm->count, hm->journal_records);
     fflush(stdout);
     
-    history_manager_save_to_file(hm);
+    wait_for_compactor(hm);
+    stop_indexer(hm);
+    if (hm->journal_fd != -1) {
+        if (g_fsync != HISTORY_FSYNC_NEVER) fsync(hm->journal_fd);
+        close(hm->journal_fd);
+    }
+    pthread_mutex_destroy(&hm->journal_lock);
+    history_file_unmap(&hm->map);
+    history_index_reset(&hm->index);
+    free(hm->appended);
+    free(hm->arena);
+    free(hm->entries);
     free(hm);
 }
 
@@ -73,13 +607,10 @@ int history_manager_add_command(HistoryManager *hm, const char *command) {
         return -1;
     }
     
-    char cmd_copy[MAX_COMMAND_LENGTH];
-    strncpy(cmd_copy, command, MAX_COMMAND_LENGTH - 1);
-    cmd_copy[MAX_COMMAND_LENGTH - 1] = '\0';
-    
-    sanitize_command(cmd_copy);
+    size_t len;
+    const char *cmd = trim_command(command, &len);
     
-    if (strlen(cmd_copy) == 0) {
+    if (len == 0) {
         printf("[HISTORY_ADD] Skipping empty command\n");
         fflush(stdout);
         return 0;
@@ -87,28 +618,19 @@ int history_manager_add_command(HistoryManager *hm, const char *command) {
     
     // Don't add duplicate of most recent command
     if (hm->count > 0) {
-        int last_idx = (hm->start_index + hm->count - 1) % MAX_HISTORY_SIZE;
-        if (strcmp(hm->commands[last_idx], cmd_copy) == 0) {
-            printf("[HISTORY_ADD] Skipping duplicate: '%s'\n", cmd_copy);
+        size_t last_len;
+        const char *last = history_manager_get(hm, hm->count - 1, &last_len);
+        if (last_len == len && memcmp(last, cmd, len) == 0) {
+            printf("[HISTORY_ADD] Skipping duplicate: '%.*s'\n", (int)len, cmd);
             fflush(stdout);
             return 0;
         }
     }
     
-    if (hm->count < MAX_HISTORY_SIZE) {
-        int idx = (hm->start_index + hm->count) % MAX_HISTORY_SIZE;
-        strncpy(hm->commands[idx], cmd_copy, MAX_COMMAND_LENGTH - 1);
-        hm->commands[idx][MAX_COMMAND_LENGTH - 1] = '\0';
-        hm->count++;
-        printf("[HISTORY_ADD] Added command #%d: '%s' at index %d\n", 
-               hm->count, cmd_copy, idx);
-    } else {
-        strncpy(hm->commands[hm->start_index], cmd_copy, MAX_COMMAND_LENGTH - 1);
-        hm->commands[hm->start_index][MAX_COMMAND_LENGTH - 1] = '\0';
-        hm->start_index = (hm->start_index + 1) % MAX_HISTORY_SIZE;
-        printf("[HISTORY_ADD] Added command (buffer full): '%s'\n", cmd_copy);
-    }
-    
+    uint32_t now = (uint32_t)time(NULL);
+    if (store_command(hm, cmd, len, now) == -1) return -1;
+    journal_append(hm, cmd, len, now);
+    printf("[HISTORY_ADD] Added command #%d: '%.*s'\n", hm->count, (int)len, cmd);
     fflush(stdout);
     return 0;
 }
@@ -133,21 +655,18 @@ int history_manager_get_recent(HistoryManager *hm, char *buffer,
         num_to_show = HISTORY_DISPLAY_SIZE;
     }
     
-    char line[MAX_COMMAND_LENGTH + 32];
     size_t current_len = 0;
     
     for (int i = 0; i < num_to_show; i++) {
-        int idx = (hm->start_index + hm->count - 1 - i) % MAX_HISTORY_SIZE;
+        const char *command = history_manager_get(hm, hm->count - 1 - i, NULL);
         
-        snprintf(line, sizeof(line), "  [%d] %s\n", 
-                 hm->count - i, hm->commands[idx]);
-        
-        size_t line_len = strlen(line);
-        if (current_len + line_len >= buffer_size - 1) {
+        int line_len = snprintf(buffer + current_len, buffer_size - current_len,
+                                "  [%d] %s\n", hm->count - i, command);
+        if (line_len < 0 || current_len + line_len >= buffer_size - 1) {
+            buffer[current_len] = '\0';
             break;
         }
         
-        strcat(buffer, line);
         current_len += line_len;
     }
     
@@ -157,6 +676,29 @@ int history_manager_get_recent(HistoryManager *hm, char *buffer,
     return num_to_show;
 }
 
+// Commands equal to the term, through the index: those with all of its
+// trigrams, checked
+static int find_exact_indexed(HistoryManager *hm, const char *term, size_t term_len) {
+    const TrigramList *lists[FUZZY_MAX_FAST];
+    int count = 0;
+    for (size_t i = 0; i + 3 <= term_len; i++) {
+        const TrigramList *list = history_index_find(&hm->index, term + i);
+        if (!list) return -1;
+        // Any of them narrow it down: what they find is checked
+        if (count < FUZZY_MAX_FAST) lists[count++] = list;
+    }
+    IndexCursor cursor;
+    history_index_cursor(&cursor, &hm->index, lists, count);
+    uint32_t id;
+    while (history_index_next(&cursor, &id)) {
+        int idx = (int)(id - hm->index.first_id);
+        size_t len;
+        const char *command = history_manager_get(hm, idx, &len);
+        if (len == term_len && memcmp(command, term, len) == 0) return idx;
+    }
+    return -1;
+}
+
 int history_manager_search_exact(HistoryManager *hm, const char *search_term,
                                   char *result, size_t result_size) {
     if (!hm || !search_term || !result || result_size == 0) return 0;
@@ -169,18 +711,26 @@ int history_manager_search_exact(HistoryManager *hm, const char *search_term,
            search_term, hm->count);
     fflush(stdout);
     
-    for (int i = 0; i < hm->count; i++) {
-        int idx = (hm->start_index + hm->count - 1 - i) % MAX_HISTORY_SIZE;
-        
-        if (strcmp(hm->commands[idx], search_term) == 0) {
-            strncpy(result, hm->commands[idx], result_size - 1);
-            result[result_size - 1] = '\0';
-            printf("[HISTORY_SEARCH] Found exact match at index %d\n", idx);
-            fflush(stdout);
-            return 1;
+    size_t term_len = strlen(search_term);
+    int idx = -1;
+    if (term_len >= 3 && index_ready(hm)) {
+        idx = find_exact_indexed(hm, search_term, term_len);
+    } else {
+        for (int i = 0; i < hm->count && idx == -1; i++) {
+            const char *command = history_manager_get(hm, hm->count - 1 - i, NULL);
+            if (strcmp(command, search_term) == 0) idx = hm->count - 1 - i;
         }
     }
     
+    if (idx != -1) {
+        const char *command = history_manager_get(hm, idx, NULL);
+        strncpy(result, command, result_size - 1);
+        result[result_size - 1] = '\0';
+        printf("[HISTORY_SEARCH] Found exact match at index %d\n", idx);
+        fflush(stdout);
+        return 1;
+    }
+    
     printf("[HISTORY_SEARCH] No exact match found\n");
     fflush(stdout);
     return 0;
@@ -188,86 +738,131 @@ int history_manager_search_exact(HistoryManager *hm, const char *search_term,
 
 int calculate_lcs_length(const char *str1, const char *str2) {
     if (!str1 || !str2) return 0;
-    
-    int len1 = strlen(str1);
-    int len2 = strlen(str2);
-    
-    if (len1 == 0 || len2 == 0) return 0;
-    
-    int **dp = malloc((len1 + 1) * sizeof(int*));
-    if (!dp) return 0;
-    
-    for (int i = 0; i <= len1; i++) {
-        dp[i] = calloc(len2 + 1, sizeof(int));
-        if (!dp[i]) {
-            for (int j = 0; j < i; j++) free(dp[j]);
-            free(dp);
-            return 0;
+    return (int)fuzzy_longest_common_reference(str1, strlen(str1), str2, strlen(str2));
+}
+
+// Shortest match a fuzzy search reports
+#define FUZZY_MIN_MATCH 3
+
+// Posting-list ids a fuzzy search walks at most (about a millisecond)
+// before it scans for the rest of its matches instead
+#define FUZZY_INDEX_BUDGET 8192
+
+// Adds the commands whose longest match is exactly level bytes, newest
+// first, until there are max_results. A match that long is a window of the
+// term that long, so they are among the commands with every trigram of
+// some window: the ids of each window's trigrams are intersected, the
+// windows' merged, and only those are scored. Longer matches were added at
+// a higher level. Returns -1 if *spent (ids walked) reaches the budget
+// first.
+static int fuzzy_level(HistoryManager *hm, const FuzzyPattern *pattern, size_t level,
+                       HistorySearchResult *results, int *num_results, int max_results,
+                       size_t *spent) {
+    IndexCursor cursors[FUZZY_MAX_FAST];
+    uint32_t heads[FUZZY_MAX_FAST];     // The newest id each has left
+    int live = 0;
+    for (size_t start = 0; start + level <= pattern->len; start++) {
+        const TrigramList *lists[FUZZY_MAX_FAST];
+        int count = 0;
+        for (size_t i = start; i + 3 <= start + level; i++) {
+            lists[count] = history_index_find(&hm->index, pattern->pattern + i);
+            if (!lists[count]) break;
+            count++;
         }
+        if ((size_t)count < level - 2) continue;
+        history_index_cursor(&cursors[live], &hm->index, lists, count);
+        if (history_index_next(&cursors[live], &heads[live])) live++;
+        else *spent += cursors[live].steps;
     }
     
-    int max_length = 0;
-    
-    for (int i = 1; i <= len1; i++) {
-        for (int j = 1; j <= len2; j++) {
-            if (str1[i-1] == str2[j-1]) {
-                dp[i][j] = dp[i-1][j-1] + 1;
-                if (dp[i][j] > max_length) {
-                    max_length = dp[i][j];
-                }
+    while (live > 0 && *num_results < max_results) {
+        size_t walked = *spent;
+        uint32_t id = heads[0];
+        for (int i = 0; i < live; i++) {
+            if (heads[i] > id) id = heads[i];
+            walked += cursors[i].steps;
+        }
+        if (walked >= FUZZY_INDEX_BUDGET) {
+            *spent = walked;
+            return -1;
+        }
+        // Every window that has it moves past it
+        for (int i = 0; i < live; ) {
+            if (heads[i] == id && !history_index_next(&cursors[i], &heads[i])) {
+                *spent += cursors[i].steps;
+                live--;
+                cursors[i] = cursors[live];
+                heads[i] = heads[live];
             } else {
-                dp[i][j] = 0;
+                i++;
             }
         }
+        int idx = (int)(id - hm->index.first_id);
+        size_t len;
+        const char *command = history_manager_get(hm, idx, &len);
+        if (fuzzy_longest_common(pattern, command, len) == level) {
+            results[(*num_results)++] = (HistorySearchResult){ command, (int)level, idx + 1 };
+            printf("[HISTORY_SEARCH] Fuzzy match: '%s' (LCS=%zu)\n", command, level);
+            fflush(stdout);
+        }
     }
-    
-    for (int i = 0; i <= len1; i++) {
-        free(dp[i]);
+    for (int i = 0; i < live; i++) *spent += cursors[i].steps;
+    return 0;
+}
+
+// Without the index: the newest commands matching at most longest bytes
+// (and not found already), until there are max_results, longest match
+// first after those there were
+static void fuzzy_scan(HistoryManager *hm, const FuzzyPattern *pattern, size_t longest,
+                       HistorySearchResult *results, int *num_results, int max_results) {
+    int found = *num_results;
+    for (int idx = hm->count - 1; idx >= 0 && *num_results < max_results; idx--) {
+        size_t len;
+        const char *command = history_manager_get(hm, idx, &len);
+        size_t lcs_len = fuzzy_longest_common(pattern, command, len);
+        if (lcs_len < FUZZY_MIN_MATCH || lcs_len > longest) continue;
+        int seen = 0;
+        for (int i = 0; i < found; i++) seen |= results[i].index == idx + 1;
+        if (seen) continue;
+        
+        // After the newer ones that match as much
+        int at = (*num_results)++;
+        while (at > found && results[at - 1].lcs_length < (int)lcs_len) {
+            results[at] = results[at - 1];
+            at--;
+        }
+        results[at] = (HistorySearchResult){ command, (int)lcs_len, idx + 1 };
+        printf("[HISTORY_SEARCH] Fuzzy match: '%s' (LCS=%zu)\n", command, lcs_len);
+        fflush(stdout);
     }
-    free(dp);
-    
-    return max_length;
 }
 
 int history_manager_search_fuzzy(HistoryManager *hm, const char *search_term,
                                   HistorySearchResult *results, int max_results) {
-    if (!hm || !search_term || !results || max_results == 0) return 0;
+    if (!hm || !search_term || !results || max_results <= 0) return 0;
     
-    if (strlen(search_term) == 0 || hm->count == 0) return 0;
+    if (strlen(search_term) < FUZZY_MIN_MATCH || hm->count == 0) return 0;
     
     printf("[HISTORY_SEARCH] Fuzzy search for: '%s' in %d commands\n", 
            search_term, hm->count);
     fflush(stdout);
     
+    FuzzyPattern pattern;
+    fuzzy_pattern_init(&pattern, search_term, strlen(search_term));
     int num_results = 0;
     
-    for (int i = 0; i < hm->count && num_results < max_results; i++) {
-        int idx = (hm->start_index + hm->count - 1 - i) % MAX_HISTORY_SIZE;
-        
-        int lcs_len = calculate_lcs_length(search_term, hm->commands[idx]);
-        
-        if (lcs_len > 2) {
-            strncpy(results[num_results].command, hm->commands[idx], 
-                    MAX_COMMAND_LENGTH - 1);
-            results[num_results].command[MAX_COMMAND_LENGTH - 1] = '\0';
-            results[num_results].lcs_length = lcs_len;
-            results[num_results].index = hm->count - i;
-            num_results++;
-            printf("[HISTORY_SEARCH] Fuzzy match: '%s' (LCS=%d)\n", 
-                   hm->commands[idx], lcs_len);
-            fflush(stdout);
+    // The best matches come from the index, level by level, as long as it
+    // is cheap; the rest from a scan. Either way they come out longest
+    // match first, so need no sorting.
+    size_t level = pattern.len;
+    if (pattern.len <= FUZZY_MAX_FAST && index_ready(hm)) {
+        size_t spent = 0;
+        for (; level >= FUZZY_MIN_MATCH && num_results < max_results; level--) {
+            if (fuzzy_level(hm, &pattern, level, results, &num_results, max_results, &spent) == -1) break;
         }
     }
-    
-    // Sort by LCS length (descending)
-    for (int i = 0; i < num_results - 1; i++) {
-        for (int j = 0; j < num_results - i - 1; j++) {
-            if (results[j].lcs_length < results[j+1].lcs_length) {
-                HistorySearchResult temp = results[j];
-                results[j] = results[j+1];
-                results[j+1] = temp;
-            }
-        }
+    if (level >= FUZZY_MIN_MATCH && num_results < max_results) {
+        fuzzy_scan(hm, &pattern, level, results, &num_results, max_results);
     }
     
     printf("[HISTORY_SEARCH] Found %d fuzzy matches\n", num_results);
@@ -287,19 +882,17 @@ void format_search_results(HistorySearchResult *results, int num_results,
         return;
     }
     
-    char line[MAX_COMMAND_LENGTH + 64];
     size_t current_len = 0;
     
     for (int i = 0; i < num_results; i++) {
-        snprintf(line, sizeof(line), "%d. %s (match length: %d)\n",
-                 i + 1, results[i].command, results[i].lcs_length);
-        
-        size_t line_len = strlen(line);
-        if (current_len + line_len >= buffer_size - 1) {
+        int line_len = snprintf(buffer + current_len, buffer_size - current_len,
+                                "%d. %s (match length: %d)\n",
+                                i + 1, results[i].command, results[i].lcs_length);
+        if (line_len < 0 || current_len + line_len >= buffer_size - 1) {
+            buffer[current_len] = '\0';
             break;
         }
         
-        strcat(buffer, line);
         current_len += line_len;
     }
 }
@@ -307,8 +900,8 @@ void format_search_results(HistorySearchResult *results, int num_results,
 int history_manager_load_from_file(HistoryManager *hm) {
     if (!hm) return -1;
     
-    FILE *fp = fopen(hm->history_file, "r");
-    if (!fp) {
+    int fd = open(hm->history_file, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
         printf("[HISTORY_LOAD] File doesn't exist yet: %s\n", hm->history_file);
         fflush(stdout);
         return 0;
@@ -317,63 +910,102 @@ int history_manager_load_from_file(HistoryManager *hm) {
     printf("[HISTORY_LOAD] Loading from: %s\n", hm->history_file);
     fflush(stdout);
     
-    char line[MAX_COMMAND_LENGTH];
-    int loaded = 0;
-    
-    while (fgets(line, sizeof(line), fp) != NULL && loaded < MAX_HISTORY_SIZE) {
-        line[strcspn(line, "\n")] = '\0';
-        
-        if (strlen(line) > 0) {
-            strncpy(hm->commands[loaded], line, MAX_COMMAND_LENGTH - 1);
-            hm->commands[loaded][MAX_COMMAND_LENGTH - 1] = '\0';
-            loaded++;
-        }
+    hm->count = 0;
+    hm->start_index = 0;
+    hm->arena_start = hm->arena_len = 0;
+    stop_indexer(hm);
+    history_file_unmap(&hm->map);
+    history_index_reset(&hm->index);
+    
+    int result = history_file_map(fd, &hm->map);
+    close(fd);
+    if (result == -1) {
+        // Keep it for whoever wants to look, and start again
+        char damaged[PATH_MAX + 8];
+        snprintf(damaged, sizeof(damaged), "%s.bad", hm->history_file);
+        fprintf(stderr, "history: %s is damaged (%s); moved to %s\n",
+                hm->history_file, strerror(errno), damaged);
+        rename(hm->history_file, damaged);
+        return -1;
     }
     
-    fclose(fp);
-    
-    hm->count = loaded;
-    hm->start_index = 0;
+    // The commands in the binary part are used where they are: the newest
+    // hm->limit of them. Then the journal after it (all of a text file).
+    hm->mapped = hm->map.count < (uint64_t)hm->limit ? (int)hm->map.count : hm->limit;
+    hm->map_first = (int)(hm->map.count - hm->mapped);
+    hm->count = hm->mapped;
+    int records = read_journal(hm, hm->map.data + hm->map.end, hm->map.size - hm->map.end, 0);
+    hm->journal_records = records;
     
-    printf("[HISTORY_LOAD] Loaded %d commands\n", loaded);
+    printf("[HISTORY_LOAD] Loaded %d commands (%d mapped, %d journaled)\n",
+           hm->count, hm->mapped, records);
     fflush(stdout);
+    if (hm->mapped == 0) history_file_unmap(&hm->map);
     
     return 0;
 }
 
-int history_manager_save_to_file(HistoryManager *hm) {
-    if (!hm) return -1;
+int history_manager_import(HistoryManager *hm, const char *path) {
+    if (!hm || !path) return -1;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) return -1;
+    HistoryMap map;
+    int result = history_file_map(fd, &map);
+    close(fd);
+    if (result == -1) return -1;
+    
+    int imported = 0;
+    for (uint64_t i = 0; i < map.count; i++) {
+        size_t len;
+        const char *command = history_file_get(&map, i, &len);
+        if (len == 0) continue;
+        if (store_command(hm, command, len, map.entries[i].time) == -1) break;
+        journal_append(hm, command, len, map.entries[i].time);
+        imported++;
+    }
+    imported += read_journal(hm, map.data + map.end, map.size - map.end, 1);
+    history_file_unmap(&map);
     
-    printf("[HISTORY_SAVE] Saving %d commands to: %s\n", 
-           hm->count, hm->history_file);
+    printf("[HISTORY_IMPORT] Imported %d commands from %s\n", imported, path);
     fflush(stdout);
-    
-    char temp_file[PATH_MAX];
-    snprintf(temp_file, PATH_MAX, "%s.tmp", hm->history_file);
-    
-    FILE *fp = fopen(temp_file, "w");
-    if (!fp) {
-        perror("fopen history file");
-        return -1;
-    }
+    return imported;
+}
+
+int history_manager_export(const HistoryManager *hm, const char *path) {
+    if (!hm || !path) return -1;
+    FILE *fp = fopen(path, "w");
+    if (!fp) return -1;
     
     for (int i = 0; i < hm->count; i++) {
-        int idx = (hm->start_index + i) % MAX_HISTORY_SIZE;
-        fprintf(fp, "%s\n", hm->commands[idx]);
+        size_t len;
+        const char *command = history_manager_get(hm, i, &len);
+        uint32_t time = command_time(hm, i);
+        if (time) fprintf(fp, "#%u\n", time);
+        fwrite(command, 1, len, fp);
+        fputc('\n', fp);
     }
     
-    fclose(fp);
+    int result = ferror(fp) ? -1 : 0;
+    if (fclose(fp) != 0) result = -1;
+    return result == 0 ? hm->count : -1;
+}
+
+int history_manager_save_to_file(HistoryManager *hm) {
+    if (!hm) return -1;
     
-    if (rename(temp_file, hm->history_file) != 0) {
-        perror("rename history file");
-        unlink(temp_file);
-        return -1;
-    }
+    printf("[HISTORY_SAVE] Saving %d commands to: %s\n", 
+           hm->count, hm->history_file);
+    fflush(stdout);
     
-    chmod(hm->history_file, S_IRUSR | S_IWUSR);
+    wait_for_compactor(hm);
+    CompactJob *job = new_job(hm);
+    if (!job) return -1;
+    int result = compact(job);
+    free_job(job);
+    if (result == -1) return -1;
     
     printf("[HISTORY_SAVE] Successfully saved\n");
     fflush(stdout);
     
     return 0;
-}
\ No newline at end of file
+}
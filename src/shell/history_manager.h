@@ -4,27 +4,86 @@
 
 #include <stddef.h>
 #include <limits.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "history_file.h"
+#include "history_index.h"
 
-#define MAX_HISTORY_SIZE 10000
+#define MAX_HISTORY_SIZE 10000     // Commands kept unless history_manager_set_limit() says otherwise
 #define HISTORY_DISPLAY_SIZE 1000
-#define MAX_COMMAND_LENGTH 512
 #define MAX_SEARCH_RESULTS 10
 
+// The history file holds the commands kept when it was last written, in
+// a binary format that is mapped at startup (see history_file.h), then a
+// journal: each command added is appended to it with a single write().
+// Once the journal is long enough, the commands kept are rewritten to a
+// new file on a background thread.
+
+// When the history file is flushed to disk
+typedef enum {
+    HISTORY_FSYNC_NEVER,    // Left to the kernel
+    HISTORY_FSYNC_COMPACT,  // When it is rewritten and on exit (the default)
+    HISTORY_FSYNC_ALWAYS    // After every command
+} HistoryFsync;
+
 // Structure to hold a single history search result
 typedef struct {
-    char command[MAX_COMMAND_LENGTH];
+    const char *command;    // In the history: valid until a command is added
     int lcs_length;  // Length of longest common substring (for fuzzy matching)
     int index;       // Position in history
 } HistorySearchResult;
 
-// Main history manager structure
+// Main history manager structure. The oldest commands can be read from
+// the history file where it is mapped; the rest are stored back to back,
+// each NUL-terminated, in one arena, oldest first, and a ring of entries
+// (offsets into the arena) finds them. Both grow with what is stored, up to
+// the limit on commands. Searches go through a trigram index of them all,
+// built in the background after loading and kept up to date from then on.
 typedef struct {
-    char commands[MAX_HISTORY_SIZE][MAX_COMMAND_LENGTH];
+    HistoryMap map;         // The history file as it was at startup
+    int map_first;          // Its first command still kept
+    int mapped;             // Commands kept in it: commands 0 to mapped - 1
+    char *arena;
+    size_t arena_start;     // Bytes before this are commands no longer kept
+    size_t arena_len;
+    size_t arena_capacity;
+    HistoryEntry *entries;  // Command mapped + i is entries[(start_index + i) & (capacity - 1)]
+    size_t entries_capacity;    // Power of two
     int start_index;  // Ring buffer start position
-    int count;        // Current number of commands (up to MAX_HISTORY_SIZE)
+    int count;        // Current number of commands (up to limit)
+    int limit;
+    HistoryIndex index;         // Command i has id index.first_id + i, once built
+
+    // Building the index
+    pthread_t indexer;
+    struct HistoryIndexJob *indexer_job;    // Its work, while it runs (join it)
+    int index_dropped;          // Commands dropped since it started
     char history_file[PATH_MAX];
+
+    // Appending to the history file
+    int journal_fd;             // Open for appending, -1 if it couldn't be
+    int journal_records;        // Commands in its journal
+    pthread_mutex_t journal_lock;
+
+    // Rewriting it
+    pthread_t compactor;
+    struct HistoryCompactJob *job;  // The compactor's work, while it runs (join it)
+    char *appended;             // Lines appended since it took its copy
+    size_t appended_len, appended_capacity;
+    int appended_records;
 } HistoryManager;
 
+/**
+ * @brief Set when history files are flushed to disk (before init)
+ */
+void history_manager_set_fsync(HistoryFsync policy);
+
+/**
+ * @brief Set how many commands history managers created from now on keep
+ * (MAX_HISTORY_SIZE by default)
+ */
+void history_manager_set_limit(int commands);
+
 /**
  * @brief Initialize the history manager
  * @return Pointer to new HistoryManager, or NULL on failure
@@ -32,19 +91,35 @@ typedef struct {
 HistoryManager* history_manager_init(void);
 
 /**
- * @brief Clean up history manager and save to disk
+ * @brief Clean up history manager, waiting for a rewrite of the history
+ * file to finish
  * @param hm History manager to clean up
  */
 void history_manager_cleanup(HistoryManager *hm);
 
 /**
- * @brief Add a command to the history
+ * @brief Add a command to the history and append it to the history file
  * @param hm History manager
  * @param command Command string to add
  * @return 0 on success, -1 on failure
  */
 int history_manager_add_command(HistoryManager *hm, const char *command);
 
+/**
+ * @brief Get a command
+ * @param hm History manager
+ * @param index 0 for the oldest, count - 1 for the newest
+ * @param len Receives its length (may be NULL)
+ * @return The command, NUL-terminated, valid until a command is added;
+ * NULL if index is out of range
+ */
+const char* history_manager_get(const HistoryManager *hm, int index, size_t *len);
+
+/**
+ * @brief Bytes the commands and their index take
+ */
+size_t history_manager_memory(const HistoryManager *hm);
+
 /**
  * @brief Get the most recent N commands
  * @param hm History manager
@@ -57,7 +132,7 @@ int history_manager_get_recent(HistoryManager *hm, char *buffer,
                                 size_t buffer_size, int count);
 
 /**
- * @brief Search for exact match in history
+ * @brief Search for exact match in history, newest first
  * @param hm History manager
  * @param search_term Search string
  * @param result Output buffer for result
@@ -68,12 +143,15 @@ int history_manager_search_exact(HistoryManager *hm, const char *search_term,
                                   char *result, size_t result_size);
 
 /**
- * @brief Search for fuzzy matches using LCS algorithm
+ * @brief Search for fuzzy matches using LCS algorithm: the commands with
+ * the longest substrings in common with the term (more than 2 bytes), newest
+ * first among equals. Where the index can't find them cheaply (or isn't
+ * built yet), the rest are the newest matches instead.
  * @param hm History manager
  * @param search_term Search string
  * @param results Array to store results
  * @param max_results Maximum number of results to return
- * @return Number of results found
+ * @return Number of results found, longest match first
  */
 int history_manager_search_fuzzy(HistoryManager *hm, const char *search_term,
                                   HistorySearchResult *results, int max_results);
@@ -86,7 +164,25 @@ int history_manager_search_fuzzy(HistoryManager *hm, const char *search_term,
 int history_manager_load_from_file(HistoryManager *hm);
 
 /**
- * @brief Save history to file
+ * @brief Add the commands in a history file (text, one a line, or binary)
+ * @param hm History manager
+ * @param path The file
+ * @return Number of commands added, -1 if it couldn't be read
+ */
+int history_manager_import(HistoryManager *hm, const char *path);
+
+/**
+ * @brief Write the commands kept to a text file, one a line, each after a
+ * "#<time>" line if its time is known (as bash writes them)
+ * @param hm History manager
+ * @param path The file
+ * @return Number of commands written, -1 on failure
+ */
+int history_manager_export(const HistoryManager *hm, const char *path);
+
+/**
+ * @brief Rewrite the history file with the commands kept, now (commands
+ * are saved as they are added; this only makes the file smaller)
  * @param hm History manager
  * @return 0 on success, -1 on failure
  */
@@ -94,6 +190,7 @@ int history_manager_save_to_file(HistoryManager *hm);
 
 /**
  * @brief Calculate longest common substring length between two strings
+ * (the byte-at-a-time reference; searches use fuzzy_match.h)
  * @param str1 First string
  * @param str2 Second string
  * @return Length of longest common substring
@@ -0,0 +1,254 @@
+// src/shell/job.c
+#include "job.h"
+#include "process_spawn.h"
+#include "signal_handler.h"
+#include "child_waiter.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/wait.h>
+
+// Processes of abandoned jobs, still to be reaped
+static pid_t *g_abandoned = NULL;
+static int g_num_abandoned = 0;
+static int g_abandoned_capacity = 0;
+
+static void reap_later(pid_t pid) {
+    if (g_num_abandoned == g_abandoned_capacity) {
+        int capacity = g_abandoned_capacity ? g_abandoned_capacity * 2 : 16;
+        pid_t *grown = realloc(g_abandoned, capacity * sizeof(pid_t));
+        if (!grown) return;
+        g_abandoned = grown;
+        g_abandoned_capacity = capacity;
+    }
+    g_abandoned[g_num_abandoned++] = pid;
+}
+
+Job* job_create(const char *command, const pid_t *pids, int num_pids, pid_t pgid,
+                int output_fd, int input_fd,
+                OutputChunkCallback on_output, void *user_data) {
+    Job *job = calloc(1, sizeof(Job));
+    if (job) {
+        job->command = strdup(command ? command : "");
+        job->pids = malloc(num_pids * sizeof(pid_t));
+    }
+    if (!job || !job->command || !job->pids) {
+        perror("malloc Job");
+        if (job) {
+            free(job->command);
+            free(job->pids);
+            free(job);
+        }
+        if (output_fd != -1) close(output_fd);
+        if (input_fd != -1) close(input_fd);
+        return NULL;
+    }
+
+    job->state = JOB_SPAWNED;
+    job->pgid = pgid;
+    job->num_pids = num_pids;
+    for (int i = 0; i < num_pids; i++) {
+        job->pids[i] = pids[i];
+        if (pids[i] > 0) job->num_running++;
+    }
+    job->output_fd = output_fd;
+    job->input_fd = input_fd;
+    output_capture_init(&job->capture, on_output, user_data);
+
+    int flags = fcntl(output_fd, F_GETFL, 0);
+    fcntl(output_fd, F_SETFL, flags | O_NONBLOCK);
+
+    printf("[JOB] Started '%s' (pgid %d, %d processes)\n", job->command, pgid, job->num_running);
+    fflush(stdout);
+    return job;
+}
+
+int job_read_output(Job *job) {
+    if (!job || job->output_eof) return job ? 1 : 0;
+
+    if (output_capture_drain_fd(&job->capture, job->output_fd, &job->output_eof) > 0 &&
+        job->state == JOB_SPAWNED) {
+        job->state = JOB_STREAMING;
+    }
+    output_capture_flush(&job->capture);
+    return job->output_eof;
+}
+
+static int find_pid(Job *job, pid_t pid) {
+    for (int i = 0; i < job->num_pids; i++) {
+        if (job->pids[i] == pid) return i;
+    }
+    return -1;
+}
+
+static void mark_exited(Job *job, int i, int status) {
+    if (i == job->num_pids - 1) job->status = status;
+    job->pids[i] = -1;
+    job->num_running--;
+}
+
+JobState job_update(Job *job) {
+    if (!job || job->state == JOB_EXITED) return JOB_EXITED;
+
+    // Collect whatever the group has to report: one call per state change,
+    // however many stages the pipeline has
+    int stopped = 0;
+    int status;
+    pid_t result;
+    while (job->num_running > 0 &&
+           (result = spawn_waitpid(-job->pgid, &status, WNOHANG | WUNTRACED)) != 0) {
+        if (result == -1) {
+            if (errno == EINTR) continue;
+            // Nothing of the group is left to wait for
+            printf("[JOB] Processes of '%s' already reaped\n", job->command);
+            fflush(stdout);
+            for (int i = 0; i < job->num_pids; i++) {
+                if (job->pids[i] > 0) mark_exited(job, i, 0);
+            }
+            break;
+        }
+
+        int i = find_pid(job, result);
+        if (i == -1) continue;
+        if (WIFSTOPPED(status)) {
+            stopped = 1;
+        } else {
+            mark_exited(job, i, status);
+        }
+    }
+
+    if (job->num_running == 0) {
+        // The pipe may still be held open by something the job started in the
+        // background, so take what is buffered instead of waiting for EOF.
+        // Builtin stages are different: they are done when they close it.
+        if (!job_read_output(job) && job->in_process_stages) return job->state;
+        job->state = JOB_EXITED;
+        printf("[JOB] '%s' exited with status %d\n", job->command,
+               WIFEXITED(job->status) ? WEXITSTATUS(job->status) : 128 + WTERMSIG(job->status));
+        fflush(stdout);
+    } else if (stopped) {
+        job->state = JOB_STOPPED;
+        printf("[JOB] '%s' stopped\n", job->command);
+        fflush(stdout);
+    }
+    return job->state;
+}
+
+JobState job_wait(Job *job) {
+    while (1) {
+        // Empty the SIGCHLD pipe first so a state change after this check wakes poll()
+        signal_handler_drain_sigchld();
+        job_read_output(job);
+        JobState state = job_update(job);
+        if (state == JOB_EXITED || state == JOB_STOPPED) return state;
+        child_waiter_wait(job->output_eof ? -1 : job->output_fd);
+    }
+}
+
+static pid_t first_pid(Job *job) {
+    for (int i = 0; i < job->num_pids; i++) {
+        if (job->pids[i] > 0) return job->pids[i];
+    }
+    return job->pgid;
+}
+
+void job_set_foreground(Job *job, ProcessManager *pm) {
+    if (!job || !pm || job->pgid <= 0) return;
+    process_manager_set_foreground(pm, first_pid(job), job->pgid, job->command);
+    signal_handler_give_terminal_to(job->pgid);
+}
+
+int job_leave_foreground(Job *job, ProcessManager *pm, char *notice, size_t size) {
+    if (notice && size > 0) notice[0] = '\0';
+    if (!job || !pm) return 0;
+
+    int handed_over = 0;
+    if (job->state == JOB_STOPPED && process_manager_get_foreground(pm)) {
+        int job_id = process_manager_move_to_background(pm);
+        ProcessInfo *info = process_manager_find_by_job_id(pm, job_id);
+        if (info) {
+            info->job = job;
+            handed_over = 1;
+        }
+        if (notice && job_id != -1) {
+            snprintf(notice, size, "^Z\n\n[%d]+ Stopped                 %s\n",
+                     job_id, job->command);
+        }
+        printf("[JOB] Moved '%s' to background as job %d\n", job->command, job_id);
+        fflush(stdout);
+    } else {
+        process_manager_clear_foreground(pm);
+    }
+    signal_handler_take_terminal_back();
+    return handed_over;
+}
+
+void job_continue(Job *job) {
+    if (!job || job->state == JOB_EXITED) return;
+    if (job->pgid > 0 && kill(-job->pgid, SIGCONT) == -1) {
+        perror("kill SIGCONT");
+    }
+    job->state = JOB_STREAMING;
+}
+
+char* job_run_foreground(Job *job, ProcessManager *pm) {
+    job_set_foreground(job, pm);
+    job_wait(job);
+
+    char notice[1024];
+    int handed_over = job_leave_foreground(job, pm, notice, sizeof(notice));
+    output_capture_append(&job->capture, notice, strlen(notice));
+
+    char *output = job_take_output(job);
+    if (!handed_over) job_free(job);
+    return output;
+}
+
+char* job_take_output(Job *job) {
+    output_capture_flush(&job->capture);
+    char *output = output_capture_join(&job->capture);
+    output_capture_free(&job->capture);
+    return output;
+}
+
+void job_free(Job *job) {
+    if (!job) return;
+    if (job->output_fd != -1) close(job->output_fd);
+    if (job->input_fd != -1) close(job->input_fd);
+    output_capture_free(&job->capture);
+    free(job->pids);
+    free(job->command);
+    free(job);
+}
+
+void job_abandon(Job *job) {
+    if (!job) return;
+
+    if (job->num_running > 0 && job->pgid > 0) {
+        printf("[JOB] Hanging up '%s' (pgid %d)\n", job->command, job->pgid);
+        fflush(stdout);
+        kill(-job->pgid, SIGHUP);
+        kill(-job->pgid, SIGCONT);
+    }
+
+    for (int i = 0; i < job->num_pids; i++) {
+        if (job->pids[i] > 0) reap_later(job->pids[i]);
+    }
+
+    job_free(job);
+}
+
+void job_reap_abandoned(void) {
+    int kept = 0;
+    for (int i = 0; i < g_num_abandoned; i++) {
+        pid_t result = spawn_waitpid(g_abandoned[i], NULL, WNOHANG);
+        if (result == 0 || (result == -1 && errno == EINTR)) {
+            g_abandoned[kept++] = g_abandoned[i];
+        }
+    }
+    g_num_abandoned = kept;
+}
@@ -0,0 +1,134 @@
+// src/shell/job.h
+#ifndef JOB_H
+#define JOB_H
+
+#include <sys/types.h>
+#include "output_capture.h"
+#include "process_manager.h"
+
+// A running foreground command (one process or a whole pipeline).
+//
+// A job never blocks: the owner watches output_fd in its event loop, calls
+// job_read_output() when it is readable and job_update() whenever a child
+// may have changed state (SIGCHLD or a zygote status). The job moves
+//
+//   JOB_SPAWNED -> JOB_STREAMING -> JOB_EXITED
+//                               \-> JOB_STOPPED
+//
+// so any number of jobs can run side by side from one main loop.
+
+typedef enum {
+    JOB_SPAWNED,    // Started, no output yet
+    JOB_STREAMING,  // Output has arrived
+    JOB_STOPPED,    // A process was stopped (Ctrl+Z)
+    JOB_EXITED      // Every process was reaped and the output drained
+} JobState;
+
+typedef struct Job {
+    JobState state;
+    char *command;          // Command line, for job notifications
+    pid_t pgid;
+    pid_t *pids;            // One per stage; -1 for stages that failed to start
+    int num_pids;
+    int num_running;
+    int status;             // Wait status of the last stage
+    int output_fd;          // Read end of the output pipe (non-blocking)
+    int output_eof;
+    int input_fd;           // Write end of the first stage's stdin, or -1
+    int is_pty;             // output_fd is a pseudo-terminal master (input_fd a dup of it)
+    int in_process_stages;  // Stages run as builtins on threads; the job lasts until they close the pipe
+    OutputCapture capture;
+    void *owner;            // Whoever started the job (e.g. its tab), for the owner's use
+} Job;
+
+/**
+ * @brief Wrap already started processes in a job
+ * Takes ownership of output_fd and input_fd and makes output_fd non-blocking.
+ * @param command Command line (copied)
+ * @param pids Process IDs, -1 for stages that did not start (copied)
+ * @param num_pids Number of entries in pids
+ * @param pgid Process group shared by the processes
+ * @param output_fd Read end of the pipe their stdout/stderr go to
+ * @param input_fd Write end of the first process's stdin pipe, or -1
+ * @param on_output Receives output as it arrives (NULL = keep it for job_take_output)
+ * @param user_data Passed through to on_output
+ * @return New job, or NULL on allocation failure (descriptors are then closed)
+ */
+Job* job_create(const char *command, const pid_t *pids, int num_pids, pid_t pgid,
+                int output_fd, int input_fd,
+                OutputChunkCallback on_output, void *user_data);
+
+/**
+ * @brief Read whatever output is available without blocking
+ * @return 1 if the output pipe reached EOF, 0 otherwise
+ */
+int job_read_output(Job *job);
+
+/**
+ * @brief Collect state changes of the job's processes without blocking
+ * Once every process has exited the remaining output is read and the job
+ * becomes JOB_EXITED; a stopped process makes it JOB_STOPPED.
+ * @return The new state
+ */
+JobState job_update(Job *job);
+
+/**
+ * @brief Block until the job exits or stops (for callers without a main loop)
+ * @return The final state
+ */
+JobState job_wait(Job *job);
+
+/**
+ * @brief Register the job as pm's foreground process and give it the terminal
+ */
+void job_set_foreground(Job *job, ProcessManager *pm);
+
+/**
+ * @brief Hand the terminal back once the job has exited or stopped
+ * A stopped job is moved to pm's background list, which takes ownership of
+ * it: pm follows it from then on (`fg`, `bg`, completion notices) and
+ * releases it once it is done.
+ * @param notice Receives "^Z" and the "[N]+ Stopped" line for a stopped job,
+ * or an empty string
+ * @param size Size of notice
+ * @return 1 if pm now owns the job, 0 if the caller still does
+ */
+int job_leave_foreground(Job *job, ProcessManager *pm, char *notice, size_t size);
+
+/**
+ * @brief Continue a stopped job (SIGCONT to its process group)
+ */
+void job_continue(Job *job);
+
+/**
+ * @brief Run a job in the foreground until it exits or stops, then free it
+ * (unless it was stopped and pm took it over)
+ * @param pm Process manager for job control, or NULL
+ * @return Output not passed to the callback, including the stop notice
+ */
+char* job_run_foreground(Job *job, ProcessManager *pm);
+
+/**
+ * @brief Return the output not yet passed to the callback
+ * @return Malloc'd string (possibly empty), or NULL on allocation failure
+ */
+char* job_take_output(Job *job);
+
+/**
+ * @brief Free the job and close its descriptors. Running processes are left alone.
+ */
+void job_free(Job *job);
+
+/**
+ * @brief Hang up a job whose owner is going away (e.g. its tab was closed)
+ * Sends SIGHUP and SIGCONT to the group, frees the job and reaps its
+ * processes later from job_reap_abandoned().
+ */
+void job_abandon(Job *job);
+
+/**
+ * @brief Reap processes of abandoned jobs that have exited (non-blocking)
+ */
+void job_reap_abandoned(void);
+
+#endif // JOB_H
@@ -52,8 +52,10 @@ static MultiWatch* parse_multiwatch_command(const char *cmd_str) {
 }
 
 // The loop for the "watcher" child process.
-static void watch_process_loop(const char *command, const char *temp_file) {
+// After every run it writes a byte to notify_fd so the GUI knows temp_file is complete.
+static void watch_process_loop(const char *command, const char *temp_file, int notify_fd) {
     signal(SIGINT, SIG_IGN); // Watcher processes ignore Ctrl+C
+    fcntl(notify_fd, F_SETFD, FD_CLOEXEC); // Don't leak it into the watched command
     while (1) {
         pid_t grandchild_pid = fork();
         if (grandchild_pid == 0) { // Grandchild executes the command
@@ -67,6 +69,9 @@ static void watch_process_loop(const char *command, const char *temp_file) {
             exit(127);
         } else if (grandchild_pid > 0) {
             waitpid(grandchild_pid, NULL, 0);
+            if (write(notify_fd, "r", 1) == -1 && errno == EPIPE) {
+                exit(0);  // The GUI side is gone
+            }
         }
         sleep(1);
     }
@@ -80,38 +85,65 @@ MultiWatch* multiwatch_start_session(const char *cmd_str) {
     for (int i = 0; i < mw->num_commands; i++) {
         WatchCommand *wc = &mw->commands[i];
         snprintf(wc->temp_file, sizeof(wc->temp_file), ".temp.%d_%d.txt", getpid(), i);
+        wc->fd = -1;  // Opened once the first result is ready
+        wc->notify_fd = -1;
+        mw->poll_fds[i].fd = -1;
+
+        int notify_pipe[2];
+        if (pipe(notify_pipe) == -1) {
+            perror("multiWatch notify pipe");
+            continue;
+        }
 
         wc->pid = fork();
         if (wc->pid == 0) { // Child watcher process
-            watch_process_loop(wc->command, wc->temp_file);
+            close(notify_pipe[0]);
+            watch_process_loop(wc->command, wc->temp_file, notify_pipe[1]);
             exit(0); // Should never be reached
         }
-    }
+        close(notify_pipe[1]);
 
-    usleep(1000000); // Give children time to create the temp files
-
-    for (int i = 0; i < mw->num_commands; i++) {
-        mw->commands[i].fd = open(mw->commands[i].temp_file, O_RDONLY | O_NONBLOCK);
-        if (mw->commands[i].fd != -1) {
-            mw->poll_fds[i].fd = mw->commands[i].fd;
-            mw->poll_fds[i].events = POLLIN;
-        } else {
-            mw->poll_fds[i].fd = -1; // Mark as invalid
+        if (wc->pid == -1) {
+            perror("fork multiWatch");
+            close(notify_pipe[0]);
+            continue;
         }
+
+        fcntl(notify_pipe[0], F_SETFL, O_NONBLOCK);
+        fcntl(notify_pipe[0], F_SETFD, FD_CLOEXEC);
+        wc->notify_fd = notify_pipe[0];
+        mw->poll_fds[i].fd = wc->notify_fd;
+        mw->poll_fds[i].events = POLLIN;
     }
     return mw;
 }
 
 // Polls for new output without blocking
-void multiwatch_poll_output(MultiWatch *mw, void (*output_callback)(const char *)) {
+void multiwatch_poll_output(MultiWatch *mw,
+                            void (*output_callback)(const char *, void *),
+                            void *user_data) {
     if (!mw) return;
 
-    // Poll with a 100ms timeout to avoid busy-waiting
-    int ready = poll(mw->poll_fds, mw->num_commands, 100);
+    // Zero timeout: callers only get here once a notify pipe is readable
+    int ready = poll(mw->poll_fds, mw->num_commands, 0);
     if (ready <= 0) return;
 
     for (int i = 0; i < mw->num_commands; i++) {
+        if (mw->poll_fds[i].revents & (POLLHUP | POLLERR)) {
+            // Watcher died; stop polling it
+            mw->poll_fds[i].fd = -1;
+            continue;
+        }
         if (mw->poll_fds[i].revents & POLLIN) {
+            // Consume the notifications - only the latest result matters
+            char drain[64];
+            while (read(mw->commands[i].notify_fd, drain, sizeof(drain)) > 0) {}
+
+            if (mw->commands[i].fd == -1) {
+                mw->commands[i].fd = open(mw->commands[i].temp_file, O_RDONLY | O_CLOEXEC);
+                if (mw->commands[i].fd == -1) continue;
+            }
+
             char buffer[8192];
             lseek(mw->commands[i].fd, 0, SEEK_SET); // Read from start
             ssize_t bytes = read(mw->commands[i].fd, buffer, sizeof(buffer) - 1);
@@ -125,7 +157,7 @@ void multiwatch_poll_output(MultiWatch *mw, void (*output_callback)(const char *
                 snprintf(header, sizeof(header),
                          "\"%s\", current_time: %s\n----------------------------------------------------\n%s----------------------------------------------------\n",
                          mw->commands[i].command, timestamp, buffer);
-                output_callback(header);
+                output_callback(header, user_data);
             }
         }
     }
@@ -137,6 +169,7 @@ void cleanup_multiwatch(MultiWatch *mw) {
     for (int i = 0; i < mw->num_commands; i++) {
         if (mw->commands[i].pid > 0) kill(mw->commands[i].pid, SIGTERM);
         if (mw->commands[i].fd != -1) close(mw->commands[i].fd);
+        if (mw->commands[i].notify_fd != -1) close(mw->commands[i].notify_fd);
         unlink(mw->commands[i].temp_file);
     }
     for (int i = 0; i < mw->num_commands; i++) {
@@ -15,6 +15,7 @@ typedef struct {
     pid_t pid;
     char temp_file[256];
     int fd;
+    int notify_fd;      // Read end of a pipe the watcher pokes after each run
 } WatchCommand;
 
 // Structure to manage the multiWatch session
@@ -30,8 +31,12 @@ int is_multiwatch_command(const char *cmd_str);
 // Starts the multiWatch session (forks processes, creates files)
 MultiWatch* multiwatch_start_session(const char *cmd_str);
 
-// Polls for new output from running commands (non-blocking)
-void multiwatch_poll_output(MultiWatch *mw, void (*output_callback)(const char *));
+// Polls for new output from running commands (non-blocking).
+// Each WatchCommand's notify_fd becomes readable when a fresh result is available,
+// so callers can watch those descriptors and call this when one fires.
+void multiwatch_poll_output(MultiWatch *mw,
+                            void (*output_callback)(const char *, void *),
+                            void *user_data);
 
 // Cleans up all multiWatch resources (processes, files)
 void cleanup_multiwatch(MultiWatch *mw);
@@ -0,0 +1,156 @@
+// src/shell/output_capture.c
+#include "output_capture.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+static OutputChunk* new_chunk(size_t capacity) {
+    OutputChunk *chunk = malloc(sizeof(OutputChunk) + capacity);
+    if (!chunk) {
+        perror("malloc OutputChunk");
+        return NULL;
+    }
+    chunk->next = NULL;
+    chunk->len = 0;
+    chunk->capacity = capacity;
+    return chunk;
+}
+
+// Returns the tail chunk if it still has room, otherwise links in a new one
+static OutputChunk* writable_chunk(OutputCapture *oc) {
+    if (oc->tail && oc->tail->len < oc->tail->capacity) {
+        return oc->tail;
+    }
+
+    OutputChunk *chunk = new_chunk(OUTPUT_CHUNK_SIZE);
+    if (!chunk) return NULL;
+
+    if (oc->tail) {
+        oc->tail->next = chunk;
+    } else {
+        oc->head = chunk;
+    }
+    oc->tail = chunk;
+    return chunk;
+}
+
+void output_capture_init(OutputCapture *oc, OutputChunkCallback on_chunk, void *user_data) {
+    if (!oc) return;
+    oc->head = NULL;
+    oc->tail = NULL;
+    oc->total_len = 0;
+    oc->on_chunk = on_chunk;
+    oc->user_data = user_data;
+}
+
+int output_capture_append(OutputCapture *oc, const char *data, size_t len) {
+    if (!oc || !data) return -1;
+
+    while (len > 0) {
+        OutputChunk *chunk = writable_chunk(oc);
+        if (!chunk) return -1;
+
+        size_t space = chunk->capacity - chunk->len;
+        size_t n = (len < space) ? len : space;
+        memcpy(chunk->data + chunk->len, data, n);
+        chunk->len += n;
+        oc->total_len += n;
+        data += n;
+        len -= n;
+    }
+    return 0;
+}
+
+ssize_t output_capture_drain_fd(OutputCapture *oc, int fd, int *eof) {
+    if (!oc) return -1;
+
+    ssize_t total = 0;
+    while (1) {
+        OutputChunk *chunk = writable_chunk(oc);
+        if (!chunk) return -1;
+
+        ssize_t n = read(fd, chunk->data + chunk->len, chunk->capacity - chunk->len);
+        if (n > 0) {
+            chunk->len += n;
+            oc->total_len += n;
+            total += n;
+            // In streaming mode, hand off full chunks right away so memory stays bounded
+            if (oc->on_chunk && chunk->len == chunk->capacity) {
+                output_capture_flush(oc);
+            }
+        } else if (n == 0) {
+            if (eof) *eof = 1;
+            break;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno == EIO) {
+            // A pty master reports EIO instead of EOF once the slave side is closed
+            if (eof) *eof = 1;
+            break;
+        } else {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                printf("[CAPTURE] Read error: %s\n", strerror(errno));
+                fflush(stdout);
+                if (eof) *eof = 1;
+            }
+            break;
+        }
+    }
+    return total;
+}
+
+void output_capture_flush(OutputCapture *oc) {
+    if (!oc || !oc->on_chunk) return;
+
+    OutputChunk *chunk = oc->head;
+    while (chunk) {
+        OutputChunk *next = chunk->next;
+        if (chunk->len > 0) {
+            oc->on_chunk(chunk->data, chunk->len, oc->user_data);
+        }
+        if (next) {
+            free(chunk);
+        } else {
+            // Keep the last chunk around so steady streaming doesn't malloc per read
+            chunk->len = 0;
+            oc->head = chunk;
+            oc->tail = chunk;
+        }
+        chunk = next;
+    }
+    oc->total_len = 0;
+}
+
+char* output_capture_join(OutputCapture *oc) {
+    if (!oc) return NULL;
+
+    char *result = malloc(oc->total_len + 1);
+    if (!result) {
+        perror("malloc capture result");
+        return NULL;
+    }
+
+    size_t pos = 0;
+    for (OutputChunk *chunk = oc->head; chunk; chunk = chunk->next) {
+        memcpy(result + pos, chunk->data, chunk->len);
+        pos += chunk->len;
+    }
+    result[pos] = '\0';
+    return result;
+}
+
+void output_capture_free(OutputCapture *oc) {
+    if (!oc) return;
+
+    OutputChunk *chunk = oc->head;
+    while (chunk) {
+        OutputChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    oc->head = NULL;
+    oc->tail = NULL;
+    oc->total_len = 0;
+}
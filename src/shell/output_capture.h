@@ -0,0 +1,78 @@
+// src/shell/output_capture.h
+#ifndef OUTPUT_CAPTURE_H
+#define OUTPUT_CAPTURE_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#define OUTPUT_CHUNK_SIZE 65536
+
+/**
+ * @brief Receives captured output as it arrives.
+ * The data is NOT NUL-terminated and is only valid for the duration of the call.
+ */
+typedef void (*OutputChunkCallback)(const char *data, size_t len, void *user_data);
+
+// A single block of captured bytes
+typedef struct OutputChunk {
+    struct OutputChunk *next;
+    size_t len;                  // Bytes used in data
+    size_t capacity;             // Bytes allocated for data
+    char data[];
+} OutputChunk;
+
+// Growable list of chunks that a child's output pipe is drained into
+typedef struct {
+    OutputChunk *head;
+    OutputChunk *tail;
+    size_t total_len;            // Bytes currently held in the list
+    OutputChunkCallback on_chunk; // If set, chunks are streamed out and released
+    void *user_data;
+} OutputCapture;
+
+/**
+ * @brief Initialize an output capture
+ * @param oc Capture to initialize
+ * @param on_chunk Streaming callback, or NULL to accumulate everything
+ * @param user_data Passed through to on_chunk
+ */
+void output_capture_init(OutputCapture *oc, OutputChunkCallback on_chunk, void *user_data);
+
+/**
+ * @brief Append bytes to the capture (grows the chunk list as needed)
+ * @return 0 on success, -1 on allocation failure
+ */
+int output_capture_append(OutputCapture *oc, const char *data, size_t len);
+
+/**
+ * @brief Read everything currently available from fd into the capture
+ *
+ * Reads directly into chunk storage in OUTPUT_CHUNK_SIZE pieces until the
+ * fd would block or reaches EOF. Works for both blocking and non-blocking fds
+ * (a blocking fd is read until EOF).
+ *
+ * @param oc Capture
+ * @param fd File descriptor to read from
+ * @param eof Set to 1 if EOF (or a hard read error) was reached
+ * @return Number of bytes read, or -1 on allocation failure
+ */
+ssize_t output_capture_drain_fd(OutputCapture *oc, int fd, int *eof);
+
+/**
+ * @brief Hand all buffered chunks to the streaming callback and release them
+ * Does nothing if no callback is set.
+ */
+void output_capture_flush(OutputCapture *oc);
+
+/**
+ * @brief Concatenate everything held by the capture into one string
+ * @return Newly allocated NUL-terminated string (caller frees), or NULL on failure
+ */
+char* output_capture_join(OutputCapture *oc);
+
+/**
+ * @brief Free all chunks held by the capture
+ */
+void output_capture_free(OutputCapture *oc);
+
+#endif // OUTPUT_CAPTURE_H
@@ -0,0 +1,319 @@
+// src/shell/path_cache.c
+#include "path_cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <limits.h>
+#include <time.h>
+#include <sys/stat.h>
+
+// Search path used by execvp() when PATH is unset
+#define DEFAULT_PATH "/bin:/usr/bin"
+
+#define INITIAL_BUCKETS 64
+
+typedef struct PathEntry {
+    char *name;
+    char *path;
+    int hits;
+    int pinned;              // Added with `hash -p`
+    struct PathEntry *next;
+} PathEntry;
+
+typedef struct {
+    char *dir;
+    int exists;
+    time_t mtime;
+    long mtime_nsec;
+} PathDir;
+
+static PathEntry **g_buckets = NULL;
+static size_t g_num_buckets = 0;
+static size_t g_num_entries = 0;
+
+// The PATH the table was filled from, split into directories
+static char *g_path = NULL;
+static PathDir *g_dirs = NULL;
+static int g_num_dirs = 0;
+static time_t g_last_dir_check = 0;
+
+static uint32_t hash_name(const char *name) {
+    // FNV-1a
+    uint32_t h = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+        h ^= *p;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void free_entry(PathEntry *e) {
+    free(e->name);
+    free(e->path);
+    free(e);
+}
+
+// Drops every entry, or only the ones found by searching PATH
+static void drop_entries(int keep_pinned) {
+    for (size_t b = 0; b < g_num_buckets; b++) {
+        PathEntry **link = &g_buckets[b];
+        while (*link) {
+            PathEntry *e = *link;
+            if (keep_pinned && e->pinned) {
+                link = &e->next;
+                continue;
+            }
+            *link = e->next;
+            free_entry(e);
+            g_num_entries--;
+        }
+    }
+}
+
+static void stat_dir(PathDir *d) {
+    struct stat st;
+    d->exists = (stat(d->dir, &st) == 0);
+    d->mtime = d->exists ? st.st_mtime : 0;
+#if defined(__APPLE__)
+    d->mtime_nsec = d->exists ? st.st_mtimespec.tv_nsec : 0;
+#else
+    d->mtime_nsec = d->exists ? st.st_mtim.tv_nsec : 0;
+#endif
+}
+
+static void free_dirs(void) {
+    for (int i = 0; i < g_num_dirs; i++) free(g_dirs[i].dir);
+    free(g_dirs);
+    g_dirs = NULL;
+    g_num_dirs = 0;
+}
+
+// Splits PATH into directories; an empty component means the current directory
+static void load_dirs(const char *path) {
+    free_dirs();
+    int count = 1;
+    for (const char *p = path; *p; p++) {
+        if (*p == ':') count++;
+    }
+    g_dirs = calloc(count, sizeof(PathDir));
+    if (!g_dirs) return;
+
+    const char *start = path;
+    for (;;) {
+        const char *end = strchr(start, ':');
+        size_t len = end ? (size_t)(end - start) : strlen(start);
+        PathDir *d = &g_dirs[g_num_dirs];
+        d->dir = (len == 0) ? strdup(".") : strndup(start, len);
+        if (d->dir) {
+            stat_dir(d);
+            g_num_dirs++;
+        }
+        if (!end) break;
+        start = end + 1;
+    }
+}
+
+// Empties the table if PATH changed, and drops looked-up entries if a PATH
+// directory changed since the last check
+static void validate(void) {
+    const char *path = getenv("PATH");
+    if (!path) path = DEFAULT_PATH;
+
+    if (!g_path || strcmp(path, g_path) != 0) {
+        drop_entries(0);
+        free(g_path);
+        g_path = strdup(path);
+        load_dirs(path);
+        g_last_dir_check = time(NULL);
+        return;
+    }
+
+    // Stat'ing every directory on each command would cost as much as the
+    // execve() probes the table saves, so look at most once a second
+    time_t now = time(NULL);
+    if (now == g_last_dir_check) return;
+    g_last_dir_check = now;
+
+    int changed = 0;
+    for (int i = 0; i < g_num_dirs; i++) {
+        PathDir before = g_dirs[i];
+        stat_dir(&g_dirs[i]);
+        if (before.exists != g_dirs[i].exists || before.mtime != g_dirs[i].mtime ||
+            before.mtime_nsec != g_dirs[i].mtime_nsec) {
+            changed = 1;
+        }
+    }
+    if (changed) {
+        printf("[HASH] A PATH directory changed, forgetting looked-up commands\n");
+        fflush(stdout);
+        drop_entries(1);
+    }
+}
+
+static PathEntry* find(const char *name) {
+    if (g_num_buckets == 0) return NULL;
+    PathEntry *e = g_buckets[hash_name(name) & (g_num_buckets - 1)];
+    while (e && strcmp(e->name, name) != 0) e = e->next;
+    return e;
+}
+
+static int grow(void) {
+    size_t num_buckets = g_num_buckets ? g_num_buckets * 2 : INITIAL_BUCKETS;
+    PathEntry **buckets = calloc(num_buckets, sizeof(PathEntry *));
+    if (!buckets) return -1;
+
+    for (size_t b = 0; b < g_num_buckets; b++) {
+        PathEntry *e = g_buckets[b];
+        while (e) {
+            PathEntry *next = e->next;
+            size_t idx = hash_name(e->name) & (num_buckets - 1);
+            e->next = buckets[idx];
+            buckets[idx] = e;
+            e = next;
+        }
+    }
+    free(g_buckets);
+    g_buckets = buckets;
+    g_num_buckets = num_buckets;
+    return 0;
+}
+
+static PathEntry* insert(const char *name, const char *path, int pinned) {
+    PathEntry *e = find(name);
+    if (e) {
+        char *copy = strdup(path);
+        if (!copy) return NULL;
+        free(e->path);
+        e->path = copy;
+        e->pinned = pinned;
+        return e;
+    }
+
+    if (g_num_entries >= g_num_buckets && grow() == -1) return NULL;
+
+    e = calloc(1, sizeof(PathEntry));
+    if (!e) return NULL;
+    e->name = strdup(name);
+    e->path = strdup(path);
+    if (!e->name || !e->path) {
+        free_entry(e);
+        return NULL;
+    }
+    e->pinned = pinned;
+
+    size_t idx = hash_name(name) & (g_num_buckets - 1);
+    e->next = g_buckets[idx];
+    g_buckets[idx] = e;
+    g_num_entries++;
+    return e;
+}
+
+// Finds the first executable regular file called name in PATH
+static int search_path(const char *name, char *out, size_t size) {
+    for (int i = 0; i < g_num_dirs; i++) {
+        int n = snprintf(out, size, "%s/%s", g_dirs[i].dir, name);
+        if (n < 0 || (size_t)n >= size) continue;
+
+        struct stat st;
+        if (stat(out, &st) == 0 && S_ISREG(st.st_mode) && access(out, X_OK) == 0) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static PathEntry* lookup(const char *name) {
+    validate();
+
+    PathEntry *e = find(name);
+    if (e) return e;
+
+    char path[PATH_MAX];
+    if (search_path(name, path, sizeof(path)) == -1) return NULL;
+    return insert(name, path, 0);
+}
+
+int path_cache_resolve(const char *name, char *out, size_t size) {
+    if (!name || !*name) return -1;
+
+    if (strchr(name, '/')) {
+        snprintf(out, size, "%s", name);
+        return 0;
+    }
+
+    PathEntry *e = lookup(name);
+    if (!e) return -1;
+    e->hits++;
+    snprintf(out, size, "%s", e->path);
+    return 0;
+}
+
+int path_cache_remember(const char *name) {
+    if (!name || !*name || strchr(name, '/')) return -1;
+    return lookup(name) ? 0 : -1;
+}
+
+int path_cache_lookup(const char *name, char *out, size_t size) {
+    if (!name || !*name) return -1;
+
+    if (strchr(name, '/')) {
+        snprintf(out, size, "%s", name);
+        return access(name, X_OK) == 0 ? 0 : -1;
+    }
+
+    validate();
+    PathEntry *e = find(name);
+    if (e) {
+        snprintf(out, size, "%s", e->path);
+        return 1;
+    }
+    return search_path(name, out, size) == 0 ? 0 : -1;
+}
+
+int path_cache_insert(const char *name, const char *path) {
+    validate();
+    return insert(name, path, 1) ? 0 : -1;
+}
+
+void path_cache_forget(const char *name) {
+    if (g_num_buckets == 0) return;
+    PathEntry **link = &g_buckets[hash_name(name) & (g_num_buckets - 1)];
+    while (*link) {
+        if (strcmp((*link)->name, name) == 0) {
+            PathEntry *e = *link;
+            *link = e->next;
+            free_entry(e);
+            g_num_entries--;
+            return;
+        }
+        link = &(*link)->next;
+    }
+}
+
+void path_cache_clear(void) {
+    drop_entries(0);
+}
+
+char* path_cache_list(void) {
+    validate();
+    if (g_num_entries == 0) return strdup("hash: hash table empty\n");
+
+    size_t size = 16;
+    for (size_t b = 0; b < g_num_buckets; b++) {
+        for (PathEntry *e = g_buckets[b]; e; e = e->next) {
+            size += strlen(e->path) + 16;
+        }
+    }
+
+    char *out = malloc(size);
+    if (!out) return NULL;
+    size_t len = snprintf(out, size, "hits\tcommand\n");
+    for (size_t b = 0; b < g_num_buckets; b++) {
+        for (PathEntry *e = g_buckets[b]; e; e = e->next) {
+            len += snprintf(out + len, size - len, "%4d\t%s\n", e->hits, e->path);
+        }
+    }
+    return out;
+}
@@ -0,0 +1,64 @@
+// src/shell/path_cache.h
+#ifndef PATH_CACHE_H
+#define PATH_CACHE_H
+
+#include <stddef.h>
+
+// Command name -> absolute path table, like the shell's `hash`.
+//
+// Names are looked up in $PATH the first time they are run and remembered,
+// so later runs exec the binary directly instead of trying execve() in every
+// PATH directory. The table is emptied when PATH changes, and entries are
+// dropped when one of the PATH directories is modified (checked at most
+// once a second).
+
+/**
+ * @brief Resolve a command name to the file to execute
+ * Names containing '/' are returned unchanged. Counts a hit.
+ * @param name Command name (argv[0])
+ * @param out Receives the path
+ * @param size Size of out
+ * @return 0 on success, -1 if the command isn't found in PATH
+ */
+int path_cache_resolve(const char *name, char *out, size_t size);
+
+/**
+ * @brief Look a name up and remember it without counting a hit (`hash name`)
+ * @return 0 if found, -1 if not
+ */
+int path_cache_remember(const char *name);
+
+/**
+ * @brief Find what a name would run without remembering it or counting a hit (`type`)
+ * @param name Command name
+ * @param out Receives the path
+ * @param size Size of out
+ * @return 1 if the name is in the table, 0 if it was found in PATH (or is an
+ * executable path), -1 if not found
+ */
+int path_cache_lookup(const char *name, char *out, size_t size);
+
+/**
+ * @brief Remember name as path regardless of PATH (`hash -p path name`)
+ * Such entries survive PATH directory changes but not a PATH change or `hash -r`.
+ * @return 0 on success, -1 on allocation failure
+ */
+int path_cache_insert(const char *name, const char *path);
+
+/**
+ * @brief Forget one name (e.g. its binary was removed)
+ */
+void path_cache_forget(const char *name);
+
+/**
+ * @brief Forget every name (`hash -r`)
+ */
+void path_cache_clear(void);
+
+/**
+ * @brief List the table as "hits\tcommand" lines (`hash`)
+ * @return Malloc'd text, "hash: hash table empty\n" when empty, or NULL
+ */
+char* path_cache_list(void);
+
+#endif // PATH_CACHE_H
@@ -1,8 +1,10 @@
 // in src/shell/pipe_handler.c
+#define _GNU_SOURCE   // F_SETPIPE_SZ
 
 #include "pipe_handler.h"
 #include "process_manager.h"
 #include "signal_handler.h"
+#include "process_spawn.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -11,6 +13,7 @@
 #include <sys/wait.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <limits.h>
 
 // Check for pipe character outside of quotes
 int has_pipe(const char *cmd_str) {
@@ -26,13 +29,24 @@ int has_pipe(const char *cmd_str) {
 }
 
 Pipeline* parse_pipeline(char *cmd_str) {
-    Pipeline *pipeline = malloc(sizeof(Pipeline));
-    pipeline->num_commands = 0;
+    Pipeline *pipeline = calloc(1, sizeof(Pipeline));
+    if (!pipeline) return NULL;
 
     char *saveptr;
     char *segment = strtok_r(cmd_str, "|", &saveptr);
 
-    while (segment != NULL && pipeline->num_commands < MAX_PIPE_COMMANDS) {
+    while (segment != NULL) {
+        if (pipeline->num_commands == pipeline->capacity) {
+            int capacity = pipeline->capacity ? pipeline->capacity * 2 : 4;
+            PipeCommand *commands = realloc(pipeline->commands, capacity * sizeof(PipeCommand));
+            if (!commands) {
+                perror("realloc pipeline");
+                break;
+            }
+            pipeline->commands = commands;
+            pipeline->capacity = capacity;
+        }
+
         PipeCommand *p_cmd = &pipeline->commands[pipeline->num_commands];
         p_cmd->raw_command = strdup(segment);
 
@@ -53,236 +67,204 @@ void free_pipeline(Pipeline *pipeline) {
         free_command(&pipeline->commands[i].cmd);
         cleanup_redirect_info(&pipeline->commands[i].redirects);
     }
+    free(pipeline->commands);
     free(pipeline);
 }
 
-// Legacy version without signal handling
-char* execute_pipeline(Pipeline *pipeline) {
-    if (pipeline->num_commands == 0) return NULL;
-
-    int capture_pipe[2];
-    if (pipe(capture_pipe) == -1) {
-        perror("capture pipe");
-        return NULL;
-    }
+// Bigger pipes let a fast stage run ahead instead of being woken for every
+// 64 KB the next one consumes. Best effort: the size is capped by
+// /proc/sys/fs/pipe-max-size, and other systems don't support it at all.
+static void enlarge_pipe(int fd) {
+#ifdef F_SETPIPE_SZ
+    fcntl(fd, F_SETPIPE_SZ, PIPELINE_PIPE_SIZE);
+#else
+    (void)fd;
+#endif
+}
 
-    pid_t *pids = malloc(pipeline->num_commands * sizeof(pid_t));
-    int input_fd = STDIN_FILENO;
-    int pipe_fds[2];
+// Results of starting a pipeline's stages
+typedef struct {
+    int started;            // Stages running (processes and builtins)
+    int builtins;           // Of which builtins, writing from threads
+    int last_status;        // Exit status of the last stage if it is a builtin, else -1
+    pid_t pgid;             // Group of the processes, 0 if there are none
+} StageResult;
+
+// Starts every stage, each reading the previous stage's output and the last
+// one writing into capture_fd. With job_control the processes share a new
+// process group led by the first one. Builtins run in the shell and hand
+// their output to a thread that writes it into the pipe (pid -1, but they
+// count as started). A stage that can't be started gets pid -1 and its
+// error appended to errors; the rest of the pipeline still runs.
+static StageResult spawn_pipeline_stages(Pipeline *pipeline, int capture_fd, int job_control,
+                                         BuiltinEnv *env, pid_t *pids,
+                                         char *errors, size_t errors_size) {
+    StageResult result = { 0, 0, -1, 0 };
+    pid_t pipeline_pgid = 0;
+    int input_fd = -1;   // -1 = inherit our stdin
 
     for (int i = 0; i < pipeline->num_commands; i++) {
         PipeCommand *p_cmd = &pipeline->commands[i];
+        int is_last = (i == pipeline->num_commands - 1);
+        int pipe_fds[2] = { -1, -1 };
+        pids[i] = -1;
 
-        if (i < pipeline->num_commands - 1) {
-            if (pipe(pipe_fds) == -1) {
+        if (!is_last) {
+            if (spawn_pipe(pipe_fds) == -1) {
                 perror("inter-process pipe");
-                free(pids);
-                return NULL;
+                break;
             }
+            enlarge_pipe(pipe_fds[1]);
         }
 
-        pids[i] = fork();
-        if (pids[i] == 0) { // Child Process
-            if (input_fd != STDIN_FILENO) {
-                dup2(input_fd, STDIN_FILENO);
-                close(input_fd);
-            }
-
-            if (i < pipeline->num_commands - 1) {
-                close(pipe_fds[0]);
-                dup2(pipe_fds[1], STDOUT_FILENO);
-                close(pipe_fds[1]);
+        char message[PATH_MAX + 128];
+        message[0] = '\0';
+        int redir_in, redir_out;
+        const Builtin *builtin = NULL;
+        if (redirect_open_files(&p_cmd->redirects, &redir_in, &redir_out,
+                                message, sizeof(message)) == -1) {
+            strcat(message, "\n");
+        } else if (p_cmd->cmd.argc == 0) {
+            snprintf(message, sizeof(message), "syntax error near unexpected token `|'\n");
+        } else if ((builtin = builtin_find(p_cmd->cmd.args[0])) != NULL) {
+            // Builtins don't read their input; closing it below is all they do with it
+            int out_fd = (redir_out != -1) ? redir_out : (is_last ? capture_fd : pipe_fds[1]);
+            int status = builtin_start_stage(builtin, &p_cmd->cmd, env, out_fd,
+                                             errors, errors_size);
+            if (status != -1) {
+                result.started++;
+                result.builtins++;
+                if (is_last) result.last_status = status;
             } else {
-                close(capture_pipe[0]);
-                dup2(capture_pipe[1], STDOUT_FILENO);
-                close(capture_pipe[1]);
+                snprintf(message, sizeof(message), "%s: cannot start pipeline stage\n",
+                         p_cmd->cmd.args[0]);
             }
+            if (redir_in != -1) close(redir_in);
+            if (redir_out != -1) close(redir_out);
+        } else {
+            SpawnRequest req;
+            spawn_request_init(&req);
+            req.stdin_fd = (redir_in != -1) ? redir_in : input_fd;
+            req.stdout_fd = (redir_out != -1) ? redir_out : (is_last ? capture_fd : pipe_fds[1]);
+            req.pgid = job_control ? pipeline_pgid : -1;
+
+            pids[i] = spawn_process(p_cmd->cmd.args, &req);
+            if (pids[i] == -1) {
+                spawn_format_error(p_cmd->cmd.args[0], errno, message, sizeof(message));
+            }
+            if (redir_in != -1) close(redir_in);
+            if (redir_out != -1) close(redir_out);
+        }
 
-            execvp(p_cmd->cmd.args[0], p_cmd->cmd.args);
-            perror("execvp in pipe");
-            exit(127);
+        if (pids[i] != -1) {
+            result.started++;
+            if (pipeline_pgid == 0) pipeline_pgid = pids[i];
+        } else if (errors && strlen(errors) + strlen(message) < errors_size) {
+            strcat(errors, message);
         }
 
-        if (input_fd != STDIN_FILENO) close(input_fd);
-        if (i < pipeline->num_commands - 1) {
+        if (input_fd != -1) close(input_fd);
+        if (!is_last) {
             close(pipe_fds[1]);
             input_fd = pipe_fds[0];
         }
     }
+    if (input_fd != -1) close(input_fd);
 
-    close(capture_pipe[1]);
+    result.pgid = pipeline_pgid;
+    return result;
+}
 
-    char *output = malloc(8192);
-    if (output) output[0] = '\0';
-    char buffer[256];
-    ssize_t bytes_read;
+// Legacy version without signal handling
+char* execute_pipeline(Pipeline *pipeline) {
+    if (!pipeline || pipeline->num_commands == 0) return NULL;
+
+    int capture_pipe[2];
+    if (spawn_pipe(capture_pipe) == -1) {
+        perror("capture pipe");
+        return NULL;
+    }
+    enlarge_pipe(capture_pipe[1]);
 
-    while ((bytes_read = read(capture_pipe[0], buffer, sizeof(buffer) - 1)) > 0) {
-        buffer[bytes_read] = '\0';
-        strcat(output, buffer);
+    pid_t *pids = malloc(pipeline->num_commands * sizeof(pid_t));
+    if (!pids) {
+        close(capture_pipe[0]);
+        close(capture_pipe[1]);
+        return NULL;
     }
+
+    char errors[4096];
+    errors[0] = '\0';
+    spawn_pipeline_stages(pipeline, capture_pipe[1], 0, NULL, pids, errors, sizeof(errors));
+    close(capture_pipe[1]);
+
+    OutputCapture capture;
+    output_capture_init(&capture, NULL, NULL);
+    output_capture_append(&capture, errors, strlen(errors));
+    output_capture_drain_fd(&capture, capture_pipe[0], NULL);
     close(capture_pipe[0]);
 
     for (int i = 0; i < pipeline->num_commands; i++) {
-        waitpid(pids[i], NULL, 0);
+        if (pids[i] != -1) spawn_waitpid(pids[i], NULL, 0);
     }
 
     free(pids);
+    char *output = output_capture_join(&capture);
+    output_capture_free(&capture);
     return output;
 }
 
-// NEW: Execute pipeline with signal handling and non-blocking I/O
-char* execute_pipeline_with_signals(Pipeline *pipeline, ProcessManager *pm, 
-                                    const char *cmd_str) {
-    if (pipeline->num_commands == 0) return NULL;
+Job* pipeline_start(Pipeline *pipeline, const char *cmd_str, BuiltinEnv *env,
+                    OutputChunkCallback on_output, void *user_data, char **output) {
+    *output = NULL;
+    if (!pipeline || pipeline->num_commands == 0) return NULL;
 
     int capture_pipe[2];
-    if (pipe(capture_pipe) == -1) {
+    if (spawn_pipe(capture_pipe) == -1) {
         perror("capture pipe");
         return NULL;
     }
-    
-    // Make read end non-blocking
-    int flags = fcntl(capture_pipe[0], F_GETFL, 0);
-    fcntl(capture_pipe[0], F_SETFL, flags | O_NONBLOCK);
+    enlarge_pipe(capture_pipe[1]);
 
     pid_t *pids = malloc(pipeline->num_commands * sizeof(pid_t));
-    pid_t pipeline_pgid = 0;
-    int input_fd = STDIN_FILENO;
-    int pipe_fds[2];
-
-    for (int i = 0; i < pipeline->num_commands; i++) {
-        PipeCommand *p_cmd = &pipeline->commands[i];
-
-        if (i < pipeline->num_commands - 1) {
-            if (pipe(pipe_fds) == -1) {
-                perror("inter-process pipe");
-                free(pids);
-                return NULL;
-            }
-        }
-
-        pids[i] = fork();
-        if (pids[i] == 0) { // Child Process
-            // Put all pipeline processes in the same process group
-            if (i == 0) {
-                // First process creates the group
-                setpgid(0, 0);
-            } else {
-                // Subsequent processes join the group
-                setpgid(0, pipeline_pgid);
-            }
-            
-            // Restore default signal handlers
-            signal_handler_setup_child();
-            
-            if (input_fd != STDIN_FILENO) {
-                dup2(input_fd, STDIN_FILENO);
-                close(input_fd);
-            }
-
-            if (i < pipeline->num_commands - 1) {
-                close(pipe_fds[0]);
-                dup2(pipe_fds[1], STDOUT_FILENO);
-                close(pipe_fds[1]);
-            } else {
-                close(capture_pipe[0]);
-                dup2(capture_pipe[1], STDOUT_FILENO);
-                close(capture_pipe[1]);
-            }
-
-            execvp(p_cmd->cmd.args[0], p_cmd->cmd.args);
-            perror("execvp in pipe");
-            exit(127);
-        }
-
-        // Parent: Set up process group
-        if (i == 0) {
-            pipeline_pgid = pids[0];
-            setpgid(pids[0], pipeline_pgid);
-        } else {
-            setpgid(pids[i], pipeline_pgid);
-        }
-
-        if (input_fd != STDIN_FILENO) close(input_fd);
-        if (i < pipeline->num_commands - 1) {
-            close(pipe_fds[1]);
-            input_fd = pipe_fds[0];
-        }
+    if (!pids) {
+        close(capture_pipe[0]);
+        close(capture_pipe[1]);
+        return NULL;
     }
+    char errors[4096];
+    errors[0] = '\0';
 
+    // All stages share one process group so job control signals reach each of them
+    StageResult stages = spawn_pipeline_stages(pipeline, capture_pipe[1], 1, env, pids,
+                                               errors, sizeof(errors));
     close(capture_pipe[1]);
 
-    // Register as foreground process
-    if (pm && pipeline_pgid > 0) {
-        process_manager_set_foreground(pm, pids[0], pipeline_pgid, cmd_str);
-        signal_handler_give_terminal_to(pipeline_pgid);
+    if (stages.started == 0) {
+        close(capture_pipe[0]);
+        free(pids);
+        *output = strdup(errors);
+        return NULL;
     }
 
-    // Read output using non-blocking I/O
-    char *output = malloc(8192);
-    if (output) output[0] = '\0';
-    int output_len = 0;
-    char buffer[256];
-    int all_exited = 0;
-
-    // Keep reading until all processes exit
-    while (!all_exited) {
-        all_exited = 1;
-        
-        // Check status of all pipeline processes
-        for (int i = 0; i < pipeline->num_commands; i++) {
-            int status;
-            pid_t result = waitpid(pids[i], &status, WNOHANG | WUNTRACED);
-            
-            if (result == 0) {
-                // Process still running
-                all_exited = 0;
-            } else if (result == pids[i]) {
-                if (WIFSTOPPED(status)) {
-                    // Process stopped
-                    all_exited = 0;
-                }
-                // else: process exited or terminated
-            }
-        }
-        
-        // Try to read output (non-blocking)
-        ssize_t bytes_read = read(capture_pipe[0], buffer, sizeof(buffer) - 1);
-        if (bytes_read > 0) {
-            buffer[bytes_read] = '\0';
-            if (output && output_len + bytes_read < 8192) {
-                strcat(output, buffer);
-                output_len += bytes_read;
-            }
-        } else if (bytes_read == -1 && errno != EAGAIN && errno != EWOULDBLOCK) {
-            // Real error
-            break;
-        }
-        
-        if (!all_exited) {
-            usleep(1000); // 1ms delay to avoid busy-waiting
-        }
-    }
-    
-    // Read any remaining output
-    ssize_t bytes_read;
-    while ((bytes_read = read(capture_pipe[0], buffer, sizeof(buffer) - 1)) > 0) {
-        buffer[bytes_read] = '\0';
-        if (output && output_len + bytes_read < 8192) {
-            strcat(output, buffer);
-            output_len += bytes_read;
-        }
-    }
-    
-    close(capture_pipe[0]);
+    Job *job = job_create(cmd_str, pids, pipeline->num_commands, stages.pgid,
+                          capture_pipe[0], -1, on_output, user_data);
+    free(pids);
+    if (!job) return NULL;
 
-    // Clean up
-    if (pm) {
-        process_manager_clear_foreground(pm);
-        signal_handler_take_terminal_back();
-    }
+    job->in_process_stages = stages.builtins;
+    if (stages.last_status != -1) job->status = (stages.last_status & 0xff) << 8;
+    // Errors from stages that didn't start come before the pipeline's output
+    output_capture_append(&job->capture, errors, strlen(errors));
+    return job;
+}
 
-    free(pids);
-    return output;
-}
\ No newline at end of file
+// Synchronous version for callers without a main loop
+char* execute_pipeline_with_signals(Pipeline *pipeline, ProcessManager *pm, 
+                                    const char *cmd_str) {
+    char *output;
+    BuiltinEnv env = { .pm = pm };
+    Job *job = pipeline_start(pipeline, cmd_str, &env, NULL, NULL, &output);
+    if (!job) return output;
+    return job_run_foreground(job, pm);
+}
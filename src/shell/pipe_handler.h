@@ -6,9 +6,12 @@
 #include "command_parser.h"
 #include "redirect_handler.h"
 #include "process_manager.h"
+#include "job.h"
+#include "builtins.h"
 #include <sys/types.h>
 
-#define MAX_PIPE_COMMANDS 16
+// Inter-stage pipes are enlarged to this where the system allows it (Linux)
+#define PIPELINE_PIPE_SIZE (1024 * 1024)
 
 // Forward declaration
 
@@ -19,10 +22,11 @@ typedef struct {
     RedirectInfo redirects;
 } PipeCommand;
 
-// The complete pipeline of commands
+// The complete pipeline of commands (any number of stages)
 typedef struct {
-    PipeCommand commands[MAX_PIPE_COMMANDS];
+    PipeCommand *commands;
     int num_commands;
+    int capacity;
 } Pipeline;
 
 /**
@@ -46,7 +50,24 @@ void free_pipeline(Pipeline *pipeline);
 char* execute_pipeline(Pipeline *pipeline);
 
 /**
- * @brief Execute pipeline with full signal handling support.
+ * @brief Start every stage of a pipeline without waiting for it.
+ * The processes share a new process group; the last stage's stdout goes to
+ * the job's output pipe. Builtin stages run in the shell, as a subshell
+ * would run them, and a thread writes their output into the pipe.
+ * @param pipeline The pipeline to execute.
+ * @param cmd_str Original command string for display.
+ * @param env Shell state for builtin stages, or NULL.
+ * @param on_output Receives the pipeline's output as it arrives.
+ * @param user_data Passed through to on_output.
+ * @param output Set to the error messages when no stage could be started.
+ * @return The running job, or NULL if nothing was started.
+ */
+Job* pipeline_start(Pipeline *pipeline, const char *cmd_str, BuiltinEnv *env,
+                    OutputChunkCallback on_output, void *user_data, char **output);
+
+/**
+ * @brief Execute pipeline with full signal handling support, blocking
+ * until it exits or is stopped.
  * @param pipeline The pipeline to execute.
  * @param pm Process manager for job control.
  * @param cmd_str Original command string for display.
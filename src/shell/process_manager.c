@@ -1,11 +1,14 @@
 // src/shell/process_manager.c
 #include "process_manager.h"
+#include "process_spawn.h"
+#include "job.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <signal.h>
 #include <sys/wait.h>
 #include <unistd.h>
+#include <errno.h>
 
 ProcessManager* process_manager_init(void) {
     ProcessManager *pm = calloc(1, sizeof(ProcessManager));
@@ -21,6 +24,18 @@ ProcessManager* process_manager_init(void) {
     return pm;
 }
 
+// Hands a job pm no longer tracks back to its owner
+static void release_job(ProcessManager *pm, ProcessInfo *info) {
+    Job *job = info->job;
+    info->job = NULL;
+    if (!job) return;
+    if (pm->release_job) {
+        pm->release_job(job, pm->release_data);
+    } else {
+        job_abandon(job);
+    }
+}
+
 void process_manager_cleanup(ProcessManager *pm) {
     if (!pm) return;
     
@@ -29,8 +44,11 @@ void process_manager_cleanup(ProcessManager *pm) {
         if (pm->bg_jobs[i].state == PROC_RUNNING || 
             pm->bg_jobs[i].state == PROC_STOPPED) {
             kill(-pm->bg_jobs[i].pgid, SIGTERM);
-            waitpid(pm->bg_jobs[i].pid, NULL, 0);
+            kill(-pm->bg_jobs[i].pgid, SIGCONT);  // A stopped job only sees SIGTERM once continued
+            if (!pm->bg_jobs[i].job) spawn_waitpid(pm->bg_jobs[i].pid, NULL, 0);
         }
+        // Jobs are reaped later, from job_reap_abandoned()
+        release_job(pm, &pm->bg_jobs[i]);
     }
     
     // Clean up foreground process if any
@@ -60,6 +78,7 @@ void process_manager_set_foreground(ProcessManager *pm, pid_t pid, pid_t pgid,
     pm->fg_process->state = PROC_RUNNING;
     pm->fg_process->job_id = 0; // Foreground jobs don't have job IDs
     pm->fg_process->start_time = time(NULL);
+    pm->fg_process->job = NULL;
     
     strncpy(pm->fg_process->command, command, MAX_COMMAND_LEN - 1);
     pm->fg_process->command[MAX_COMMAND_LEN - 1] = '\0';
@@ -118,6 +137,7 @@ int process_manager_add_background(ProcessManager *pm, pid_t pid, pid_t pgid,
     job->state = state;
     job->job_id = pm->next_job_id++;
     job->start_time = time(NULL);
+    job->job = NULL;
     
     strncpy(job->command, command, MAX_COMMAND_LEN - 1);
     job->command[MAX_COMMAND_LEN - 1] = '\0';
@@ -127,6 +147,14 @@ int process_manager_add_background(ProcessManager *pm, pid_t pid, pid_t pgid,
     return job->job_id;
 }
 
+void process_manager_set_job_release(ProcessManager *pm,
+                                     void (*release)(struct Job *, void *),
+                                     void *user_data) {
+    if (!pm) return;
+    pm->release_job = release;
+    pm->release_data = user_data;
+}
+
 void process_manager_remove_background(ProcessManager *pm, pid_t pid) {
     if (!pm) return;
     
@@ -136,6 +164,8 @@ void process_manager_remove_background(ProcessManager *pm, pid_t pid) {
             memmove(&pm->bg_jobs[i], &pm->bg_jobs[i + 1], 
                     (pm->num_bg_jobs - i - 1) * sizeof(ProcessInfo));
             pm->num_bg_jobs--;
+            // Like bash, number new jobs after the highest one still around
+            pm->next_job_id = pm->num_bg_jobs ? pm->bg_jobs[pm->num_bg_jobs - 1].job_id + 1 : 1;
             return;
         }
     }
@@ -164,17 +194,71 @@ ProcessInfo* process_manager_find_by_pid(ProcessManager *pm, pid_t pid) {
     return NULL;
 }
 
+ProcessInfo* process_manager_find_by_job_id(ProcessManager *pm, int job_id) {
+    if (!pm || pm->num_bg_jobs == 0) return NULL;
+    if (job_id == 0) return &pm->bg_jobs[pm->num_bg_jobs - 1];
+
+    for (int i = 0; i < pm->num_bg_jobs; i++) {
+        if (pm->bg_jobs[i].job_id == job_id) {
+            return &pm->bg_jobs[i];
+        }
+    }
+
+    return NULL;
+}
+
+// Follows a job pm owns through all of its processes
+static int check_owned_job(ProcessManager *pm, ProcessInfo *info,
+                           void (*output_callback)(const char *, void *),
+                           void *user_data) {
+    char notification[1024];
+    JobState state = job_update(info->job);
+
+    if (state == JOB_EXITED) {
+        int status = info->job->status;
+        snprintf(notification, sizeof(notification), "[%d]+ %-24s%s\n", info->job_id,
+                 WIFSIGNALED(status) ? "Terminated" : "Done", info->command);
+        output_callback(notification, user_data);
+        release_job(pm, info);
+        process_manager_remove_background(pm, info->pid);
+        return 1;
+    }
+    if (state == JOB_STOPPED && info->state != PROC_STOPPED) {
+        info->state = PROC_STOPPED;
+        snprintf(notification, sizeof(notification),
+                 "[%d]+ Stopped                 %s\n", info->job_id, info->command);
+        output_callback(notification, user_data);
+    }
+    return 0;
+}
+
 void process_manager_check_background_jobs(ProcessManager *pm, 
-                                           void (*output_callback)(const char *)) {
+                                           void (*output_callback)(const char *, void *),
+                                           void *user_data) {
     if (!pm || !output_callback) return;
     
-    int status;
-    pid_t pid;
-    
-    // Check all background jobs non-blockingly
-    while ((pid = waitpid(-1, &status, WNOHANG | WUNTRACED | WCONTINUED)) > 0) {
-        ProcessInfo *job = process_manager_find_by_pid(pm, pid);
-        if (!job) continue; // Not a tracked background job
+    // Only wait on our own jobs: waitpid(-1) would also reap children that
+    // belong to other tabs or to a command that is still being waited on
+    int i = 0;
+    while (i < pm->num_bg_jobs) {
+        ProcessInfo *job = &pm->bg_jobs[i];
+        if (job->job) {
+            if (!check_owned_job(pm, job, output_callback, user_data)) i++;
+            continue;
+        }
+
+        int status;
+        pid_t pid = spawn_waitpid(job->pid, &status, WNOHANG | WUNTRACED | WCONTINUED);
+        
+        if (pid == -1 && errno == ECHILD) {
+            // Reaped elsewhere - nothing left to track
+            process_manager_remove_background(pm, job->pid);
+            continue;
+        }
+        if (pid != job->pid) {
+            i++;
+            continue;
+        }
         
         char notification[1024];
         
@@ -183,30 +267,33 @@ void process_manager_check_background_jobs(ProcessManager *pm,
             snprintf(notification, sizeof(notification),
                      "[%d]+ Done                    %s\n",
                      job->job_id, job->command);
-            output_callback(notification);
+            output_callback(notification, user_data);
             process_manager_remove_background(pm, pid);
+            continue;
         } else if (WIFSIGNALED(status)) {
             // Process terminated by signal
             snprintf(notification, sizeof(notification),
                      "[%d]+ Terminated              %s\n",
                      job->job_id, job->command);
-            output_callback(notification);
+            output_callback(notification, user_data);
             process_manager_remove_background(pm, pid);
+            continue;
         } else if (WIFSTOPPED(status)) {
             // Process was stopped
             process_manager_update_state(pm, pid, PROC_STOPPED);
             snprintf(notification, sizeof(notification),
                      "[%d]+ Stopped                 %s\n",
                      job->job_id, job->command);
-            output_callback(notification);
+            output_callback(notification, user_data);
         } else if (WIFCONTINUED(status)) {
             // Process was resumed
             process_manager_update_state(pm, pid, PROC_RUNNING);
             snprintf(notification, sizeof(notification),
                      "[%d]+ Running                 %s\n",
                      job->job_id, job->command);
-            output_callback(notification);
+            output_callback(notification, user_data);
         }
+        i++;
     }
 }
 
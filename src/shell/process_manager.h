@@ -8,6 +8,8 @@
 #define MAX_BG_JOBS 100
 #define MAX_COMMAND_LEN 512
 
+struct Job;
+
 // Process states
 typedef enum {
     PROC_RUNNING,
@@ -23,6 +25,7 @@ typedef struct {
     ProcessState state;             // Current state
     int job_id;                     // Job number (for background jobs)
     time_t start_time;              // When the job was started
+    struct Job *job;                // Pipes and processes of a stopped foreground job (owned), or NULL
 } ProcessInfo;
 
 // Manager for all processes in a tab
@@ -31,6 +34,8 @@ typedef struct {
     ProcessInfo bg_jobs[MAX_BG_JOBS]; // Array of background jobs
     int num_bg_jobs;                  // Number of background jobs
     int next_job_id;                  // Next job ID to assign
+    void (*release_job)(struct Job *job, void *user_data); // Disposes of finished jobs
+    void *release_data;
 } ProcessManager;
 
 /**
@@ -74,6 +79,16 @@ ProcessInfo* process_manager_get_foreground(ProcessManager *pm);
  */
 int process_manager_move_to_background(ProcessManager *pm);
 
+/**
+ * @brief Set how pm gets rid of the jobs it owns once they finish or pm is cleaned up
+ * @param pm Process manager
+ * @param release Called with each job pm lets go of (NULL = job_abandon)
+ * @param user_data Passed through to release
+ */
+void process_manager_set_job_release(ProcessManager *pm,
+                                     void (*release)(struct Job *, void *),
+                                     void *user_data);
+
 /**
  * @brief Add a background job
  * @param pm Process manager
@@ -109,13 +124,23 @@ void process_manager_update_state(ProcessManager *pm, pid_t pid, ProcessState st
  */
 ProcessInfo* process_manager_find_by_pid(ProcessManager *pm, pid_t pid);
 
+/**
+ * @brief Find a background job by job number
+ * @param pm Process manager
+ * @param job_id Job number, or 0 for the most recent job
+ * @return Pointer to ProcessInfo, or NULL if not found
+ */
+ProcessInfo* process_manager_find_by_job_id(ProcessManager *pm, int job_id);
+
 /**
  * @brief Check for completed background jobs and print notifications
  * @param pm Process manager
  * @param output_callback Callback function to output notifications
+ * @param user_data Passed through to output_callback
  */
 void process_manager_check_background_jobs(ProcessManager *pm, 
-                                           void (*output_callback)(const char *));
+                                           void (*output_callback)(const char *, void *),
+                                           void *user_data);
 
 /**
  * @brief Get a string representation of the process state
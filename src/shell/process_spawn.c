@@ -0,0 +1,258 @@
+// src/shell/process_spawn.c
+#define _GNU_SOURCE   // pipe2()
+#include "process_spawn.h"
+#include "signal_handler.h"
+#include "zygote.h"
+#include "path_cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <sys/ioctl.h>
+
+extern char **environ;
+
+static SpawnMode g_spawn_mode = SPAWN_MODE_POSIX_SPAWN;
+
+void spawn_set_mode(SpawnMode mode) {
+    g_spawn_mode = mode;
+}
+
+SpawnMode spawn_get_mode(void) {
+    return g_spawn_mode;
+}
+
+void spawn_request_init(SpawnRequest *req) {
+    req->stdin_fd = -1;
+    req->stdout_fd = -1;
+    req->stderr_fd = -1;
+    req->pgid = 0;
+    req->new_session = 0;
+}
+
+int spawn_pipe(int fds[2]) {
+#ifdef __linux__
+    return pipe2(fds, O_CLOEXEC);
+#else
+    if (pipe(fds) == -1) return -1;
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    return 0;
+#endif
+}
+
+void spawn_format_error(const char *name, int err, char *buf, size_t size) {
+    if (err == ENOENT && !strchr(name, '/')) {
+        snprintf(buf, size, "%s: command not found\n", name);
+    } else {
+        snprintf(buf, size, "%s: %s\n", name, strerror(err));
+    }
+}
+
+static pid_t spawn_with_posix_spawn(const char *path, char *const argv[], const SpawnRequest *req) {
+    // A new session takes its stdin, a pty slave, as its controlling
+    // terminal by opening it by name (without O_NOCTTY) once it leads the
+    // session. Redirected from a file, it has none, as with TIOCSCTTY.
+    char tty[PATH_MAX];
+    int open_tty = 0;
+    if (req->new_session) {
+#ifndef POSIX_SPAWN_SETSID
+        errno = ENOSYS;
+        return -1;
+#endif
+        open_tty = req->stdin_fd >= 0 && ttyname_r(req->stdin_fd, tty, sizeof(tty)) == 0;
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+
+    int err = posix_spawn_file_actions_init(&actions);
+    if (err) {
+        errno = err;
+        return -1;
+    }
+    err = posix_spawnattr_init(&attr);
+    if (err) {
+        posix_spawn_file_actions_destroy(&actions);
+        errno = err;
+        return -1;
+    }
+
+    // Redirections become dup2 file actions on the already-open descriptors
+    int fds[3] = { req->stdin_fd, req->stdout_fd, req->stderr_fd };
+    for (int target = 0; target < 3 && !err; target++) {
+        if (target == 0 && open_tty) {
+            err = posix_spawn_file_actions_addopen(&actions, 0, tty, O_RDWR, 0);
+        } else if (fds[target] >= 0) {
+            err = posix_spawn_file_actions_adddup2(&actions, fds[target], target);
+        }
+    }
+
+    // Undo the shell's ignored/handled signals and any blocked mask
+    sigset_t defaults, mask;
+    signal_handler_get_child_defaults(&defaults);
+    sigemptyset(&mask);
+
+    short flags = POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK;
+    if (req->new_session) {
+#ifdef POSIX_SPAWN_SETSID
+        // Its process group becomes the terminal's foreground group
+        flags |= POSIX_SPAWN_SETSID;
+#endif
+    } else if (req->pgid >= 0) {
+        flags |= POSIX_SPAWN_SETPGROUP;
+        if (!err) err = posix_spawnattr_setpgroup(&attr, req->pgid);
+    }
+#ifdef POSIX_SPAWN_USEVFORK
+    // Older glibc only uses vfork semantics when asked to
+    flags |= POSIX_SPAWN_USEVFORK;
+#endif
+    if (!err) err = posix_spawnattr_setsigdefault(&attr, &defaults);
+    if (!err) err = posix_spawnattr_setsigmask(&attr, &mask);
+    if (!err) err = posix_spawnattr_setflags(&attr, flags);
+
+    pid_t pid = -1;
+    if (!err) {
+        err = posix_spawn(&pid, path, &actions, &attr, argv, environ);
+    }
+
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+
+    if (err) {
+        errno = err;
+        return -1;
+    }
+    return pid;
+}
+
+static pid_t spawn_with_fork(const char *path, char *const argv[], const SpawnRequest *req) {
+    // The child reports a failed exec through this pipe; it closes on success
+    int err_pipe[2];
+    if (spawn_pipe(err_pipe) == -1) return -1;
+
+    pid_t pid = fork();
+    if (pid == -1) {
+        int saved = errno;
+        close(err_pipe[0]);
+        close(err_pipe[1]);
+        errno = saved;
+        return -1;
+    }
+
+    if (pid == 0) {
+        close(err_pipe[0]);
+        if (req->new_session) {
+            setsid();
+        } else if (req->pgid >= 0) {
+            setpgid(0, req->pgid);
+        }
+
+        signal_handler_setup_child();
+        sigset_t mask;
+        sigemptyset(&mask);
+        sigprocmask(SIG_SETMASK, &mask, NULL);
+
+        int fds[3] = { req->stdin_fd, req->stdout_fd, req->stderr_fd };
+        for (int target = 0; target < 3; target++) {
+            if (fds[target] < 0) continue;
+            if (fds[target] == target) {
+                fcntl(target, F_SETFD, 0);   // dup2 onto itself won't clear close-on-exec
+            } else {
+                dup2(fds[target], target);
+            }
+        }
+        if (req->new_session) ioctl(0, TIOCSCTTY, 0);
+
+        execve(path, argv, environ);
+        int err = errno;
+        ssize_t ignored = write(err_pipe[1], &err, sizeof(err));
+        (void)ignored;
+        _exit(127);
+    }
+
+    close(err_pipe[1]);
+
+    // Set the group from the parent too, so it is in place before we hand it the terminal
+    // (not for a new session: setsid() fails for a process group leader)
+    if (req->pgid >= 0 && !req->new_session) {
+        setpgid(pid, req->pgid == 0 ? pid : req->pgid);
+    }
+
+    int child_err = 0;
+    ssize_t n;
+    do {
+        n = read(err_pipe[0], &child_err, sizeof(child_err));
+    } while (n == -1 && errno == EINTR);
+    close(err_pipe[0]);
+
+    if (n == (ssize_t)sizeof(child_err)) {
+        waitpid(pid, NULL, 0);
+        errno = child_err;
+        return -1;
+    }
+    return pid;
+}
+
+// Starts the already-resolved file with the current spawn mode
+static pid_t spawn_path(const char *path, char *const argv[], const SpawnRequest *req) {
+    if (g_spawn_mode == SPAWN_MODE_ZYGOTE) {
+        int fds[3] = { req->stdin_fd, req->stdout_fd, req->stderr_fd };
+        pid_t pid = zygote_spawn(path, argv, fds, req->pgid, req->new_session);
+        if (pid != -1 || zygote_is_running()) {
+            return pid;
+        }
+        g_spawn_mode = SPAWN_MODE_POSIX_SPAWN;
+    }
+
+    if (g_spawn_mode == SPAWN_MODE_FORK) {
+        return spawn_with_fork(path, argv, req);
+    }
+    pid_t pid = spawn_with_posix_spawn(path, argv, req);
+    // Without POSIX_SPAWN_SETSID, a new session needs TIOCSCTTY in a forked child
+    if (pid == -1 && req->new_session && errno == ENOSYS) {
+        return spawn_with_fork(path, argv, req);
+    }
+    return pid;
+}
+
+pid_t spawn_process(char *const argv[], const SpawnRequest *req) {
+    if (!argv || !argv[0] || !req) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    // execve() the hashed path directly instead of probing every PATH entry
+    char path[PATH_MAX];
+    if (path_cache_resolve(argv[0], path, sizeof(path)) == -1) {
+        errno = ENOENT;
+        return -1;
+    }
+
+    pid_t pid = spawn_path(path, argv, req);
+    if (pid == -1 && errno == ENOENT && !strchr(argv[0], '/')) {
+        // The binary moved since it was hashed; search PATH again
+        path_cache_forget(argv[0]);
+        if (path_cache_resolve(argv[0], path, sizeof(path)) == -1) {
+            errno = ENOENT;
+            return -1;
+        }
+        pid = spawn_path(path, argv, req);
+    }
+    return pid;
+}
+
+pid_t spawn_waitpid(pid_t pid, int *status, int options) {
+    // ECHILD from the zygote means it never started this pid
+    pid_t result = zygote_waitpid(pid, status, options);
+    if (result != -1 || errno != ECHILD) {
+        return result;
+    }
+    return waitpid(pid, status, options);
+}
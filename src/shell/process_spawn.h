@@ -0,0 +1,93 @@
+// src/shell/process_spawn.h
+#ifndef PROCESS_SPAWN_H
+#define PROCESS_SPAWN_H
+
+#include <sys/types.h>
+#include <stddef.h>
+
+// How child processes are created.
+// posix_spawn never copies the GUI's page tables (glibc uses
+// clone(CLONE_VM|CLONE_VFORK)), so its cost doesn't grow with scrollback.
+// That includes commands on a pty: POSIX_SPAWN_SETSID, then opening the
+// slave by name, makes it their controlling terminal.
+// SPAWN_MODE_ZYGOTE hands the request to the pre-forked helper (zygote.h),
+// which forks from a small address space regardless of how much the GUI holds.
+// fork + exec is kept for comparison in the benchmarks.
+typedef enum {
+    SPAWN_MODE_POSIX_SPAWN,
+    SPAWN_MODE_FORK,
+    SPAWN_MODE_ZYGOTE
+} SpawnMode;
+
+// Describes the child to start. All descriptors are dup2()'d onto 0/1/2 in
+// the child and stay open in the parent; open them close-on-exec.
+typedef struct {
+    int stdin_fd;     // Child's stdin, or -1 to inherit
+    int stdout_fd;    // Child's stdout, or -1 to inherit
+    int stderr_fd;    // Child's stderr, or -1 to inherit
+    pid_t pgid;       // 0 = new group led by the child, >0 = join that group, -1 = stay in ours
+    int new_session;  // Nonzero: lead a new session with stdin_fd (a pty slave) as its
+                      // controlling terminal; pgid is ignored
+} SpawnRequest;
+
+/**
+ * @brief Fill a request with "inherit everything, new process group"
+ */
+void spawn_request_init(SpawnRequest *req);
+
+/**
+ * @brief Start argv[0] as described by req
+ *
+ * argv[0] is resolved through the PATH hash table (path_cache.h) and the
+ * file is exec'd directly.
+ * Signals the shell ignores are reset to their defaults and the signal
+ * mask is cleared. Failures that happen before exec (e.g. command not
+ * found) are reported here rather than by the child.
+ *
+ * @param argv NULL-terminated argument vector
+ * @param req Descriptors and process group
+ * @return Child PID, or -1 with errno set
+ */
+pid_t spawn_process(char *const argv[], const SpawnRequest *req);
+
+/**
+ * @brief waitpid() for a process started with spawn_process
+ *
+ * Processes started by the zygote are not our children; their statuses
+ * come from the helper. Everything else goes to waitpid().
+ *
+ * @param pid Child PID, or -pgid for any process of that group
+ * @param status Receives the wait status
+ * @param options WNOHANG, WUNTRACED, WCONTINUED
+ * @return As waitpid()
+ */
+pid_t spawn_waitpid(pid_t pid, int *status, int options);
+
+/**
+ * @brief Format a spawn failure the way a shell reports it
+ * @param name Command name
+ * @param err errno from spawn_process
+ * @param buf Output buffer (receives e.g. "foo: command not found\n")
+ * @param size Size of buf
+ */
+void spawn_format_error(const char *name, int err, char *buf, size_t size);
+
+/**
+ * @brief Create a pipe whose ends are both close-on-exec
+ * @return 0 on success, -1 on failure
+ */
+int spawn_pipe(int fds[2]);
+
+/**
+ * @brief Select how processes are created (default: SPAWN_MODE_POSIX_SPAWN)
+ * SPAWN_MODE_ZYGOTE needs zygote_start() to have succeeded; if the helper
+ * dies, spawning falls back to SPAWN_MODE_POSIX_SPAWN.
+ */
+void spawn_set_mode(SpawnMode mode);
+
+/**
+ * @brief Get the current spawn mode
+ */
+SpawnMode spawn_get_mode(void);
+
+#endif // PROCESS_SPAWN_H
@@ -0,0 +1,67 @@
+// src/shell/pseudo_terminal.c
+#define _XOPEN_SOURCE 600   // posix_openpt(), grantpt(), unlockpt(), ptsname()
+#define _DEFAULT_SOURCE     // struct winsize, TIOCSWINSZ (glibc)
+#define _DARWIN_C_SOURCE    // The same on macOS
+#include "pseudo_terminal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+
+static struct winsize g_default_size = { 24, 80, 0, 0 };
+
+static struct winsize make_size(int cols, int rows, int width, int height) {
+    struct winsize ws;
+    ws.ws_col = cols > 0 ? cols : 1;
+    ws.ws_row = rows > 0 ? rows : 1;
+    ws.ws_xpixel = width > 0 ? width : 0;
+    ws.ws_ypixel = height > 0 ? height : 0;
+    return ws;
+}
+
+void pty_set_default_size(int cols, int rows, int width, int height) {
+    g_default_size = make_size(cols, rows, width, height);
+}
+
+int pty_open(int *master, int *slave) {
+    int m = posix_openpt(O_RDWR | O_NOCTTY);
+    if (m == -1) {
+        perror("posix_openpt");
+        return -1;
+    }
+    fcntl(m, F_SETFD, FD_CLOEXEC);
+
+    const char *name = NULL;
+    if (grantpt(m) == -1 || unlockpt(m) == -1 || !(name = ptsname(m))) {
+        perror("grantpt/unlockpt");
+        close(m);
+        return -1;
+    }
+
+    int s = open(name, O_RDWR | O_NOCTTY);
+    if (s == -1) {
+        perror("open pty slave");
+        close(m);
+        return -1;
+    }
+    fcntl(s, F_SETFD, FD_CLOEXEC);
+
+    struct termios t;
+    if (tcgetattr(s, &t) == 0) {
+        t.c_lflag &= ~(ECHO | ECHONL);
+        t.c_oflag &= ~ONLCR;
+        tcsetattr(s, TCSANOW, &t);
+    }
+    ioctl(m, TIOCSWINSZ, &g_default_size);
+
+    *master = m;
+    *slave = s;
+    return 0;
+}
+
+int pty_set_size(int master, int cols, int rows, int width, int height) {
+    struct winsize ws = make_size(cols, rows, width, height);
+    return ioctl(master, TIOCSWINSZ, &ws);
+}
@@ -0,0 +1,41 @@
+// src/shell/pseudo_terminal.h
+#ifndef PSEUDO_TERMINAL_H
+#define PSEUDO_TERMINAL_H
+
+// Pseudo-terminals for foreground commands.
+//
+// A command whose stdout is a terminal line-buffers its output and behaves
+// interactively (python, top, less), where with a pipe it would buffer
+// 4 KB at a time. The GUI keeps the master side; the child gets the slave
+// as stdin/stdout/stderr and as its controlling terminal.
+//
+// The slave starts with echo off, since the tab already echoes the lines it
+// sends, and without \n -> \r\n translation, since the tab buffer doesn't
+// interpret carriage returns.
+
+/**
+ * @brief Set the window size given to pseudo-terminals opened from now on
+ * @param cols Columns
+ * @param rows Rows
+ * @param width Width in pixels
+ * @param height Height in pixels
+ */
+void pty_set_default_size(int cols, int rows, int width, int height);
+
+/**
+ * @brief Open a pseudo-terminal pair with the default window size
+ * Both descriptors are close-on-exec.
+ * @param master Receives the master side (kept by the GUI)
+ * @param slave Receives the slave side (given to the child)
+ * @return 0 on success, -1 on failure
+ */
+int pty_open(int *master, int *slave);
+
+/**
+ * @brief Resize a pseudo-terminal; its foreground process group gets SIGWINCH
+ * @param master Master side
+ * @return 0 on success, -1 on failure
+ */
+int pty_set_size(int master, int cols, int rows, int width, int height);
+
+#endif // PSEUDO_TERMINAL_H
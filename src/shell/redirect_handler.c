@@ -5,6 +5,9 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <ctype.h> 
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
 
 void init_redirect_info(RedirectInfo *info) {
     info->count = 0;
@@ -49,4 +52,36 @@ void parse_redirections(char *cmd_str, RedirectInfo *info) {
             }
         }
     }
-}
\ No newline at end of file
+}
+
+int redirect_open_files(const RedirectInfo *info, int *in_fd, int *out_fd,
+                        char *errbuf, size_t errsize) {
+    *in_fd = -1;
+    *out_fd = -1;
+    if (!info) return 0;
+
+    for (int i = 0; i < info->count; ++i) {
+        const Redirect *r = &info->redirects[i];
+        int fd;
+        if (r->type == REDIRECT_INPUT) {
+            fd = open(r->filename, O_RDONLY | O_CLOEXEC);
+        } else if (r->type == REDIRECT_OUTPUT) {
+            fd = open(r->filename, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        } else {
+            continue;
+        }
+
+        if (fd == -1) {
+            if (errbuf) snprintf(errbuf, errsize, "%s: %s", r->filename, strerror(errno));
+            if (*in_fd != -1) close(*in_fd);
+            if (*out_fd != -1) close(*out_fd);
+            *in_fd = *out_fd = -1;
+            return -1;
+        }
+
+        int *slot = (r->type == REDIRECT_INPUT) ? in_fd : out_fd;
+        if (*slot != -1) close(*slot);
+        *slot = fd;
+    }
+    return 0;
+}
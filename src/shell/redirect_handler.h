@@ -3,6 +3,8 @@
 #ifndef REDIRECT_HANDLER_H
 #define REDIRECT_HANDLER_H
 
+#include <stddef.h>
+
 #define MAX_REDIRECTS 4
 
 // The project PDF only requires input redirection for Step 4
@@ -35,6 +37,20 @@ void init_redirect_info(RedirectInfo *info);
  */
 void parse_redirections(char *cmd_str, RedirectInfo *info);
 
+/**
+ * @brief Opens the files named by the redirections, in the parent.
+ * Later redirections of the same kind replace earlier ones, as in the shell.
+ * The returned descriptors are close-on-exec; the spawner dup2()s them.
+ * @param info Parsed redirections (may be NULL)
+ * @param in_fd Receives the input file fd, or -1 if there is no '<'
+ * @param out_fd Receives the output file fd, or -1 if there is no '>'
+ * @param errbuf Receives "file: reason" when a file can't be opened
+ * @param errsize Size of errbuf
+ * @return 0 on success, -1 on failure (no descriptors are left open)
+ */
+int redirect_open_files(const RedirectInfo *info, int *in_fd, int *out_fd,
+                        char *errbuf, size_t errsize);
+
 /**
  * @brief Frees memory allocated by the redirection parser.
  */
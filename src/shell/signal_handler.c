@@ -6,19 +6,36 @@
 #include <termios.h>
 #include <errno.h>
 #include <string.h>
+#include <fcntl.h>
 
 // Global variable to store the shell's process group ID
 static pid_t shell_pgid = 0;
 static int shell_terminal = -1;
 static struct termios shell_tmodes;
 
+// Self-pipe written by the SIGCHLD handler so waiters can block in poll()
+static int sigchld_pipe[2] = {-1, -1};
+
 /**
  * SIGCHLD handler - DO NOT reap processes here
- * Let the main code handle waitpid() to avoid race conditions
+ * Let the main code handle waitpid() to avoid race conditions.
+ * It only pokes the self-pipe so anything polling on it wakes up.
  */
 static void sigchld_handler(int sig) {
-    // DO NOTHING - just interrupt system calls
-    // The main event loop will handle process cleanup
+    (void)sig;
+    int saved_errno = errno;
+    if (sigchld_pipe[1] != -1) {
+        // Non-blocking: if the pipe is full a wakeup is already pending
+        ssize_t ignored = write(sigchld_pipe[1], "c", 1);
+        (void)ignored;
+    }
+    errno = saved_errno;
+}
+
+static int set_nonblock_cloexec(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1) return -1;
+    return fcntl(fd, F_SETFD, FD_CLOEXEC);
 }
 
 int signal_handler_init(void) {
@@ -41,7 +58,16 @@ int signal_handler_init(void) {
     // Terminal control will be taken only when needed for child processes
     fprintf(stderr, "[DEBUG] GUI shell created with PGID=%d, not taking terminal control yet\n", shell_pgid);
     
-    // Set up SIGCHLD handler - just interrupt, don't reap
+    // Wakeup pipe for SIGCHLD (must exist before the handler is installed)
+    if (pipe(sigchld_pipe) == -1) {
+        perror("pipe SIGCHLD");
+        sigchld_pipe[0] = sigchld_pipe[1] = -1;
+    } else if (set_nonblock_cloexec(sigchld_pipe[0]) == -1 ||
+               set_nonblock_cloexec(sigchld_pipe[1]) == -1) {
+        perror("fcntl SIGCHLD pipe");
+    }
+    
+    // Set up SIGCHLD handler - just wake waiters, don't reap
     struct sigaction sa_chld;
     sa_chld.sa_handler = sigchld_handler;
     sigemptyset(&sa_chld.sa_mask);
@@ -75,14 +101,25 @@ int signal_handler_init(void) {
     return 0;
 }
 
+void signal_handler_get_child_defaults(sigset_t *set) {
+    sigemptyset(set);
+    sigaddset(set, SIGINT);
+    sigaddset(set, SIGTSTP);
+    sigaddset(set, SIGTTOU);
+    sigaddset(set, SIGTTIN);
+    sigaddset(set, SIGCHLD);
+    sigaddset(set, SIGQUIT);
+}
+
 void signal_handler_setup_child(void) {
     // Restore default signal handlers in child processes
-    signal(SIGINT, SIG_DFL);
-    signal(SIGTSTP, SIG_DFL);
-    signal(SIGTTOU, SIG_DFL);
-    signal(SIGTTIN, SIG_DFL);
-    signal(SIGCHLD, SIG_DFL);
-    signal(SIGQUIT, SIG_DFL);
+    sigset_t defaults;
+    signal_handler_get_child_defaults(&defaults);
+    for (int sig = 1; sig < NSIG; sig++) {
+        if (sigismember(&defaults, sig) == 1) {
+            signal(sig, SIG_DFL);
+        }
+    }
 }
 
 int signal_handler_give_terminal_to(pid_t pgid) {
@@ -137,6 +174,19 @@ int signal_handler_take_terminal_back(void) {
     return 0;
 }
 
+int signal_handler_get_sigchld_fd(void) {
+    return sigchld_pipe[0];
+}
+
+void signal_handler_drain_sigchld(void) {
+    if (sigchld_pipe[0] == -1) return;
+    
+    char buf[64];
+    while (read(sigchld_pipe[0], buf, sizeof(buf)) > 0) {
+        // Discard - the bytes only mean "some child changed state"
+    }
+}
+
 pid_t signal_handler_get_shell_pgid(void) {
     return shell_pgid;
 }
@@ -25,6 +25,16 @@ int signal_handler_init(void);
  */
 void signal_handler_setup_child(void);
 
+/**
+ * @brief Get the signals a child must have reset to SIG_DFL
+ * 
+ * These are the signals the shell ignores or handles. Used with
+ * posix_spawnattr_setsigdefault() when the child is not forked by hand.
+ * 
+ * @param set Filled with the signals
+ */
+void signal_handler_get_child_defaults(sigset_t *set);
+
 /**
  * @brief Enable signal delivery for foreground process group
  * 
@@ -45,6 +55,24 @@ int signal_handler_give_terminal_to(pid_t pgid);
  */
 int signal_handler_take_terminal_back(void);
 
+/**
+ * @brief Get the read end of the SIGCHLD wakeup pipe
+ * 
+ * The SIGCHLD handler writes a byte here every time a child exits, stops
+ * or continues, so it can be polled alongside other descriptors.
+ * 
+ * @return File descriptor, or -1 if the pipe could not be created
+ */
+int signal_handler_get_sigchld_fd(void);
+
+/**
+ * @brief Empty the SIGCHLD wakeup pipe
+ * 
+ * Call this BEFORE checking children with waitpid(), so a child that changes
+ * state afterwards always leaves a fresh byte behind to wake the next poll().
+ */
+void signal_handler_drain_sigchld(void);
+
 /**
  * @brief Get the shell's process group ID
  * 
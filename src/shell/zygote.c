@@ -0,0 +1,650 @@
+// src/shell/zygote.c
+#define _GNU_SOURCE   // SOCK_CLOEXEC
+#include "zygote.h"
+#include "signal_handler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <stdint.h>
+#include <limits.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#include <sys/ioctl.h>
+
+extern char **environ;
+
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SEND_FLAGS 0    // SO_NOSIGPIPE is set on the socket instead (macOS)
+#endif
+
+#define ZYGOTE_MSG_SPAWNED 1
+#define ZYGOTE_MSG_STATUS  2
+
+// Exit status reported for children whose helper died before reporting them
+#define ZYGOTE_LOST_STATUS (255 << 8)
+
+// GUI -> helper. Sent with the child's descriptors attached (SCM_RIGHTS),
+// followed by payload_len bytes: cwd, the file to execute, argv[0..argc) and
+// envp[0..envc), each NUL-terminated.
+typedef struct {
+    int32_t argc;
+    int32_t envc;
+    int32_t pgid;
+    int32_t new_session;   // setsid() and take stdin as the controlling terminal
+    int32_t fd_mask;       // Bit i set: a descriptor for the child's fd i is attached
+    uint32_t payload_len;
+} ZygoteRequest;
+
+// Helper -> GUI
+typedef struct {
+    int32_t type;    // ZYGOTE_MSG_*
+    int32_t pid;     // -1 for a failed spawn
+    int32_t value;   // errno for a failed spawn, wait status for ZYGOTE_MSG_STATUS
+} ZygoteMessage;
+
+typedef struct {
+    pid_t pid;
+    pid_t pgid;   // 0 if it stayed in the helper's group
+} ZygoteChild;
+
+typedef struct {
+    pid_t pid;
+    pid_t pgid;
+    int status;
+} ZygoteStatus;
+
+static int g_sock = -1;
+static pid_t g_zygote_pid = -1;
+
+// Children the helper started that haven't exited yet
+static ZygoteChild *g_children = NULL;
+static int g_num_children = 0;
+static int g_children_capacity = 0;
+
+// Statuses reported by the helper but not collected yet, oldest first
+static ZygoteStatus *g_statuses = NULL;
+static int g_num_statuses = 0;
+static int g_statuses_capacity = 0;
+
+// ============================================================================
+//  Socket helpers (used on both sides)
+// ============================================================================
+
+static int send_all(int fd, const void *buf, size_t len) {
+    const char *p = buf;
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, SEND_FLAGS);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static int recv_all(int fd, void *buf, size_t len) {
+    char *p = buf;
+    while (len > 0) {
+        ssize_t n = recv(fd, p, len, 0);
+        if (n == 0) {
+            errno = EPIPE;
+            return -1;
+        }
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static void set_nosigpipe(int fd) {
+#ifdef SO_NOSIGPIPE
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#else
+    (void)fd;
+#endif
+}
+
+// ============================================================================
+//  Helper process
+// ============================================================================
+
+static int g_helper_child_pipe[2] = {-1, -1};
+
+static void helper_sigchld(int sig) {
+    (void)sig;
+    int saved_errno = errno;
+    ssize_t ignored = write(g_helper_child_pipe[1], "c", 1);
+    (void)ignored;
+    errno = saved_errno;
+}
+
+static void helper_report_children(int sock) {
+    int status;
+    pid_t pid;
+    while ((pid = waitpid(-1, &status, WNOHANG | WUNTRACED | WCONTINUED)) > 0) {
+        ZygoteMessage msg = { ZYGOTE_MSG_STATUS, pid, status };
+        send_all(sock, &msg, sizeof(msg));
+    }
+}
+
+// Splits the payload into cwd, path, argv and envp. Returns 0 if it is well formed.
+static int helper_parse_payload(char *payload, uint32_t len, const ZygoteRequest *req,
+                                char **cwd, char **path, char **argv, char **envp) {
+    char *p = payload;
+    char *end = payload + len;
+    int total = 2 + req->argc + req->envc;
+
+    for (int i = 0; i < total; i++) {
+        char *nul = memchr(p, '\0', end - p);
+        if (!nul) return -1;
+        if (i == 0) {
+            *cwd = p;
+        } else if (i == 1) {
+            *path = p;
+        } else if (i < 2 + req->argc) {
+            argv[i - 2] = p;
+        } else {
+            envp[i - 2 - req->argc] = p;
+        }
+        p = nul + 1;
+    }
+    argv[req->argc] = NULL;
+    envp[req->envc] = NULL;
+    return 0;
+}
+
+// Forks and execs one request. Returns the pid, or -1 with errno set.
+static pid_t helper_spawn(const ZygoteRequest *req, const int fds[3], const char *cwd,
+                          const char *path, char **argv, char **envp, int sock) {
+    int err_pipe[2];
+    if (pipe(err_pipe) == -1) return -1;
+    fcntl(err_pipe[0], F_SETFD, FD_CLOEXEC);
+    fcntl(err_pipe[1], F_SETFD, FD_CLOEXEC);
+
+    pid_t pid = fork();
+    if (pid == -1) {
+        int saved = errno;
+        close(err_pipe[0]);
+        close(err_pipe[1]);
+        errno = saved;
+        return -1;
+    }
+
+    if (pid == 0) {
+        close(err_pipe[0]);
+        close(sock);
+        close(g_helper_child_pipe[0]);
+        close(g_helper_child_pipe[1]);
+
+        if (req->new_session) {
+            setsid();
+        } else if (req->pgid >= 0) {
+            setpgid(0, req->pgid);
+        }
+
+        signal_handler_setup_child();
+        sigset_t mask;
+        sigemptyset(&mask);
+        sigprocmask(SIG_SETMASK, &mask, NULL);
+
+        for (int target = 0; target < 3; target++) {
+            if (fds[target] < 0) continue;
+            if (fds[target] == target) {
+                fcntl(target, F_SETFD, 0);
+            } else {
+                dup2(fds[target], target);
+            }
+        }
+        if (req->new_session) ioctl(0, TIOCSCTTY, 0);
+
+        if (chdir(cwd) == 0) {
+            execve(path, argv, envp);
+        }
+        int err = errno;
+        ssize_t ignored = write(err_pipe[1], &err, sizeof(err));
+        (void)ignored;
+        _exit(127);
+    }
+
+    close(err_pipe[1]);
+    // A session leader can't be moved, and setsid() fails for a group leader
+    if (req->pgid >= 0 && !req->new_session) {
+        setpgid(pid, req->pgid == 0 ? pid : req->pgid);
+    }
+
+    int child_err = 0;
+    ssize_t n;
+    do {
+        n = read(err_pipe[0], &child_err, sizeof(child_err));
+    } while (n == -1 && errno == EINTR);
+    close(err_pipe[0]);
+
+    if (n == (ssize_t)sizeof(child_err)) {
+        // Reap it here so it is never reported as a status
+        waitpid(pid, NULL, 0);
+        errno = child_err;
+        return -1;
+    }
+    return pid;
+}
+
+// Serves one request. Returns -1 once the GUI has gone away.
+static int helper_handle_request(int sock) {
+    ZygoteRequest req;
+    int received[3];
+    int num_received = 0;
+
+    char control[CMSG_SPACE(3 * sizeof(int))];
+    struct iovec iov = { &req, sizeof(req) };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t n;
+    do {
+        n = recvmsg(sock, &msg, 0);
+    } while (n == -1 && errno == EINTR);
+    if (n <= 0) return -1;
+
+    for (struct cmsghdr *c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+        if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_RIGHTS) continue;
+        int count = (c->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        for (int i = 0; i < count && num_received < 3; i++) {
+            memcpy(&received[num_received], CMSG_DATA(c) + i * sizeof(int), sizeof(int));
+            // Only the dup2()'d copies may survive exec
+            fcntl(received[num_received++], F_SETFD, FD_CLOEXEC);
+        }
+    }
+
+    int result = 0;
+    char *payload = NULL;
+    char **argv = NULL;
+    char **envp = NULL;
+
+    if ((size_t)n < sizeof(req) && recv_all(sock, (char *)&req + n, sizeof(req) - n) == -1) {
+        result = -1;
+        goto out;
+    }
+
+    // Descriptors arrive in order of the targets they are meant for
+    int fds[3] = {-1, -1, -1};
+    for (int target = 0, next = 0; target < 3; target++) {
+        if ((req.fd_mask & (1 << target)) && next < num_received) {
+            fds[target] = received[next++];
+        }
+    }
+
+    payload = malloc(req.payload_len + 1);
+    argv = calloc(req.argc + 1, sizeof(char *));
+    envp = calloc(req.envc + 1, sizeof(char *));
+    if (!payload || !argv || !envp) {
+        result = -1;
+        goto out;
+    }
+    if (recv_all(sock, payload, req.payload_len) == -1) {
+        result = -1;
+        goto out;
+    }
+    payload[req.payload_len] = '\0';
+
+    ZygoteMessage reply = { ZYGOTE_MSG_SPAWNED, -1, EINVAL };
+    char *cwd = NULL;
+    char *path = NULL;
+    if (req.argc > 0 &&
+        helper_parse_payload(payload, req.payload_len, &req, &cwd, &path, argv, envp) == 0) {
+        pid_t pid = helper_spawn(&req, fds, cwd, path, argv, envp, sock);
+        reply.pid = pid;
+        reply.value = (pid == -1) ? errno : 0;
+    }
+    if (send_all(sock, &reply, sizeof(reply)) == -1) result = -1;
+
+out:
+    for (int i = 0; i < num_received; i++) close(received[i]);
+    free(payload);
+    free(argv);
+    free(envp);
+    return result;
+}
+
+static void zygote_main(int sock) {
+    if (pipe(g_helper_child_pipe) == -1) _exit(1);
+    for (int i = 0; i < 2; i++) {
+        fcntl(g_helper_child_pipe[i], F_SETFL, O_NONBLOCK);
+        fcntl(g_helper_child_pipe[i], F_SETFD, FD_CLOEXEC);
+    }
+
+    // Report stops and continues too, so job control works for the GUI
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = helper_sigchld;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;
+    sigaction(SIGCHLD, &sa, NULL);
+
+    for (;;) {
+        struct pollfd pfds[2] = {
+            { sock, POLLIN, 0 },
+            { g_helper_child_pipe[0], POLLIN, 0 }
+        };
+        if (poll(pfds, 2, -1) == -1) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        if (pfds[1].revents & POLLIN) {
+            char buf[64];
+            while (read(g_helper_child_pipe[0], buf, sizeof(buf)) > 0) {
+            }
+            helper_report_children(sock);
+        }
+
+        if (pfds[0].revents & (POLLIN | POLLHUP | POLLERR)) {
+            if (helper_handle_request(sock) == -1) break;
+        }
+    }
+    _exit(0);
+}
+
+// ============================================================================
+//  GUI side
+// ============================================================================
+
+// pid > 0 selects that process, pid < -1 every process in group -pid (as for waitpid)
+static int pid_matches(pid_t pid, pid_t child_pid, pid_t child_pgid) {
+    return pid > 0 ? child_pid == pid : child_pgid == -pid;
+}
+
+static int find_child(pid_t pid) {
+    for (int i = 0; i < g_num_children; i++) {
+        if (pid_matches(pid, g_children[i].pid, g_children[i].pgid)) return i;
+    }
+    return -1;
+}
+
+static void track_child(pid_t pid, pid_t pgid) {
+    if (g_num_children == g_children_capacity) {
+        int capacity = g_children_capacity ? g_children_capacity * 2 : 16;
+        ZygoteChild *children = realloc(g_children, capacity * sizeof(ZygoteChild));
+        if (!children) return;
+        g_children = children;
+        g_children_capacity = capacity;
+    }
+    g_children[g_num_children].pid = pid;
+    g_children[g_num_children].pgid = pgid;
+    g_num_children++;
+}
+
+static void store_status(pid_t pid, int status) {
+    if (g_num_statuses == g_statuses_capacity) {
+        int capacity = g_statuses_capacity ? g_statuses_capacity * 2 : 16;
+        ZygoteStatus *statuses = realloc(g_statuses, capacity * sizeof(ZygoteStatus));
+        if (!statuses) return;
+        g_statuses = statuses;
+        g_statuses_capacity = capacity;
+    }
+    int idx = find_child(pid);
+    g_statuses[g_num_statuses].pid = pid;
+    g_statuses[g_num_statuses].pgid = (idx != -1) ? g_children[idx].pgid : 0;
+    g_statuses[g_num_statuses].status = status;
+    g_num_statuses++;
+
+    // An exited child is no longer running; its status stays until collected
+    if (idx != -1 && !WIFSTOPPED(status) && !WIFCONTINUED(status)) {
+        g_children[idx] = g_children[--g_num_children];
+    }
+}
+
+// The helper died: report its children as exited so nobody waits forever
+static void zygote_lost(void) {
+    printf("[ZYGOTE] Spawner helper is gone, spawning locally from now on\n");
+    fflush(stdout);
+
+    if (g_sock != -1) close(g_sock);
+    g_sock = -1;
+    if (g_zygote_pid > 0) waitpid(g_zygote_pid, NULL, WNOHANG);
+    g_zygote_pid = -1;
+
+    while (g_num_children > 0) {
+        store_status(g_children[0].pid, ZYGOTE_LOST_STATUS);
+    }
+}
+
+// Reads and files one message. Returns 1 if a message was read, 0 if none
+// was ready (non-blocking), -1 if the helper is gone.
+static int zygote_read_message(ZygoteMessage *msg, int block) {
+    if (g_sock == -1) return -1;
+
+    if (!block) {
+        struct pollfd pfd = { g_sock, POLLIN, 0 };
+        int ready;
+        do {
+            ready = poll(&pfd, 1, 0);
+        } while (ready == -1 && errno == EINTR);
+        if (ready <= 0) return 0;
+    }
+
+    if (recv_all(g_sock, msg, sizeof(*msg)) == -1) {
+        zygote_lost();
+        return -1;
+    }
+    if (msg->type == ZYGOTE_MSG_STATUS) {
+        store_status(msg->pid, msg->value);
+    }
+    return 1;
+}
+
+int zygote_start(void) {
+    if (g_sock != -1) return 0;
+
+    int sv[2];
+#ifdef SOCK_CLOEXEC
+    int rc = socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv);
+#else
+    int rc = socketpair(AF_UNIX, SOCK_STREAM, 0, sv);
+#endif
+    if (rc == -1) {
+        perror("socketpair");
+        return -1;
+    }
+
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("fork");
+        close(sv[0]);
+        close(sv[1]);
+        return -1;
+    }
+
+    if (pid == 0) {
+        close(sv[0]);
+        set_nosigpipe(sv[1]);
+        zygote_main(sv[1]);
+    }
+
+    close(sv[1]);
+    fcntl(sv[0], F_SETFD, FD_CLOEXEC);
+    set_nosigpipe(sv[0]);
+    g_sock = sv[0];
+    g_zygote_pid = pid;
+
+    printf("[ZYGOTE] Spawner helper started (PID=%d)\n", pid);
+    fflush(stdout);
+    return 0;
+}
+
+void zygote_stop(void) {
+    if (g_sock == -1) return;
+    close(g_sock);
+    g_sock = -1;
+    if (g_zygote_pid > 0) waitpid(g_zygote_pid, NULL, 0);
+    g_zygote_pid = -1;
+
+    free(g_children);
+    free(g_statuses);
+    g_children = NULL;
+    g_statuses = NULL;
+    g_num_children = g_children_capacity = 0;
+    g_num_statuses = g_statuses_capacity = 0;
+}
+
+int zygote_is_running(void) {
+    return g_sock != -1;
+}
+
+int zygote_get_fd(void) {
+    return g_sock;
+}
+
+pid_t zygote_spawn(const char *path, char *const argv[], const int fds[3], pid_t pgid,
+                   int new_session) {
+    if (g_sock == -1) {
+        errno = EPIPE;
+        return -1;
+    }
+
+    char cwd[PATH_MAX];
+    if (!getcwd(cwd, sizeof(cwd))) strcpy(cwd, "/");
+
+    int argc = 0, envc = 0;
+    size_t len = strlen(cwd) + 1 + strlen(path) + 1;
+    for (; argv[argc]; argc++) len += strlen(argv[argc]) + 1;
+    for (; environ && environ[envc]; envc++) len += strlen(environ[envc]) + 1;
+
+    char *payload = malloc(len);
+    if (!payload) return -1;
+    char *p = payload;
+    size_t n = strlen(cwd) + 1;
+    memcpy(p, cwd, n);
+    p += n;
+    n = strlen(path) + 1;
+    memcpy(p, path, n);
+    p += n;
+    for (int i = 0; i < argc; i++) {
+        n = strlen(argv[i]) + 1;
+        memcpy(p, argv[i], n);
+        p += n;
+    }
+    for (int i = 0; i < envc; i++) {
+        n = strlen(environ[i]) + 1;
+        memcpy(p, environ[i], n);
+        p += n;
+    }
+
+    ZygoteRequest req = { argc, envc, pgid, new_session, 0, (uint32_t)len };
+    int attached[3];
+    int num_attached = 0;
+    for (int target = 0; target < 3; target++) {
+        if (fds[target] >= 0) {
+            req.fd_mask |= 1 << target;
+            attached[num_attached++] = fds[target];
+        }
+    }
+
+    char control[CMSG_SPACE(3 * sizeof(int))];
+    memset(control, 0, sizeof(control));
+    struct iovec iov = { &req, sizeof(req) };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    if (num_attached > 0) {
+        msg.msg_control = control;
+        msg.msg_controllen = CMSG_SPACE(num_attached * sizeof(int));
+        struct cmsghdr *c = CMSG_FIRSTHDR(&msg);
+        c->cmsg_level = SOL_SOCKET;
+        c->cmsg_type = SCM_RIGHTS;
+        c->cmsg_len = CMSG_LEN(num_attached * sizeof(int));
+        memcpy(CMSG_DATA(c), attached, num_attached * sizeof(int));
+    }
+
+    ssize_t sent;
+    do {
+        sent = sendmsg(g_sock, &msg, SEND_FLAGS);
+    } while (sent == -1 && errno == EINTR);
+
+    int failed = (sent == -1) ||
+                 ((size_t)sent < sizeof(req) &&
+                  send_all(g_sock, (char *)&req + sent, sizeof(req) - sent) == -1) ||
+                 send_all(g_sock, payload, len) == -1;
+    free(payload);
+    if (failed) {
+        zygote_lost();
+        errno = EPIPE;
+        return -1;
+    }
+
+    // Status reports for earlier children may arrive ahead of the reply
+    ZygoteMessage reply;
+    do {
+        if (zygote_read_message(&reply, 1) == -1) {
+            errno = EPIPE;
+            return -1;
+        }
+    } while (reply.type != ZYGOTE_MSG_SPAWNED);
+
+    if (reply.pid == -1) {
+        errno = reply.value;
+        return -1;
+    }
+    // Remember the group so the child can be waited for as part of it
+    pid_t child_pgid = (new_session || pgid == 0) ? reply.pid : (pgid > 0 ? pgid : 0);
+    track_child(reply.pid, child_pgid);
+    return reply.pid;
+}
+
+void zygote_drain(void) {
+    ZygoteMessage msg;
+    while (zygote_read_message(&msg, 0) == 1) {
+    }
+}
+
+pid_t zygote_waitpid(pid_t pid, int *status, int options) {
+    for (;;) {
+        zygote_drain();
+
+        for (int i = 0; i < g_num_statuses; i++) {
+            if (!pid_matches(pid, g_statuses[i].pid, g_statuses[i].pgid)) continue;
+
+            pid_t child = g_statuses[i].pid;
+            int st = g_statuses[i].status;
+            memmove(&g_statuses[i], &g_statuses[i + 1],
+                    (g_num_statuses - i - 1) * sizeof(ZygoteStatus));
+            g_num_statuses--;
+            i--;
+
+            // Like waitpid(), stops and continues are only reported when asked for
+            if (WIFSTOPPED(st) && !(options & WUNTRACED)) continue;
+            if (WIFCONTINUED(st) && !(options & WCONTINUED)) continue;
+
+            if (status) *status = st;
+            return child;
+        }
+
+        if (find_child(pid) == -1) {
+            errno = ECHILD;
+            return -1;
+        }
+        if (options & WNOHANG) return 0;
+
+        ZygoteMessage msg;
+        zygote_read_message(&msg, 1);
+    }
+}
@@ -0,0 +1,69 @@
+// src/shell/zygote.h
+#ifndef ZYGOTE_H
+#define ZYGOTE_H
+
+#include <sys/types.h>
+
+// Pre-forked spawner process.
+//
+// zygote_start() forks a small helper before the GUI allocates its tab
+// buffers and history. Spawn requests (argv, environment, cwd, process
+// group, and the stdin/stdout/stderr descriptors via SCM_RIGHTS) are sent
+// to it over a Unix socket; it forks and execs from its own small address
+// space and reports the child's pid, then every wait status (exit, stop,
+// continue) of that child. Children of the helper are not our children,
+// so their status must be collected with zygote_take_status() instead of
+// waitpid().
+
+/**
+ * @brief Fork the helper. Call early, before large allocations.
+ * @return 0 on success, -1 on failure
+ */
+int zygote_start(void);
+
+/**
+ * @brief Shut the helper down (it exits when the socket closes)
+ */
+void zygote_stop(void);
+
+/**
+ * @brief Check whether the helper is running
+ */
+int zygote_is_running(void);
+
+/**
+ * @brief Socket that becomes readable when the helper reports a status
+ * @return Descriptor, or -1 if the helper isn't running
+ */
+int zygote_get_fd(void);
+
+/**
+ * @brief Ask the helper to start a process
+ * @param path File to execute (relative paths are relative to our cwd)
+ * @param argv NULL-terminated argument vector
+ * @param fds Descriptors for the child's stdin/stdout/stderr (-1 = inherit the helper's)
+ * @param pgid 0 = new group led by the child, >0 = join that group, -1 = helper's group
+ * @param new_session Nonzero: start a new session instead (pgid is ignored)
+ * with fds[0] as its controlling terminal
+ * @return Child PID, or -1 with errno set (EPIPE if the helper is gone)
+ */
+pid_t zygote_spawn(const char *path, char *const argv[], const int fds[3], pid_t pgid,
+                   int new_session);
+
+/**
+ * @brief Read every status report the helper has sent so far (non-blocking)
+ */
+void zygote_drain(void);
+
+/**
+ * @brief waitpid() for a child of the helper
+ * @param pid Child PID, or -pgid for any child in that process group
+ * @param status Receives the wait status
+ * @param options WNOHANG, WUNTRACED and WCONTINUED as for waitpid()
+ * @return PID of the child whose status was reported, 0 if WNOHANG and
+ * nothing is pending, -1 with errno ECHILD if no such child of the helper
+ * is left
+ */
+pid_t zygote_waitpid(pid_t pid, int *status, int options);
+
+#endif // ZYGOTE_H
@@ -0,0 +1,119 @@
+// src/utils/byte_scan.c
+#include "byte_scan.h"
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BYTE_SCAN_X86 1
+#endif
+
+static int is_control(unsigned char c) {
+    return c < 0x20 || c == 0x7f;
+}
+
+static size_t scan_scalar(const char *text, size_t len) {
+    const unsigned char *p = (const unsigned char *)text;
+    size_t i = 0;
+    while (i < len && !is_control(p[i])) i++;
+    return i;
+}
+
+#ifdef BYTE_SCAN_X86
+
+// A byte is a control if min(byte, 0x1F) == byte (unsigned) or byte == 0x7F
+__attribute__((target("sse2")))
+static size_t scan_sse2(const char *text, size_t len) {
+    const __m128i c0_max = _mm_set1_epi8(0x1f);
+    const __m128i del = _mm_set1_epi8(0x7f);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(text + i));
+        __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(_mm_min_epu8(v, c0_max), v),
+                                   _mm_cmpeq_epi8(v, del));
+        unsigned mask = (unsigned)_mm_movemask_epi8(hit);
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    return i + scan_scalar(text + i, len - i);
+}
+
+__attribute__((target("avx2")))
+static size_t scan_avx2(const char *text, size_t len) {
+    const __m256i c0_max = _mm256_set1_epi8(0x1f);
+    const __m256i del = _mm256_set1_epi8(0x7f);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(text + i));
+        __m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_min_epu8(v, c0_max), v),
+                                      _mm256_cmpeq_epi8(v, del));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(hit);
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    // The tail with 16-byte vectors here too: calling the SSE2 version
+    // would switch between VEX and legacy encodings, which stalls
+    const __m128i c0_max16 = _mm_set1_epi8(0x1f);
+    const __m128i del16 = _mm_set1_epi8(0x7f);
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(text + i));
+        __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(_mm_min_epu8(v, c0_max16), v),
+                                   _mm_cmpeq_epi8(v, del16));
+        unsigned mask = (unsigned)_mm_movemask_epi8(hit);
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    return i + scan_scalar(text + i, len - i);
+}
+
+#endif
+
+typedef struct {
+    const char *name;
+    size_t (*scan)(const char *text, size_t len);
+} ByteScanner;
+
+static const ByteScanner g_scanners[] = {
+#ifdef BYTE_SCAN_X86
+    { "avx2", scan_avx2 },
+    { "sse2", scan_sse2 },
+#endif
+    { "scalar", scan_scalar },
+};
+
+#define NUM_SCANNERS (sizeof(g_scanners) / sizeof(g_scanners[0]))
+
+static const ByteScanner *g_scanner = NULL;
+
+static int cpu_has(const char *name) {
+#ifdef BYTE_SCAN_X86
+    if (strcmp(name, "avx2") == 0) return __builtin_cpu_supports("avx2");
+    if (strcmp(name, "sse2") == 0) return __builtin_cpu_supports("sse2");
+#endif
+    return strcmp(name, "scalar") == 0;
+}
+
+// The first (fastest) one the CPU runs
+static const ByteScanner* pick(void) {
+    for (size_t i = 0; i < NUM_SCANNERS; i++) {
+        if (cpu_has(g_scanners[i].name)) return &g_scanners[i];
+    }
+    return &g_scanners[NUM_SCANNERS - 1];
+}
+
+size_t byte_scan_text(const char *text, size_t len) {
+    // Only ever set to the same value, so racing threads are harmless
+    if (!g_scanner) g_scanner = pick();
+    return g_scanner->scan(text, len);
+}
+
+const char* byte_scan_implementation(void) {
+    if (!g_scanner) g_scanner = pick();
+    return g_scanner->name;
+}
+
+int byte_scan_select(const char *name) {
+    for (size_t i = 0; i < NUM_SCANNERS; i++) {
+        if (strcmp(g_scanners[i].name, name) == 0 && cpu_has(name)) {
+            g_scanner = &g_scanners[i];
+            return 0;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,33 @@
+// src/utils/byte_scan.h
+#ifndef BYTE_SCAN_H
+#define BYTE_SCAN_H
+
+#include <stddef.h>
+
+// Finds the end of a run of printable text: the first C0 control byte
+// (0x00-0x1F: newline, CR, tab, ESC...) or DEL. Bytes 0x80-0xFF are UTF-8
+// text and don't stop the run. On x86-64 this looks at 32 bytes at a time
+// with AVX2 or 16 with SSE2, whichever the CPU has, decided on first use;
+// elsewhere a byte at a time.
+
+/**
+ * @brief Length of the run of printable bytes at the start of text
+ * @param text Bytes (not NUL-terminated)
+ * @param len Their number
+ * @return Index of the first control byte, or len if there is none
+ */
+size_t byte_scan_text(const char *text, size_t len);
+
+/**
+ * @brief Name of the implementation in use: "avx2", "sse2" or "scalar"
+ */
+const char* byte_scan_implementation(void);
+
+/**
+ * @brief Use a particular implementation (for benchmarks)
+ * @param name "avx2", "sse2" or "scalar"
+ * @return 0 on success, -1 if this CPU or build doesn't have it
+ */
+int byte_scan_select(const char *name);
+
+#endif // BYTE_SCAN_H
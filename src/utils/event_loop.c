@@ -0,0 +1,395 @@
+// src/utils/event_loop.c
+#include "event_loop.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#define EVENT_LOOP_USE_EPOLL 1
+#endif
+
+#define MAX_EVENTS_PER_WAKE 64
+
+typedef struct {
+    int fd;                    // -1 once removed
+    int events;
+    EventFdCallback callback;
+    void *user_data;
+} EventSource;
+
+typedef struct {
+    int in_use;
+    int armed;
+    EventTimerCallback callback;
+    void *user_data;
+    int interval_ms;           // 0 for one-shot
+#ifdef EVENT_LOOP_USE_EPOLL
+    int fd;                    // timerfd
+#else
+    long long deadline_ms;
+#endif
+} EventTimer;
+
+struct EventLoop {
+    EventSource **sources;
+    int num_sources;
+    int capacity;
+
+    // Sources removed while dispatching are freed once the batch is done
+    EventSource **dead;
+    int num_dead;
+    int dead_capacity;
+
+    EventTimer timers[MAX_EVENT_TIMERS];
+
+#ifdef EVENT_LOOP_USE_EPOLL
+    int epoll_fd;
+#endif
+};
+
+static int find_source(EventLoop *loop, int fd) {
+    for (int i = 0; i < loop->num_sources; i++) {
+        if (loop->sources[i]->fd == fd) return i;
+    }
+    return -1;
+}
+
+static void free_dead_sources(EventLoop *loop) {
+    for (int i = 0; i < loop->num_dead; i++) {
+        free(loop->dead[i]);
+    }
+    loop->num_dead = 0;
+}
+
+EventLoop* event_loop_create(void) {
+    EventLoop *loop = calloc(1, sizeof(EventLoop));
+    if (!loop) {
+        perror("calloc EventLoop");
+        return NULL;
+    }
+
+#ifdef EVENT_LOOP_USE_EPOLL
+    loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (loop->epoll_fd == -1) {
+        perror("epoll_create1");
+        free(loop);
+        return NULL;
+    }
+    for (int i = 0; i < MAX_EVENT_TIMERS; i++) {
+        loop->timers[i].fd = -1;
+    }
+#endif
+
+    return loop;
+}
+
+void event_loop_destroy(EventLoop *loop) {
+    if (!loop) return;
+
+    for (int i = 0; i < MAX_EVENT_TIMERS; i++) {
+#ifdef EVENT_LOOP_USE_EPOLL
+        if (loop->timers[i].fd != -1) close(loop->timers[i].fd);
+#endif
+    }
+    for (int i = 0; i < loop->num_sources; i++) {
+        free(loop->sources[i]);
+    }
+    free_dead_sources(loop);
+    free(loop->sources);
+    free(loop->dead);
+
+#ifdef EVENT_LOOP_USE_EPOLL
+    close(loop->epoll_fd);
+#endif
+    free(loop);
+}
+
+int event_loop_add_fd(EventLoop *loop, int fd, int events,
+                      EventFdCallback callback, void *user_data) {
+    if (!loop || fd < 0 || !callback) return -1;
+    if (find_source(loop, fd) != -1) {
+        fprintf(stderr, "[EVENT_LOOP] fd %d is already watched\n", fd);
+        return -1;
+    }
+
+    if (loop->num_sources == loop->capacity) {
+        int new_capacity = loop->capacity ? loop->capacity * 2 : 16;
+        EventSource **grown = realloc(loop->sources, new_capacity * sizeof(EventSource *));
+        if (!grown) {
+            perror("realloc event sources");
+            return -1;
+        }
+        loop->sources = grown;
+        loop->capacity = new_capacity;
+    }
+
+    EventSource *src = malloc(sizeof(EventSource));
+    if (!src) {
+        perror("malloc EventSource");
+        return -1;
+    }
+    src->fd = fd;
+    src->events = events;
+    src->callback = callback;
+    src->user_data = user_data;
+
+#ifdef EVENT_LOOP_USE_EPOLL
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    if (events & EVENT_READ) ev.events |= EPOLLIN;
+    if (events & EVENT_WRITE) ev.events |= EPOLLOUT;
+    ev.data.ptr = src;
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+        fprintf(stderr, "[EVENT_LOOP] epoll_ctl add fd %d: %s\n", fd, strerror(errno));
+        free(src);
+        return -1;
+    }
+#endif
+
+    loop->sources[loop->num_sources++] = src;
+    return 0;
+}
+
+void event_loop_remove_fd(EventLoop *loop, int fd) {
+    if (!loop || fd < 0) return;
+
+    int idx = find_source(loop, fd);
+    if (idx == -1) return;
+
+    EventSource *src = loop->sources[idx];
+#ifdef EVENT_LOOP_USE_EPOLL
+    epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+#endif
+
+    // The source may still be referenced by the batch being dispatched
+    src->fd = -1;
+    if (loop->num_dead == loop->dead_capacity) {
+        int new_capacity = loop->dead_capacity ? loop->dead_capacity * 2 : 8;
+        EventSource **grown = realloc(loop->dead, new_capacity * sizeof(EventSource *));
+        if (!grown) {
+            perror("realloc dead sources");
+            return;  // Leak rather than risk a use-after-free
+        }
+        loop->dead = grown;
+        loop->dead_capacity = new_capacity;
+    }
+    loop->dead[loop->num_dead++] = src;
+
+    loop->sources[idx] = loop->sources[--loop->num_sources];
+}
+
+// ============================================================================
+//  TIMERS
+// ============================================================================
+
+#ifdef EVENT_LOOP_USE_EPOLL
+
+static void timerfd_ready(int fd, int events, void *user_data) {
+    (void)events;
+    EventTimer *timer = (EventTimer *)user_data;
+
+    uint64_t expirations;
+    if (read(fd, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+        return;  // Spurious wakeup or the timer was re-armed meanwhile
+    }
+    if (timer->interval_ms == 0) timer->armed = 0;
+    timer->callback(timer->user_data);
+}
+
+#else
+
+static long long monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+#endif
+
+int event_loop_add_timer(EventLoop *loop, EventTimerCallback callback, void *user_data) {
+    if (!loop || !callback) return -1;
+
+    for (int i = 0; i < MAX_EVENT_TIMERS; i++) {
+        EventTimer *timer = &loop->timers[i];
+        if (timer->in_use) continue;
+
+#ifdef EVENT_LOOP_USE_EPOLL
+        timer->fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (timer->fd == -1) {
+            perror("timerfd_create");
+            return -1;
+        }
+        if (event_loop_add_fd(loop, timer->fd, EVENT_READ, timerfd_ready, timer) == -1) {
+            close(timer->fd);
+            timer->fd = -1;
+            return -1;
+        }
+#endif
+        timer->in_use = 1;
+        timer->armed = 0;
+        timer->callback = callback;
+        timer->user_data = user_data;
+        return i;
+    }
+
+    fprintf(stderr, "[EVENT_LOOP] Out of timers\n");
+    return -1;
+}
+
+void event_loop_arm_timer(EventLoop *loop, int timer_id, int initial_ms, int interval_ms) {
+    if (!loop || timer_id < 0 || timer_id >= MAX_EVENT_TIMERS) return;
+    EventTimer *timer = &loop->timers[timer_id];
+    if (!timer->in_use) return;
+    if (initial_ms <= 0) initial_ms = 1;
+
+#ifdef EVENT_LOOP_USE_EPOLL
+    struct itimerspec spec;
+    spec.it_value.tv_sec = initial_ms / 1000;
+    spec.it_value.tv_nsec = (long)(initial_ms % 1000) * 1000000L;
+    spec.it_interval.tv_sec = interval_ms / 1000;
+    spec.it_interval.tv_nsec = (long)(interval_ms % 1000) * 1000000L;
+    if (timerfd_settime(timer->fd, 0, &spec, NULL) == -1) {
+        perror("timerfd_settime");
+        return;
+    }
+#else
+    timer->deadline_ms = monotonic_ms() + initial_ms;
+#endif
+    timer->interval_ms = interval_ms;
+    timer->armed = 1;
+}
+
+void event_loop_disarm_timer(EventLoop *loop, int timer_id) {
+    if (!loop || timer_id < 0 || timer_id >= MAX_EVENT_TIMERS) return;
+    EventTimer *timer = &loop->timers[timer_id];
+    if (!timer->in_use || !timer->armed) return;
+
+#ifdef EVENT_LOOP_USE_EPOLL
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    timerfd_settime(timer->fd, 0, &spec, NULL);
+#endif
+    timer->armed = 0;
+}
+
+// ============================================================================
+//  DISPATCH
+// ============================================================================
+
+#ifdef EVENT_LOOP_USE_EPOLL
+
+int event_loop_run_once(EventLoop *loop, int timeout_ms) {
+    if (!loop) return -1;
+
+    struct epoll_event events[MAX_EVENTS_PER_WAKE];
+    int n = epoll_wait(loop->epoll_fd, events, MAX_EVENTS_PER_WAKE, timeout_ms);
+    if (n == -1) {
+        if (errno == EINTR) return 0;
+        perror("epoll_wait");
+        return -1;
+    }
+
+    int dispatched = 0;
+    for (int i = 0; i < n; i++) {
+        EventSource *src = events[i].data.ptr;
+        if (src->fd == -1) continue;  // Removed by an earlier callback in this batch
+
+        int ready = 0;
+        if (events[i].events & EPOLLIN) ready |= EVENT_READ;
+        if (events[i].events & EPOLLOUT) ready |= EVENT_WRITE;
+        if (events[i].events & (EPOLLERR | EPOLLHUP)) ready |= EVENT_ERROR;
+
+        src->callback(src->fd, ready, src->user_data);
+        dispatched++;
+    }
+
+    free_dead_sources(loop);
+    return dispatched;
+}
+
+#else
+
+int event_loop_run_once(EventLoop *loop, int timeout_ms) {
+    if (!loop) return -1;
+
+    // Shorten the wait to the nearest armed timer
+    long long now = monotonic_ms();
+    for (int i = 0; i < MAX_EVENT_TIMERS; i++) {
+        EventTimer *timer = &loop->timers[i];
+        if (!timer->in_use || !timer->armed) continue;
+        long long wait = timer->deadline_ms - now;
+        if (wait < 0) wait = 0;
+        if (timeout_ms < 0 || wait < timeout_ms) timeout_ms = (int)wait;
+    }
+
+    int n = loop->num_sources;
+    struct pollfd *fds = NULL;
+    EventSource **batch = NULL;
+    if (n > 0) {
+        fds = malloc(n * sizeof(struct pollfd));
+        batch = malloc(n * sizeof(EventSource *));
+        if (!fds || !batch) {
+            perror("malloc poll set");
+            free(fds);
+            free(batch);
+            return -1;
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        batch[i] = loop->sources[i];
+        fds[i].fd = batch[i]->fd;
+        fds[i].events = 0;
+        if (batch[i]->events & EVENT_READ) fds[i].events |= POLLIN;
+        if (batch[i]->events & EVENT_WRITE) fds[i].events |= POLLOUT;
+        fds[i].revents = 0;
+    }
+
+    int ready_count = poll(fds, n, timeout_ms);
+    if (ready_count == -1 && errno != EINTR) {
+        perror("poll");
+        free(fds);
+        free(batch);
+        return -1;
+    }
+
+    int dispatched = 0;
+    for (int i = 0; i < n && ready_count > 0; i++) {
+        if (!fds[i].revents || batch[i]->fd == -1) continue;
+
+        int ready = 0;
+        if (fds[i].revents & POLLIN) ready |= EVENT_READ;
+        if (fds[i].revents & POLLOUT) ready |= EVENT_WRITE;
+        if (fds[i].revents & (POLLERR | POLLHUP | POLLNVAL)) ready |= EVENT_ERROR;
+
+        batch[i]->callback(batch[i]->fd, ready, batch[i]->user_data);
+        dispatched++;
+    }
+    free(fds);
+    free(batch);
+
+    now = monotonic_ms();
+    for (int i = 0; i < MAX_EVENT_TIMERS; i++) {
+        EventTimer *timer = &loop->timers[i];
+        if (!timer->in_use || !timer->armed || timer->deadline_ms > now) continue;
+
+        if (timer->interval_ms > 0) {
+            timer->deadline_ms = now + timer->interval_ms;
+        } else {
+            timer->armed = 0;
+        }
+        timer->callback(timer->user_data);
+        dispatched++;
+    }
+
+    free_dead_sources(loop);
+    return dispatched;
+}
+
+#endif
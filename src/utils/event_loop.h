@@ -0,0 +1,86 @@
+// src/utils/event_loop.h
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+// Single-threaded reactor. Uses epoll + timerfd on Linux and falls back to
+// poll() with computed timeouts elsewhere (macOS/XQuartz).
+
+#define EVENT_READ  0x1
+#define EVENT_WRITE 0x2
+#define EVENT_ERROR 0x4   // Error or hangup, always reported
+
+#define MAX_EVENT_TIMERS 16
+
+typedef struct EventLoop EventLoop;
+
+/**
+ * @brief Called when a watched descriptor is ready
+ * @param fd The descriptor
+ * @param events EVENT_* bits that are ready
+ * @param user_data Value given at registration
+ */
+typedef void (*EventFdCallback)(int fd, int events, void *user_data);
+
+/**
+ * @brief Called when a timer expires
+ */
+typedef void (*EventTimerCallback)(void *user_data);
+
+/**
+ * @brief Create an empty event loop
+ * @return New loop, or NULL on failure
+ */
+EventLoop* event_loop_create(void);
+
+/**
+ * @brief Destroy the loop and its timers (watched fds are not closed)
+ */
+void event_loop_destroy(EventLoop *loop);
+
+/**
+ * @brief Watch a descriptor
+ * @param loop Event loop
+ * @param fd Descriptor to watch (must not already be watched)
+ * @param events EVENT_READ and/or EVENT_WRITE
+ * @param callback Called when the descriptor is ready
+ * @param user_data Passed to callback
+ * @return 0 on success, -1 on failure
+ */
+int event_loop_add_fd(EventLoop *loop, int fd, int events,
+                      EventFdCallback callback, void *user_data);
+
+/**
+ * @brief Stop watching a descriptor. Safe to call from inside a callback.
+ * Call this before closing the descriptor.
+ */
+void event_loop_remove_fd(EventLoop *loop, int fd);
+
+/**
+ * @brief Create a (disarmed) timer
+ * @return Timer id, or -1 on failure
+ */
+int event_loop_add_timer(EventLoop *loop, EventTimerCallback callback, void *user_data);
+
+/**
+ * @brief Arm a timer
+ * @param loop Event loop
+ * @param timer_id Id from event_loop_add_timer
+ * @param initial_ms Delay until the first expiry (must be > 0)
+ * @param interval_ms Period after that, or 0 for a one-shot timer
+ */
+void event_loop_arm_timer(EventLoop *loop, int timer_id, int initial_ms, int interval_ms);
+
+/**
+ * @brief Disarm a timer without destroying it
+ */
+void event_loop_disarm_timer(EventLoop *loop, int timer_id);
+
+/**
+ * @brief Wait for events and dispatch their callbacks once
+ * @param loop Event loop
+ * @param timeout_ms Maximum time to block, or -1 to block until something happens
+ * @return Number of callbacks dispatched, or -1 on error
+ */
+int event_loop_run_once(EventLoop *loop, int timeout_ms);
+
+#endif // EVENT_LOOP_H
@@ -0,0 +1,89 @@
+// src/utils/fuzzy_match.c
+#include "fuzzy_match.h"
+#include <string.h>
+
+void fuzzy_pattern_init(FuzzyPattern *fp, const char *pattern, size_t len) {
+    fp->pattern = pattern;
+    fp->len = len;
+    memset(fp->masks, 0, sizeof(fp->masks));
+    if (len == 0 || len > FUZZY_MAX_FAST) {
+        fp->slices = 0;
+        return;
+    }
+    fp->slices = 64 - __builtin_clzll((unsigned long long)len);
+    for (size_t i = 0; i < len; i++) {
+        fp->masks[(unsigned char)pattern[i]] |= 1ULL << i;
+    }
+}
+
+size_t fuzzy_longest_common_reference(const char *a, size_t a_len, const char *b, size_t b_len) {
+    size_t best = 0;
+    // Diagonal d pairs a[i] with b[i + d]
+    for (long long d = -(long long)a_len + 1; d < (long long)b_len; d++) {
+        size_t i = d < 0 ? (size_t)-d : 0;
+        size_t j = (size_t)((long long)i + d);
+        // Nothing longer is left on this diagonal
+        size_t room = a_len - i < b_len - j ? a_len - i : b_len - j;
+        if (room <= best) continue;
+        size_t run = 0;
+        for (; i < a_len && j < b_len; i++, j++) {
+            if (a[i] == b[j]) {
+                if (++run > best) best = run;
+            } else {
+                run = 0;
+            }
+        }
+    }
+    return best;
+}
+
+// The bit-parallel scan, for a fixed number of slices so the loops unroll
+static inline __attribute__((always_inline))
+size_t scan_sliced(const FuzzyPattern *fp, const char *text, size_t len, const int slices) {
+    // run[s] holds bit s of the length of the match ending at each pattern
+    // byte and the current text byte
+    uint64_t run[7] = { 0 };
+    size_t best = 0;
+    for (size_t j = 0; j < len; j++) {
+        uint64_t match = fp->masks[(unsigned char)text[j]];
+        if (!match) {
+            // Not in the term (most bytes, for a short one): every run ends
+            for (int s = 0; s < slices; s++) run[s] = 0;
+            continue;
+        }
+        // Step along the diagonals, ending the runs that don't match here
+        for (int s = 0; s < slices; s++) run[s] = (run[s] << 1) & match;
+        // Add one to those that do
+        uint64_t carry = match;
+        for (int s = 0; s < slices; s++) {
+            uint64_t next = run[s] & carry;
+            run[s] ^= carry;
+            carry = next;
+        }
+        // A run can only have grown by one, so compare with best + 1
+        uint64_t longer = match;
+        size_t target = best + 1;
+        for (int s = 0; s < slices; s++) {
+            longer &= (target >> s) & 1 ? run[s] : ~run[s];
+        }
+        if (longer) {
+            if (++best == fp->len) break;
+        }
+    }
+    return best;
+}
+
+size_t fuzzy_longest_common(const FuzzyPattern *fp, const char *text, size_t len) {
+    if (fp->len == 0 || len == 0) return 0;
+    switch (fp->slices) {
+    case 1: return scan_sliced(fp, text, len, 1);
+    case 2: return scan_sliced(fp, text, len, 2);
+    case 3: return scan_sliced(fp, text, len, 3);
+    case 4: return scan_sliced(fp, text, len, 4);
+    case 5: return scan_sliced(fp, text, len, 5);
+    case 6: return scan_sliced(fp, text, len, 6);
+    case 7: return scan_sliced(fp, text, len, 7);
+    default:    // Longer than FUZZY_MAX_FAST
+        return fuzzy_longest_common_reference(fp->pattern, fp->len, text, len);
+    }
+}
@@ -0,0 +1,45 @@
+// src/utils/fuzzy_match.h
+#ifndef FUZZY_MATCH_H
+#define FUZZY_MATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Scores history entries against a search term by the length of the
+// longest substring they have in common. For terms up to 64 bytes, each
+// byte of the entry updates the length of the match along every diagonal
+// at once: the lengths are kept bit-sliced (bit i of slice s is bit s of
+// the length ending at term byte i), so a byte costs a few dozen word
+// operations whatever the term. Longer terms, and the reference the fast
+// path is checked against, walk the diagonals one byte at a time with no
+// memory at all.
+
+#define FUZZY_MAX_FAST 64
+
+// A search term, compiled once per search
+typedef struct {
+    const char *pattern;        // Not copied
+    size_t len;
+    int slices;                 // Bits needed for a length up to len (0 past FUZZY_MAX_FAST)
+    uint64_t masks[256];        // Bit i of masks[c] is set if pattern[i] == c
+} FuzzyPattern;
+
+/**
+ * @brief Compile a search term
+ * @param fp Receives it
+ * @param pattern The term (kept, not copied)
+ * @param len Its length
+ */
+void fuzzy_pattern_init(FuzzyPattern *fp, const char *pattern, size_t len);
+
+/**
+ * @brief Length of the longest substring the term and text have in common
+ */
+size_t fuzzy_longest_common(const FuzzyPattern *fp, const char *text, size_t len);
+
+/**
+ * @brief The same, one byte at a time (the reference)
+ */
+size_t fuzzy_longest_common_reference(const char *a, size_t a_len, const char *b, size_t b_len);
+
+#endif // FUZZY_MATCH_H
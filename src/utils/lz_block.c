@@ -0,0 +1,132 @@
+// src/utils/lz_block.c
+#include "lz_block.h"
+#include <stdint.h>
+#include <string.h>
+
+#define MIN_MATCH 4
+#define HASH_BITS 13
+#define LAST_LITERALS 5     // Matches stop this far from the end
+
+static uint32_t read32(const char *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint32_t hash4(uint32_t v) {
+    return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// Writes a length that didn't fit in its nibble: 255s, then the remainder
+static char* put_length(char *op, char *end, size_t len) {
+    while (len >= 255) {
+        if (op >= end) return NULL;
+        *op++ = (char)255;
+        len -= 255;
+    }
+    if (op >= end) return NULL;
+    *op++ = (char)len;
+    return op;
+}
+
+// Emits one sequence; offset 0 marks the last one (literals only)
+static char* put_sequence(char *op, char *end, const char *literals, size_t num_literals,
+                          size_t offset, size_t match_len) {
+    if (op >= end) return NULL;
+    char *token = op++;
+    size_t extra = offset ? match_len - MIN_MATCH : 0;
+    *token = (char)(((num_literals < 15 ? num_literals : 15) << 4) | (extra < 15 ? extra : 15));
+
+    if (num_literals >= 15 && !(op = put_length(op, end, num_literals - 15))) return NULL;
+    if ((size_t)(end - op) < num_literals) return NULL;
+    memcpy(op, literals, num_literals);
+    op += num_literals;
+    if (!offset) return op;
+
+    if (end - op < 2) return NULL;
+    *op++ = (char)(offset & 0xff);
+    *op++ = (char)(offset >> 8);
+    if (extra >= 15 && !(op = put_length(op, end, extra - 15))) return NULL;
+    return op;
+}
+
+size_t lz_block_compress(const char *src, size_t len, char *dst, size_t capacity) {
+    if (len > LZ_BLOCK_MAX_INPUT) return 0;
+    uint32_t table[1 << HASH_BITS];   // Position + 1 of the last 4 bytes with this hash
+    memset(table, 0, sizeof(table));
+
+    char *op = dst, *end = dst + capacity;
+    size_t ip = 0, anchor = 0;
+    size_t limit = len > LAST_LITERALS + MIN_MATCH ? len - LAST_LITERALS - MIN_MATCH : 0;
+
+    while (ip < limit) {
+        uint32_t seq = read32(src + ip);
+        uint32_t h = hash4(seq);
+        size_t ref = table[h];
+        table[h] = (uint32_t)ip + 1;
+
+        if (ref == 0 || read32(src + ref - 1) != seq) {
+            // Skip faster through input that doesn't match
+            ip += 1 + ((ip - anchor) >> 6);
+            continue;
+        }
+        ref--;
+
+        size_t match_len = MIN_MATCH;
+        while (ip + match_len < len - LAST_LITERALS && src[ref + match_len] == src[ip + match_len]) {
+            match_len++;
+        }
+        op = put_sequence(op, end, src + anchor, ip - anchor, ip - ref, match_len);
+        if (!op) return 0;
+        ip += match_len;
+        anchor = ip;
+    }
+
+    op = put_sequence(op, end, src + anchor, len - anchor, 0, 0);
+    return op ? (size_t)(op - dst) : 0;
+}
+
+// Reads the rest of a length whose nibble was 15
+static int get_length(const unsigned char **ip, const unsigned char *end, size_t *len) {
+    unsigned char b;
+    do {
+        if (*ip >= end) return -1;
+        b = *(*ip)++;
+        *len += b;
+    } while (b == 255);
+    return 0;
+}
+
+long lz_block_decompress(const char *src, size_t len, char *dst, size_t capacity) {
+    const unsigned char *ip = (const unsigned char *)src, *end = ip + len;
+    size_t out = 0;
+
+    while (ip < end) {
+        unsigned token = *ip++;
+        size_t num_literals = token >> 4;
+        if (num_literals == 15 && get_length(&ip, end, &num_literals) == -1) return -1;
+        if ((size_t)(end - ip) < num_literals || capacity - out < num_literals) return -1;
+        memcpy(dst + out, ip, num_literals);
+        ip += num_literals;
+        out += num_literals;
+        if (ip == end) break;   // The last sequence
+
+        if (end - ip < 2) return -1;
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        size_t match_len = token & 15;
+        if (match_len == 15 && get_length(&ip, end, &match_len) == -1) return -1;
+        match_len += MIN_MATCH;
+        if (offset == 0 || offset > out || capacity - out < match_len) return -1;
+
+        // A match closer than its length repeats what it produces: byte by byte
+        const char *from = dst + out - offset;
+        if (offset >= match_len) {
+            memcpy(dst + out, from, match_len);
+        } else {
+            for (size_t i = 0; i < match_len; i++) dst[out + i] = from[i];
+        }
+        out += match_len;
+    }
+    return (long)out;
+}
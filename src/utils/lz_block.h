@@ -0,0 +1,45 @@
+// src/utils/lz_block.h
+#ifndef LZ_BLOCK_H
+#define LZ_BLOCK_H
+
+#include <stddef.h>
+
+// Byte-oriented LZ77 block compression in the style of LZ4: fast enough to
+// keep up with a terminal's output on one core, and good at the repetitive
+// text (compiler and log output) that fills scrollback. Blocks are at most
+// LZ_BLOCK_MAX_INPUT bytes, so match offsets fit in 16 bits.
+//
+// A block is a series of sequences: a token byte (literal count in the high
+// nibble, match length - 4 in the low one, 15 meaning more length bytes
+// follow), the literals, then a 2-byte little-endian offset back into the
+// output. The last sequence has literals only.
+
+#define LZ_BLOCK_MAX_INPUT 65536
+
+/**
+ * @brief Worst-case compressed size of len bytes
+ */
+#define LZ_BLOCK_BOUND(len) ((len) + (len) / 255 + 16)
+
+/**
+ * @brief Compress a block
+ * @param src Input, at most LZ_BLOCK_MAX_INPUT bytes
+ * @param len Input length
+ * @param dst Output buffer
+ * @param capacity Size of dst
+ * @return Compressed size, or 0 if it would not fit in capacity (pass
+ * len - 1 to find out whether compressing is worth it at all)
+ */
+size_t lz_block_compress(const char *src, size_t len, char *dst, size_t capacity);
+
+/**
+ * @brief Decompress a block
+ * @param src Compressed block
+ * @param len Its size
+ * @param dst Output buffer
+ * @param capacity Size of dst
+ * @return Decompressed size, or -1 if the block is corrupt or doesn't fit
+ */
+long lz_block_decompress(const char *src, size_t len, char *dst, size_t capacity);
+
+#endif // LZ_BLOCK_H
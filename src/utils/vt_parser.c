@@ -0,0 +1,229 @@
+// src/utils/vt_parser.c
+#include "vt_parser.h"
+#include "byte_scan.h"
+#include <stdint.h>
+#include <string.h>
+
+#define VT_PARAM_MAX 65535
+
+typedef enum {
+    ACT_NONE,
+    ACT_PRINT,
+    ACT_EXECUTE,
+    ACT_COLLECT,
+    ACT_PARAM,
+    ACT_ESC_DISPATCH,
+    ACT_CSI_DISPATCH,
+    ACT_OSC_PUT
+} VtAction;
+
+// Entry layout: action in bits 0-3, next state in bits 4-7, and bit 8 set
+// when the byte leaves the state (so exit/entry actions run)
+#define ENTRY(action, next) ((uint16_t)((action) | ((next) << 4) | 0x100))
+#define STAY(action, state) ((uint16_t)((action) | ((state) << 4)))
+
+static uint16_t g_table[VT_NUM_STATES][256];
+static int g_table_ready = 0;
+
+static void stay(VtState s, int from, int to, VtAction action) {
+    for (int c = from; c <= to; c++) g_table[s][c] = STAY(action, s);
+}
+
+static void go(VtState s, int from, int to, VtAction action, VtState next) {
+    for (int c = from; c <= to; c++) g_table[s][c] = ENTRY(action, next);
+}
+
+// C0 controls other than the ones every state treats the same (CAN, SUB, ESC)
+static void c0(VtState s, VtAction action) {
+    stay(s, 0x00, 0x17, action);
+    stay(s, 0x19, 0x19, action);
+    stay(s, 0x1c, 0x1f, action);
+}
+
+static void build_table(void) {
+    for (int s = 0; s < VT_NUM_STATES; s++) {
+        stay(s, 0x00, 0xff, ACT_NONE);
+        c0(s, ACT_EXECUTE);
+        go(s, 0x18, 0x18, ACT_EXECUTE, VT_GROUND);
+        go(s, 0x1a, 0x1a, ACT_EXECUTE, VT_GROUND);
+        go(s, 0x1b, 0x1b, ACT_NONE, VT_ESCAPE);
+    }
+
+    // 0x80-0xFF is UTF-8 here, not 8-bit C1 controls
+    stay(VT_GROUND, 0x20, 0x7e, ACT_PRINT);
+    stay(VT_GROUND, 0x80, 0xff, ACT_PRINT);
+
+    go(VT_ESCAPE, 0x20, 0x2f, ACT_COLLECT, VT_ESCAPE_INTERMEDIATE);
+    go(VT_ESCAPE, 0x30, 0x7e, ACT_ESC_DISPATCH, VT_GROUND);
+    go(VT_ESCAPE, 0x5b, 0x5b, ACT_NONE, VT_CSI_ENTRY);
+    go(VT_ESCAPE, 0x5d, 0x5d, ACT_NONE, VT_OSC_STRING);
+    go(VT_ESCAPE, 0x50, 0x50, ACT_NONE, VT_DCS_ENTRY);
+    go(VT_ESCAPE, 0x58, 0x58, ACT_NONE, VT_SOS_PM_APC_STRING);
+    go(VT_ESCAPE, 0x5e, 0x5f, ACT_NONE, VT_SOS_PM_APC_STRING);
+
+    stay(VT_ESCAPE_INTERMEDIATE, 0x20, 0x2f, ACT_COLLECT);
+    go(VT_ESCAPE_INTERMEDIATE, 0x30, 0x7e, ACT_ESC_DISPATCH, VT_GROUND);
+
+    // Sub-parameters (38:5:n) are read as if ':' were ';'
+    go(VT_CSI_ENTRY, 0x20, 0x2f, ACT_COLLECT, VT_CSI_INTERMEDIATE);
+    go(VT_CSI_ENTRY, 0x30, 0x3b, ACT_PARAM, VT_CSI_PARAM);
+    go(VT_CSI_ENTRY, 0x3c, 0x3f, ACT_COLLECT, VT_CSI_PARAM);
+    go(VT_CSI_ENTRY, 0x40, 0x7e, ACT_CSI_DISPATCH, VT_GROUND);
+
+    stay(VT_CSI_PARAM, 0x30, 0x3b, ACT_PARAM);
+    go(VT_CSI_PARAM, 0x3c, 0x3f, ACT_NONE, VT_CSI_IGNORE);
+    go(VT_CSI_PARAM, 0x20, 0x2f, ACT_COLLECT, VT_CSI_INTERMEDIATE);
+    go(VT_CSI_PARAM, 0x40, 0x7e, ACT_CSI_DISPATCH, VT_GROUND);
+
+    stay(VT_CSI_INTERMEDIATE, 0x20, 0x2f, ACT_COLLECT);
+    go(VT_CSI_INTERMEDIATE, 0x30, 0x3f, ACT_NONE, VT_CSI_IGNORE);
+    go(VT_CSI_INTERMEDIATE, 0x40, 0x7e, ACT_CSI_DISPATCH, VT_GROUND);
+
+    go(VT_CSI_IGNORE, 0x40, 0x7e, ACT_NONE, VT_GROUND);
+
+    // Device control strings are recognised so they can be skipped whole
+    for (int s = VT_DCS_ENTRY; s <= VT_SOS_PM_APC_STRING; s++) c0(s, ACT_NONE);
+    go(VT_DCS_ENTRY, 0x20, 0x2f, ACT_NONE, VT_DCS_INTERMEDIATE);
+    go(VT_DCS_ENTRY, 0x30, 0x3f, ACT_NONE, VT_DCS_PARAM);
+    go(VT_DCS_ENTRY, 0x40, 0x7e, ACT_NONE, VT_DCS_PASSTHROUGH);
+    go(VT_DCS_PARAM, 0x20, 0x2f, ACT_NONE, VT_DCS_INTERMEDIATE);
+    go(VT_DCS_PARAM, 0x40, 0x7e, ACT_NONE, VT_DCS_PASSTHROUGH);
+    go(VT_DCS_INTERMEDIATE, 0x30, 0x3f, ACT_NONE, VT_DCS_IGNORE);
+    go(VT_DCS_INTERMEDIATE, 0x40, 0x7e, ACT_NONE, VT_DCS_PASSTHROUGH);
+
+    // OSC ends at ST (ESC \) or, as xterm allows, BEL
+    stay(VT_OSC_STRING, 0x20, 0xff, ACT_OSC_PUT);
+    go(VT_OSC_STRING, 0x07, 0x07, ACT_NONE, VT_GROUND);
+
+    g_table_ready = 1;
+}
+
+void vt_parser_init(VtParser *parser, const VtHandler *handler, void *user_data) {
+    if (!g_table_ready) build_table();
+    memset(parser, 0, sizeof(*parser));
+    parser->state = VT_GROUND;
+    parser->handler = handler;
+    parser->user_data = user_data;
+}
+
+static void clear_sequence(VtParser *parser) {
+    parser->num_params = 0;
+    parser->num_intermediates = 0;
+    parser->ignoring = 0;
+}
+
+static inline void put_param(VtParser *parser, unsigned char c) {
+    if (parser->num_params == 0) parser->params[parser->num_params++] = -1;
+
+    if (c == ';' || c == ':') {
+        if (parser->num_params < VT_MAX_PARAMS) parser->params[parser->num_params++] = -1;
+        return;
+    }
+
+    int *param = &parser->params[parser->num_params - 1];
+    int value = (*param < 0 ? 0 : *param) * 10 + (c - '0');
+    *param = value > VT_PARAM_MAX ? VT_PARAM_MAX : value;
+}
+
+static void collect(VtParser *parser, unsigned char c) {
+    if (parser->num_intermediates < VT_MAX_INTERMEDIATES) {
+        parser->intermediates[parser->num_intermediates++] = (char)c;
+    } else {
+        parser->ignoring = 1;
+    }
+}
+
+static inline void run_action(VtParser *parser, VtAction action, unsigned char c) {
+    const VtHandler *h = parser->handler;
+
+    switch (action) {
+        case ACT_NONE:
+            break;
+        case ACT_PRINT:
+            h->print(parser->user_data, (const char *)&c, 1);
+            break;
+        case ACT_EXECUTE:
+            h->execute(parser->user_data, c);
+            break;
+        case ACT_COLLECT:
+            collect(parser, c);
+            break;
+        case ACT_PARAM:
+            put_param(parser, c);
+            break;
+        case ACT_ESC_DISPATCH:
+            if (!parser->ignoring) h->esc_dispatch(parser->user_data, parser, c);
+            break;
+        case ACT_CSI_DISPATCH:
+            if (!parser->ignoring) h->csi_dispatch(parser->user_data, parser, c);
+            break;
+        case ACT_OSC_PUT:
+            if (parser->osc_len < VT_MAX_OSC) parser->osc[parser->osc_len++] = (char)c;
+            break;
+    }
+}
+
+static void transition(VtParser *parser, uint16_t entry, unsigned char c) {
+    VtState next = (VtState)((entry >> 4) & 0x0f);
+
+    if (parser->state == VT_OSC_STRING && parser->handler->osc_dispatch) {
+        parser->handler->osc_dispatch(parser->user_data, parser->osc, parser->osc_len);
+    }
+
+    run_action(parser, (VtAction)(entry & 0x0f), c);
+    parser->state = next;
+
+    switch (next) {
+        case VT_ESCAPE:
+        case VT_CSI_ENTRY:
+        case VT_DCS_ENTRY:
+            clear_sequence(parser);
+            break;
+        case VT_OSC_STRING:
+            parser->osc_len = 0;
+            break;
+        default:
+            break;
+    }
+}
+
+void vt_parser_feed(VtParser *parser, const char *data, size_t len) {
+    const unsigned char *p = (const unsigned char *)data;
+    const unsigned char *end = p + len;
+
+    while (p < end) {
+        if (parser->state == VT_GROUND) {
+            // Text is by far the common case: hand it over a run at a time
+            const unsigned char *run = p;
+            p += byte_scan_text((const char *)p, (size_t)(end - p));
+            if (p > run) parser->handler->print(parser->user_data, (const char *)run, (size_t)(p - run));
+            if (p == end) break;
+        }
+
+        unsigned char c = *p++;
+        uint16_t entry = g_table[parser->state][c];
+
+        if ((entry & 0x0f) == ACT_PARAM) {
+            // Parameters come in runs of digits and separators
+            put_param(parser, c);
+            parser->state = (VtState)((entry >> 4) & 0x0f);
+            while (p < end && ((*p >= '0' && *p <= '9') || *p == ';')) put_param(parser, *p++);
+        } else if (entry & 0x100) {
+            transition(parser, entry, c);
+        } else {
+            run_action(parser, (VtAction)(entry & 0x0f), c);
+        }
+    }
+}
+
+int vt_param(const VtParser *parser, int index, int fallback) {
+    if (index >= parser->num_params) return fallback;
+    int value = parser->params[index];
+    return value > 0 ? value : fallback;
+}
+
+char vt_private_marker(const VtParser *parser) {
+    if (parser->num_intermediates == 0) return 0;
+    char c = parser->intermediates[0];
+    return (c >= 0x3c && c <= 0x3f) ? c : 0;
+}
@@ -0,0 +1,94 @@
+// src/utils/vt_parser.h
+#ifndef VT_PARSER_H
+#define VT_PARSER_H
+
+#include <stddef.h>
+
+// DEC VT500-series escape sequence parser after Paul Williams' state
+// diagram (vt100.net/emu/dec_ansi_parser). Each state has a 256-entry
+// transition table giving the action and next state for a byte, so a byte
+// costs one lookup; runs of printable text in the ground state are handed
+// over whole. Bytes 0x80-0xFF are printable (UTF-8) rather than C1 controls.
+//
+// The parser only recognises sequences; what they mean is up to the
+// VtHandler callbacks.
+
+#define VT_MAX_PARAMS 16
+#define VT_MAX_INTERMEDIATES 2
+#define VT_MAX_OSC 512
+
+typedef enum {
+    VT_GROUND,
+    VT_ESCAPE,
+    VT_ESCAPE_INTERMEDIATE,
+    VT_CSI_ENTRY,
+    VT_CSI_PARAM,
+    VT_CSI_INTERMEDIATE,
+    VT_CSI_IGNORE,
+    VT_DCS_ENTRY,
+    VT_DCS_PARAM,
+    VT_DCS_INTERMEDIATE,
+    VT_DCS_PASSTHROUGH,
+    VT_DCS_IGNORE,
+    VT_OSC_STRING,
+    VT_SOS_PM_APC_STRING,
+    VT_NUM_STATES
+} VtState;
+
+struct VtParser;
+
+typedef struct {
+    // Printable bytes, in as long runs as the input allows
+    void (*print)(void *user_data, const char *text, size_t len);
+    // A C0 control (LF, CR, BS, TAB, BEL...)
+    void (*execute)(void *user_data, unsigned char c);
+    // A complete CSI sequence; params, intermediates (including a private
+    // marker such as '?') are in the parser
+    void (*csi_dispatch)(void *user_data, const struct VtParser *parser, unsigned char final);
+    // A complete escape sequence (ESC 7, ESC M, ESC ( B...)
+    void (*esc_dispatch)(void *user_data, const struct VtParser *parser, unsigned char final);
+    // An operating system command (window title...), may be NULL
+    void (*osc_dispatch)(void *user_data, const char *data, size_t len);
+} VtHandler;
+
+typedef struct VtParser {
+    VtState state;
+    int params[VT_MAX_PARAMS];  // -1 = omitted (use the default)
+    int num_params;
+    char intermediates[VT_MAX_INTERMEDIATES];
+    int num_intermediates;
+    int ignoring;               // Too many intermediates: dispatch nothing
+    char osc[VT_MAX_OSC];
+    size_t osc_len;
+    const VtHandler *handler;
+    void *user_data;
+} VtParser;
+
+/**
+ * @brief Set up a parser in the ground state
+ * @param parser Parser
+ * @param handler Callbacks (must stay valid)
+ * @param user_data Passed to every callback
+ */
+void vt_parser_init(VtParser *parser, const VtHandler *handler, void *user_data);
+
+/**
+ * @brief Parse bytes; sequences may be split across calls
+ */
+void vt_parser_feed(VtParser *parser, const char *data, size_t len);
+
+/**
+ * @brief A parameter of the sequence being dispatched
+ * @param parser Parser
+ * @param index Which one, from 0
+ * @param fallback Value if it is missing or 0 (pass 0 to keep 0)
+ */
+int vt_param(const VtParser *parser, int index, int fallback);
+
+/**
+ * @brief Private marker of the CSI sequence being dispatched ('?', '>'...),
+ * or 0 if there is none
+ */
+char vt_private_marker(const VtParser *parser);
+
+#endif // VT_PARSER_H